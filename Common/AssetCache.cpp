@@ -0,0 +1,56 @@
+﻿#include "AssetCache.h"
+
+using namespace DX;
+
+AssetCache::AssetCache() :
+	m_hits(0),
+	m_misses(0)
+{
+}
+
+// Counts a hit or a miss.
+const std::shared_ptr<const void>* AssetCache::Find(std::wstring const& name, std::type_info const& type)
+{
+	auto found = m_assets.find(name);
+	if (found == m_assets.end())
+	{
+		++m_misses;
+		return nullptr;
+	}
+
+	if (found->second.Type != std::type_index(type))
+	{
+		throw std::logic_error("Asset was cached as a different type.");
+	}
+	++m_hits;
+	return &found->second.Asset;
+}
+
+void AssetCache::Add(std::wstring const& name, std::type_info const& type, std::shared_ptr<const void> asset)
+{
+	Entry entry{ std::move(asset), std::type_index(type) };
+	auto inserted = m_assets.emplace(name, entry);
+	if (!inserted.second)
+	{
+		inserted.first->second = entry;
+	}
+}
+
+void AssetCache::Remove(std::wstring const& name)
+{
+	m_assets.erase(name);
+}
+
+void AssetCache::Clear()
+{
+	m_assets.clear();
+}
+
+AssetCacheStatistics AssetCache::GetStatistics() const
+{
+	AssetCacheStatistics statistics;
+	statistics.Hits = m_hits;
+	statistics.Misses = m_misses;
+	statistics.AssetCount = static_cast<uint32_t>(m_assets.size());
+	return statistics;
+}
@@ -0,0 +1,67 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+
+namespace DX
+{
+	struct AssetCacheStatistics
+	{
+		uint64_t	Hits;
+		uint64_t	Misses;
+		uint32_t	AssetCount;
+	};
+
+	// Device-independent assets, such as decoded textures, built meshes and serialized
+	// blobs, kept by name for as long as the cache lives. Owned outside the renderers, so
+	// that a renderer recreated after the device is removed only has to upload them again.
+	// Not thread-safe.
+	class AssetCache
+	{
+	public:
+		AssetCache();
+
+		AssetCache(AssetCache const&) = delete;
+		AssetCache& operator=(AssetCache const&) = delete;
+
+		// Returns the asset cached under the name, or on a miss caches what create returns.
+		// Nothing is cached if create throws. A name has to be asked for as the same type
+		// every time.
+		template<typename T, typename Create>
+		std::shared_ptr<const T> GetOrCreate(std::wstring const& name, Create&& create)
+		{
+			if (const std::shared_ptr<const void>* asset = Find(name, typeid(T)))
+			{
+				return std::static_pointer_cast<const T>(*asset);
+			}
+
+			std::shared_ptr<const T> asset = create();
+			Add(name, typeid(T), asset);
+			return asset;
+		}
+
+		void Remove(std::wstring const& name);
+		void Clear();
+
+		AssetCacheStatistics GetStatistics() const;
+
+	private:
+		struct Entry
+		{
+			std::shared_ptr<const void>	Asset;
+			std::type_index				Type;
+		};
+
+		const std::shared_ptr<const void>* Find(std::wstring const& name, std::type_info const& type);
+		void Add(std::wstring const& name, std::type_info const& type, std::shared_ptr<const void> asset);
+
+		std::unordered_map<std::wstring, Entry>	m_assets;
+		uint64_t								m_hits;
+		uint64_t								m_misses;
+	};
+}
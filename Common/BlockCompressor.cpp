@@ -0,0 +1,816 @@
+﻿#include "BlockCompressor.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace DX;
+
+namespace
+{
+	// One 4x4 block as planes of R, G, B and A, so four texels fill a vector.
+	struct BlockTexels
+	{
+		float C[4][16];
+	};
+
+	// A pair of endpoints in 0-255 space. Palette entries interpolate from First to Second.
+	struct Endpoints
+	{
+		float First[4];
+		float Second[4];
+	};
+
+	typedef float Palette[16][4];
+
+	// Rows of blocks handed to each task by CompressAsync.
+	const uint32_t c_blockRowsPerTask = 8;
+
+	// Interpolation weights, in 64ths, for BC7's 4-bit indices.
+	const int c_bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// Position between First and Second of each BC1 colour index.
+	const float c_bc1Positions[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+	void LoadBlock(const uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch, uint32_t blockX, uint32_t blockY, BlockTexels& block)
+	{
+		for (uint32_t y = 0; y < 4; ++y)
+		{
+			const uint8_t* row = pixels + std::min(blockY * 4 + y, height - 1) * rowPitch;
+			for (uint32_t x = 0; x < 4; ++x)
+			{
+				const uint8_t* texel = row + std::min(blockX * 4 + x, width - 1) * 4;
+				const uint32_t i = y * 4 + x;
+				block.C[0][i] = texel[2];
+				block.C[1][i] = texel[1];
+				block.C[2][i] = texel[0];
+				block.C[3][i] = texel[3];
+			}
+		}
+	}
+
+	void ComputeBoundingBox(const BlockTexels& block, int firstChannel, int channelCount, Endpoints& endpoints)
+	{
+		for (int c = firstChannel; c < firstChannel + channelCount; ++c)
+		{
+			const float* plane = block.C[c];
+#if DX_SIMD_SSE2
+			__m128 low = _mm_min_ps(_mm_min_ps(_mm_loadu_ps(plane), _mm_loadu_ps(plane + 4)), _mm_min_ps(_mm_loadu_ps(plane + 8), _mm_loadu_ps(plane + 12)));
+			__m128 high = _mm_max_ps(_mm_max_ps(_mm_loadu_ps(plane), _mm_loadu_ps(plane + 4)), _mm_max_ps(_mm_loadu_ps(plane + 8), _mm_loadu_ps(plane + 12)));
+			low = _mm_min_ps(low, _mm_shuffle_ps(low, low, _MM_SHUFFLE(1, 0, 3, 2)));
+			low = _mm_min_ps(low, _mm_shuffle_ps(low, low, _MM_SHUFFLE(2, 3, 0, 1)));
+			high = _mm_max_ps(high, _mm_shuffle_ps(high, high, _MM_SHUFFLE(1, 0, 3, 2)));
+			high = _mm_max_ps(high, _mm_shuffle_ps(high, high, _MM_SHUFFLE(2, 3, 0, 1)));
+			endpoints.First[c] = _mm_cvtss_f32(low);
+			endpoints.Second[c] = _mm_cvtss_f32(high);
+#elif DX_SIMD_NEON
+			float32x4_t low = vminq_f32(vminq_f32(vld1q_f32(plane), vld1q_f32(plane + 4)), vminq_f32(vld1q_f32(plane + 8), vld1q_f32(plane + 12)));
+			float32x4_t high = vmaxq_f32(vmaxq_f32(vld1q_f32(plane), vld1q_f32(plane + 4)), vmaxq_f32(vld1q_f32(plane + 8), vld1q_f32(plane + 12)));
+			float32x2_t lowPair = vpmin_f32(vget_low_f32(low), vget_high_f32(low));
+			float32x2_t highPair = vpmax_f32(vget_low_f32(high), vget_high_f32(high));
+			endpoints.First[c] = vget_lane_f32(vpmin_f32(lowPair, lowPair), 0);
+			endpoints.Second[c] = vget_lane_f32(vpmax_f32(highPair, highPair), 0);
+#else
+			endpoints.First[c] = *std::min_element(plane, plane + 16);
+			endpoints.Second[c] = *std::max_element(plane, plane + 16);
+#endif
+		}
+	}
+
+	// Pulls the endpoints in by a sixteenth of the range, so that the interpolated entries
+	// land nearer the bulk of the texels rather than the outliers.
+	void InsetBoundingBox(int firstChannel, int channelCount, Endpoints& endpoints)
+	{
+		for (int c = firstChannel; c < firstChannel + channelCount; ++c)
+		{
+			float inset = (endpoints.Second[c] - endpoints.First[c]) / 16.0f;
+			endpoints.First[c] += inset;
+			endpoints.Second[c] -= inset;
+		}
+	}
+
+	// The bounding box only gives each channel's range; the colours may run along any of its
+	// diagonals. Takes green as the reference and swaps the ends of every other channel that
+	// falls as green rises, judged by the sign of its covariance with green about the box
+	// centre.
+	void SelectBoundingBoxDiagonal(const BlockTexels& block, int channelCount, Endpoints& endpoints)
+	{
+		const float greenCenter = 0.5f * (endpoints.First[1] + endpoints.Second[1]);
+		for (int c = 0; c < channelCount; ++c)
+		{
+			if (c == 1)
+			{
+				continue;
+			}
+			const float center = 0.5f * (endpoints.First[c] + endpoints.Second[c]);
+			const float* green = block.C[1];
+			const float* plane = block.C[c];
+#if DX_SIMD_SSE2
+			__m128 sum = _mm_setzero_ps();
+			for (int i = 0; i < 16; i += 4)
+			{
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(green + i), _mm_set1_ps(greenCenter)), _mm_sub_ps(_mm_loadu_ps(plane + i), _mm_set1_ps(center))));
+			}
+			sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+			sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 1, 1, 1)));
+			const float covariance = _mm_cvtss_f32(sum);
+#elif DX_SIMD_NEON
+			float32x4_t sum = vdupq_n_f32(0.0f);
+			for (int i = 0; i < 16; i += 4)
+			{
+				sum = vmlaq_f32(sum, vsubq_f32(vld1q_f32(green + i), vdupq_n_f32(greenCenter)), vsubq_f32(vld1q_f32(plane + i), vdupq_n_f32(center)));
+			}
+			float32x2_t pair = vpadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+			const float covariance = vget_lane_f32(vpadd_f32(pair, pair), 0);
+#else
+			float covariance = 0.0f;
+			for (int i = 0; i < 16; ++i)
+			{
+				covariance += (green[i] - greenCenter) * (plane[i] - center);
+			}
+#endif
+			if (covariance < 0.0f)
+			{
+				std::swap(endpoints.First[c], endpoints.Second[c]);
+			}
+		}
+	}
+
+	// Endpoints spanning the block along its principal axis, found by power iteration on
+	// the covariance matrix, and inset like the bounding box.
+	void ComputePrincipalAxis(const BlockTexels& block, int channelCount, Endpoints& endpoints)
+	{
+		float mean[4] = {};
+		for (int c = 0; c < channelCount; ++c)
+		{
+			for (int i = 0; i < 16; ++i)
+			{
+				mean[c] += block.C[c][i];
+			}
+			mean[c] /= 16.0f;
+		}
+
+		float covariance[4][4] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			float d[4];
+			for (int c = 0; c < channelCount; ++c)
+			{
+				d[c] = block.C[c][i] - mean[c];
+			}
+			for (int r = 0; r < channelCount; ++r)
+			{
+				for (int c = r; c < channelCount; ++c)
+				{
+					covariance[r][c] += d[r] * d[c];
+				}
+			}
+		}
+		for (int r = 0; r < channelCount; ++r)
+		{
+			for (int c = 0; c < r; ++c)
+			{
+				covariance[r][c] = covariance[c][r];
+			}
+		}
+
+		// Start from the bounding box diagonal, which is rarely orthogonal to the answer.
+		Endpoints box;
+		ComputeBoundingBox(block, 0, channelCount, box);
+		float axis[4] = {};
+		for (int c = 0; c < channelCount; ++c)
+		{
+			axis[c] = box.Second[c] - box.First[c];
+		}
+
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[4] = {};
+			float length = 0.0f;
+			for (int r = 0; r < channelCount; ++r)
+			{
+				for (int c = 0; c < channelCount; ++c)
+				{
+					next[r] += covariance[r][c] * axis[c];
+				}
+				length = std::max(length, fabsf(next[r]));
+			}
+			if (length == 0.0f)
+			{
+				break;
+			}
+			for (int c = 0; c < channelCount; ++c)
+			{
+				axis[c] = next[c] / length;
+			}
+		}
+
+		float lengthSquared = 0.0f;
+		for (int c = 0; c < channelCount; ++c)
+		{
+			lengthSquared += axis[c] * axis[c];
+		}
+		if (lengthSquared > 0.0f)
+		{
+			const float scale = 1.0f / sqrtf(lengthSquared);
+			for (int c = 0; c < channelCount; ++c)
+			{
+				axis[c] *= scale;
+			}
+		}
+
+		float lowest = 0.0f;
+		float highest = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			float t = 0.0f;
+			for (int c = 0; c < channelCount; ++c)
+			{
+				t += (block.C[c][i] - mean[c]) * axis[c];
+			}
+			lowest = std::min(lowest, t);
+			highest = std::max(highest, t);
+		}
+		const float inset = (highest - lowest) / 16.0f;
+		lowest += inset;
+		highest -= inset;
+
+		for (int c = 0; c < channelCount; ++c)
+		{
+			endpoints.First[c] = std::min(std::max(mean[c] + axis[c] * lowest, 0.0f), 255.0f);
+			endpoints.Second[c] = std::min(std::max(mean[c] + axis[c] * highest, 0.0f), 255.0f);
+		}
+	}
+
+	// Picks the nearest palette entry for every texel and returns the total squared error.
+	float SelectIndices(const BlockTexels& block, int firstChannel, int channelCount, const Palette& palette, int paletteSize, uint8_t* indices)
+	{
+		float total = 0.0f;
+		int i = 0;
+#if DX_SIMD_SSE2
+		for (; i < 16; i += 4)
+		{
+			__m128 best = _mm_set1_ps(1e30f);
+			__m128i bestIndex = _mm_setzero_si128();
+			for (int p = 0; p < paletteSize; ++p)
+			{
+				__m128 distance = _mm_setzero_ps();
+				for (int c = firstChannel; c < firstChannel + channelCount; ++c)
+				{
+					__m128 d = _mm_sub_ps(_mm_loadu_ps(block.C[c] + i), _mm_set1_ps(palette[p][c]));
+					distance = _mm_add_ps(distance, _mm_mul_ps(d, d));
+				}
+				__m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+				best = _mm_min_ps(distance, best);
+				bestIndex = _mm_or_si128(_mm_andnot_si128(closer, bestIndex), _mm_and_si128(closer, _mm_set1_epi32(p)));
+			}
+			bestIndex = _mm_packs_epi32(bestIndex, bestIndex);
+			bestIndex = _mm_packus_epi16(bestIndex, bestIndex);
+			uint32_t packed = static_cast<uint32_t>(_mm_cvtsi128_si32(bestIndex));
+			memcpy(indices + i, &packed, 4);
+
+			best = _mm_add_ps(best, _mm_movehl_ps(best, best));
+			best = _mm_add_ss(best, _mm_shuffle_ps(best, best, _MM_SHUFFLE(1, 1, 1, 1)));
+			total += _mm_cvtss_f32(best);
+		}
+#elif DX_SIMD_NEON
+		for (; i < 16; i += 4)
+		{
+			float32x4_t best = vdupq_n_f32(1e30f);
+			uint32x4_t bestIndex = vdupq_n_u32(0);
+			for (int p = 0; p < paletteSize; ++p)
+			{
+				float32x4_t distance = vdupq_n_f32(0.0f);
+				for (int c = firstChannel; c < firstChannel + channelCount; ++c)
+				{
+					float32x4_t d = vsubq_f32(vld1q_f32(block.C[c] + i), vdupq_n_f32(palette[p][c]));
+					distance = vmlaq_f32(distance, d, d);
+				}
+				uint32x4_t closer = vcltq_f32(distance, best);
+				best = vminq_f32(distance, best);
+				bestIndex = vbslq_u32(closer, vdupq_n_u32(p), bestIndex);
+			}
+			uint16x4_t narrow = vmovn_u32(bestIndex);
+			uint8x8_t bytes = vmovn_u16(vcombine_u16(narrow, narrow));
+			vst1_lane_u32(reinterpret_cast<uint32_t*>(indices + i), vreinterpret_u32_u8(bytes), 0);
+			float32x2_t pair = vpadd_f32(vget_low_f32(best), vget_high_f32(best));
+			total += vget_lane_f32(vpadd_f32(pair, pair), 0);
+		}
+#endif
+		for (; i < 16; ++i)
+		{
+			float best = 1e30f;
+			for (int p = 0; p < paletteSize; ++p)
+			{
+				float distance = 0.0f;
+				for (int c = firstChannel; c < firstChannel + channelCount; ++c)
+				{
+					float d = block.C[c][i] - palette[p][c];
+					distance += d * d;
+				}
+				if (distance < best)
+				{
+					best = distance;
+					indices[i] = static_cast<uint8_t>(p);
+				}
+			}
+			total += best;
+		}
+		return total;
+	}
+
+	// Least-squares endpoints for the current indices, where positions[index] is how far
+	// that palette entry sits from First towards Second. Fails if the system is singular,
+	// which happens when every texel uses the same entry.
+	bool RefineEndpoints(const BlockTexels& block, int firstChannel, int channelCount, const uint8_t* indices, const float* positions, Endpoints& endpoints)
+	{
+		float aa = 0.0f;
+		float ab = 0.0f;
+		float bb = 0.0f;
+		float ax[4] = {};
+		float bx[4] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			const float b = positions[indices[i]];
+			const float a = 1.0f - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int c = firstChannel; c < firstChannel + channelCount; ++c)
+			{
+				ax[c] += a * block.C[c][i];
+				bx[c] += b * block.C[c][i];
+			}
+		}
+
+		const float determinant = aa * bb - ab * ab;
+		if (fabsf(determinant) < 1e-6f)
+		{
+			return false;
+		}
+
+		for (int c = firstChannel; c < firstChannel + channelCount; ++c)
+		{
+			endpoints.First[c] = std::min(std::max((bb * ax[c] - ab * bx[c]) / determinant, 0.0f), 255.0f);
+			endpoints.Second[c] = std::min(std::max((aa * bx[c] - ab * ax[c]) / determinant, 0.0f), 255.0f);
+		}
+		return true;
+	}
+
+	int RefinementCount(BlockCompressionQuality quality)
+	{
+		switch (quality)
+		{
+		case BlockCompressionQuality::Fast: return 0;
+		case BlockCompressionQuality::Normal: return 1;
+		default: return 4;
+		}
+	}
+
+	uint16_t QuantizeRgb565(const float* rgb)
+	{
+		uint32_t r = static_cast<uint32_t>(rgb[0] * (31.0f / 255.0f) + 0.5f);
+		uint32_t g = static_cast<uint32_t>(rgb[1] * (63.0f / 255.0f) + 0.5f);
+		uint32_t b = static_cast<uint32_t>(rgb[2] * (31.0f / 255.0f) + 0.5f);
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	void ExpandRgb565(uint16_t color, float* rgb)
+	{
+		uint32_t r = (color >> 11) & 31;
+		uint32_t g = (color >> 5) & 63;
+		uint32_t b = color & 31;
+		rgb[0] = static_cast<float>((r << 3) | (r >> 2));
+		rgb[1] = static_cast<float>((g << 2) | (g >> 4));
+		rgb[2] = static_cast<float>((b << 3) | (b >> 2));
+	}
+
+	// BC1 colour block in four-colour mode, which BC3 always uses and which BC1 selects by
+	// storing the larger endpoint first. Returns the squared error.
+	float EvaluateColorEndpoints(const BlockTexels& block, Endpoints const& endpoints, uint16_t* colors, uint8_t* indices)
+	{
+		colors[0] = QuantizeRgb565(endpoints.First);
+		colors[1] = QuantizeRgb565(endpoints.Second);
+		if (colors[0] < colors[1])
+		{
+			std::swap(colors[0], colors[1]);
+		}
+
+		Palette palette;
+		ExpandRgb565(colors[0], palette[0]);
+		ExpandRgb565(colors[1], palette[1]);
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+			palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+		}
+		return SelectIndices(block, 0, 3, palette, colors[0] == colors[1] ? 1 : 4, indices);
+	}
+
+	void EncodeColorBlock(const BlockTexels& block, BlockCompressionQuality quality, uint8_t* output)
+	{
+		Endpoints endpoints;
+		if (quality == BlockCompressionQuality::Fast)
+		{
+			ComputeBoundingBox(block, 0, 3, endpoints);
+			SelectBoundingBoxDiagonal(block, 3, endpoints);
+			InsetBoundingBox(0, 3, endpoints);
+		}
+		else
+		{
+			ComputePrincipalAxis(block, 3, endpoints);
+		}
+
+		uint16_t colors[2];
+		uint8_t indices[16];
+		float error = EvaluateColorEndpoints(block, endpoints, colors, indices);
+
+		if (quality == BlockCompressionQuality::High)
+		{
+			Endpoints box;
+			ComputeBoundingBox(block, 0, 3, box);
+			SelectBoundingBoxDiagonal(block, 3, box);
+			InsetBoundingBox(0, 3, box);
+			uint16_t boxColors[2];
+			uint8_t boxIndices[16];
+			float boxError = EvaluateColorEndpoints(block, box, boxColors, boxIndices);
+			if (boxError < error)
+			{
+				error = boxError;
+				memcpy(colors, boxColors, sizeof(colors));
+				memcpy(indices, boxIndices, sizeof(indices));
+			}
+		}
+
+		for (int iteration = RefinementCount(quality); iteration > 0 && error > 0.0f; --iteration)
+		{
+			Endpoints refined;
+			if (colors[0] == colors[1] || !RefineEndpoints(block, 0, 3, indices, c_bc1Positions, refined))
+			{
+				break;
+			}
+
+			uint16_t refinedColors[2];
+			uint8_t refinedIndices[16];
+			float refinedError = EvaluateColorEndpoints(block, refined, refinedColors, refinedIndices);
+			if (refinedError >= error)
+			{
+				break;
+			}
+			error = refinedError;
+			memcpy(colors, refinedColors, sizeof(colors));
+			memcpy(indices, refinedIndices, sizeof(indices));
+		}
+
+		uint32_t packedIndices = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			packedIndices |= static_cast<uint32_t>(indices[i]) << (i * 2);
+		}
+		memcpy(output, &colors[0], 2);
+		memcpy(output + 2, &colors[1], 2);
+		memcpy(output + 4, &packedIndices, 4);
+	}
+
+	// BC3 alpha block. With the first endpoint larger there are six interpolated values;
+	// otherwise four, plus exact 0 and 255.
+	float EvaluateAlphaEndpoints(const BlockTexels& block, int first, int second, uint8_t* indices)
+	{
+		Palette palette;
+		palette[0][3] = static_cast<float>(first);
+		palette[1][3] = static_cast<float>(second);
+		if (first > second)
+		{
+			for (int i = 2; i < 8; ++i)
+			{
+				palette[i][3] = ((8 - i) * first + (i - 1) * second) / 7.0f;
+			}
+		}
+		else
+		{
+			for (int i = 2; i < 6; ++i)
+			{
+				palette[i][3] = ((6 - i) * first + (i - 1) * second) / 5.0f;
+			}
+			palette[6][3] = 0.0f;
+			palette[7][3] = 255.0f;
+		}
+		return SelectIndices(block, 3, 1, palette, 8, indices);
+	}
+
+	void EncodeAlphaBlock(const BlockTexels& block, BlockCompressionQuality quality, uint8_t* output)
+	{
+		Endpoints range;
+		ComputeBoundingBox(block, 3, 1, range);
+		int low = static_cast<int>(range.First[3]);
+		int high = static_cast<int>(range.Second[3]);
+
+		int endpoints[2] = { high, low };
+		uint8_t indices[16];
+		float error = EvaluateAlphaEndpoints(block, high, low, indices);
+
+		if (quality != BlockCompressionQuality::Fast && error > 0.0f)
+		{
+			// The other mode only helps when the block mixes 0 or 255 with other values.
+			int innerLow = 255;
+			int innerHigh = 0;
+			for (int i = 0; i < 16; ++i)
+			{
+				int a = static_cast<int>(block.C[3][i]);
+				if (a != 0 && a != 255)
+				{
+					innerLow = std::min(innerLow, a);
+					innerHigh = std::max(innerHigh, a);
+				}
+			}
+			if (innerLow <= innerHigh)
+			{
+				uint8_t innerIndices[16];
+				float innerError = EvaluateAlphaEndpoints(block, innerLow, innerHigh, innerIndices);
+				if (innerError < error)
+				{
+					error = innerError;
+					endpoints[0] = innerLow;
+					endpoints[1] = innerHigh;
+					memcpy(indices, innerIndices, sizeof(indices));
+				}
+			}
+		}
+
+		if (quality == BlockCompressionQuality::High && endpoints[0] > endpoints[1])
+		{
+			const float positions[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+			for (int iteration = RefinementCount(quality); iteration > 0 && error > 0.0f; --iteration)
+			{
+				Endpoints refined;
+				if (!RefineEndpoints(block, 3, 1, indices, positions, refined))
+				{
+					break;
+				}
+				int first = static_cast<int>(refined.First[3] + 0.5f);
+				int second = static_cast<int>(refined.Second[3] + 0.5f);
+				if (first <= second)
+				{
+					break;
+				}
+
+				uint8_t refinedIndices[16];
+				float refinedError = EvaluateAlphaEndpoints(block, first, second, refinedIndices);
+				if (refinedError >= error)
+				{
+					break;
+				}
+				error = refinedError;
+				endpoints[0] = first;
+				endpoints[1] = second;
+				memcpy(indices, refinedIndices, sizeof(indices));
+			}
+		}
+
+		uint64_t packedIndices = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			packedIndices |= static_cast<uint64_t>(indices[i]) << (i * 3);
+		}
+		output[0] = static_cast<uint8_t>(endpoints[0]);
+		output[1] = static_cast<uint8_t>(endpoints[1]);
+		for (int i = 0; i < 6; ++i)
+		{
+			output[2 + i] = static_cast<uint8_t>(packedIndices >> (i * 8));
+		}
+	}
+
+	// BC7 mode 6 endpoint: 7 bits per channel plus a p-bit shared by the channels, picked
+	// to minimise the error of the quantized endpoint.
+	void QuantizeBC7Endpoint(const float* value, int* quantized, int& pBit)
+	{
+		float bestError = 1e30f;
+		for (int p = 0; p < 2; ++p)
+		{
+			int candidate[4];
+			float error = 0.0f;
+			for (int c = 0; c < 4; ++c)
+			{
+				candidate[c] = std::min(std::max(static_cast<int>((value[c] - p) * 0.5f + 0.5f), 0), 127);
+				float d = static_cast<float>(candidate[c] * 2 + p) - value[c];
+				error += d * d;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				pBit = p;
+				memcpy(quantized, candidate, sizeof(candidate));
+			}
+		}
+	}
+
+	struct BC7Block
+	{
+		int		Endpoints[2][4];	// 7-bit values.
+		int		PBits[2];
+		uint8_t	Indices[16];
+	};
+
+	float EvaluateBC7Endpoints(const BlockTexels& block, Endpoints const& endpoints, BC7Block& encoded)
+	{
+		QuantizeBC7Endpoint(endpoints.First, encoded.Endpoints[0], encoded.PBits[0]);
+		QuantizeBC7Endpoint(endpoints.Second, encoded.Endpoints[1], encoded.PBits[1]);
+
+		Palette palette;
+		for (int c = 0; c < 4; ++c)
+		{
+			const int first = encoded.Endpoints[0][c] * 2 + encoded.PBits[0];
+			const int second = encoded.Endpoints[1][c] * 2 + encoded.PBits[1];
+			for (int i = 0; i < 16; ++i)
+			{
+				palette[i][c] = static_cast<float>(((64 - c_bc7Weights[i]) * first + c_bc7Weights[i] * second + 32) >> 6);
+			}
+		}
+		return SelectIndices(block, 0, 4, palette, 16, encoded.Indices);
+	}
+
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(uint8_t* output) : m_output(output), m_position(0)
+		{
+			memset(output, 0, 16);
+		}
+
+		void Write(uint32_t value, int bits)
+		{
+			for (int i = 0; i < bits; ++i, ++m_position)
+			{
+				m_output[m_position >> 3] |= static_cast<uint8_t>(((value >> i) & 1) << (m_position & 7));
+			}
+		}
+
+	private:
+		uint8_t*	m_output;
+		int			m_position;
+	};
+
+	void EncodeBC7Block(const BlockTexels& block, BlockCompressionQuality quality, uint8_t* output)
+	{
+		Endpoints endpoints;
+		if (quality == BlockCompressionQuality::Fast)
+		{
+			ComputeBoundingBox(block, 0, 4, endpoints);
+			SelectBoundingBoxDiagonal(block, 4, endpoints);
+			InsetBoundingBox(0, 4, endpoints);
+		}
+		else
+		{
+			ComputePrincipalAxis(block, 4, endpoints);
+		}
+
+		BC7Block encoded;
+		float error = EvaluateBC7Endpoints(block, endpoints, encoded);
+
+		if (quality == BlockCompressionQuality::High)
+		{
+			Endpoints box;
+			ComputeBoundingBox(block, 0, 4, box);
+			SelectBoundingBoxDiagonal(block, 4, box);
+			InsetBoundingBox(0, 4, box);
+			BC7Block boxEncoded;
+			float boxError = EvaluateBC7Endpoints(block, box, boxEncoded);
+			if (boxError < error)
+			{
+				error = boxError;
+				encoded = boxEncoded;
+			}
+		}
+
+		float positions[16];
+		for (int i = 0; i < 16; ++i)
+		{
+			positions[i] = c_bc7Weights[i] / 64.0f;
+		}
+		for (int iteration = RefinementCount(quality); iteration > 0 && error > 0.0f; --iteration)
+		{
+			Endpoints refined;
+			if (!RefineEndpoints(block, 0, 4, encoded.Indices, positions, refined))
+			{
+				break;
+			}
+
+			BC7Block refinedEncoded;
+			float refinedError = EvaluateBC7Endpoints(block, refined, refinedEncoded);
+			if (refinedError >= error)
+			{
+				break;
+			}
+			error = refinedError;
+			encoded = refinedEncoded;
+		}
+
+		// The first texel's index is stored without its top bit, so it must be below 8.
+		if (encoded.Indices[0] & 8)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				std::swap(encoded.Endpoints[0][c], encoded.Endpoints[1][c]);
+			}
+			std::swap(encoded.PBits[0], encoded.PBits[1]);
+			for (int i = 0; i < 16; ++i)
+			{
+				encoded.Indices[i] = static_cast<uint8_t>(15 - encoded.Indices[i]);
+			}
+		}
+
+		BitWriter writer(output);
+		writer.Write(1 << 6, 7);
+		for (int c = 0; c < 4; ++c)
+		{
+			writer.Write(encoded.Endpoints[0][c], 7);
+			writer.Write(encoded.Endpoints[1][c], 7);
+		}
+		writer.Write(encoded.PBits[0], 1);
+		writer.Write(encoded.PBits[1], 1);
+		writer.Write(encoded.Indices[0], 3);
+		for (int i = 1; i < 16; ++i)
+		{
+			writer.Write(encoded.Indices[i], 4);
+		}
+	}
+}
+
+BlockCompressor::BlockCompressor(BlockFormat format, BlockCompressionQuality quality) :
+	m_format(format),
+	m_quality(quality)
+{
+}
+
+BlockFormat BlockCompressor::ChooseFormat(const void* pixels, uint32_t width, uint32_t height, size_t rowPitch, bool useBC7ForAlpha)
+{
+	const uint8_t* source = static_cast<const uint8_t*>(pixels);
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		const uint32_t* row = reinterpret_cast<const uint32_t*>(source + y * rowPitch);
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			if ((row[x] >> 24) != 255)
+			{
+				return useBC7ForAlpha ? BlockFormat::BC7 : BlockFormat::BC3;
+			}
+		}
+	}
+	return BlockFormat::BC1;
+}
+
+void BlockCompressor::CompressBlockRows(const void* pixels, uint32_t width, uint32_t height, size_t rowPitch,
+	uint32_t firstBlockRow, uint32_t blockRowCount, void* destination, size_t destinationRowPitch) const
+{
+	const uint8_t* source = static_cast<const uint8_t*>(pixels);
+	const uint32_t blocksWide = GetBlockCount(width);
+	const uint32_t blockBytes = GetBlockBytes(m_format);
+
+	BlockTexels block;
+	for (uint32_t blockY = firstBlockRow; blockY < firstBlockRow + blockRowCount; ++blockY)
+	{
+		uint8_t* output = static_cast<uint8_t*>(destination) + blockY * destinationRowPitch;
+		for (uint32_t blockX = 0; blockX < blocksWide; ++blockX, output += blockBytes)
+		{
+			LoadBlock(source, width, height, rowPitch, blockX, blockY, block);
+			switch (m_format)
+			{
+			case BlockFormat::BC1:
+				EncodeColorBlock(block, m_quality, output);
+				break;
+
+			case BlockFormat::BC3:
+				EncodeAlphaBlock(block, m_quality, output);
+				EncodeColorBlock(block, m_quality, output + 8);
+				break;
+
+			case BlockFormat::BC7:
+				EncodeBC7Block(block, m_quality, output);
+				break;
+			}
+		}
+	}
+}
+
+void BlockCompressor::Compress(const void* pixels, uint32_t width, uint32_t height, size_t rowPitch, void* destination, size_t destinationRowPitch) const
+{
+	CompressBlockRows(pixels, width, height, rowPitch, 0, GetBlockCount(height), destination, destinationRowPitch);
+}
+
+std::vector<std::future<void>> BlockCompressor::CompressAsync(ThreadPool& pool, const void* pixels, uint32_t width, uint32_t height, size_t rowPitch,
+	void* destination, size_t destinationRowPitch) const
+{
+	std::vector<std::future<void>> pending;
+	const uint32_t blocksHigh = GetBlockCount(height);
+	for (uint32_t firstBlockRow = 0; firstBlockRow < blocksHigh; firstBlockRow += c_blockRowsPerTask)
+	{
+		const uint32_t blockRowCount = std::min(c_blockRowsPerTask, blocksHigh - firstBlockRow);
+		BlockCompressor compressor = *this;
+		pending.push_back(pool.Submit([=]()
+		{
+			compressor.CompressBlockRows(pixels, width, height, rowPitch, firstBlockRow, blockRowCount, destination, destinationRowPitch);
+		}));
+	}
+	return pending;
+}
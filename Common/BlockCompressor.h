@@ -0,0 +1,66 @@
+﻿#pragma once
+
+#include "ThreadPool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <vector>
+
+namespace DX
+{
+	enum class BlockFormat
+	{
+		BC1,	// 4 bits per texel, opaque colour.
+		BC3,	// 8 bits per texel, BC1 colour plus interpolated alpha.
+		BC7,	// 8 bits per texel, RGBA with 7-bit endpoints (mode 6 only).
+	};
+
+	// Trades encode time for quality. Fast uses bounding-box endpoints, Normal fits them
+	// to the principal axis of the block and refines them once, High also tries the
+	// bounding box and refines until the error stops improving.
+	enum class BlockCompressionQuality
+	{
+		Fast,
+		Normal,
+		High,
+	};
+
+	// Encodes premultiplied BGRA images, as the PNG decoder and mip generator write them,
+	// into 4x4 BC blocks. Partial blocks at the right and bottom edges replicate the edge
+	// texels. Blocks are independent, so images are split into bands of block rows that
+	// can be compressed on separate threads.
+	class BlockCompressor
+	{
+	public:
+		BlockCompressor(BlockFormat format, BlockCompressionQuality quality = BlockCompressionQuality::Normal);
+
+		// BC1 when every texel is opaque; otherwise BC7, or BC3 when useBC7ForAlpha is false.
+		static BlockFormat ChooseFormat(const void* pixels, uint32_t width, uint32_t height, size_t rowPitch, bool useBC7ForAlpha = true);
+
+		static uint32_t GetBlockBytes(BlockFormat format) { return format == BlockFormat::BC1 ? 8 : 16; }
+		static uint32_t GetBlockCount(uint32_t size) { return (size + 3) / 4; }
+
+		BlockFormat GetFormat() const { return m_format; }
+
+		// Bytes in one row of blocks, without padding.
+		size_t GetRowPitch(uint32_t width) const { return static_cast<size_t>(GetBlockCount(width)) * GetBlockBytes(m_format); }
+
+		// Encodes blockRowCount rows of blocks starting at firstBlockRow. destination is the
+		// start of the whole compressed image, and destinationRowPitch is in bytes.
+		void CompressBlockRows(const void* pixels, uint32_t width, uint32_t height, size_t rowPitch,
+			uint32_t firstBlockRow, uint32_t blockRowCount, void* destination, size_t destinationRowPitch) const;
+
+		void Compress(const void* pixels, uint32_t width, uint32_t height, size_t rowPitch, void* destination, size_t destinationRowPitch) const;
+
+		// Queues the image on the pool in bands of block rows. The source and destination must
+		// stay valid until every returned future is ready. Waiting on the futures from one of
+		// the pool's own threads can deadlock.
+		std::vector<std::future<void>> CompressAsync(ThreadPool& pool, const void* pixels, uint32_t width, uint32_t height, size_t rowPitch,
+			void* destination, size_t destinationRowPitch) const;
+
+	private:
+		BlockFormat				m_format;
+		BlockCompressionQuality	m_quality;
+	};
+}
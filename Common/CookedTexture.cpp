@@ -0,0 +1,205 @@
+﻿#include "CookedTexture.h"
+#include "TextureLayout.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace DX;
+
+namespace
+{
+	uint64_t Align(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// Texels per block edge and bytes per block; uncompressed texels are 1x1 blocks.
+	void GetBlockLayout(CookedTextureFormat format, uint32_t& blockSize, uint32_t& blockBytes)
+	{
+		switch (format)
+		{
+		case CookedTextureFormat::Bgra8: blockSize = 1; blockBytes = 4; break;
+		case CookedTextureFormat::BC1: blockSize = 4; blockBytes = 8; break;
+		case CookedTextureFormat::BC3:
+		case CookedTextureFormat::BC7: blockSize = 4; blockBytes = 16; break;
+		default: throw CookedTextureError("Unknown cooked texture format.");
+		}
+	}
+
+#ifndef _WIN32
+	std::string ToNarrow(const std::wstring& text)
+	{
+		std::string result(text.size() * MB_CUR_MAX + 1, '\0');
+		size_t length = wcstombs(&result[0], text.c_str(), result.size());
+		if (length == static_cast<size_t>(-1))
+		{
+			throw CookedTextureError("File name can't be converted.");
+		}
+		result.resize(length);
+		return result;
+	}
+#endif
+
+	FILE* OpenFile(const std::wstring& fileName, const wchar_t* mode)
+	{
+		FILE* file = nullptr;
+#ifdef _WIN32
+		if (_wfopen_s(&file, fileName.c_str(), mode) != 0)
+		{
+			file = nullptr;
+		}
+#else
+		file = fopen(ToNarrow(fileName).c_str(), ToNarrow(mode).c_str());
+#endif
+		return file;
+	}
+}
+
+CookedTextureWriter::CookedTextureWriter(CookedTextureFormat format, uint32_t width, uint32_t height, uint32_t mipCount, uint32_t flags) :
+	m_header{},
+	m_mips(mipCount)
+{
+	uint32_t blockSize;
+	uint32_t blockBytes;
+	GetBlockLayout(format, blockSize, blockBytes);
+
+	// Levels are placed as GetCopyableFootprints would place them in an upload buffer.
+	static_assert(c_cookedTexturePlacementAlignment == c_texturePlacementAlignment && c_cookedTexturePitchAlignment == c_texturePitchAlignment,
+		"Cooked levels are placed as for an upload.");
+	std::vector<SubresourceFootprint> footprints(mipCount);
+	GetTextureFootprints(TextureLayoutDesc{ 0, width, height, 1, mipCount, false }, TextureFormatLayout{ blockSize, blockSize, blockBytes },
+		0, mipCount, 0, footprints.data());
+
+	uint64_t payloadSize = 0;
+	for (uint32_t i = 0; i < mipCount; ++i)
+	{
+		SubresourceFootprint const& footprint = footprints[i];
+		CookedTextureMip& mip = m_mips[i];
+		mip.Width = footprint.Width;
+		mip.Height = footprint.Height;
+		mip.RowCount = footprint.RowCount;
+		mip.RowSize = static_cast<uint32_t>(footprint.RowSize);
+		mip.RowPitch = footprint.RowPitch;
+		mip.Offset = footprint.Offset;
+		payloadSize = mip.Offset + static_cast<uint64_t>(mip.RowPitch) * mip.RowCount;
+	}
+
+	m_header.Magic = c_cookedTextureMagic;
+	m_header.Version = c_cookedTextureVersion;
+	m_header.Format = static_cast<uint32_t>(format);
+	m_header.Flags = flags;
+	m_header.Width = width;
+	m_header.Height = height;
+	m_header.MipCount = mipCount;
+	m_header.PayloadOffset = Align(sizeof(CookedTextureHeader) + sizeof(CookedTextureMip) * mipCount, c_cookedTexturePlacementAlignment);
+	m_header.PayloadSize = payloadSize;
+
+	m_payload.resize(static_cast<size_t>(payloadSize));
+}
+
+void CookedTextureWriter::SetMipData(uint32_t mip, const void* source, size_t sourceRowPitch)
+{
+	CookedTextureMip const& layout = m_mips[mip];
+	const uint8_t* sourceRow = static_cast<const uint8_t*>(source);
+	uint8_t* destinationRow = m_payload.data() + layout.Offset;
+	for (uint32_t row = 0; row < layout.RowCount; ++row)
+	{
+		memcpy(destinationRow, sourceRow, layout.RowSize);
+		sourceRow += sourceRowPitch;
+		destinationRow += layout.RowPitch;
+	}
+}
+
+void CookedTextureWriter::Write(const std::wstring& fileName) const
+{
+	FILE* file = OpenFile(fileName, L"wb");
+	if (!file)
+	{
+		throw CookedTextureError("Cooked texture can't be created.");
+	}
+
+	static const uint8_t padding[c_cookedTexturePlacementAlignment] = {};
+	const size_t tableEnd = sizeof(CookedTextureHeader) + sizeof(CookedTextureMip) * m_mips.size();
+
+	bool succeeded =
+		fwrite(&m_header, sizeof(m_header), 1, file) == 1 &&
+		fwrite(m_mips.data(), sizeof(CookedTextureMip), m_mips.size(), file) == m_mips.size() &&
+		fwrite(padding, 1, static_cast<size_t>(m_header.PayloadOffset - tableEnd), file) == m_header.PayloadOffset - tableEnd &&
+		fwrite(m_payload.data(), 1, m_payload.size(), file) == m_payload.size();
+	succeeded = fclose(file) == 0 && succeeded;
+
+	if (!succeeded)
+	{
+		throw CookedTextureError("Cooked texture can't be written.");
+	}
+}
+
+CookedTexture::CookedTexture(const std::wstring& fileName) :
+	m_header(nullptr),
+	m_mips(nullptr)
+{
+	try
+	{
+		m_file = FileView(fileName);
+	}
+	catch (FileViewError const&)
+	{
+		throw CookedTextureError("Cooked texture can't be opened.");
+	}
+
+	if (m_file.GetSize() < sizeof(CookedTextureHeader))
+	{
+		throw CookedTextureError("Cooked texture is truncated.");
+	}
+
+	m_header = reinterpret_cast<const CookedTextureHeader*>(m_file.GetData());
+	m_mips = reinterpret_cast<const CookedTextureMip*>(m_file.GetData() + sizeof(CookedTextureHeader));
+	Validate();
+}
+
+// Everything later code indexes with comes from the file, so all of it is range-checked.
+void CookedTexture::Validate() const
+{
+	CookedTextureHeader const& header = *m_header;
+	if (header.Magic != c_cookedTextureMagic || header.Version != c_cookedTextureVersion)
+	{
+		throw CookedTextureError("Not a cooked texture, or an older version.");
+	}
+
+	uint32_t blockSize;
+	uint32_t blockBytes;
+	GetBlockLayout(static_cast<CookedTextureFormat>(header.Format), blockSize, blockBytes);
+
+	// A full chain ends at 1x1, so there are at most floor(log2(max(width, height))) + 1 levels.
+	uint32_t maxMipCount = 1;
+	for (uint32_t size = std::max(header.Width, header.Height); size > 1; size >>= 1)
+	{
+		++maxMipCount;
+	}
+
+	if (header.Width == 0 || header.Height == 0 || header.MipCount == 0 || header.MipCount > maxMipCount ||
+		header.PayloadOffset < sizeof(CookedTextureHeader) + sizeof(CookedTextureMip) * header.MipCount ||
+		header.PayloadOffset > m_file.GetSize() || header.PayloadSize > m_file.GetSize() - header.PayloadOffset)
+	{
+		throw CookedTextureError("Cooked texture header is corrupt.");
+	}
+
+	// Each level holds exactly the whole blocks its size needs in the declared format, so a
+	// level can't be read as a different size or format from the one it was cooked at.
+	for (uint32_t i = 0; i < header.MipCount; ++i)
+	{
+		CookedTextureMip const& mip = m_mips[i];
+		const uint32_t blocksWide = (std::max(1u, header.Width >> i) + blockSize - 1) / blockSize;
+		const uint32_t blocksHigh = (std::max(1u, header.Height >> i) + blockSize - 1) / blockSize;
+		if (mip.Width != blocksWide * blockSize || mip.Height != blocksHigh * blockSize ||
+			mip.RowCount != blocksHigh || mip.RowSize != blocksWide * blockBytes ||
+			mip.RowPitch < mip.RowSize || mip.RowPitch % c_cookedTexturePitchAlignment != 0 ||
+			mip.Offset % c_cookedTexturePlacementAlignment != 0 ||
+			mip.Offset > header.PayloadSize || static_cast<uint64_t>(mip.RowPitch) * mip.RowCount > header.PayloadSize - mip.Offset)
+		{
+			throw CookedTextureError("Cooked texture mip table is corrupt.");
+		}
+	}
+}
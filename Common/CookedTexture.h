@@ -0,0 +1,113 @@
+﻿#pragma once
+
+#include "FileView.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace DX
+{
+	// Thrown when a cooked texture can't be opened, written or doesn't validate.
+	class CookedTextureError : public std::runtime_error
+	{
+	public:
+		explicit CookedTextureError(const char* message) : std::runtime_error(message) {}
+	};
+
+	enum class CookedTextureFormat : uint32_t
+	{
+		Bgra8,	// Premultiplied B8G8R8A8.
+		BC1,
+		BC3,
+		BC7,
+	};
+
+	const uint32_t c_cookedTextureMagic = 0x58455443;	// "CTEX"
+	const uint32_t c_cookedTextureVersion = 1;
+	const uint32_t c_cookedTextureSrgb = 1;				// Flags: levels are sRGB-encoded.
+
+	// Mirrors D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT and D3D12_TEXTURE_DATA_PITCH_ALIGNMENT,
+	// so every level in the payload can be copied to the GPU from where it lies.
+	const uint32_t c_cookedTexturePlacementAlignment = 512;
+	const uint32_t c_cookedTexturePitchAlignment = 256;
+
+	// The file is the header, MipCount CookedTextureMip entries, then the payload at
+	// PayloadOffset. The payload is laid out exactly as an upload buffer would be.
+	struct CookedTextureHeader
+	{
+		uint32_t	Magic;
+		uint32_t	Version;
+		uint32_t	Format;				// CookedTextureFormat.
+		uint32_t	Flags;
+		uint32_t	Width;
+		uint32_t	Height;
+		uint32_t	MipCount;
+		uint32_t	CookSettings;		// Chosen by whoever cooks the file; compared on load.
+		uint64_t	SourceSize;			// Identify the file the texture was cooked from, so
+		uint64_t	SourceModifiedTime;	// a stale cook can be detected without reading it.
+		uint64_t	PayloadOffset;
+		uint64_t	PayloadSize;
+	};
+
+	// A placed footprint within the payload.
+	struct CookedTextureMip
+	{
+		uint64_t	Offset;		// From the start of the payload.
+		uint32_t	Width;		// Of the footprint, so whole blocks for the BC formats.
+		uint32_t	Height;
+		uint32_t	RowPitch;
+		uint32_t	RowCount;	// Rows of texels, or rows of blocks.
+		uint32_t	RowSize;	// Bytes of data at the start of each row.
+		uint32_t	Reserved;
+	};
+
+	static_assert(sizeof(CookedTextureHeader) == 64, "The header is part of the file format.");
+	static_assert(sizeof(CookedTextureMip) == 32, "Mip entries are part of the file format.");
+
+	// Builds a cooked texture in memory, one level at a time, and writes it out.
+	class CookedTextureWriter
+	{
+	public:
+		CookedTextureWriter(CookedTextureFormat format, uint32_t width, uint32_t height, uint32_t mipCount, uint32_t flags = 0);
+
+		CookedTextureHeader& GetHeader() { return m_header; }
+		CookedTextureMip const& GetMip(uint32_t mip) const { return m_mips[mip]; }
+		const uint8_t* GetPayload() const { return m_payload.data(); }
+
+		// Copies a level's rows (texels, or blocks for the BC formats) into the payload.
+		void SetMipData(uint32_t mip, const void* source, size_t sourceRowPitch);
+
+		// A level's place in the payload, laid out as GetMip describes, for writing its rows
+		// in place.
+		uint8_t* GetMipData(uint32_t mip) { return m_payload.data() + m_mips[mip].Offset; }
+
+		void Write(const std::wstring& fileName) const;
+
+	private:
+		CookedTextureHeader				m_header;
+		std::vector<CookedTextureMip>	m_mips;
+		std::vector<uint8_t>			m_payload;
+	};
+
+	// Read-only view of a cooked texture file. The file is memory-mapped, so the payload
+	// is paged in as it is copied out rather than read up front.
+	class CookedTexture
+	{
+	public:
+		explicit CookedTexture(const std::wstring& fileName);
+
+		CookedTextureHeader const& GetHeader() const { return *m_header; }
+		CookedTextureMip const& GetMip(uint32_t mip) const { return m_mips[mip]; }
+		const uint8_t* GetPayload() const { return m_file.GetData() + m_header->PayloadOffset; }
+
+	private:
+		void Validate() const;
+
+		FileView					m_file;
+		const CookedTextureHeader*	m_header;
+		const CookedTextureMip*		m_mips;
+	};
+}
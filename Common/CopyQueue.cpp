@@ -0,0 +1,104 @@
+﻿#include "pch.h"
+#include "CopyQueue.h"
+#include "DirectXHelper.h"
+
+using namespace DX;
+using namespace Microsoft::WRL;
+
+void DX::RecordCopies(ID3D12GraphicsCommandList* commandList, const CopyRequest* copies, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		CopyRequest const& copy = copies[i];
+		ID3D12Resource* destination = static_cast<ID3D12Resource*>(copy.Destination);
+		ID3D12Resource* source = static_cast<ID3D12Resource*>(copy.Source);
+
+		if (copy.Type == CopyType::Buffer)
+		{
+			commandList->CopyBufferRegion(destination, copy.DestinationOffset, source, copy.SourceOffset, copy.Size);
+		}
+		else
+		{
+			D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint{};
+			footprint.Offset = copy.SourceOffset;
+			footprint.Footprint = CD3DX12_SUBRESOURCE_FOOTPRINT(static_cast<DXGI_FORMAT>(copy.Format), copy.Width, copy.Height, 1, copy.RowPitch);
+
+			CD3DX12_TEXTURE_COPY_LOCATION destinationLocation(destination, copy.Subresource);
+			CD3DX12_TEXTURE_COPY_LOCATION sourceLocation(source, footprint);
+			commandList->CopyTextureRegion(&destinationLocation, copy.X, copy.Y, 0, &sourceLocation, nullptr);
+		}
+	}
+}
+
+CopyQueue::CopyQueue(ID3D12Device* device) :
+	m_device(device),
+	m_submittedFenceValue(0)
+{
+	D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+	queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+	queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+	DX::ThrowIfFailed(device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_commandQueue)));
+	NAME_D3D12_OBJECT(m_commandQueue);
+
+	DX::ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
+	NAME_D3D12_OBJECT(m_fence);
+}
+
+// The copies still in flight read from, and write to, resources their owners are about to
+// release.
+CopyQueue::~CopyQueue()
+{
+	if (m_fence->GetCompletedValue() < m_submittedFenceValue)
+	{
+		HANDLE fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+		if (fenceEvent != nullptr && SUCCEEDED(m_fence->SetEventOnCompletion(m_submittedFenceValue, fenceEvent)))
+		{
+			WaitForSingleObjectEx(fenceEvent, INFINITE, FALSE);
+		}
+		if (fenceEvent != nullptr)
+		{
+			CloseHandle(fenceEvent);
+		}
+	}
+}
+
+void CopyQueue::Submit(const CopyRequest* copies, size_t count, uint64_t fenceValue)
+{
+	// Reuse the oldest allocator if its batch has finished.
+	ComPtr<ID3D12CommandAllocator> allocator;
+	if (!m_allocators.empty() && m_allocators.front().FenceValue <= m_fence->GetCompletedValue())
+	{
+		allocator = m_allocators.front().Allocator;
+		m_allocators.pop_front();
+		DX::ThrowIfFailed(allocator->Reset());
+	}
+	else
+	{
+		DX::ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&allocator)));
+	}
+
+	if (m_commandList)
+	{
+		DX::ThrowIfFailed(m_commandList->Reset(allocator.Get(), nullptr));
+	}
+	else
+	{
+		DX::ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, allocator.Get(), nullptr, IID_PPV_ARGS(&m_commandList)));
+		NAME_D3D12_OBJECT(m_commandList);
+	}
+
+	RecordCopies(m_commandList.Get(), copies, count);
+
+	DX::ThrowIfFailed(m_commandList->Close());
+	ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
+	m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+	DX::ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), fenceValue));
+
+	m_submittedFenceValue = fenceValue;
+	m_allocators.push_back(FencedAllocator{ fenceValue, allocator });
+}
+
+void CopyQueue::WaitOnQueue(ID3D12CommandQueue* queue, uint64_t fenceValue)
+{
+	DX::ThrowIfFailed(queue->Wait(m_fence.Get(), fenceValue));
+}
@@ -0,0 +1,41 @@
+﻿#pragma once
+
+#include "UploadBatcher.h"
+
+#include <deque>
+
+namespace DX
+{
+	// Records copies on any command list, such as a direct one when a resource has to stay on
+	// that queue.
+	void RecordCopies(ID3D12GraphicsCommandList* commandList, const CopyRequest* copies, size_t count);
+
+	// A COPY command queue with its own allocators and fence, executing each batch of copies
+	// as one command list. Other queues wait on the fence rather than the CPU.
+	class CopyQueue : public CopyQueueBackend
+	{
+	public:
+		explicit CopyQueue(ID3D12Device* device);
+		~CopyQueue();
+
+		void Submit(const CopyRequest* copies, size_t count, uint64_t fenceValue) override;
+		uint64_t GetCompletedFenceValue() override { return m_fence->GetCompletedValue(); }
+
+		// Makes queue wait, on the GPU, until the batch that signals fenceValue has finished.
+		void WaitOnQueue(ID3D12CommandQueue* queue, uint64_t fenceValue);
+
+	private:
+		struct FencedAllocator
+		{
+			uint64_t										FenceValue;
+			Microsoft::WRL::ComPtr<ID3D12CommandAllocator>	Allocator;
+		};
+
+		Microsoft::WRL::ComPtr<ID3D12Device>				m_device;
+		Microsoft::WRL::ComPtr<ID3D12CommandQueue>			m_commandQueue;
+		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>	m_commandList;
+		Microsoft::WRL::ComPtr<ID3D12Fence>					m_fence;
+		uint64_t											m_submittedFenceValue;
+		std::deque<FencedAllocator>							m_allocators;	// Oldest batch first.
+	};
+}
@@ -0,0 +1,53 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+namespace DX
+{
+	// Holds objects until the GPU has finished with them. Each is queued with the fence value
+	// the queue signals after the last work using it. Fence values are kept in order, so
+	// draining stops at the first object still in use, and costs constant time per object
+	// released over the queue's lifetime.
+	template<typename T>
+	class DeferredReleaseQueue
+	{
+	public:
+		// An object queued with an earlier fence value than the one before it is held until
+		// that one is released.
+		void Enqueue(T object, uint64_t fenceValue)
+		{
+			if (!m_entries.empty() && fenceValue < m_entries.back().FenceValue)
+			{
+				fenceValue = m_entries.back().FenceValue;
+			}
+			m_entries.push_back(Entry{ fenceValue, std::move(object) });
+		}
+
+		// Releases the objects queued with completedFenceValue or earlier, and returns how many.
+		size_t Drain(uint64_t completedFenceValue)
+		{
+			size_t releasedCount = 0;
+			while (!m_entries.empty() && m_entries.front().FenceValue <= completedFenceValue)
+			{
+				m_entries.pop_front();
+				++releasedCount;
+			}
+			return releasedCount;
+		}
+
+		void Clear() { m_entries.clear(); }
+		size_t GetSize() const { return m_entries.size(); }
+
+	private:
+		struct Entry
+		{
+			uint64_t	FenceValue;
+			T			Object;
+		};
+
+		std::deque<Entry>	m_entries;
+	};
+}
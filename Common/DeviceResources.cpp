@@ -420,6 +420,9 @@ void DX::DeviceResources::WaitForGpu()
 	DX::ThrowIfFailed(m_fence->SetEventOnCompletion(m_fenceValues[m_currentFrame], m_fenceEvent));
 	WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
 
+	// Everything queued for release so far is no longer in use.
+	m_deferredReleases.Drain(m_fenceValues[m_currentFrame]);
+
 	// Increment the fence value for the current frame.
 	m_fenceValues[m_currentFrame]++;
 }
@@ -441,6 +444,9 @@ void DX::DeviceResources::MoveToNextFrame()
 		WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
 	}
 
+	// Release whatever the frames that have finished were the last to use.
+	m_deferredReleases.Drain(m_fence->GetCompletedValue());
+
 	// Set the fence value for the next frame.
 	m_fenceValues[m_currentFrame] = currentFenceValue + 1;
 }
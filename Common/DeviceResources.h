@@ -1,5 +1,7 @@
 ﻿#pragma once
 
+#include "DeferredReleaseQueue.h"
+
 namespace DX
 {
 	static const UINT c_frameCount = 3;		// Use triple buffering.
@@ -31,6 +33,9 @@ namespace DX
 		void Present();
 		void WaitForGpu();
 
+		// Releases object once the work recorded so far this frame has finished on the GPU.
+		void DeferRelease(Microsoft::WRL::ComPtr<IUnknown> object)	{ m_deferredReleases.Enqueue(std::move(object), m_fenceValues[m_currentFrame]); }
+
 		// The size of the render target, in pixels.
 		SizeU						GetOutputSize() const				{ return m_outputSize; }
 
@@ -53,6 +58,11 @@ namespace DX
 		DirectX::XMFLOAT4X4			GetOrientationTransform3D() const	{ return m_orientationTransform3D; }
 		UINT						GetCurrentFrameIndex() const		{ return m_currentFrame; }
 
+		// The fence value the queue signals once the work recorded so far this frame has
+		// finished, and the latest value it has signalled.
+		UINT64						GetCurrentFenceValue() const		{ return m_fenceValues[m_currentFrame]; }
+		UINT64						GetCompletedFenceValue() const		{ return m_fence->GetCompletedValue(); }
+
 		CD3DX12_CPU_DESCRIPTOR_HANDLE GetRenderTargetView() const
 		{
 			return CD3DX12_CPU_DESCRIPTOR_HANDLE(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), m_currentFrame, m_rtvDescriptorSize);
@@ -92,6 +102,7 @@ namespace DX
 		Microsoft::WRL::ComPtr<ID3D12Fence>				m_fence;
 		UINT64											m_fenceValues[c_frameCount];
 		HANDLE											m_fenceEvent;
+		DeferredReleaseQueue<Microsoft::WRL::ComPtr<IUnknown>>	m_deferredReleases;
 
 		// Cached reference to the Window.
 		HWND											m_window;
@@ -0,0 +1,164 @@
+﻿#include "FeedbackEmulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace DX;
+
+FeedbackEmulator::FeedbackEmulator(uint32_t width, uint32_t height, uint32_t mipCount, uint32_t regionWidth, uint32_t regionHeight) :
+	m_width(width),
+	m_height(height),
+	m_mipCount(mipCount)
+{
+	if (width == 0 || height == 0 || mipCount == 0 || regionWidth == 0 || regionHeight == 0)
+	{
+		throw std::invalid_argument("Texture and region sizes must be non-zero.");
+	}
+
+	m_map.Width = (width + regionWidth - 1) / regionWidth;
+	m_map.Height = (height + regionHeight - 1) / regionHeight;
+	m_map.RegionWidth = regionWidth;
+	m_map.RegionHeight = regionHeight;
+	m_map.Mips.assign(static_cast<size_t>(m_map.Width) * m_map.Height, c_feedbackNotSampled);
+}
+
+void FeedbackEmulator::Clear()
+{
+	std::fill(m_map.Mips.begin(), m_map.Mips.end(), c_feedbackNotSampled);
+}
+
+void FeedbackEmulator::AddTriangles(const FeedbackVertex* vertices, const uint32_t* indices, size_t indexCount, float viewportWidth, float viewportHeight)
+{
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		AddTriangle(vertices[indices[i]], vertices[indices[i + 1]], vertices[indices[i + 2]], viewportWidth, viewportHeight);
+	}
+}
+
+// Points on the triangle are v2 + s (v0 - v2) + t (v1 - v2), in clip space and in texel
+// space alike, so a region centre's (s, t) comes from the UVs and its screen position, and
+// the Jacobian of the screen position, from the clip-space positions.
+void FeedbackEmulator::AddTriangle(FeedbackVertex const& v0, FeedbackVertex const& v1, FeedbackVertex const& v2, float viewportWidth, float viewportHeight)
+{
+	// Texel-space edges. The texture is addressed with BORDER, so UVs are clamped to [0, 1]
+	// for picking regions; derivatives use them as they are.
+	const float u2 = v2.UV[0] * m_width;
+	const float w2 = v2.UV[1] * m_height;
+	const float dUds = v0.UV[0] * m_width - u2;
+	const float dUdt = v1.UV[0] * m_width - u2;
+	const float dVds = v0.UV[1] * m_height - w2;
+	const float dVdt = v1.UV[1] * m_height - w2;
+
+	const float uvDeterminant = dUds * dVdt - dUdt * dVds;
+	if (std::fabs(uvDeterminant) < 1e-12f)
+	{
+		return;
+	}
+
+	float clipEdgeS[4];
+	float clipEdgeT[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		clipEdgeS[i] = v0.ClipPosition[i] - v2.ClipPosition[i];
+		clipEdgeT[i] = v1.ClipPosition[i] - v2.ClipPosition[i];
+	}
+
+	// Returns the mip sampled at (s, t), or -1 if nothing is drawn there.
+	auto getSampledMip = [&](float s, float t) -> int
+	{
+		float clip[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			clip[i] = v2.ClipPosition[i] + s * clipEdgeS[i] + t * clipEdgeT[i];
+		}
+		if (clip[3] <= 0.0f || std::fabs(clip[0]) > clip[3] || std::fabs(clip[1]) > clip[3] || clip[2] < 0.0f || clip[2] > clip[3])
+		{
+			return -1;
+		}
+
+		// Derivatives of the pixel position, which is y-down, with respect to s and t.
+		const float xScale = 0.5f * viewportWidth / (clip[3] * clip[3]);
+		const float yScale = -0.5f * viewportHeight / (clip[3] * clip[3]);
+		const float dXds = xScale * (clipEdgeS[0] * clip[3] - clip[0] * clipEdgeS[3]);
+		const float dXdt = xScale * (clipEdgeT[0] * clip[3] - clip[0] * clipEdgeT[3]);
+		const float dYds = yScale * (clipEdgeS[1] * clip[3] - clip[1] * clipEdgeS[3]);
+		const float dYdt = yScale * (clipEdgeT[1] * clip[3] - clip[1] * clipEdgeT[3]);
+
+		// A clockwise triangle keeps its orientation on the way to y-down pixels.
+		const float screenDeterminant = dXds * dYdt - dXdt * dYds;
+		if (screenDeterminant <= 0.0f)
+		{
+			return -1;
+		}
+
+		// d(uv)/d(pixel) is d(uv)/d(s, t) times the inverse of d(pixel)/d(s, t).
+		const float dUdx = (dUds * dYdt - dUdt * dYds) / screenDeterminant;
+		const float dVdx = (dVds * dYdt - dVdt * dYds) / screenDeterminant;
+		const float dUdy = (dUdt * dXds - dUds * dXdt) / screenDeterminant;
+		const float dVdy = (dVdt * dXds - dVds * dXdt) / screenDeterminant;
+
+		const float lengthSquared = std::max(dUdx * dUdx + dVdx * dVdx, dUdy * dUdy + dVdy * dVdy);
+		const float lod = 0.5f * std::log2(std::max(lengthSquared, 1.0f));
+		return std::min(static_cast<int>(lod), static_cast<int>(m_mipCount) - 1);
+	};
+
+	auto record = [&](uint32_t regionX, uint32_t regionY, int mip)
+	{
+		uint8_t& entry = m_map.Mips[static_cast<size_t>(regionY) * m_map.Width + regionX];
+		entry = std::min(entry, static_cast<uint8_t>(mip));
+	};
+
+	// Regions whose centres fall within the triangle's UV bounds.
+	const float minU = std::max(0.0f, std::min({ v0.UV[0], v1.UV[0], v2.UV[0] })) * m_width;
+	const float maxU = std::min(1.0f, std::max({ v0.UV[0], v1.UV[0], v2.UV[0] })) * m_width;
+	const float minV = std::max(0.0f, std::min({ v0.UV[1], v1.UV[1], v2.UV[1] })) * m_height;
+	const float maxV = std::min(1.0f, std::max({ v0.UV[1], v1.UV[1], v2.UV[1] })) * m_height;
+	if (minU > maxU || minV > maxV)
+	{
+		return;
+	}
+
+	const uint32_t firstX = static_cast<uint32_t>(std::max(0.0f, std::ceil(minU / m_map.RegionWidth - 0.5f)));
+	const uint32_t lastX = std::min(m_map.Width - 1, static_cast<uint32_t>(std::max(0.0f, std::floor(maxU / m_map.RegionWidth - 0.5f))));
+	const uint32_t firstY = static_cast<uint32_t>(std::max(0.0f, std::ceil(minV / m_map.RegionHeight - 0.5f)));
+	const uint32_t lastY = std::min(m_map.Height - 1, static_cast<uint32_t>(std::max(0.0f, std::floor(maxV / m_map.RegionHeight - 0.5f))));
+
+	const float epsilon = 1e-5f;
+	bool covered = false;
+	for (uint32_t regionY = firstY; regionY <= lastY; ++regionY)
+	{
+		const float dv = (regionY + 0.5f) * m_map.RegionHeight - w2;
+		for (uint32_t regionX = firstX; regionX <= lastX; ++regionX)
+		{
+			const float du = (regionX + 0.5f) * m_map.RegionWidth - u2;
+			const float s = (du * dVdt - dUdt * dv) / uvDeterminant;
+			const float t = (dUds * dv - du * dVds) / uvDeterminant;
+			if (s < -epsilon || t < -epsilon || s + t > 1.0f + epsilon)
+			{
+				continue;
+			}
+
+			covered = true;
+			const int mip = getSampledMip(s, t);
+			if (mip >= 0)
+			{
+				record(regionX, regionY, mip);
+			}
+		}
+	}
+
+	// A triangle smaller than a region still samples the region it lies in.
+	if (!covered)
+	{
+		const float third = 1.0f / 3.0f;
+		const int mip = getSampledMip(third, third);
+		const float u = (v0.UV[0] + v1.UV[0] + v2.UV[0]) * third;
+		const float v = (v0.UV[1] + v1.UV[1] + v2.UV[1]) * third;
+		if (mip >= 0 && u >= 0.0f && u <= 1.0f && v >= 0.0f && v <= 1.0f)
+		{
+			record(std::min(m_map.Width - 1, static_cast<uint32_t>(u * m_width) / m_map.RegionWidth),
+				std::min(m_map.Height - 1, static_cast<uint32_t>(v * m_height) / m_map.RegionHeight), mip);
+		}
+	}
+}
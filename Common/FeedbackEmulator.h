@@ -0,0 +1,45 @@
+﻿#pragma once
+
+#include "ResidencyManager.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace DX
+{
+	// A vertex as it leaves the vertex shader: clip-space position and texture coordinates.
+	struct FeedbackVertex
+	{
+		float	ClipPosition[4];
+		float	UV[2];
+	};
+
+	// Builds on the CPU the min-mip feedback map that a pixel shader calling
+	// WriteSamplerFeedback would, so that residency decisions can be made without GPU
+	// feedback. Each region is sampled once, at its centre: the UV derivatives there are
+	// worked out exactly from the triangle's projection, and the mip is the one a trilinear
+	// sample would read first. Triangles that are back-facing or clipped there are skipped,
+	// but nothing is depth-tested, so occluded front faces are recorded as well.
+	class FeedbackEmulator
+	{
+	public:
+		FeedbackEmulator(uint32_t width, uint32_t height, uint32_t mipCount, uint32_t regionWidth, uint32_t regionHeight);
+
+		// Resets every region to c_feedbackNotSampled.
+		void Clear();
+
+		// Records a triangle list. Front faces are clockwise on screen, as with the default
+		// rasterizer state.
+		void AddTriangles(const FeedbackVertex* vertices, const uint32_t* indices, size_t indexCount, float viewportWidth, float viewportHeight);
+
+		MinMipMap const& GetMap() const { return m_map; }
+
+	private:
+		void AddTriangle(FeedbackVertex const& v0, FeedbackVertex const& v1, FeedbackVertex const& v2, float viewportWidth, float viewportHeight);
+
+		uint32_t	m_width;
+		uint32_t	m_height;
+		uint32_t	m_mipCount;
+		MinMipMap	m_map;
+	};
+}
@@ -0,0 +1,174 @@
+﻿#include "FileView.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace DX;
+
+FileView::FileView() :
+	m_data(nullptr),
+	m_size(0),
+	m_mapped(false)
+{
+}
+
+FileView::FileView(const std::wstring& fileName, FileAccess access) :
+	m_data(nullptr),
+	m_size(0),
+	m_mapped(false)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		access == FileAccess::Sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		throw FileViewError("File can't be opened.");
+	}
+
+	LARGE_INTEGER size{};
+	if (!GetFileSizeEx(file, &size) || static_cast<ULONGLONG>(size.QuadPart) > SIZE_MAX)
+	{
+		CloseHandle(file);
+		throw FileViewError("File size can't be read.");
+	}
+	m_size = static_cast<size_t>(size.QuadPart);
+
+	if (m_size > 0)
+	{
+		// The view keeps the mapping and the file open, so neither handle is needed after this.
+		HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping)
+		{
+			m_data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+			m_mapped = m_data != nullptr;
+			CloseHandle(mapping);
+		}
+
+		if (!m_mapped)
+		{
+			m_buffer.resize(m_size);
+			for (size_t offset = 0; offset < m_size;)
+			{
+				DWORD chunk = static_cast<DWORD>(std::min<size_t>(m_size - offset, 1u << 30));
+				DWORD read = 0;
+				if (!ReadFile(file, m_buffer.data() + offset, chunk, &read, nullptr) || read == 0)
+				{
+					CloseHandle(file);
+					throw FileViewError("File can't be read.");
+				}
+				offset += read;
+			}
+			m_data = m_buffer.data();
+		}
+	}
+	CloseHandle(file);
+#else
+	std::string narrowName(fileName.size() * MB_CUR_MAX + 1, '\0');
+	size_t length = wcstombs(&narrowName[0], fileName.c_str(), narrowName.size());
+	if (length == static_cast<size_t>(-1))
+	{
+		throw FileViewError("File name can't be converted.");
+	}
+	narrowName.resize(length);
+
+	int file = open(narrowName.c_str(), O_RDONLY);
+	struct stat status;
+	if (file < 0 || fstat(file, &status) != 0)
+	{
+		if (file >= 0)
+		{
+			close(file);
+		}
+		throw FileViewError("File can't be opened.");
+	}
+	m_size = static_cast<size_t>(status.st_size);
+
+	if (m_size > 0)
+	{
+		void* view = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (view != MAP_FAILED)
+		{
+			madvise(view, m_size, access == FileAccess::Sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+			m_data = static_cast<const uint8_t*>(view);
+			m_mapped = true;
+		}
+		else
+		{
+			posix_fadvise(file, 0, 0, access == FileAccess::Sequential ? POSIX_FADV_SEQUENTIAL : POSIX_FADV_RANDOM);
+			m_buffer.resize(m_size);
+			for (size_t offset = 0; offset < m_size;)
+			{
+				ssize_t bytesRead = read(file, m_buffer.data() + offset, m_size - offset);
+				if (bytesRead <= 0)
+				{
+					close(file);
+					throw FileViewError("File can't be read.");
+				}
+				offset += static_cast<size_t>(bytesRead);
+			}
+			m_data = m_buffer.data();
+		}
+	}
+	close(file);
+#endif
+}
+
+FileView::~FileView()
+{
+	Close();
+}
+
+FileView::FileView(FileView&& other) :
+	m_data(other.m_data),
+	m_size(other.m_size),
+	m_mapped(other.m_mapped),
+	m_buffer(std::move(other.m_buffer))
+{
+	other.m_data = nullptr;
+	other.m_size = 0;
+	other.m_mapped = false;
+}
+
+FileView& FileView::operator=(FileView&& other)
+{
+	if (this != &other)
+	{
+		Close();
+		m_data = other.m_data;
+		m_size = other.m_size;
+		m_mapped = other.m_mapped;
+		m_buffer = std::move(other.m_buffer);
+		other.m_data = nullptr;
+		other.m_size = 0;
+		other.m_mapped = false;
+	}
+	return *this;
+}
+
+void FileView::Close()
+{
+	if (m_mapped)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(m_data);
+#else
+		munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+	}
+	m_data = nullptr;
+	m_size = 0;
+	m_mapped = false;
+	m_buffer.clear();
+}
@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace DX
+{
+	// Thrown when a file can't be opened or read.
+	class FileViewError : public std::runtime_error
+	{
+	public:
+		explicit FileViewError(const char* message) : std::runtime_error(message) {}
+	};
+
+	// How the contents will be read, passed on to the OS so it can plan read-ahead.
+	enum class FileAccess
+	{
+		Sequential,	// Front to back, once. Read-ahead is aggressive.
+		Random,		// Scattered reads. Read-ahead is disabled.
+	};
+
+	// Read-only view of a whole file. The file is memory-mapped where possible, so parsing
+	// from the view reads the page cache directly instead of going through a copy. If
+	// mapping fails, the file is read into a buffer instead and the view points at that.
+	class FileView
+	{
+	public:
+		FileView();
+		explicit FileView(const std::wstring& fileName, FileAccess access = FileAccess::Sequential);
+		~FileView();
+
+		FileView(FileView&& other);
+		FileView& operator=(FileView&& other);
+		FileView(FileView const&) = delete;
+		FileView& operator=(FileView const&) = delete;
+
+		const uint8_t* GetData() const { return m_data; }
+		size_t GetSize() const { return m_size; }
+		bool IsMapped() const { return m_mapped; }
+
+	private:
+		void Close();
+
+		const uint8_t*			m_data;
+		size_t					m_size;
+		bool					m_mapped;
+		std::vector<uint8_t>	m_buffer;	// Only used when the file couldn't be mapped.
+	};
+}
@@ -0,0 +1,238 @@
+﻿#include "pch.h"
+#include "GpuAllocator.h"
+#include "DirectXHelper.h"
+
+using namespace DX;
+using namespace Microsoft::WRL;
+
+namespace
+{
+	D3D12_HEAP_FLAGS GetHeapFlags(D3D12_RESOURCE_DESC const& desc)
+	{
+		if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+		{
+			return D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+		}
+		if ((desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) != 0)
+		{
+			return D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+		}
+		return D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+	}
+
+	void AddStatistics(TlsfStatistics& total, TlsfStatistics const& statistics)
+	{
+		total.Size += statistics.Size;
+		total.UsedBytes += statistics.UsedBytes;
+		total.AllocationCount += statistics.AllocationCount;
+		total.FreeBlockCount += statistics.FreeBlockCount;
+		if (statistics.LargestFreeBlock > total.LargestFreeBlock)
+		{
+			total.LargestFreeBlock = statistics.LargestFreeBlock;
+		}
+	}
+}
+
+GpuAllocator::GpuAllocator(ID3D12Device* device) :
+	m_device(device)
+{
+}
+
+GpuAllocator::~GpuAllocator()
+{
+	// The shared buffers are placed in the heaps, so they go first.
+	for (Buffer& buffer : m_buffers)
+	{
+		if (buffer.Data)
+		{
+			buffer.Allocation.Resource->Unmap(0, nullptr);
+		}
+	}
+	m_buffers.clear();
+}
+
+GpuAllocation GpuAllocator::CreateResource(D3D12_RESOURCE_DESC const& desc, D3D12_HEAP_TYPE heapType, D3D12_RESOURCE_STATES initialState,
+	const D3D12_CLEAR_VALUE* clearValue)
+{
+	const D3D12_RESOURCE_ALLOCATION_INFO info = m_device->GetResourceAllocationInfo(0, 1, &desc);
+	const D3D12_HEAP_FLAGS flags = GetHeapFlags(desc);
+
+	GpuAllocation allocation;
+	allocation.Heap = static_cast<uint32_t>(m_heaps.size());
+	for (uint32_t i = 0; i < m_heaps.size(); ++i)
+	{
+		Heap& heap = m_heaps[i];
+		if (heap.Object && heap.Type == heapType && heap.Flags == flags && heap.Allocator->Allocate(info.SizeInBytes, info.Alignment, allocation.Range))
+		{
+			allocation.Heap = i;
+			break;
+		}
+	}
+
+	if (allocation.Heap == m_heaps.size())
+	{
+		// Alignment is at most 4 MB, for multisampled textures, and heaps are placed at
+		// least that aligned.
+		const uint64_t heapSize = (std::max)(c_heapSize, (info.SizeInBytes + D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT - 1) & ~static_cast<uint64_t>(D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT - 1));
+
+		Heap heap;
+		heap.Type = heapType;
+		heap.Flags = flags;
+		CD3DX12_HEAP_DESC heapDesc(heapSize, heapType, info.Alignment > D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT ? D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT : 0, flags);
+		DX::ThrowIfFailed(m_device->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap.Object)));
+		heap.Allocator = std::make_unique<TlsfAllocator>(heapSize);
+		if (!heap.Allocator->Allocate(info.SizeInBytes, info.Alignment, allocation.Range))
+		{
+			DX::ThrowIfFailed(E_OUTOFMEMORY);
+		}
+
+		// Reuse the entry of a heap that has been released.
+		allocation.Heap = static_cast<uint32_t>(m_heaps.size());
+		for (uint32_t i = 0; i < m_heaps.size(); ++i)
+		{
+			if (!m_heaps[i].Object)
+			{
+				allocation.Heap = i;
+				break;
+			}
+		}
+		if (allocation.Heap == m_heaps.size())
+		{
+			m_heaps.push_back(std::move(heap));
+		}
+		else
+		{
+			m_heaps[allocation.Heap] = std::move(heap);
+		}
+	}
+
+	Heap& heap = m_heaps[allocation.Heap];
+	HRESULT hr = m_device->CreatePlacedResource(heap.Object.Get(), allocation.Range.Offset, &desc, initialState, clearValue, IID_PPV_ARGS(&allocation.Resource));
+	if (FAILED(hr))
+	{
+		heap.Allocator->Free(allocation.Range);
+		DX::ThrowIfFailed(hr);
+	}
+	return allocation;
+}
+
+void GpuAllocator::Free(GpuAllocation& allocation)
+{
+	allocation.Resource = nullptr;
+
+	Heap& heap = m_heaps[allocation.Heap];
+	heap.Allocator->Free(allocation.Range);
+	if (heap.Allocator->IsEmpty() && heap.Allocator->GetSize() > c_heapSize)
+	{
+		heap = Heap();
+	}
+}
+
+GpuBufferRange GpuAllocator::AllocateBuffer(uint64_t size, uint64_t alignment, D3D12_HEAP_TYPE heapType)
+{
+	GpuBufferRange range;
+	range.Buffer = static_cast<uint32_t>(m_buffers.size());
+	for (uint32_t i = 0; i < m_buffers.size(); ++i)
+	{
+		Buffer& buffer = m_buffers[i];
+		if (buffer.Allocator && buffer.Type == heapType && buffer.Allocator->Allocate(size, alignment, range.Range))
+		{
+			range.Buffer = i;
+			break;
+		}
+	}
+
+	if (range.Buffer == m_buffers.size())
+	{
+		const uint64_t bufferSize = (std::max)(c_bufferSize, (size + D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT - 1) & ~static_cast<uint64_t>(D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT - 1));
+
+		Buffer buffer;
+		buffer.Type = heapType;
+		buffer.Data = nullptr;
+		buffer.Allocation = CreateResource(CD3DX12_RESOURCE_DESC::Buffer(bufferSize), heapType,
+			heapType == D3D12_HEAP_TYPE_UPLOAD ? D3D12_RESOURCE_STATE_GENERIC_READ : D3D12_RESOURCE_STATE_COMMON);
+		if (heapType == D3D12_HEAP_TYPE_UPLOAD)
+		{
+			CD3DX12_RANGE readRange(0, 0);		// We do not intend to read from this resource on the CPU.
+			DX::ThrowIfFailed(buffer.Allocation.Resource->Map(0, &readRange, reinterpret_cast<void**>(&buffer.Data)));
+		}
+		buffer.Allocator = std::make_unique<TlsfAllocator>(bufferSize);
+		if (!buffer.Allocator->Allocate(size, alignment, range.Range))
+		{
+			if (buffer.Data)
+			{
+				buffer.Allocation.Resource->Unmap(0, nullptr);
+			}
+			Free(buffer.Allocation);
+			DX::ThrowIfFailed(E_OUTOFMEMORY);
+		}
+
+		// Buffers placed at 64 KB are aligned enough for any range alignment up to that.
+		range.Buffer = static_cast<uint32_t>(m_buffers.size());
+		for (uint32_t i = 0; i < m_buffers.size(); ++i)
+		{
+			if (!m_buffers[i].Allocator)
+			{
+				range.Buffer = i;
+				break;
+			}
+		}
+		if (range.Buffer == m_buffers.size())
+		{
+			m_buffers.push_back(std::move(buffer));
+		}
+		else
+		{
+			m_buffers[range.Buffer] = std::move(buffer);
+		}
+	}
+
+	Buffer const& buffer = m_buffers[range.Buffer];
+	range.Resource = buffer.Allocation.Resource.Get();
+	range.Offset = range.Range.Offset;
+	range.GpuAddress = range.Resource->GetGPUVirtualAddress() + range.Offset;
+	range.Data = buffer.Data ? buffer.Data + range.Offset : nullptr;
+	return range;
+}
+
+void GpuAllocator::Free(GpuBufferRange& range)
+{
+	Buffer& buffer = m_buffers[range.Buffer];
+	buffer.Allocator->Free(range.Range);
+	range.Resource = nullptr;
+	range.Data = nullptr;
+
+	if (buffer.Allocator->IsEmpty() && buffer.Allocator->GetSize() > c_bufferSize)
+	{
+		if (buffer.Data)
+		{
+			buffer.Allocation.Resource->Unmap(0, nullptr);
+		}
+		Free(buffer.Allocation);
+		buffer = Buffer();
+	}
+}
+
+GpuAllocatorStatistics GpuAllocator::GetStatistics() const
+{
+	GpuAllocatorStatistics statistics{};
+	for (Heap const& heap : m_heaps)
+	{
+		if (heap.Object)
+		{
+			++statistics.HeapCount;
+			statistics.HeapBytes += heap.Allocator->GetSize();
+			AddStatistics(statistics.Heaps, heap.Allocator->GetStatistics());
+		}
+	}
+	for (Buffer const& buffer : m_buffers)
+	{
+		if (buffer.Allocator)
+		{
+			++statistics.BufferCount;
+			statistics.BufferBytes += buffer.Allocator->GetSize();
+			AddStatistics(statistics.Buffers, buffer.Allocator->GetStatistics());
+		}
+	}
+	return statistics;
+}
@@ -0,0 +1,87 @@
+﻿#pragma once
+
+#include "TlsfAllocator.h"
+
+namespace DX
+{
+	// A resource placed in one of the allocator's heaps.
+	struct GpuAllocation
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource>	Resource;
+		uint32_t								Heap;
+		TlsfAllocation							Range;
+	};
+
+	// A range of a buffer shared with other small buffers. Upload ranges stay mapped.
+	struct GpuBufferRange
+	{
+		ID3D12Resource*				Resource;
+		uint64_t					Offset;
+		D3D12_GPU_VIRTUAL_ADDRESS	GpuAddress;
+		uint8_t*					Data;		// Null outside upload heaps.
+		uint32_t					Buffer;
+		TlsfAllocation				Range;
+	};
+
+	struct GpuAllocatorStatistics
+	{
+		uint32_t	HeapCount;
+		uint64_t	HeapBytes;
+		uint32_t	BufferCount;		// Shared buffers handing out ranges.
+		uint64_t	BufferBytes;
+		TlsfStatistics	Heaps;			// Summed over the heaps; LargestFreeBlock is the largest in any.
+		TlsfStatistics	Buffers;
+	};
+
+	// Places resources in large heaps instead of giving each its own committed allocation,
+	// and hands out small buffers as ranges of shared ones, which avoids 64 KB of alignment
+	// for each. Space within a heap or buffer is managed by a TlsfAllocator. Heaps are kept
+	// separate for buffers, render target and depth textures, and other textures, as
+	// resource heap tier 1 requires. A resource larger than c_heapSize gets a heap of its
+	// own, released when the resource is freed. Freeing is immediate, so callers must make
+	// sure the GPU is done with what they free; anything still allocated is released with
+	// the allocator.
+	class GpuAllocator
+	{
+	public:
+		explicit GpuAllocator(ID3D12Device* device);
+		~GpuAllocator();
+
+		GpuAllocator(GpuAllocator const&) = delete;
+		GpuAllocator& operator=(GpuAllocator const&) = delete;
+
+		GpuAllocation CreateResource(D3D12_RESOURCE_DESC const& desc, D3D12_HEAP_TYPE heapType, D3D12_RESOURCE_STATES initialState,
+			const D3D12_CLEAR_VALUE* clearValue = nullptr);
+		void Free(GpuAllocation& allocation);
+
+		// Buffers in default heaps start in the common state; upload ones are GENERIC_READ.
+		GpuBufferRange AllocateBuffer(uint64_t size, uint64_t alignment, D3D12_HEAP_TYPE heapType);
+		void Free(GpuBufferRange& range);
+
+		GpuAllocatorStatistics GetStatistics() const;
+
+		static const uint64_t c_heapSize = 32 * 1024 * 1024;
+		static const uint64_t c_bufferSize = 2 * 1024 * 1024;
+
+	private:
+		struct Heap
+		{
+			Microsoft::WRL::ComPtr<ID3D12Heap>	Object;
+			D3D12_HEAP_TYPE						Type;
+			D3D12_HEAP_FLAGS					Flags;
+			std::unique_ptr<TlsfAllocator>		Allocator;
+		};
+
+		struct Buffer
+		{
+			GpuAllocation					Allocation;
+			D3D12_HEAP_TYPE					Type;
+			uint8_t*						Data;
+			std::unique_ptr<TlsfAllocator>	Allocator;
+		};
+
+		Microsoft::WRL::ComPtr<ID3D12Device>	m_device;
+		std::vector<Heap>						m_heaps;	// Released heaps leave an empty entry.
+		std::vector<Buffer>						m_buffers;
+	};
+}
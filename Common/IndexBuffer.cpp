@@ -0,0 +1,165 @@
+﻿#include "IndexBuffer.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace DX;
+
+namespace
+{
+	const uint32_t c_maxIndex16 = 0xFFFF;
+}
+
+void DX::ConvertIndices(const uint32_t* indices, size_t count, uint32_t baseVertex, void* destination, size_t indexSize)
+{
+	if (indexSize == 4 && baseVertex == 0)
+	{
+		memcpy(destination, indices, count * sizeof(uint32_t));
+		return;
+	}
+	if (indexSize != 2 && indexSize != 4)
+	{
+		throw std::invalid_argument("Indices are 2 or 4 bytes.");
+	}
+
+	// Relative indices are computed with unsigned wraparound, so one below the base comes out
+	// too large for 16 bits, and is caught with the rest.
+	size_t i = 0;
+	uint32_t overflow = 0;
+	if (indexSize == 4)
+	{
+		uint32_t* output = static_cast<uint32_t*>(destination);
+		for (; i < count; ++i)
+		{
+			overflow |= indices[i] < baseVertex ? 1 : 0;
+			output[i] = indices[i] - baseVertex;
+		}
+	}
+	else
+	{
+		uint16_t* output = static_cast<uint16_t*>(destination);
+#if DX_SIMD_SSE2
+		{
+			// SSE2 only packs to signed 16 bits, so the values are moved into that range and
+			// back. Anything out of range is noted from its high bits, not saturated away.
+			const __m128i base = _mm_set1_epi32(static_cast<int>(baseVertex));
+			const __m128i signedBias = _mm_set1_epi32(0x8000);
+			const __m128i unsignedFlip = _mm_set1_epi16(static_cast<short>(0x8000));
+			__m128i high = _mm_setzero_si128();
+			for (; i + 8 <= count; i += 8)
+			{
+				const __m128i a = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + i)), base);
+				const __m128i b = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + i + 4)), base);
+				high = _mm_or_si128(high, _mm_srli_epi32(_mm_or_si128(a, b), 16));
+				const __m128i packed = _mm_packs_epi32(_mm_sub_epi32(a, signedBias), _mm_sub_epi32(b, signedBias));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_xor_si128(packed, unsignedFlip));
+			}
+			overflow |= _mm_movemask_epi8(_mm_cmpeq_epi32(high, _mm_setzero_si128())) != 0xFFFF ? 1 : 0;
+		}
+#elif DX_SIMD_NEON
+		{
+			const uint32x4_t base = vdupq_n_u32(baseVertex);
+			uint32x4_t high = vdupq_n_u32(0);
+			for (; i + 8 <= count; i += 8)
+			{
+				const uint32x4_t a = vsubq_u32(vld1q_u32(indices + i), base);
+				const uint32x4_t b = vsubq_u32(vld1q_u32(indices + i + 4), base);
+				high = vorrq_u32(high, vshrq_n_u32(vorrq_u32(a, b), 16));
+				vst1q_u16(output + i, vcombine_u16(vmovn_u32(a), vmovn_u32(b)));
+			}
+			overflow |= vmaxvq_u32(high) != 0 ? 1 : 0;
+		}
+#endif
+		for (; i < count; ++i)
+		{
+			const uint32_t index = indices[i] - baseVertex;
+			overflow |= index > c_maxIndex16 ? 1 : 0;
+			output[i] = static_cast<uint16_t>(index);
+		}
+	}
+
+	if (overflow)
+	{
+		throw std::out_of_range("Index doesn't fit relative to the base vertex.");
+	}
+}
+
+IndexBuffer DX::BuildIndexBuffer(Mesh const& mesh, uint32_t maxSubmeshes)
+{
+	if (mesh.Indices.size() % 3 != 0)
+	{
+		throw std::invalid_argument("Meshes are triangle lists.");
+	}
+	if (mesh.Indices.size() > UINT32_MAX)
+	{
+		throw std::length_error("Too many indices to draw.");
+	}
+
+	IndexBuffer buffer;
+	const uint32_t indexCount = static_cast<uint32_t>(mesh.Indices.size());
+
+	// Greedily cut the triangles into runs whose vertices fit 16 bits from the run's lowest
+	// one, which gives the fewest runs that keep the triangles in order.
+	bool split = true;
+	uint32_t lowest = UINT32_MAX;
+	uint32_t highest = 0;
+	for (uint32_t i = 0; i < indexCount && split; i += 3)
+	{
+		const uint32_t* triangle = &mesh.Indices[i];
+		const uint32_t triangleLowest = std::min({ triangle[0], triangle[1], triangle[2] });
+		const uint32_t triangleHighest = std::max({ triangle[0], triangle[1], triangle[2] });
+		if (i == 0 || (std::max(highest, triangleHighest) - std::min(lowest, triangleLowest)) > c_maxIndex16)
+		{
+			if (i != 0)
+			{
+				buffer.Submeshes.back().IndexCount = i - buffer.Submeshes.back().FirstIndex;
+			}
+			if (buffer.Submeshes.size() == maxSubmeshes || triangleHighest - triangleLowest > c_maxIndex16)
+			{
+				split = false;
+				break;
+			}
+			buffer.Submeshes.push_back(IndexedSubmesh{ i, 0, 0 });
+			lowest = triangleLowest;
+			highest = triangleHighest;
+		}
+		else
+		{
+			lowest = std::min(lowest, triangleLowest);
+			highest = std::max(highest, triangleHighest);
+		}
+		// The base is only known once the run ends, but is its lowest vertex so far.
+		buffer.Submeshes.back().BaseVertex = lowest;
+	}
+
+	if (!split)
+	{
+		buffer.IndexSize = 4;
+		buffer.Submeshes.assign(1, IndexedSubmesh{ 0, indexCount, 0 });
+		buffer.Data.resize(static_cast<size_t>(indexCount) * sizeof(uint32_t));
+		ConvertIndices(mesh.Indices.data(), indexCount, 0, buffer.Data.data(), sizeof(uint32_t));
+		return buffer;
+	}
+
+	buffer.IndexSize = 2;
+	buffer.Data.resize(static_cast<size_t>(indexCount) * sizeof(uint16_t));
+	if (buffer.Submeshes.empty())
+	{
+		return buffer;
+	}
+	buffer.Submeshes.back().IndexCount = indexCount - buffer.Submeshes.back().FirstIndex;
+
+	// A mesh that fits as it is keeps a base of zero, so it can be drawn without one.
+	if (buffer.Submeshes.size() == 1 && highest <= c_maxIndex16)
+	{
+		buffer.Submeshes[0].BaseVertex = 0;
+	}
+	for (IndexedSubmesh const& submesh : buffer.Submeshes)
+	{
+		ConvertIndices(mesh.Indices.data() + submesh.FirstIndex, submesh.IndexCount, submesh.BaseVertex,
+			buffer.Data.data() + static_cast<size_t>(submesh.FirstIndex) * sizeof(uint16_t), sizeof(uint16_t));
+	}
+	return buffer;
+}
@@ -0,0 +1,39 @@
+﻿#pragma once
+
+#include "MeshGenerator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace DX
+{
+	// One draw's range of an index buffer. Its indices are relative to BaseVertex.
+	struct IndexedSubmesh
+	{
+		uint32_t	FirstIndex;
+		uint32_t	IndexCount;
+		uint32_t	BaseVertex;
+	};
+
+	// Indices ready to upload, IndexSize bytes each, and the draws that cover them.
+	struct IndexBuffer
+	{
+		std::vector<uint8_t>		Data;
+		uint32_t					IndexSize;
+		std::vector<IndexedSubmesh>	Submeshes;
+	};
+
+	// Builds 16-bit indices when the mesh's triangles can be split, in order, into at most
+	// maxSubmeshes runs that each use a span of no more than 65536 vertices; each run is
+	// drawn with its lowest vertex as the base. Otherwise the indices are 32-bit, in one
+	// submesh. A mesh that fits in 16 bits is one submesh, and one slightly over splits in
+	// two, as long as its vertices are numbered in the order the triangles use them, as
+	// after OptimizeVertexFetch. A triangle whose vertices are further apart than that
+	// can't be drawn with 16-bit indices at all.
+	IndexBuffer BuildIndexBuffer(Mesh const& mesh, uint32_t maxSubmeshes = 4);
+
+	// Writes each index less baseVertex as an indexSize-byte integer. Throws
+	// std::out_of_range if one doesn't fit, which includes an index below baseVertex.
+	void ConvertIndices(const uint32_t* indices, size_t count, uint32_t baseVertex, void* destination, size_t indexSize);
+}
@@ -0,0 +1,493 @@
+﻿#include "MeshGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace DX;
+
+namespace
+{
+	const float c_pi = 3.14159265358979f;
+
+	// Adds the triangles of a grid of (columns + 1) x (rows + 1) vertices, stored in rows from
+	// firstVertex on. Each quad is split from its top right to its bottom left corner.
+	void AddGridTriangles(Mesh& mesh, uint32_t firstVertex, uint32_t columns, uint32_t rows)
+	{
+		for (uint32_t row = 0; row < rows; ++row)
+		{
+			for (uint32_t column = 0; column < columns; ++column)
+			{
+				const uint32_t topLeft = firstVertex + row * (columns + 1) + column;
+				const uint32_t bottomLeft = topLeft + columns + 1;
+				const uint32_t triangle[6] = { topLeft, topLeft + 1, bottomLeft, bottomLeft, topLeft + 1, bottomLeft + 1 };
+				mesh.Indices.insert(mesh.Indices.end(), triangle, triangle + 6);
+			}
+		}
+	}
+
+	// A face's grid: the corner at UV (0, 0), and the edges along which U and V increase.
+	void AddFace(Mesh& mesh, const float origin[3], const float right[3], const float down[3], uint32_t columns, uint32_t rows)
+	{
+		const uint32_t firstVertex = static_cast<uint32_t>(mesh.Vertices.size());
+		for (uint32_t row = 0; row <= rows; ++row)
+		{
+			const float v = static_cast<float>(row) / rows;
+			for (uint32_t column = 0; column <= columns; ++column)
+			{
+				const float u = static_cast<float>(column) / columns;
+				MeshVertex vertex;
+				for (int i = 0; i < 3; ++i)
+				{
+					vertex.Position[i] = origin[i] + u * right[i] + v * down[i];
+				}
+				vertex.UV[0] = u;
+				vertex.UV[1] = v;
+				mesh.Vertices.push_back(vertex);
+			}
+		}
+		AddGridTriangles(mesh, firstVertex, columns, rows);
+	}
+
+	// Longitude and latitude, as CreateUvSphere maps them: U is zero towards -X and grows
+	// towards +Z, V is zero at +Y.
+	void SetSphereUV(MeshVertex& vertex)
+	{
+		const float* p = vertex.Position;
+		const float length = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+		const float u = std::atan2(p[2], -p[0]) / (2.0f * c_pi);
+		vertex.UV[0] = u < 0.0f ? u + 1.0f : u;
+		vertex.UV[1] = std::acos(std::max(-1.0f, std::min(1.0f, p[1] / length))) / c_pi;
+	}
+
+	void CheckSegments(uint32_t count)
+	{
+		if (count == 0)
+		{
+			throw std::invalid_argument("Meshes need at least one segment.");
+		}
+	}
+
+	void CheckVertexCount(uint64_t count)
+	{
+		if (count > UINT32_MAX)
+		{
+			throw std::length_error("Too many vertices for 32-bit indices.");
+		}
+	}
+}
+
+Mesh DX::CreateCube(float size, uint32_t segments)
+{
+	CheckSegments(segments);
+	CheckVertexCount(6ull * (segments + 1) * (segments + 1));
+
+	// Each face's top left corner and the directions to its right and down, seen from outside.
+	const float h = 0.5f * size;
+	const float faces[6][3][3] =
+	{
+		{ { -h,  h,  h }, {  size, 0, 0 }, { 0, -size, 0 } },	// Front
+		{ {  h,  h,  h }, { 0, 0, -size }, { 0, -size, 0 } },	// Right
+		{ {  h,  h, -h }, { -size, 0, 0 }, { 0, -size, 0 } },	// Back
+		{ { -h,  h, -h }, { 0, 0,  size }, { 0, -size, 0 } },	// Left
+		{ { -h,  h, -h }, {  size, 0, 0 }, { 0, 0,  size } },	// Top
+		{ { -h, -h,  h }, {  size, 0, 0 }, { 0, 0, -size } },	// Bottom
+	};
+
+	Mesh mesh;
+	mesh.Vertices.reserve(6 * (segments + 1) * (segments + 1));
+	mesh.Indices.reserve(36 * segments * segments);
+	for (auto const& face : faces)
+	{
+		AddFace(mesh, face[0], face[1], face[2], segments, segments);
+	}
+	return mesh;
+}
+
+Mesh DX::CreatePlane(float width, float depth, uint32_t segmentsX, uint32_t segmentsZ)
+{
+	CheckSegments(segmentsX);
+	CheckSegments(segmentsZ);
+	CheckVertexCount(static_cast<uint64_t>(segmentsX + 1) * (segmentsZ + 1));
+
+	const float origin[3] = { -0.5f * width, 0, -0.5f * depth };
+	const float right[3] = { width, 0, 0 };
+	const float down[3] = { 0, 0, depth };
+
+	Mesh mesh;
+	mesh.Vertices.reserve(static_cast<size_t>(segmentsX + 1) * (segmentsZ + 1));
+	mesh.Indices.reserve(static_cast<size_t>(6) * segmentsX * segmentsZ);
+	AddFace(mesh, origin, right, down, segmentsX, segmentsZ);
+	return mesh;
+}
+
+Mesh DX::CreateUvSphere(float radius, uint32_t slices, uint32_t stacks)
+{
+	if (slices < 3 || stacks < 2)
+	{
+		throw std::invalid_argument("A sphere needs at least 3 slices and 2 stacks.");
+	}
+	CheckVertexCount(static_cast<uint64_t>(slices + 1) * (stacks + 1));
+
+	// The angles are the same down every column, and the same along every row.
+	std::vector<float> sines(slices + 1);
+	std::vector<float> cosines(slices + 1);
+	for (uint32_t slice = 0; slice <= slices; ++slice)
+	{
+		const float longitude = 2.0f * c_pi * slice / slices;
+		sines[slice] = slice == slices ? 0.0f : std::sin(longitude);
+		cosines[slice] = slice == slices ? 1.0f : std::cos(longitude);
+	}
+
+	Mesh mesh;
+	mesh.Vertices.reserve(static_cast<size_t>(slices + 1) * (stacks + 1));
+	mesh.Indices.reserve(static_cast<size_t>(6) * slices * (stacks - 1));
+	for (uint32_t stack = 0; stack <= stacks; ++stack)
+	{
+		const float latitude = c_pi * stack / stacks;
+		const float y = stack == 0 ? radius : stack == stacks ? -radius : radius * std::cos(latitude);
+		const float ring = stack == 0 || stack == stacks ? 0.0f : radius * std::sin(latitude);
+		for (uint32_t slice = 0; slice <= slices; ++slice)
+		{
+			MeshVertex vertex;
+			vertex.Position[0] = -ring * cosines[slice];
+			vertex.Position[1] = y;
+			vertex.Position[2] = ring * sines[slice];
+			vertex.UV[0] = static_cast<float>(slice) / slices;
+			vertex.UV[1] = static_cast<float>(stack) / stacks;
+			mesh.Vertices.push_back(vertex);
+		}
+	}
+
+	// The quads touching a pole have collapsed to triangles there.
+	for (uint32_t stack = 0; stack < stacks; ++stack)
+	{
+		for (uint32_t slice = 0; slice < slices; ++slice)
+		{
+			const uint32_t topLeft = stack * (slices + 1) + slice;
+			const uint32_t bottomLeft = topLeft + slices + 1;
+			if (stack > 0)
+			{
+				const uint32_t triangle[3] = { topLeft, topLeft + 1, bottomLeft };
+				mesh.Indices.insert(mesh.Indices.end(), triangle, triangle + 3);
+			}
+			if (stack + 1 < stacks)
+			{
+				const uint32_t triangle[3] = { bottomLeft, topLeft + 1, bottomLeft + 1 };
+				mesh.Indices.insert(mesh.Indices.end(), triangle, triangle + 3);
+			}
+		}
+	}
+	return mesh;
+}
+
+Mesh DX::CreateIcosphere(float radius, uint32_t edgeSegments)
+{
+	CheckSegments(edgeSegments);
+	const uint64_t faceVertexCount = static_cast<uint64_t>(edgeSegments + 1) * (edgeSegments + 2) / 2;
+	CheckVertexCount(20 * faceVertexCount);
+
+	const float phi = 1.61803398875f;
+	const float corners[12][3] =
+	{
+		{ -1, phi, 0 }, { 1, phi, 0 }, { -1, -phi, 0 }, { 1, -phi, 0 },
+		{ 0, -1, phi }, { 0, 1, phi }, { 0, -1, -phi }, { 0, 1, -phi },
+		{ phi, 0, -1 }, { phi, 0, 1 }, { -phi, 0, -1 }, { -phi, 0, 1 },
+	};
+	const uint32_t faces[20][3] =
+	{
+		{ 0, 5, 11 }, { 0, 1, 5 }, { 0, 7, 1 }, { 0, 10, 7 }, { 0, 11, 10 },
+		{ 1, 9, 5 }, { 5, 4, 11 }, { 11, 2, 10 }, { 10, 6, 7 }, { 7, 8, 1 },
+		{ 3, 4, 9 }, { 3, 2, 4 }, { 3, 6, 2 }, { 3, 8, 6 }, { 3, 9, 8 },
+		{ 4, 5, 9 }, { 2, 11, 4 }, { 6, 10, 2 }, { 8, 7, 6 }, { 9, 1, 8 },
+	};
+
+	// Each face is a triangular grid: row i holds edgeSegments + 1 - i vertices, stepping
+	// from a towards b along the row and towards c from row to row.
+	Mesh mesh;
+	mesh.Vertices.reserve(static_cast<size_t>(20 * faceVertexCount));
+	mesh.Indices.reserve(static_cast<size_t>(60) * edgeSegments * edgeSegments);
+	for (auto const& face : faces)
+	{
+		const float* a = corners[face[0]];
+		float ab[3];
+		float ac[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			ab[i] = (corners[face[1]][i] - a[i]) / edgeSegments;
+			ac[i] = (corners[face[2]][i] - a[i]) / edgeSegments;
+		}
+
+		const uint32_t firstVertex = static_cast<uint32_t>(mesh.Vertices.size());
+		for (uint32_t row = 0; row <= edgeSegments; ++row)
+		{
+			for (uint32_t column = 0; column + row <= edgeSegments; ++column)
+			{
+				float p[3];
+				for (int i = 0; i < 3; ++i)
+				{
+					p[i] = a[i] + column * ab[i] + row * ac[i];
+				}
+				const float scale = radius / std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+
+				MeshVertex vertex = {};
+				for (int i = 0; i < 3; ++i)
+				{
+					vertex.Position[i] = p[i] * scale;
+				}
+				mesh.Vertices.push_back(vertex);
+			}
+		}
+
+		// Row r starts (edgeSegments + 1) r - r (r - 1) / 2 vertices into the face.
+		uint32_t rowStart = firstVertex;
+		for (uint32_t row = 0; row < edgeSegments; ++row)
+		{
+			const uint32_t rowLength = edgeSegments + 1 - row;
+			const uint32_t nextRowStart = rowStart + rowLength;
+			for (uint32_t column = 0; column + 1 < rowLength; ++column)
+			{
+				const uint32_t triangle[3] = { rowStart + column, rowStart + column + 1, nextRowStart + column };
+				mesh.Indices.insert(mesh.Indices.end(), triangle, triangle + 3);
+				if (column + 2 < rowLength)
+				{
+					const uint32_t other[3] = { rowStart + column + 1, nextRowStart + column + 1, nextRowStart + column };
+					mesh.Indices.insert(mesh.Indices.end(), other, other + 3);
+				}
+			}
+			rowStart = nextRowStart;
+		}
+	}
+
+	// The faces' edges were generated once for each side.
+	WeldVertices(mesh, radius * 1e-5f);
+
+	for (MeshVertex& vertex : mesh.Vertices)
+	{
+		SetSphereUV(vertex);
+	}
+
+	// A triangle whose U spans more than half the texture crosses the seam, so its vertices
+	// on the low side get a copy with U past 1. U is undefined at a pole, so a pole vertex
+	// gets a copy for each triangle, with the U of the rest of the triangle.
+	const float poleTolerance = radius * 1e-6f;
+	const uint32_t vertexCount = static_cast<uint32_t>(mesh.Vertices.size());
+	std::vector<uint32_t> wrapped(vertexCount, UINT32_MAX);
+	for (size_t triangle = 0; triangle < mesh.Indices.size(); triangle += 3)
+	{
+		uint32_t* indices = &mesh.Indices[triangle];
+		bool pole[3];
+		float minU = 1.0f;
+		float maxU = 0.0f;
+		for (int i = 0; i < 3; ++i)
+		{
+			MeshVertex const& vertex = mesh.Vertices[indices[i]];
+			pole[i] = std::fabs(vertex.Position[0]) < poleTolerance && std::fabs(vertex.Position[2]) < poleTolerance;
+			if (!pole[i])
+			{
+				minU = std::min(minU, vertex.UV[0]);
+				maxU = std::max(maxU, vertex.UV[0]);
+			}
+		}
+
+		float sumU = 0.0f;
+		int count = 0;
+		for (int i = 0; i < 3; ++i)
+		{
+			if (pole[i])
+			{
+				continue;
+			}
+			if (maxU - minU > 0.5f && mesh.Vertices[indices[i]].UV[0] < 0.5f)
+			{
+				uint32_t& copy = wrapped[indices[i]];
+				if (copy == UINT32_MAX)
+				{
+					MeshVertex vertex = mesh.Vertices[indices[i]];
+					vertex.UV[0] += 1.0f;
+					copy = static_cast<uint32_t>(mesh.Vertices.size());
+					mesh.Vertices.push_back(vertex);
+				}
+				indices[i] = copy;
+			}
+			sumU += mesh.Vertices[indices[i]].UV[0];
+			++count;
+		}
+
+		for (int i = 0; i < 3; ++i)
+		{
+			if (pole[i])
+			{
+				MeshVertex vertex = mesh.Vertices[indices[i]];
+				vertex.UV[0] = sumU / static_cast<float>(count);
+				indices[i] = static_cast<uint32_t>(mesh.Vertices.size());
+				mesh.Vertices.push_back(vertex);
+			}
+		}
+	}
+	return mesh;
+}
+
+Mesh DX::CreateTorus(float majorRadius, float minorRadius, uint32_t majorSegments, uint32_t minorSegments)
+{
+	if (majorSegments < 3 || minorSegments < 3)
+	{
+		throw std::invalid_argument("A torus needs at least 3 segments each way.");
+	}
+	CheckVertexCount(static_cast<uint64_t>(majorSegments + 1) * (minorSegments + 1));
+
+	// U goes around the Y axis as on the sphere; V goes around the tube from its top,
+	// outwards first.
+	std::vector<float> tubeSines(minorSegments + 1);
+	std::vector<float> tubeCosines(minorSegments + 1);
+	for (uint32_t segment = 0; segment <= minorSegments; ++segment)
+	{
+		const float angle = 2.0f * c_pi * segment / minorSegments;
+		tubeSines[segment] = segment == minorSegments ? 0.0f : std::sin(angle);
+		tubeCosines[segment] = segment == minorSegments ? 1.0f : std::cos(angle);
+	}
+
+	Mesh mesh;
+	mesh.Vertices.reserve(static_cast<size_t>(majorSegments + 1) * (minorSegments + 1));
+	mesh.Indices.reserve(static_cast<size_t>(6) * majorSegments * minorSegments);
+	for (uint32_t tube = 0; tube <= minorSegments; ++tube)
+	{
+		const float distance = majorRadius + minorRadius * tubeSines[tube];
+		const float y = minorRadius * tubeCosines[tube];
+		for (uint32_t segment = 0; segment <= majorSegments; ++segment)
+		{
+			const float angle = 2.0f * c_pi * segment / majorSegments;
+			const float sine = segment == majorSegments ? 0.0f : std::sin(angle);
+			const float cosine = segment == majorSegments ? 1.0f : std::cos(angle);
+
+			MeshVertex vertex;
+			vertex.Position[0] = -distance * cosine;
+			vertex.Position[1] = y;
+			vertex.Position[2] = distance * sine;
+			vertex.UV[0] = static_cast<float>(segment) / majorSegments;
+			vertex.UV[1] = static_cast<float>(tube) / minorSegments;
+			mesh.Vertices.push_back(vertex);
+		}
+	}
+	AddGridTriangles(mesh, 0, majorSegments, minorSegments);
+	return mesh;
+}
+
+// Cells are at least twice the tolerance across, so every vertex within the tolerance of a
+// position is in its cell or, where the position is within the tolerance of a cell's side,
+// the one across it: 2x2x2 cells at most. They are made about the size of the spacing of the
+// vertices when that is larger, so most hold one vertex, and hash to buckets in a
+// power-of-two table, each chaining the kept vertices in it. The hash keeps cells that are
+// next to each other in X in neighbouring buckets, which keeps a run of nearby vertices in
+// cache.
+void DX::WeldVertices(Mesh& mesh, float positionTolerance, float uvTolerance)
+{
+	if (!(positionTolerance > 0.0f) || !(uvTolerance >= 0.0f))
+	{
+		throw std::invalid_argument("Weld tolerances must be positive.");
+	}
+
+	const size_t vertexCount = mesh.Vertices.size();
+	if (vertexCount == 0)
+	{
+		return;
+	}
+
+	float lower[3];
+	float upper[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		lower[i] = upper[i] = mesh.Vertices[0].Position[i];
+	}
+	for (MeshVertex const& vertex : mesh.Vertices)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			lower[i] = std::min(lower[i], vertex.Position[i]);
+			upper[i] = std::max(upper[i], vertex.Position[i]);
+		}
+	}
+	const float extent = std::max({ upper[0] - lower[0], upper[1] - lower[1], upper[2] - lower[2] });
+	const float cellSize = std::max(2.0f * positionTolerance, extent / std::sqrt(static_cast<float>(vertexCount)));
+	const float cellScale = 1.0f / cellSize;
+
+	size_t bucketCount = 1;
+	while (bucketCount < 2 * vertexCount)
+	{
+		bucketCount *= 2;
+	}
+
+	const uint32_t none = UINT32_MAX;
+	std::vector<uint32_t> buckets(bucketCount, none);
+	std::vector<uint32_t> next;
+	next.reserve(vertexCount);
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<MeshVertex> welded;
+	welded.reserve(vertexCount);
+
+	const float toleranceSquared = positionTolerance * positionTolerance;
+	auto getBucket = [&](int64_t x, int64_t y, int64_t z)
+	{
+		const uint64_t hash = static_cast<uint64_t>(x) + static_cast<uint64_t>(y) * 0x9E3779B1ull + static_cast<uint64_t>(z) * 0x85EBCA77C2B2AE63ull;
+		return static_cast<size_t>(hash & (bucketCount - 1));
+	};
+
+	for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+	{
+		MeshVertex const& v = mesh.Vertices[vertex];
+
+		// The cell, and the range of cells the tolerance box touches, found with one floor
+		// a coordinate.
+		int64_t cell[3];
+		int64_t first[3];
+		int64_t last[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			const float scaled = (v.Position[i] - lower[i]) * cellScale;
+			cell[i] = static_cast<int64_t>(scaled);
+			const float offset = (scaled - static_cast<float>(cell[i])) * cellSize;
+			first[i] = offset < positionTolerance ? cell[i] - 1 : cell[i];
+			last[i] = cellSize - offset < positionTolerance ? cell[i] + 1 : cell[i];
+		}
+
+		uint32_t match = none;
+		for (int64_t z = first[2]; z <= last[2] && match == none; ++z)
+		{
+			for (int64_t y = first[1]; y <= last[1] && match == none; ++y)
+			{
+				for (int64_t x = first[0]; x <= last[0] && match == none; ++x)
+				{
+					for (uint32_t candidate = buckets[getBucket(x, y, z)]; candidate != none; candidate = next[candidate])
+					{
+						MeshVertex const& w = welded[candidate];
+						const float dx = w.Position[0] - v.Position[0];
+						const float dy = w.Position[1] - v.Position[1];
+						const float dz = w.Position[2] - v.Position[2];
+						if (dx * dx + dy * dy + dz * dz <= toleranceSquared &&
+							std::fabs(w.UV[0] - v.UV[0]) <= uvTolerance && std::fabs(w.UV[1] - v.UV[1]) <= uvTolerance)
+						{
+							match = candidate;
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		if (match == none)
+		{
+			match = static_cast<uint32_t>(welded.size());
+			const size_t bucket = getBucket(cell[0], cell[1], cell[2]);
+			next.push_back(buckets[bucket]);
+			buckets[bucket] = match;
+			welded.push_back(v);
+		}
+		remap[vertex] = match;
+	}
+
+	for (uint32_t& index : mesh.Indices)
+	{
+		index = remap[index];
+	}
+	mesh.Vertices.swap(welded);
+}
@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace DX
+{
+	// Position and texture coordinates, laid out as the sample's VertexPositionTex.
+	struct MeshVertex
+	{
+		float	Position[3];
+		float	UV[2];
+	};
+
+	// An indexed triangle list. Front faces are clockwise seen from outside, as with the
+	// default rasterizer state, and UVs run right and down from the top left of each face.
+	struct Mesh
+	{
+		std::vector<MeshVertex>	Vertices;
+		std::vector<uint32_t>	Indices;
+	};
+
+	// A size x size cube centred on the origin, each face split into segments x segments
+	// quads with a texture of its own. Cube(1, 1) is the sample's 24-vertex cube.
+	Mesh CreateCube(float size, uint32_t segments);
+
+	// A width x depth plane in XZ, facing +Y, split into segmentsX x segmentsZ quads.
+	Mesh CreatePlane(float width, float depth, uint32_t segmentsX, uint32_t segmentsZ);
+
+	// A sphere around the Y axis, mapped with longitude and latitude. There is a column of
+	// vertices for the seam at each end of the texture, and a row for each pole.
+	Mesh CreateUvSphere(float radius, uint32_t slices, uint32_t stacks);
+
+	// An icosahedron with each edge split into edgeSegments, pushed out onto the sphere,
+	// so its triangles are close to equal in size. The faces' shared vertices are welded.
+	// It is mapped as CreateUvSphere is; triangles across the seam get vertices of their
+	// own there, as do the ones touching a pole.
+	Mesh CreateIcosphere(float radius, uint32_t edgeSegments);
+
+	// A torus around the Y axis: the tube's centre circles at majorRadius.
+	Mesh CreateTorus(float majorRadius, float minorRadius, uint32_t majorSegments, uint32_t minorSegments);
+
+	// Merges vertices whose positions are within positionTolerance of each other and whose
+	// UVs are within uvTolerance, keeping the first of each, and remaps the indices. Nearby
+	// vertices are found with a hash grid, so this is linear in the vertex count.
+	void WeldVertices(Mesh& mesh, float positionTolerance, float uvTolerance = 1e-6f);
+}
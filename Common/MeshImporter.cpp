@@ -0,0 +1,1096 @@
+﻿#include "MeshImporter.h"
+#include "FileView.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+using namespace DX;
+
+namespace
+{
+	const uint32_t c_none = UINT32_MAX;
+	const uint32_t c_maxJsonDepth = 64;
+
+	bool IsDigit(char c) { return static_cast<unsigned>(c - '0') < 10; }
+	bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+	// 16 if c isn't a hexadecimal digit.
+	uint32_t GetHexDigit(char c)
+	{
+		return IsDigit(c) ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : 16;
+	}
+
+	const char* SkipSpaces(const char* text, const char* end)
+	{
+		while (text != end && IsSpace(*text))
+		{
+			++text;
+		}
+		return text;
+	}
+
+	// To the start of the next line.
+	const char* SkipLine(const char* text, const char* end)
+	{
+		const char* newline = static_cast<const char*>(memchr(text, '\n', end - text));
+		return newline ? newline + 1 : end;
+	}
+
+	// Whether all eight bytes, lowest first, are ASCII digits: their high nibbles are 3, and
+	// stay 3 with 6 added to the low ones.
+	bool IsEightDigits(uint64_t chunk)
+	{
+		return ((chunk & 0xF0F0F0F0F0F0F0F0) | (((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) == 0x3333333333333333;
+	}
+
+	// Combines eight digits into pairs, then fours, then all eight, with a multiply for
+	// each. The first digit is in the lowest byte, as loads are little-endian on every
+	// target.
+	uint32_t ParseEightDigits(uint64_t chunk)
+	{
+		chunk -= 0x3030303030303030;
+		chunk = chunk * 10 + (chunk >> 8);
+		return static_cast<uint32_t>((((chunk & 0x000000FF000000FF) * (100 + (1000000ULL << 32))) +
+			(((chunk >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32)))) >> 32);
+	}
+
+	// Appends a run of digits to mantissa while it has room, which is for 18 digits at
+	// least. Digits after that are counted in dropped, and once one is, all the rest are.
+	const char* ParseDigits(const char* text, const char* end, uint64_t& mantissa, int& kept, int& dropped)
+	{
+		while (end - text >= 8 && mantissa < 10000000000ULL)
+		{
+			uint64_t chunk;
+			memcpy(&chunk, text, sizeof(chunk));
+			if (!IsEightDigits(chunk))
+			{
+				break;
+			}
+			mantissa = mantissa * 100000000 + ParseEightDigits(chunk);
+			kept += 8;
+			text += 8;
+		}
+		for (; text != end && IsDigit(*text); ++text)
+		{
+			if (dropped == 0 && mantissa < 1000000000000000000ULL)
+			{
+				mantissa = mantissa * 10 + static_cast<uint64_t>(*text - '0');
+				++kept;
+			}
+			else
+			{
+				++dropped;
+			}
+		}
+		return text;
+	}
+
+	// mantissa x 10^exponent. Both factors are exact doubles for the usual exponents, so
+	// there is a single rounding.
+	double ScaleByPowerOfTen(uint64_t mantissa, int exponent)
+	{
+		static const double c_powers[] =
+		{
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+		};
+		const double value = static_cast<double>(mantissa);
+		if (mantissa == 0)
+		{
+			return 0.0;
+		}
+		if (mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22)
+		{
+			return exponent >= 0 ? value * c_powers[exponent] : value / c_powers[-exponent];
+		}
+		return value * std::pow(10.0, exponent);
+	}
+
+	// A one-based OBJ index, negative to count back from the last element, as a zero-based
+	// index into the count elements so far, or c_none if it is out of range.
+	const char* ParseObjIndex(const char* text, const char* end, size_t count, uint32_t& index)
+	{
+		const bool negative = text != end && *text == '-';
+		if (negative)
+		{
+			++text;
+		}
+		if (text == end || !IsDigit(*text))
+		{
+			return nullptr;
+		}
+		uint64_t value = 0;
+		for (; text != end && IsDigit(*text); ++text)
+		{
+			value = std::min<uint64_t>(value * 10 + static_cast<uint64_t>(*text - '0'), UINT32_MAX);
+		}
+		if (value == 0 || value > count)
+		{
+			index = c_none;
+		}
+		else
+		{
+			index = static_cast<uint32_t>(negative ? count - value : value - 1);
+		}
+		return text;
+	}
+
+	// A JSON document as a tree in one array: each node links to its first child and its
+	// next sibling, and an object's children hold their keys. Strings are unescaped into
+	// one shared buffer.
+	class JsonDocument
+	{
+	public:
+		enum class Type : uint8_t
+		{
+			Null,
+			Boolean,
+			Number,
+			String,
+			Array,
+			Object,
+		};
+
+		JsonDocument(const char* text, size_t size) :
+			m_end(text + size)
+		{
+			const char* end = ParseValue(SkipWhitespace(text), 0);
+			if (SkipWhitespace(end) != m_end)
+			{
+				Fail("unexpected text after the document");
+			}
+		}
+
+		uint32_t GetRoot() const { return 0; }
+		Type GetType(uint32_t node) const { return m_nodes[node].Kind; }
+		double GetNumber(uint32_t node) const { return m_nodes[node].Number; }
+		uint32_t GetFirstChild(uint32_t node) const { return m_nodes[node].FirstChild; }
+		uint32_t GetNextSibling(uint32_t node) const { return m_nodes[node].NextSibling; }
+
+		std::string GetString(uint32_t node) const
+		{
+			Node const& string = m_nodes[node];
+			return m_strings.substr(string.StringOffset, string.StringLength);
+		}
+
+		// A member of an object, or c_none.
+		uint32_t Find(uint32_t object, const char* key) const
+		{
+			if (object == c_none || m_nodes[object].Kind != Type::Object)
+			{
+				return c_none;
+			}
+			const size_t keyLength = strlen(key);
+			for (uint32_t child = m_nodes[object].FirstChild; child != c_none; child = m_nodes[child].NextSibling)
+			{
+				Node const& member = m_nodes[child];
+				if (member.KeyLength == keyLength && m_strings.compare(member.KeyOffset, keyLength, key) == 0)
+				{
+					return child;
+				}
+			}
+			return c_none;
+		}
+
+		// The elements of an array, or none if it is missing.
+		std::vector<uint32_t> GetElements(uint32_t array) const
+		{
+			std::vector<uint32_t> elements;
+			if (array != c_none)
+			{
+				if (m_nodes[array].Kind != Type::Array)
+				{
+					throw MeshImportError("glTF: expected an array.");
+				}
+				for (uint32_t child = m_nodes[array].FirstChild; child != c_none; child = m_nodes[child].NextSibling)
+				{
+					elements.push_back(child);
+				}
+			}
+			return elements;
+		}
+
+	private:
+		struct Node
+		{
+			Type		Kind;
+			double		Number;			// 1 or 0 for booleans.
+			uint32_t	FirstChild;
+			uint32_t	NextSibling;
+			uint32_t	StringOffset;
+			uint32_t	StringLength;
+			uint32_t	KeyOffset;		// Into m_strings, for the members of objects.
+			uint32_t	KeyLength;
+		};
+
+		[[noreturn]] void Fail(const char* what) const
+		{
+			throw MeshImportError(std::string("glTF JSON: ") + what + ".");
+		}
+
+		const char* SkipWhitespace(const char* text) const
+		{
+			while (text != m_end && (*text == ' ' || *text == '\t' || *text == '\r' || *text == '\n'))
+			{
+				++text;
+			}
+			return text;
+		}
+
+		uint32_t AddNode(Type kind)
+		{
+			m_nodes.push_back(Node{ kind, 0.0, c_none, c_none, 0, 0, 0, 0 });
+			return static_cast<uint32_t>(m_nodes.size() - 1);
+		}
+
+		void AppendUtf8(uint32_t codePoint)
+		{
+			if (codePoint < 0x80)
+			{
+				m_strings += static_cast<char>(codePoint);
+			}
+			else if (codePoint < 0x800)
+			{
+				m_strings += static_cast<char>(0xC0 | (codePoint >> 6));
+				m_strings += static_cast<char>(0x80 | (codePoint & 0x3F));
+			}
+			else if (codePoint < 0x10000)
+			{
+				m_strings += static_cast<char>(0xE0 | (codePoint >> 12));
+				m_strings += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+				m_strings += static_cast<char>(0x80 | (codePoint & 0x3F));
+			}
+			else
+			{
+				m_strings += static_cast<char>(0xF0 | (codePoint >> 18));
+				m_strings += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+				m_strings += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+				m_strings += static_cast<char>(0x80 | (codePoint & 0x3F));
+			}
+		}
+
+		const char* ParseHex4(const char* text, uint32_t& value) const
+		{
+			if (m_end - text < 4)
+			{
+				Fail("truncated escape");
+			}
+			value = 0;
+			for (int i = 0; i < 4; ++i, ++text)
+			{
+				const uint32_t digit = GetHexDigit(*text);
+				if (digit == 16)
+				{
+					Fail("bad escape");
+				}
+				value = value * 16 + digit;
+			}
+			return text;
+		}
+
+		// Unescapes the string starting after its opening quote onto m_strings.
+		const char* ParseString(const char* text, uint32_t& offset, uint32_t& length)
+		{
+			offset = static_cast<uint32_t>(m_strings.size());
+			while (true)
+			{
+				const char* run = text;
+				while (text != m_end && *text != '"' && *text != '\\')
+				{
+					++text;
+				}
+				m_strings.append(run, text);
+				if (text == m_end)
+				{
+					Fail("unterminated string");
+				}
+				if (*text++ == '"')
+				{
+					break;
+				}
+				if (text == m_end)
+				{
+					Fail("unterminated string");
+				}
+				const char escape = *text++;
+				switch (escape)
+				{
+				case '"': case '\\': case '/': m_strings += escape; break;
+				case 'b': m_strings += '\b'; break;
+				case 'f': m_strings += '\f'; break;
+				case 'n': m_strings += '\n'; break;
+				case 'r': m_strings += '\r'; break;
+				case 't': m_strings += '\t'; break;
+				case 'u':
+				{
+					uint32_t codePoint;
+					text = ParseHex4(text, codePoint);
+					if (codePoint >= 0xD800 && codePoint < 0xDC00 && m_end - text >= 2 && text[0] == '\\' && text[1] == 'u')
+					{
+						uint32_t low;
+						const char* next = ParseHex4(text + 2, low);
+						if (low >= 0xDC00 && low < 0xE000)
+						{
+							codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+							text = next;
+						}
+					}
+					AppendUtf8(codePoint);
+					break;
+				}
+				default:
+					Fail("bad escape");
+				}
+			}
+			length = static_cast<uint32_t>(m_strings.size() - offset);
+			return text;
+		}
+
+		const char* ParseValue(const char* text, uint32_t depth)
+		{
+			if (depth > c_maxJsonDepth)
+			{
+				Fail("nested too deeply");
+			}
+			if (text == m_end)
+			{
+				Fail("unexpected end");
+			}
+
+			auto matches = [&](const char* literal)
+			{
+				const size_t length = strlen(literal);
+				return static_cast<size_t>(m_end - text) >= length && memcmp(text, literal, length) == 0;
+			};
+
+			const char c = *text;
+			if (c == '{' || c == '[')
+			{
+				const bool isObject = c == '{';
+				const uint32_t node = AddNode(isObject ? Type::Object : Type::Array);
+				uint32_t previous = c_none;
+				text = SkipWhitespace(text + 1);
+				if (text != m_end && *text == (isObject ? '}' : ']'))
+				{
+					return text + 1;
+				}
+				while (true)
+				{
+					uint32_t keyOffset = 0;
+					uint32_t keyLength = 0;
+					if (isObject)
+					{
+						if (text == m_end || *text != '"')
+						{
+							Fail("expected a key");
+						}
+						text = SkipWhitespace(ParseString(text + 1, keyOffset, keyLength));
+						if (text == m_end || *text != ':')
+						{
+							Fail("expected ':'");
+						}
+						text = SkipWhitespace(text + 1);
+					}
+
+					const uint32_t child = static_cast<uint32_t>(m_nodes.size());
+					text = SkipWhitespace(ParseValue(text, depth + 1));
+					m_nodes[child].KeyOffset = keyOffset;
+					m_nodes[child].KeyLength = keyLength;
+					(previous == c_none ? m_nodes[node].FirstChild : m_nodes[previous].NextSibling) = child;
+					previous = child;
+
+					if (text != m_end && *text == ',')
+					{
+						text = SkipWhitespace(text + 1);
+					}
+					else if (text != m_end && *text == (isObject ? '}' : ']'))
+					{
+						return text + 1;
+					}
+					else
+					{
+						Fail(isObject ? "expected ',' or '}'" : "expected ',' or ']'");
+					}
+				}
+			}
+			if (c == '"')
+			{
+				const uint32_t node = AddNode(Type::String);
+				uint32_t offset;
+				uint32_t length;
+				text = ParseString(text + 1, offset, length);
+				m_nodes[node].StringOffset = offset;
+				m_nodes[node].StringLength = length;
+				return text;
+			}
+			if (matches("true") || matches("false"))
+			{
+				m_nodes[AddNode(Type::Boolean)].Number = c == 't' ? 1.0 : 0.0;
+				return text + (c == 't' ? 4 : 5);
+			}
+			if (matches("null"))
+			{
+				AddNode(Type::Null);
+				return text + 4;
+			}
+
+			double number;
+			const char* end = ParseDouble(text, m_end, number);
+			if (!end)
+			{
+				Fail("unexpected character");
+			}
+			m_nodes[AddNode(Type::Number)].Number = number;
+			return end;
+		}
+
+		const char*			m_end;
+		std::vector<Node>	m_nodes;
+		std::string			m_strings;
+	};
+
+	// A range of bytes in one of a glTF file's buffers.
+	struct GltfBufferView
+	{
+		const uint8_t*	Data;
+		size_t			Size;
+		size_t			Stride;		// Zero if the accessor's elements are packed.
+	};
+
+	struct GltfAccessor
+	{
+		const uint8_t*	Data;
+		size_t			Count;
+		size_t			Stride;
+		uint32_t		ComponentType;
+		bool			Normalized;
+	};
+
+	const uint32_t c_gltfUnsignedByte = 5121;
+	const uint32_t c_gltfUnsignedShort = 5123;
+	const uint32_t c_gltfUnsignedInt = 5125;
+	const uint32_t c_gltfFloat = 5126;
+	const uint32_t c_gltfTriangles = 4;
+
+	uint32_t ReadUint32(const uint8_t* data)
+	{
+		uint32_t value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	// A URI's percent escapes decoded, then its UTF-8 as a wide string for FileView.
+	std::wstring UriToFileName(std::string const& uri)
+	{
+		std::string bytes;
+		for (size_t i = 0; i < uri.size(); ++i)
+		{
+			if (uri[i] == '%' && i + 2 < uri.size() && GetHexDigit(uri[i + 1]) < 16 && GetHexDigit(uri[i + 2]) < 16)
+			{
+				bytes += static_cast<char>(GetHexDigit(uri[i + 1]) * 16 + GetHexDigit(uri[i + 2]));
+				i += 2;
+			}
+			else
+			{
+				bytes += uri[i];
+			}
+		}
+
+		std::wstring name;
+		for (size_t i = 0; i < bytes.size();)
+		{
+			const uint8_t lead = static_cast<uint8_t>(bytes[i]);
+			const size_t length = lead < 0x80 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+			uint32_t codePoint = length == 1 ? lead : lead & (0x7F >> length);
+			for (size_t j = 1; j < length && i + j < bytes.size(); ++j)
+			{
+				codePoint = (codePoint << 6) | (static_cast<uint8_t>(bytes[i + j]) & 0x3F);
+			}
+			i += length;
+			if (sizeof(wchar_t) == 2 && codePoint >= 0x10000)
+			{
+				name += static_cast<wchar_t>(0xD800 + ((codePoint - 0x10000) >> 10));
+				name += static_cast<wchar_t>(0xDC00 + ((codePoint - 0x10000) & 0x3FF));
+			}
+			else
+			{
+				name += static_cast<wchar_t>(codePoint);
+			}
+		}
+		return name;
+	}
+}
+
+const char* DX::ParseDouble(const char* text, const char* end, double& value)
+{
+	bool negative = false;
+	if (text != end && (*text == '-' || *text == '+'))
+	{
+		negative = *text == '-';
+		++text;
+	}
+
+	uint64_t mantissa = 0;
+	int kept = 0;
+	int dropped = 0;
+	const char* digits = text;
+	text = ParseDigits(text, end, mantissa, kept, dropped);
+	size_t digitCount = text - digits;
+	int exponent = dropped;
+
+	if (text != end && *text == '.')
+	{
+		const char* fraction = ++text;
+		const int integerKept = kept;
+		text = ParseDigits(text, end, mantissa, kept, dropped);
+		digitCount += text - fraction;
+		exponent -= kept - integerKept;
+	}
+	if (digitCount == 0)
+	{
+		return nullptr;
+	}
+
+	// An 'e' without digits after it isn't part of the number.
+	if (text != end && (*text == 'e' || *text == 'E'))
+	{
+		const char* exponentText = text + 1;
+		bool negativeExponent = false;
+		if (exponentText != end && (*exponentText == '-' || *exponentText == '+'))
+		{
+			negativeExponent = *exponentText == '-';
+			++exponentText;
+		}
+		if (exponentText != end && IsDigit(*exponentText))
+		{
+			int explicitExponent = 0;
+			for (; exponentText != end && IsDigit(*exponentText); ++exponentText)
+			{
+				explicitExponent = std::min(explicitExponent * 10 + (*exponentText - '0'), 100000);
+			}
+			exponent += negativeExponent ? -explicitExponent : explicitExponent;
+			text = exponentText;
+		}
+	}
+
+	value = ScaleByPowerOfTen(mantissa, exponent);
+	if (negative)
+	{
+		value = -value;
+	}
+	return text;
+}
+
+const char* DX::ParseFloat(const char* text, const char* end, float& value)
+{
+	double result;
+	text = ParseDouble(text, end, result);
+	if (text)
+	{
+		value = static_cast<float>(result);
+	}
+	return text;
+}
+
+Mesh DX::ImportObj(const char* text, size_t size)
+{
+	const char* const end = text + size;
+
+	// Count the elements first, so that every array is allocated once at its final size,
+	// rather than growing and briefly needing twice the memory. This reads little more
+	// than the line starts, and the file is in the page cache for the second pass.
+	size_t positionCount = 0;
+	size_t uvCount = 0;
+	size_t faceCount = 0;
+	for (const char* line = text; line != end; line = SkipLine(line, end))
+	{
+		line = SkipSpaces(line, end);
+		if (end - line >= 2 && line[0] == 'v' && IsSpace(line[1]))
+		{
+			++positionCount;
+		}
+		else if (end - line >= 3 && line[0] == 'v' && line[1] == 't' && IsSpace(line[2]))
+		{
+			++uvCount;
+		}
+		else if (end - line >= 2 && line[0] == 'f' && IsSpace(line[1]))
+		{
+			++faceCount;
+		}
+	}
+	if (positionCount >= c_none || uvCount >= c_none)
+	{
+		throw MeshImportError("OBJ: too many vertices.");
+	}
+
+	struct Float3 { float Values[3]; };
+	struct Float2 { float Values[2]; };
+	std::vector<Float3> positions;
+	std::vector<Float2> uvs;
+	positions.reserve(positionCount);
+	uvs.reserve(uvCount);
+
+	// Each position's vertices, one for each UV it is used with, in a list through
+	// nextVertex.
+	std::vector<uint32_t> firstVertex(positionCount, c_none);
+	std::vector<uint32_t> nextVertex;
+	std::vector<uint32_t> vertexUvs;
+	nextVertex.reserve(positionCount);
+	vertexUvs.reserve(positionCount);
+
+	Mesh mesh;
+	mesh.Vertices.reserve(positionCount);
+	mesh.Indices.reserve(faceCount * 3);
+
+	uint64_t lineNumber = 0;
+	auto fail = [&](const char* what)
+	{
+		throw MeshImportError("OBJ line " + std::to_string(lineNumber) + ": " + what);
+	};
+
+	auto getVertex = [&](uint32_t position, uint32_t uv)
+	{
+		for (uint32_t vertex = firstVertex[position]; vertex != c_none; vertex = nextVertex[vertex])
+		{
+			if (vertexUvs[vertex] == uv)
+			{
+				return vertex;
+			}
+		}
+		if (mesh.Vertices.size() >= c_none)
+		{
+			fail("too many vertices.");
+		}
+
+		// OBJ texture coordinates run up from the bottom of the texture.
+		MeshVertex vertex;
+		memcpy(vertex.Position, positions[position].Values, sizeof(vertex.Position));
+		vertex.UV[0] = uv == c_none ? 0.0f : uvs[uv].Values[0];
+		vertex.UV[1] = uv == c_none ? 0.0f : 1.0f - uvs[uv].Values[1];
+
+		const uint32_t index = static_cast<uint32_t>(mesh.Vertices.size());
+		mesh.Vertices.push_back(vertex);
+		vertexUvs.push_back(uv);
+		nextVertex.push_back(firstVertex[position]);
+		firstVertex[position] = index;
+		return index;
+	};
+
+	for (const char* line = text; line != end; line = SkipLine(line, end))
+	{
+		++lineNumber;
+		const char* p = SkipSpaces(line, end);
+		if (end - p < 2)
+		{
+			continue;
+		}
+
+		if (p[0] == 'v' && IsSpace(p[1]))
+		{
+			// Anything after x, y and z, such as w or a vertex colour, is ignored.
+			Float3 position;
+			p += 2;
+			for (float& value : position.Values)
+			{
+				p = ParseFloat(SkipSpaces(p, end), end, value);
+				if (!p)
+				{
+					fail("expected a number.");
+				}
+			}
+			positions.push_back(position);
+		}
+		else if (p[0] == 'v' && p[1] == 't' && end - p >= 3 && IsSpace(p[2]))
+		{
+			Float2 uv = { { 0.0f, 0.0f } };
+			p = ParseFloat(SkipSpaces(p + 3, end), end, uv.Values[0]);
+			if (!p)
+			{
+				fail("expected a number.");
+			}
+			const char* v = ParseFloat(SkipSpaces(p, end), end, uv.Values[1]);
+			if (!v)
+			{
+				uv.Values[1] = 0.0f;
+			}
+			uvs.push_back(uv);
+		}
+		else if (p[0] == 'f' && IsSpace(p[1]))
+		{
+			// Corners are v, v/vt, v//vn or v/vt/vn. Polygons are fanned out from their first
+			// corner, turning OBJ's counter-clockwise front faces clockwise.
+			uint32_t first = c_none;
+			uint32_t previous = c_none;
+			uint32_t cornerCount = 0;
+			p = SkipSpaces(p + 1, end);
+			while (p != end && *p != '\n' && *p != '#')
+			{
+				uint32_t position;
+				uint32_t uv = c_none;
+				p = ParseObjIndex(p, end, positions.size(), position);
+				if (!p || position == c_none)
+				{
+					fail(p ? "position index out of range." : "expected an index.");
+				}
+				if (p != end && *p == '/')
+				{
+					++p;
+					if (p != end && *p != '/')
+					{
+						p = ParseObjIndex(p, end, uvs.size(), uv);
+						if (!p || uv == c_none)
+						{
+							fail(p ? "texture coordinate index out of range." : "expected an index.");
+						}
+					}
+					if (p != end && *p == '/')
+					{
+						uint32_t normal;
+						p = ParseObjIndex(p + 1, end, UINT32_MAX, normal);
+						if (!p)
+						{
+							fail("expected an index.");
+						}
+					}
+				}
+
+				const uint32_t vertex = getVertex(position, uv);
+				if (cornerCount == 0)
+				{
+					first = vertex;
+				}
+				else if (cornerCount >= 2)
+				{
+					mesh.Indices.push_back(first);
+					mesh.Indices.push_back(vertex);
+					mesh.Indices.push_back(previous);
+				}
+				previous = vertex;
+				++cornerCount;
+				p = SkipSpaces(p, end);
+			}
+			if (cornerCount < 3)
+			{
+				fail("faces need at least three corners.");
+			}
+		}
+	}
+	return mesh;
+}
+
+Mesh DX::ImportGltf(const uint8_t* data, size_t size, std::wstring const& directory)
+{
+	// A .glb file is a header and chunks: the JSON, then optionally the first buffer.
+	const char* json = reinterpret_cast<const char*>(data);
+	size_t jsonSize = size;
+	const uint8_t* binaryChunk = nullptr;
+	size_t binaryChunkSize = 0;
+	if (size >= 12 && ReadUint32(data) == 0x46546C67)
+	{
+		if (ReadUint32(data + 4) != 2)
+		{
+			throw MeshImportError("glTF: only version 2 is supported.");
+		}
+		const size_t length = std::min<size_t>(ReadUint32(data + 8), size);
+		json = nullptr;
+		for (size_t offset = 12; offset + 8 <= length;)
+		{
+			const size_t chunkSize = ReadUint32(data + offset);
+			const uint32_t chunkType = ReadUint32(data + offset + 4);
+			if (chunkSize > length - offset - 8)
+			{
+				throw MeshImportError("glTF: chunk runs past the end of the file.");
+			}
+			if (chunkType == 0x4E4F534A && !json)
+			{
+				json = reinterpret_cast<const char*>(data + offset + 8);
+				jsonSize = chunkSize;
+			}
+			else if (chunkType == 0x004E4942 && !binaryChunk)
+			{
+				binaryChunk = data + offset + 8;
+				binaryChunkSize = chunkSize;
+			}
+			offset += 8 + ((chunkSize + 3) & ~size_t(3));
+		}
+		if (!json)
+		{
+			throw MeshImportError("glTF: no JSON chunk.");
+		}
+	}
+
+	JsonDocument document(json, jsonSize);
+	const uint32_t root = document.GetRoot();
+
+	auto getInteger = [&](uint32_t object, const char* key, uint64_t defaultValue)
+	{
+		const uint32_t node = document.Find(object, key);
+		if (node == c_none)
+		{
+			if (defaultValue == UINT64_MAX)
+			{
+				throw MeshImportError(std::string("glTF: '") + key + "' is missing.");
+			}
+			return defaultValue;
+		}
+		const double value = document.GetType(node) == JsonDocument::Type::Number ? document.GetNumber(node) : -1.0;
+		if (!(value >= 0.0 && value <= 9007199254740992.0 && value == std::floor(value)))
+		{
+			throw MeshImportError(std::string("glTF: '") + key + "' isn't a valid count or index.");
+		}
+		return static_cast<uint64_t>(value);
+	};
+	auto getString = [&](uint32_t object, const char* key)
+	{
+		const uint32_t node = document.Find(object, key);
+		return node != c_none && document.GetType(node) == JsonDocument::Type::String ? document.GetString(node) : std::string();
+	};
+
+	// Buffers are mapped as they are, never copied.
+	std::vector<FileView> files;
+	std::vector<std::pair<const uint8_t*, size_t>> buffers;
+	for (uint32_t buffer : document.GetElements(document.Find(root, "buffers")))
+	{
+		const uint64_t byteLength = getInteger(buffer, "byteLength", UINT64_MAX);
+		const std::string uri = getString(buffer, "uri");
+		if (uri.empty())
+		{
+			if (!buffers.empty() || !binaryChunk || byteLength > binaryChunkSize)
+			{
+				throw MeshImportError("glTF: a buffer without a URI must be the .glb file's binary chunk.");
+			}
+			buffers.emplace_back(binaryChunk, static_cast<size_t>(byteLength));
+			continue;
+		}
+		if (uri.compare(0, 5, "data:") == 0)
+		{
+			throw MeshImportError("glTF: buffers embedded as data URIs aren't supported.");
+		}
+		files.emplace_back(directory + UriToFileName(uri), FileAccess::Sequential);
+		if (byteLength > files.back().GetSize())
+		{
+			throw MeshImportError("glTF: buffer file is shorter than its byteLength.");
+		}
+		buffers.emplace_back(files.back().GetData(), static_cast<size_t>(byteLength));
+	}
+
+	std::vector<GltfBufferView> bufferViews;
+	for (uint32_t bufferView : document.GetElements(document.Find(root, "bufferViews")))
+	{
+		const uint64_t buffer = getInteger(bufferView, "buffer", UINT64_MAX);
+		const uint64_t offset = getInteger(bufferView, "byteOffset", 0);
+		const uint64_t length = getInteger(bufferView, "byteLength", UINT64_MAX);
+		if (buffer >= buffers.size() || offset > buffers[buffer].second || length > buffers[buffer].second - offset)
+		{
+			throw MeshImportError("glTF: buffer view is out of range.");
+		}
+		bufferViews.push_back(GltfBufferView{ buffers[buffer].first + offset, static_cast<size_t>(length), static_cast<size_t>(getInteger(bufferView, "byteStride", 0)) });
+	}
+
+	const std::vector<uint32_t> accessors = document.GetElements(document.Find(root, "accessors"));
+	auto getAccessor = [&](uint64_t index, uint32_t components)
+	{
+		if (index >= accessors.size())
+		{
+			throw MeshImportError("glTF: accessor index is out of range.");
+		}
+		const uint32_t accessor = accessors[index];
+		static const char* const c_types[] = { "", "SCALAR", "VEC2", "VEC3" };
+		if (getString(accessor, "type") != c_types[components])
+		{
+			throw MeshImportError(std::string("glTF: expected a ") + c_types[components] + " accessor.");
+		}
+		if (document.Find(accessor, "sparse") != c_none || document.Find(accessor, "bufferView") == c_none)
+		{
+			throw MeshImportError("glTF: sparse accessors and accessors without buffer views aren't supported.");
+		}
+
+		GltfAccessor result;
+		result.ComponentType = static_cast<uint32_t>(getInteger(accessor, "componentType", UINT64_MAX));
+		const uint32_t normalized = document.Find(accessor, "normalized");
+		result.Normalized = normalized != c_none && document.GetNumber(normalized) != 0.0;
+		result.Count = static_cast<size_t>(getInteger(accessor, "count", UINT64_MAX));
+
+		const size_t componentSize = result.ComponentType == c_gltfUnsignedByte ? 1 : result.ComponentType == c_gltfUnsignedShort ? 2 : 4;
+		const size_t elementSize = componentSize * components;
+		const uint64_t view = getInteger(accessor, "bufferView", UINT64_MAX);
+		const uint64_t offset = getInteger(accessor, "byteOffset", 0);
+		if (view >= bufferViews.size())
+		{
+			throw MeshImportError("glTF: buffer view index is out of range.");
+		}
+		GltfBufferView const& bufferView = bufferViews[view];
+		result.Stride = bufferView.Stride != 0 ? bufferView.Stride : elementSize;
+		if (result.Stride < elementSize || (result.Count != 0 && (offset > bufferView.Size || bufferView.Size - offset < elementSize ||
+			(bufferView.Size - offset - elementSize) / result.Stride < result.Count - 1)))
+		{
+			throw MeshImportError("glTF: accessor runs past its buffer view.");
+		}
+		result.Data = bufferView.Data + offset;
+		return result;
+	};
+
+	// Gather the triangle lists first, so the mesh is allocated once at its final size.
+	struct Primitive
+	{
+		GltfAccessor	Positions;
+		GltfAccessor	UVs;		// Count is zero without texture coordinates.
+		GltfAccessor	Indices;	// Count is zero for a primitive that isn't indexed.
+	};
+	std::vector<Primitive> primitives;
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	for (uint32_t mesh : document.GetElements(document.Find(root, "meshes")))
+	{
+		for (uint32_t primitive : document.GetElements(document.Find(mesh, "primitives")))
+		{
+			// Points and lines have no surface to draw.
+			const uint64_t mode = getInteger(primitive, "mode", c_gltfTriangles);
+			if (mode < c_gltfTriangles)
+			{
+				continue;
+			}
+			if (mode != c_gltfTriangles)
+			{
+				throw MeshImportError("glTF: triangle strips and fans aren't supported.");
+			}
+
+			const uint32_t attributes = document.Find(primitive, "attributes");
+			Primitive gathered = {};
+			gathered.Positions = getAccessor(getInteger(attributes, "POSITION", UINT64_MAX), 3);
+			if (gathered.Positions.ComponentType != c_gltfFloat)
+			{
+				throw MeshImportError("glTF: positions must be floats.");
+			}
+			if (document.Find(attributes, "TEXCOORD_0") != c_none)
+			{
+				gathered.UVs = getAccessor(getInteger(attributes, "TEXCOORD_0", UINT64_MAX), 2);
+				if (gathered.UVs.Count != gathered.Positions.Count ||
+					(gathered.UVs.ComponentType != c_gltfFloat && !(gathered.UVs.Normalized &&
+					(gathered.UVs.ComponentType == c_gltfUnsignedByte || gathered.UVs.ComponentType == c_gltfUnsignedShort))))
+				{
+					throw MeshImportError("glTF: texture coordinates must be floats or normalized bytes or shorts, one per position.");
+				}
+			}
+			if (document.Find(primitive, "indices") != c_none)
+			{
+				gathered.Indices = getAccessor(getInteger(primitive, "indices", UINT64_MAX), 1);
+				if (gathered.Indices.ComponentType != c_gltfUnsignedByte && gathered.Indices.ComponentType != c_gltfUnsignedShort &&
+					gathered.Indices.ComponentType != c_gltfUnsignedInt)
+				{
+					throw MeshImportError("glTF: indices must be unsigned integers.");
+				}
+			}
+			const size_t primitiveIndexCount = document.Find(primitive, "indices") != c_none ? gathered.Indices.Count : gathered.Positions.Count;
+			if (primitiveIndexCount % 3 != 0)
+			{
+				throw MeshImportError("glTF: triangle list index count isn't a multiple of three.");
+			}
+			vertexCount += gathered.Positions.Count;
+			indexCount += primitiveIndexCount;
+			if (vertexCount >= c_none)
+			{
+				throw MeshImportError("glTF: too many vertices.");
+			}
+			primitives.push_back(gathered);
+		}
+	}
+
+	Mesh result;
+	result.Vertices.resize(vertexCount);
+	result.Indices.resize(indexCount);
+	MeshVertex* vertex = result.Vertices.data();
+	uint32_t* index = result.Indices.data();
+	for (Primitive const& primitive : primitives)
+	{
+		const uint32_t baseVertex = static_cast<uint32_t>(vertex - result.Vertices.data());
+		for (size_t i = 0; i < primitive.Positions.Count; ++i, ++vertex)
+		{
+			memcpy(vertex->Position, primitive.Positions.Data + i * primitive.Positions.Stride, sizeof(vertex->Position));
+			if (primitive.UVs.Count == 0)
+			{
+				vertex->UV[0] = 0.0f;
+				vertex->UV[1] = 0.0f;
+				continue;
+			}
+			const uint8_t* uv = primitive.UVs.Data + i * primitive.UVs.Stride;
+			if (primitive.UVs.ComponentType == c_gltfFloat)
+			{
+				memcpy(vertex->UV, uv, sizeof(vertex->UV));
+			}
+			else if (primitive.UVs.ComponentType == c_gltfUnsignedShort)
+			{
+				uint16_t values[2];
+				memcpy(values, uv, sizeof(values));
+				vertex->UV[0] = values[0] / 65535.0f;
+				vertex->UV[1] = values[1] / 65535.0f;
+			}
+			else
+			{
+				vertex->UV[0] = uv[0] / 255.0f;
+				vertex->UV[1] = uv[1] / 255.0f;
+			}
+		}
+
+		// glTF's front faces are counter-clockwise, so each triangle's last two corners swap.
+		const size_t primitiveIndexCount = primitive.Indices.Count != 0 ? primitive.Indices.Count : primitive.Positions.Count;
+		for (size_t i = 0; i < primitiveIndexCount; i += 3, index += 3)
+		{
+			uint32_t corners[3];
+			for (size_t corner = 0; corner < 3; ++corner)
+			{
+				if (primitive.Indices.Count == 0)
+				{
+					corners[corner] = static_cast<uint32_t>(i + corner);
+					continue;
+				}
+				const uint8_t* source = primitive.Indices.Data + (i + corner) * primitive.Indices.Stride;
+				if (primitive.Indices.ComponentType == c_gltfUnsignedInt)
+				{
+					memcpy(&corners[corner], source, sizeof(uint32_t));
+				}
+				else if (primitive.Indices.ComponentType == c_gltfUnsignedShort)
+				{
+					uint16_t value;
+					memcpy(&value, source, sizeof(value));
+					corners[corner] = value;
+				}
+				else
+				{
+					corners[corner] = *source;
+				}
+				if (corners[corner] >= primitive.Positions.Count)
+				{
+					throw MeshImportError("glTF: index is out of range.");
+				}
+			}
+			index[0] = baseVertex + corners[0];
+			index[1] = baseVertex + corners[2];
+			index[2] = baseVertex + corners[1];
+		}
+	}
+	return result;
+}
+
+Mesh DX::ImportMesh(std::wstring const& fileName)
+{
+	const size_t dot = fileName.find_last_of(L'.');
+	std::wstring extension = dot == std::wstring::npos ? std::wstring() : fileName.substr(dot);
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](wchar_t c) { return static_cast<wchar_t>(c >= L'A' && c <= L'Z' ? c - L'A' + L'a' : c); });
+
+	if (extension == L".obj")
+	{
+		FileView file(fileName, FileAccess::Sequential);
+		return ImportObj(reinterpret_cast<const char*>(file.GetData()), file.GetSize());
+	}
+	if (extension == L".gltf" || extension == L".glb")
+	{
+		const size_t slash = fileName.find_last_of(L"\\/");
+		FileView file(fileName, FileAccess::Sequential);
+		return ImportGltf(file.GetData(), file.GetSize(), slash == std::wstring::npos ? std::wstring() : fileName.substr(0, slash + 1));
+	}
+	throw MeshImportError("Mesh files must be .obj, .gltf or .glb.");
+}
@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#include "MeshGenerator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace DX
+{
+	// Thrown when a mesh file is malformed or uses something the importer doesn't support.
+	class MeshImportError : public std::runtime_error
+	{
+	public:
+		explicit MeshImportError(std::string const& message) : std::runtime_error(message) {}
+	};
+
+	// Imports a Wavefront OBJ (.obj) or glTF 2.0 (.gltf with its buffers in files of their own,
+	// or .glb) file as one mesh, following the conventions of CreateCube: front faces
+	// clockwise and UVs running down from the top of the texture. The file is memory-mapped
+	// and parsed in place, so besides the mesh itself, the importer only holds a few bytes
+	// per vertex while it works. Throws MeshImportError, or FileViewError if a file can't be
+	// read.
+	Mesh ImportMesh(std::wstring const& fileName);
+
+	// Positions and texture coordinates of every face, triangulated as fans. Vertices are
+	// shared by the corners that use the same position and texture coordinates; normals,
+	// groups and materials are ignored.
+	Mesh ImportObj(const char* text, size_t size);
+
+	// The triangles of every primitive of every mesh, in the meshes' own spaces: node
+	// transforms aren't applied. data is either a .glb file, or a .gltf file's JSON, in which
+	// case buffers are read from files named by their URIs, relative to directory.
+	Mesh ImportGltf(const uint8_t* data, size_t size, std::wstring const& directory);
+
+	// Parses a decimal floating-point number, as in OBJ and JSON, from text, at most to end.
+	// Returns the first character after it, or nullptr if there is no number there. Runs of
+	// eight digits are converted eight at a time, within a 64-bit register.
+	const char* ParseFloat(const char* text, const char* end, float& value);
+	const char* ParseDouble(const char* text, const char* end, double& value);
+}
@@ -0,0 +1,365 @@
+﻿#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace DX;
+
+namespace
+{
+	const uint32_t c_none = UINT32_MAX;
+
+	// A FIFO cache of vertex indices. A vertex is in the cache if it was added within the
+	// last cacheSize misses.
+	class VertexCache
+	{
+	public:
+		VertexCache(size_t vertexCount, uint32_t cacheSize) :
+			m_timestamps(vertexCount, 0),
+			m_time(cacheSize + 1),
+			m_cacheSize(cacheSize)
+		{
+		}
+
+		// Returns whether the vertex missed.
+		bool Access(uint32_t vertex)
+		{
+			if (m_time - m_timestamps[vertex] > m_cacheSize)
+			{
+				m_timestamps[vertex] = m_time++;
+				return true;
+			}
+			return false;
+		}
+
+		// Every vertex misses from now on.
+		void Flush()
+		{
+			m_time += m_cacheSize + 1;
+		}
+
+	private:
+		std::vector<uint32_t>	m_timestamps;
+		uint32_t				m_time;
+		uint32_t				m_cacheSize;
+	};
+
+	void CheckMesh(Mesh const& mesh, uint32_t cacheSize)
+	{
+		if (mesh.Indices.size() % 3 != 0)
+		{
+			throw std::invalid_argument("Meshes are triangle lists.");
+		}
+		if (cacheSize == 0)
+		{
+			throw std::invalid_argument("The vertex cache needs at least one entry.");
+		}
+		for (uint32_t index : mesh.Indices)
+		{
+			if (index >= mesh.Vertices.size())
+			{
+				throw std::out_of_range("Index is past the last vertex.");
+			}
+		}
+	}
+
+	// Area-weighted sum of the outward normal, and the centroid weighted the same way.
+	struct ClusterShape
+	{
+		float	Centroid[3];
+		float	Normal[3];
+		float	Area;
+	};
+
+	void AddTriangle(ClusterShape& shape, Mesh const& mesh, const uint32_t* triangle)
+	{
+		const float* a = mesh.Vertices[triangle[0]].Position;
+		const float* b = mesh.Vertices[triangle[1]].Position;
+		const float* c = mesh.Vertices[triangle[2]].Position;
+		const float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		const float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+
+		// Clockwise front faces, so AC x AB points out.
+		const float normal[3] = { ac[1] * ab[2] - ac[2] * ab[1], ac[2] * ab[0] - ac[0] * ab[2], ac[0] * ab[1] - ac[1] * ab[0] };
+		const float area = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		for (int i = 0; i < 3; ++i)
+		{
+			shape.Centroid[i] += area * (a[i] + b[i] + c[i]) / 3.0f;
+			shape.Normal[i] += normal[i];
+		}
+		shape.Area += area;
+	}
+}
+
+VertexCacheStatistics DX::AnalyzeVertexCache(Mesh const& mesh, uint32_t cacheSize)
+{
+	CheckMesh(mesh, cacheSize);
+
+	VertexCache cache(mesh.Vertices.size(), cacheSize);
+	uint32_t misses = 0;
+	for (uint32_t index : mesh.Indices)
+	{
+		misses += cache.Access(index) ? 1 : 0;
+	}
+
+	VertexCacheStatistics statistics;
+	statistics.VerticesTransformed = misses;
+	statistics.Acmr = mesh.Indices.empty() ? 0.0f : static_cast<float>(misses) / static_cast<float>(mesh.Indices.size() / 3);
+	statistics.Atvr = mesh.Vertices.empty() ? 0.0f : static_cast<float>(misses) / static_cast<float>(mesh.Vertices.size());
+	return statistics;
+}
+
+void DX::OptimizeVertexCache(Mesh& mesh, uint32_t cacheSize)
+{
+	CheckMesh(mesh, cacheSize);
+
+	const uint32_t vertexCount = static_cast<uint32_t>(mesh.Vertices.size());
+	const uint32_t triangleCount = static_cast<uint32_t>(mesh.Indices.size() / 3);
+
+	// The triangles using each vertex, and how many of them are still to be emitted.
+	std::vector<uint32_t> liveCounts(vertexCount, 0);
+	for (uint32_t index : mesh.Indices)
+	{
+		++liveCounts[index];
+	}
+	std::vector<uint32_t> firstTriangles(vertexCount + 1, 0);
+	for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+	{
+		firstTriangles[vertex + 1] = firstTriangles[vertex] + liveCounts[vertex];
+	}
+	std::vector<uint32_t> adjacency(mesh.Indices.size());
+	{
+		std::vector<uint32_t> filled(firstTriangles.begin(), firstTriangles.end() - 1);
+		for (uint32_t triangle = 0; triangle < triangleCount; ++triangle)
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				adjacency[filled[mesh.Indices[triangle * 3 + i]]++] = triangle;
+			}
+		}
+	}
+
+	std::vector<uint32_t> timestamps(vertexCount, 0);
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint32_t> deadEnds;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> indices;
+	indices.reserve(mesh.Indices.size());
+	uint32_t time = cacheSize + 1;
+	uint32_t cursor = 0;
+
+	// Where to go when none of the candidates will do: the most recently used vertex with
+	// triangles left, or the next one in input order.
+	auto skipDeadEnd = [&]() -> uint32_t
+	{
+		while (!deadEnds.empty())
+		{
+			const uint32_t vertex = deadEnds.back();
+			deadEnds.pop_back();
+			if (liveCounts[vertex] > 0)
+			{
+				return vertex;
+			}
+		}
+		for (; cursor < vertexCount; ++cursor)
+		{
+			if (liveCounts[cursor] > 0)
+			{
+				return cursor;
+			}
+		}
+		return c_none;
+	};
+
+	uint32_t fanVertex = skipDeadEnd();
+	while (fanVertex != c_none)
+	{
+		candidates.clear();
+		for (uint32_t i = firstTriangles[fanVertex]; i < firstTriangles[fanVertex + 1]; ++i)
+		{
+			const uint32_t triangle = adjacency[i];
+			if (emitted[triangle])
+			{
+				continue;
+			}
+			emitted[triangle] = 1;
+
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				const uint32_t vertex = mesh.Indices[triangle * 3 + corner];
+				indices.push_back(vertex);
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				--liveCounts[vertex];
+				if (time - timestamps[vertex] > cacheSize)
+				{
+					timestamps[vertex] = time++;
+				}
+			}
+		}
+
+		// The best candidate is the one that has been in the cache longest and will still
+		// be in it once its remaining triangles are emitted. If none will, start again from
+		// a dead end.
+		uint32_t next = c_none;
+		uint32_t bestAge = 0;
+		for (uint32_t vertex : candidates)
+		{
+			if (liveCounts[vertex] == 0)
+			{
+				continue;
+			}
+
+			const uint32_t age = time - timestamps[vertex];
+			if (age + 2 * liveCounts[vertex] <= cacheSize && age > bestAge)
+			{
+				next = vertex;
+				bestAge = age;
+			}
+		}
+		fanVertex = next != c_none ? next : skipDeadEnd();
+	}
+
+	mesh.Indices.swap(indices);
+}
+
+void DX::OptimizeOverdraw(Mesh& mesh, float threshold, uint32_t cacheSize)
+{
+	CheckMesh(mesh, cacheSize);
+
+	const uint32_t triangleCount = static_cast<uint32_t>(mesh.Indices.size() / 3);
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Hard boundaries are where all three of a triangle's vertices miss: the cache has
+	// started over, so the clusters either side can be drawn in any order at no cost.
+	std::vector<uint32_t> hardStarts;
+	{
+		VertexCache cache(mesh.Vertices.size(), cacheSize);
+		for (uint32_t triangle = 0; triangle < triangleCount; ++triangle)
+		{
+			int misses = 0;
+			for (int i = 0; i < 3; ++i)
+			{
+				misses += cache.Access(mesh.Indices[triangle * 3 + i]) ? 1 : 0;
+			}
+			if (misses == 3 || triangle == 0)
+			{
+				hardStarts.push_back(triangle);
+			}
+		}
+		hardStarts.push_back(triangleCount);
+	}
+
+	// Each hard cluster is split again wherever its misses so far, starting from an empty
+	// cache, are within the threshold of the whole cluster's rate.
+	std::vector<uint32_t> clusterStarts;
+	{
+		VertexCache cache(mesh.Vertices.size(), cacheSize);
+		for (size_t hard = 0; hard + 1 < hardStarts.size(); ++hard)
+		{
+			const uint32_t start = hardStarts[hard];
+			const uint32_t end = hardStarts[hard + 1];
+
+			cache.Flush();
+			uint32_t clusterMisses = 0;
+			for (uint32_t i = start * 3; i < end * 3; ++i)
+			{
+				clusterMisses += cache.Access(mesh.Indices[i]) ? 1 : 0;
+			}
+			const float limit = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - start);
+
+			cache.Flush();
+			clusterStarts.push_back(start);
+			uint32_t softStart = start;
+			uint32_t misses = 0;
+			for (uint32_t triangle = start; triangle < end; ++triangle)
+			{
+				for (int i = 0; i < 3; ++i)
+				{
+					misses += cache.Access(mesh.Indices[triangle * 3 + i]) ? 1 : 0;
+				}
+				if (triangle + 1 < end && static_cast<float>(misses) <= limit * static_cast<float>(triangle + 1 - softStart))
+				{
+					softStart = triangle + 1;
+					clusterStarts.push_back(softStart);
+					misses = 0;
+					cache.Flush();
+				}
+			}
+		}
+		clusterStarts.push_back(triangleCount);
+	}
+
+	// Clusters are drawn facing furthest out first: by how far the cluster's centroid is
+	// in front of the mesh's centroid, along the cluster's average normal.
+	const size_t clusterCount = clusterStarts.size() - 1;
+	std::vector<ClusterShape> shapes(clusterCount, ClusterShape{});
+	ClusterShape meshShape = {};
+	for (size_t cluster = 0; cluster < clusterCount; ++cluster)
+	{
+		for (uint32_t triangle = clusterStarts[cluster]; triangle < clusterStarts[cluster + 1]; ++triangle)
+		{
+			AddTriangle(shapes[cluster], mesh, &mesh.Indices[triangle * 3]);
+		}
+		for (int i = 0; i < 3; ++i)
+		{
+			meshShape.Centroid[i] += shapes[cluster].Centroid[i];
+		}
+		meshShape.Area += shapes[cluster].Area;
+	}
+
+	std::vector<float> sortKeys(clusterCount);
+	for (size_t cluster = 0; cluster < clusterCount; ++cluster)
+	{
+		ClusterShape const& shape = shapes[cluster];
+		const float normalLength = std::sqrt(shape.Normal[0] * shape.Normal[0] + shape.Normal[1] * shape.Normal[1] + shape.Normal[2] * shape.Normal[2]);
+		float key = 0.0f;
+		if (shape.Area > 0.0f && normalLength > 0.0f)
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				const float offset = shape.Centroid[i] / shape.Area - (meshShape.Area > 0.0f ? meshShape.Centroid[i] / meshShape.Area : 0.0f);
+				key += offset * shape.Normal[i] / normalLength;
+			}
+		}
+		sortKeys[cluster] = key;
+	}
+
+	std::vector<uint32_t> order(clusterCount);
+	for (size_t cluster = 0; cluster < clusterCount; ++cluster)
+	{
+		order[cluster] = static_cast<uint32_t>(cluster);
+	}
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<uint32_t> indices;
+	indices.reserve(mesh.Indices.size());
+	for (uint32_t cluster : order)
+	{
+		indices.insert(indices.end(), mesh.Indices.begin() + clusterStarts[cluster] * 3, mesh.Indices.begin() + clusterStarts[cluster + 1] * 3);
+	}
+	mesh.Indices.swap(indices);
+}
+
+void DX::OptimizeVertexFetch(Mesh& mesh)
+{
+	CheckMesh(mesh, 1);
+
+	std::vector<uint32_t> remap(mesh.Vertices.size(), c_none);
+	std::vector<MeshVertex> vertices;
+	vertices.reserve(mesh.Vertices.size());
+	for (uint32_t& index : mesh.Indices)
+	{
+		if (remap[index] == c_none)
+		{
+			remap[index] = static_cast<uint32_t>(vertices.size());
+			vertices.push_back(mesh.Vertices[index]);
+		}
+		index = remap[index];
+	}
+	mesh.Vertices.swap(vertices);
+}
@@ -0,0 +1,41 @@
+﻿#pragma once
+
+#include "MeshGenerator.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace DX
+{
+	// Entries in the post-transform vertex cache the optimizers plan for. Small enough for
+	// any GPU's cache to hold at least this many vertices of a few attributes.
+	const uint32_t c_vertexCacheSize = 16;
+
+	struct VertexCacheStatistics
+	{
+		uint32_t	VerticesTransformed;
+		float		Acmr;	// Vertices transformed per triangle: 3 at worst, towards 0.5 for a large grid.
+		float		Atvr;	// Vertices transformed per vertex: 1 at best.
+	};
+
+	// Counts the vertex shader runs a FIFO post-transform cache of cacheSize entries would
+	// leave the mesh's triangles needing, in their current order.
+	VertexCacheStatistics AnalyzeVertexCache(Mesh const& mesh, uint32_t cacheSize = c_vertexCacheSize);
+
+	// Reorders the triangles for the post-transform cache with Tipsify: triangles are
+	// emitted in fans around a vertex, and the next vertex to fan around is one that is still
+	// in the cache and will stay there while its own fan is emitted, or failing that the most
+	// recently used vertex with triangles left. Linear in the triangle count.
+	void OptimizeVertexCache(Mesh& mesh, uint32_t cacheSize = c_vertexCacheSize);
+
+	// Reorders a cache-optimized mesh so that triangles facing out from its centre come
+	// first, which lets depth testing reject more of what is behind them. The triangles are
+	// split into clusters wherever the cache starts over, and again wherever that costs at
+	// most threshold times the cluster's own cache misses; clusters are kept whole, so the
+	// cache efficiency is mostly kept too. Assumes clockwise front faces, as Mesh has them.
+	void OptimizeOverdraw(Mesh& mesh, float threshold = 1.05f, uint32_t cacheSize = c_vertexCacheSize);
+
+	// Reorders the vertices into the order the indices first use them, so that vertex fetch
+	// reads through the vertex buffer, and drops vertices no triangle uses.
+	void OptimizeVertexFetch(Mesh& mesh);
+}
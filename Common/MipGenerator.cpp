@@ -0,0 +1,578 @@
+﻿#include "MipGenerator.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace DX;
+
+namespace
+{
+	const double c_pi = 3.14159265358979323846;
+
+	// Filter support, in destination texels either side of the centre.
+	const double c_windowedSincRadius = 3.0;
+	const double c_kaiserAlpha = 4.0;
+
+	double Sinc(double x)
+	{
+		if (fabs(x) < 1e-6)
+		{
+			return 1.0;
+		}
+		return sin(c_pi * x) / (c_pi * x);
+	}
+
+	// Zeroth-order modified Bessel function of the first kind.
+	double BesselI0(double x)
+	{
+		double sum = 1.0;
+		double term = 1.0;
+		double halfX = x * 0.5;
+		for (int k = 1; k < 32; ++k)
+		{
+			term *= (halfX / k) * (halfX / k);
+			sum += term;
+			if (term < sum * 1e-12)
+			{
+				break;
+			}
+		}
+		return sum;
+	}
+
+	double EvaluateKernel(MipFilter filter, double x)
+	{
+		double r = fabs(x) / c_windowedSincRadius;
+		if (r >= 1.0)
+		{
+			return 0.0;
+		}
+
+		if (filter == MipFilter::Lanczos)
+		{
+			return Sinc(x) * Sinc(x / c_windowedSincRadius);
+		}
+		return Sinc(x) * BesselI0(c_kaiserAlpha * sqrt(1.0 - r * r)) / BesselI0(c_kaiserAlpha);
+	}
+
+	// Transfer function tables. Decoding only ever sees 8-bit values, so it is one lookup
+	// with the unpremultiply folded in; encoding takes linear values in [0, 1] and
+	// interpolates between c_encodeTableSize evenly spaced samples, which stays well under a
+	// hundredth of a code value from the exact curve.
+	const int c_encodeTableSize = 4096;
+
+	struct SrgbTables
+	{
+		// Gamma-premultiplied value to linear-premultiplied on the 0-255 scale, by alpha.
+		float ToLinearPremultiplied[256][256];
+		// With a repeat of the last sample, so interpolating at exactly 1 reads in range.
+		float ToSrgb[c_encodeTableSize + 2];
+
+		SrgbTables()
+		{
+			float toLinear[256];
+			for (int i = 0; i < 256; ++i)
+			{
+				double c = i / 255.0;
+				toLinear[i] = static_cast<float>(c <= 0.04045 ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4));
+			}
+			for (int alpha = 0; alpha < 256; ++alpha)
+			{
+				const float scale = alpha > 0 ? 255.0f / alpha : 0.0f;
+				for (int value = 0; value < 256; ++value)
+				{
+					const uint32_t unpremultiplied = std::min(255u, static_cast<uint32_t>(value * scale + 0.5f));
+					ToLinearPremultiplied[alpha][value] = toLinear[unpremultiplied] * alpha;
+				}
+			}
+			for (int i = 0; i <= c_encodeTableSize; ++i)
+			{
+				double l = static_cast<double>(i) / c_encodeTableSize;
+				ToSrgb[i] = static_cast<float>(l <= 0.0031308 ? l * 12.92 : 1.055 * pow(l, 1.0 / 2.4) - 0.055);
+			}
+			ToSrgb[c_encodeTableSize + 1] = ToSrgb[c_encodeTableSize];
+		}
+	};
+
+	const SrgbTables& GetSrgbTables()
+	{
+		static const SrgbTables tables;
+		return tables;
+	}
+
+	float EncodeSrgb(const SrgbTables& tables, float linear)
+	{
+		float position = linear * c_encodeTableSize;
+		if (position >= c_encodeTableSize)
+		{
+			return 1.0f;
+		}
+		int i = static_cast<int>(position);
+		float t = position - i;
+		return tables.ToSrgb[i] + t * (tables.ToSrgb[i + 1] - tables.ToSrgb[i]);
+	}
+
+	// out[i] = sum over k of weights[k] * rows[k][i], for count floats.
+	void WeightedRowSum(float* out, const float* const* rows, const float* weights, uint32_t taps, size_t count)
+	{
+		size_t i = 0;
+#if DX_SIMD_AVX2
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 sum = _mm256_setzero_ps();
+			for (uint32_t k = 0; k < taps; ++k)
+			{
+				sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[k]), _mm256_loadu_ps(rows[k] + i)));
+			}
+			_mm256_storeu_ps(out + i, sum);
+		}
+#endif
+#if DX_SIMD_SSE2
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 sum = _mm_setzero_ps();
+			for (uint32_t k = 0; k < taps; ++k)
+			{
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows[k] + i)));
+			}
+			_mm_storeu_ps(out + i, sum);
+		}
+#elif DX_SIMD_NEON
+		for (; i + 4 <= count; i += 4)
+		{
+			float32x4_t sum = vdupq_n_f32(0.0f);
+			for (uint32_t k = 0; k < taps; ++k)
+			{
+				sum = vmlaq_n_f32(sum, vld1q_f32(rows[k] + i), weights[k]);
+			}
+			vst1q_f32(out + i, sum);
+		}
+#endif
+		for (; i < count; ++i)
+		{
+			float sum = 0.0f;
+			for (uint32_t k = 0; k < taps; ++k)
+			{
+				sum += weights[k] * rows[k][i];
+			}
+			out[i] = sum;
+		}
+	}
+
+	// Filters a row of BGRA float texels horizontally; one texel is one 4-wide vector.
+	void FilterRowHorizontal(float* out, const float* row, uint32_t width, const uint32_t* first, const uint32_t* count, const float* weights, uint32_t weightStride)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			const float* source = row + first[x] * 4;
+			const float* w = weights + x * weightStride;
+#if DX_SIMD_SSE2
+			__m128 sum = _mm_setzero_ps();
+			for (uint32_t k = 0; k < count[x]; ++k)
+			{
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(w[k]), _mm_loadu_ps(source + k * 4)));
+			}
+			_mm_storeu_ps(out + x * 4, sum);
+#elif DX_SIMD_NEON
+			float32x4_t sum = vdupq_n_f32(0.0f);
+			for (uint32_t k = 0; k < count[x]; ++k)
+			{
+				sum = vmlaq_n_f32(sum, vld1q_f32(source + k * 4), w[k]);
+			}
+			vst1q_f32(out + x * 4, sum);
+#else
+			float sum[4] = {};
+			for (uint32_t k = 0; k < count[x]; ++k)
+			{
+				for (int c = 0; c < 4; ++c)
+				{
+					sum[c] += w[k] * source[k * 4 + c];
+				}
+			}
+			memcpy(out + x * 4, sum, sizeof(sum));
+#endif
+		}
+	}
+
+	void ConvertRowToFloat(const uint8_t* source, float* out, uint32_t width)
+	{
+		uint32_t x = 0;
+#if DX_SIMD_SSE2
+		const __m128i zero = _mm_setzero_si128();
+		for (; x + 4 <= width; x += 4)
+		{
+			__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + x * 4));
+			__m128i lo = _mm_unpacklo_epi8(pixels, zero);
+			__m128i hi = _mm_unpackhi_epi8(pixels, zero);
+			_mm_storeu_ps(out + x * 4, _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)));
+			_mm_storeu_ps(out + x * 4 + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)));
+			_mm_storeu_ps(out + x * 4 + 8, _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)));
+			_mm_storeu_ps(out + x * 4 + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)));
+		}
+#elif DX_SIMD_NEON
+		for (; x + 4 <= width; x += 4)
+		{
+			uint8x16_t pixels = vld1q_u8(source + x * 4);
+			uint16x8_t lo = vmovl_u8(vget_low_u8(pixels));
+			uint16x8_t hi = vmovl_u8(vget_high_u8(pixels));
+			vst1q_f32(out + x * 4, vcvtq_f32_u32(vmovl_u16(vget_low_u16(lo))));
+			vst1q_f32(out + x * 4 + 4, vcvtq_f32_u32(vmovl_u16(vget_high_u16(lo))));
+			vst1q_f32(out + x * 4 + 8, vcvtq_f32_u32(vmovl_u16(vget_low_u16(hi))));
+			vst1q_f32(out + x * 4 + 12, vcvtq_f32_u32(vmovl_u16(vget_high_u16(hi))));
+		}
+#endif
+		for (; x < width * 4; ++x)
+		{
+			out[x] = source[x];
+		}
+	}
+
+	// Gamma-premultiplied 8-bit texels to linear-premultiplied floats on the 0-255 scale.
+	void ConvertRowToFloatLinear(const uint8_t* source, float* out, uint32_t width)
+	{
+		const SrgbTables& tables = GetSrgbTables();
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			const uint8_t* p = source + x * 4;
+			const float* toLinear = tables.ToLinearPremultiplied[p[3]];
+			float* o = out + x * 4;
+			o[0] = toLinear[p[0]];
+			o[1] = toLinear[p[1]];
+			o[2] = toLinear[p[2]];
+			o[3] = static_cast<float>(p[3]);
+		}
+	}
+
+	// Linear-premultiplied floats back to 8 bits. For an _SRGB format the premultiplied
+	// value itself is encoded, since that is what the sampler decodes; for UNORM the colour
+	// is unpremultiplied, encoded and premultiplied again in gamma space. The vector paths
+	// do everything but the table reads: the clamps, the unpremultiply, the interpolation
+	// and the packing.
+	void ConvertLinearRowToBgra(const float* row, uint32_t* out, uint32_t width, bool encodePremultiplied)
+	{
+		const SrgbTables& tables = GetSrgbTables();
+		const float* toSrgb = tables.ToSrgb;
+		uint32_t x = 0;
+#if DX_SIMD_SSE2
+		{
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 maximum = _mm_set1_ps(255.0f);
+			const __m128 tableSize = _mm_set1_ps(static_cast<float>(c_encodeTableSize));
+			const __m128 premultipliedScale = _mm_set1_ps(c_encodeTableSize / 255.0f);
+			const __m128 smallestAlpha = _mm_set1_ps(1e-20f);
+			const __m128 half = _mm_set1_ps(0.5f);
+			for (; x + 4 <= width; x += 4)
+			{
+				// Four texels a channel per register, so the unpremultiply is one divide.
+				__m128 channels[4] =
+				{
+					_mm_loadu_ps(row + x * 4), _mm_loadu_ps(row + x * 4 + 4),
+					_mm_loadu_ps(row + x * 4 + 8), _mm_loadu_ps(row + x * 4 + 12),
+				};
+				_MM_TRANSPOSE4_PS(channels[0], channels[1], channels[2], channels[3]);
+				const __m128 alpha = _mm_min_ps(_mm_max_ps(channels[3], zero), maximum);
+
+				// A transparent texel's colour is zero, so dividing it by a tiny alpha is too.
+				const __m128 scale = encodePremultiplied ? premultipliedScale : _mm_div_ps(tableSize, _mm_max_ps(alpha, smallestAlpha));
+				__m128 t[3];
+				__m128 low[3];
+				__m128 high[3];
+				for (int c = 0; c < 3; ++c)
+				{
+					const __m128 v = _mm_min_ps(_mm_max_ps(channels[c], zero), alpha);
+					const __m128 position = _mm_min_ps(_mm_mul_ps(v, scale), tableSize);
+					const __m128i i = _mm_cvttps_epi32(position);
+					t[c] = _mm_sub_ps(position, _mm_cvtepi32_ps(i));
+#if DX_SIMD_AVX2
+					low[c] = _mm_i32gather_ps(toSrgb, i, 4);
+					high[c] = _mm_i32gather_ps(toSrgb + 1, i, 4);
+#else
+					alignas(16) int32_t index[4];
+					_mm_store_si128(reinterpret_cast<__m128i*>(index), i);
+					low[c] = _mm_setr_ps(toSrgb[index[0]], toSrgb[index[1]], toSrgb[index[2]], toSrgb[index[3]]);
+					high[c] = _mm_setr_ps(toSrgb[index[0] + 1], toSrgb[index[1] + 1], toSrgb[index[2] + 1], toSrgb[index[3] + 1]);
+#endif
+				}
+				for (int c = 0; c < 3; ++c)
+				{
+					const __m128 encoded = _mm_add_ps(low[c], _mm_mul_ps(t[c], _mm_sub_ps(high[c], low[c])));
+					channels[c] = _mm_mul_ps(encoded, encodePremultiplied ? maximum : alpha);
+				}
+				channels[3] = alpha;
+				_MM_TRANSPOSE4_PS(channels[0], channels[1], channels[2], channels[3]);
+
+				const __m128i i0 = _mm_cvttps_epi32(_mm_add_ps(channels[0], half));
+				const __m128i i1 = _mm_cvttps_epi32(_mm_add_ps(channels[1], half));
+				const __m128i i2 = _mm_cvttps_epi32(_mm_add_ps(channels[2], half));
+				const __m128i i3 = _mm_cvttps_epi32(_mm_add_ps(channels[3], half));
+				const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(i0, i1), _mm_packs_epi32(i2, i3));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), packed);
+			}
+		}
+#elif DX_SIMD_NEON
+		{
+			const float32x4_t zero = vdupq_n_f32(0.0f);
+			const float32x4_t maximum = vdupq_n_f32(255.0f);
+			const float32x4_t tableSize = vdupq_n_f32(static_cast<float>(c_encodeTableSize));
+			for (; x < width; ++x)
+			{
+				float32x4_t v = vminq_f32(vmaxq_f32(vld1q_f32(row + x * 4), zero), maximum);
+				const float32x4_t alpha = vdupq_n_f32(vgetq_lane_f32(v, 3));
+				v = vminq_f32(v, alpha);
+
+				float32x4_t scale;
+				if (encodePremultiplied)
+				{
+					scale = vdupq_n_f32(c_encodeTableSize / 255.0f);
+				}
+				else
+				{
+					// A transparent texel's colour is zero, so dividing it by a tiny alpha is too.
+					const float32x4_t divisor = vmaxq_f32(alpha, vdupq_n_f32(1e-20f));
+					float32x4_t reciprocal = vrecpeq_f32(divisor);
+					reciprocal = vmulq_f32(vrecpsq_f32(divisor, reciprocal), reciprocal);
+					reciprocal = vmulq_f32(vrecpsq_f32(divisor, reciprocal), reciprocal);
+					scale = vmulq_f32(tableSize, reciprocal);
+				}
+				const float32x4_t position = vminq_f32(vmulq_f32(v, scale), tableSize);
+				const int32x4_t index = vcvtq_s32_f32(position);
+				const float32x4_t t = vsubq_f32(position, vcvtq_f32_s32(index));
+
+				const int i0 = vgetq_lane_s32(index, 0);
+				const int i1 = vgetq_lane_s32(index, 1);
+				const int i2 = vgetq_lane_s32(index, 2);
+				const float lowValues[4] = { toSrgb[i0], toSrgb[i1], toSrgb[i2], 0.0f };
+				const float highValues[4] = { toSrgb[i0 + 1], toSrgb[i1 + 1], toSrgb[i2 + 1], 0.0f };
+				const float32x4_t low = vld1q_f32(lowValues);
+				float32x4_t encoded = vmlaq_f32(low, t, vsubq_f32(vld1q_f32(highValues), low));
+				encoded = vmulq_f32(encoded, encodePremultiplied ? maximum : alpha);
+				encoded = vsetq_lane_f32(vgetq_lane_f32(alpha, 0), encoded, 3);
+
+				uint16x4_t i = vmovn_u32(vcvtq_u32_f32(vaddq_f32(encoded, vdupq_n_f32(0.5f))));
+				uint8x8_t b = vmovn_u16(vcombine_u16(i, i));
+				out[x] = vget_lane_u32(vreinterpret_u32_u8(b), 0);
+			}
+		}
+#endif
+		for (; x < width; ++x)
+		{
+			const float* p = row + x * 4;
+			const float alpha = std::min(std::max(p[3], 0.0f), 255.0f);
+			uint32_t packed = static_cast<uint32_t>(alpha + 0.5f) << 24;
+			if (alpha > 0.0f)
+			{
+				const float inverseAlpha = 1.0f / alpha;
+				for (int c = 0; c < 3; ++c)
+				{
+					float value = std::min(std::max(p[c], 0.0f), alpha);
+					float encoded = encodePremultiplied ?
+						EncodeSrgb(tables, value * (1.0f / 255.0f)) * 255.0f :
+						EncodeSrgb(tables, value * inverseAlpha) * alpha;
+					packed |= static_cast<uint32_t>(encoded + 0.5f) << (c * 8);
+				}
+			}
+			out[x] = packed;
+		}
+	}
+
+	// Rounds back to 8 bits. Negative lobes of the sinc filters can push colour above
+	// alpha, which isn't a valid premultiplied value, so colour is clamped to alpha.
+	void ConvertRowToBgra(const float* row, uint32_t* out, uint32_t width)
+	{
+		uint32_t x = 0;
+#if DX_SIMD_SSE2
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 maximum = _mm_set1_ps(255.0f);
+		const __m128 half = _mm_set1_ps(0.5f);
+		for (; x < width; ++x)
+		{
+			__m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(row + x * 4), zero), maximum);
+			v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)));
+			__m128i i = _mm_cvttps_epi32(_mm_add_ps(v, half));
+			i = _mm_packs_epi32(i, i);
+			out[x] = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(i, i)));
+		}
+#elif DX_SIMD_NEON
+		for (; x < width; ++x)
+		{
+			float32x4_t v = vminq_f32(vmaxq_f32(vld1q_f32(row + x * 4), vdupq_n_f32(0.0f)), vdupq_n_f32(255.0f));
+			v = vminq_f32(v, vdupq_n_f32(vgetq_lane_f32(v, 3)));
+			uint16x4_t i = vmovn_u32(vcvtq_u32_f32(vaddq_f32(v, vdupq_n_f32(0.5f))));
+			uint8x8_t b = vmovn_u16(vcombine_u16(i, i));
+			out[x] = vget_lane_u32(vreinterpret_u32_u8(b), 0);
+		}
+#endif
+		for (; x < width; ++x)
+		{
+			const float* p = row + x * 4;
+			float alpha = std::min(std::max(p[3], 0.0f), 255.0f);
+			uint32_t packed = static_cast<uint32_t>(alpha + 0.5f) << 24;
+			for (int c = 0; c < 3; ++c)
+			{
+				float value = std::min(std::max(p[c], 0.0f), alpha);
+				packed |= static_cast<uint32_t>(value + 0.5f) << (c * 8);
+			}
+			out[x] = packed;
+		}
+	}
+}
+
+MipGenerator::MipGenerator(MipFilter filter, MipColorSpace colorSpace) :
+	m_filter(filter),
+	m_colorSpace(colorSpace),
+	m_width(0),
+	m_height(0)
+{
+}
+
+uint32_t MipGenerator::GetLevelCount(uint32_t width, uint32_t height)
+{
+	uint32_t levels = 1;
+	while (width > 1 || height > 1)
+	{
+		width = std::max(1u, width / 2);
+		height = std::max(1u, height / 2);
+		++levels;
+	}
+	return levels;
+}
+
+void MipGenerator::SetSource(const void* pixels, uint32_t width, uint32_t height, size_t rowPitch)
+{
+	m_width = width;
+	m_height = height;
+	m_current.resize(static_cast<size_t>(width) * height * 4);
+
+	const uint8_t* source = static_cast<const uint8_t*>(pixels);
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		float* row = m_current.data() + static_cast<size_t>(y) * width * 4;
+		if (m_colorSpace == MipColorSpace::Gamma)
+		{
+			ConvertRowToFloat(source + y * rowPitch, row, width);
+		}
+		else
+		{
+			ConvertRowToFloatLinear(source + y * rowPitch, row, width);
+		}
+	}
+}
+
+void MipGenerator::WriteRow(const float* row, uint32_t* destination, uint32_t width) const
+{
+	if (m_colorSpace == MipColorSpace::Gamma)
+	{
+		ConvertRowToBgra(row, destination, width);
+	}
+	else
+	{
+		ConvertLinearRowToBgra(row, destination, width, m_colorSpace == MipColorSpace::Srgb);
+	}
+}
+
+void MipGenerator::WriteCurrentLevel(void* destination, size_t destinationRowPitch) const
+{
+	uint8_t* output = static_cast<uint8_t*>(destination);
+	for (uint32_t y = 0; y < m_height; ++y)
+	{
+		WriteRow(m_current.data() + static_cast<size_t>(y) * m_width * 4, reinterpret_cast<uint32_t*>(output + y * destinationRowPitch), m_width);
+	}
+}
+
+void MipGenerator::BuildTaps(uint32_t sourceSize, uint32_t destinationSize, FilterTaps& taps) const
+{
+	const double scale = static_cast<double>(sourceSize) / destinationSize;
+	const double support = (m_filter == MipFilter::Box ? 0.5 : c_windowedSincRadius) * scale;
+
+	taps.MaxCount = static_cast<uint32_t>(ceil(support * 2.0)) + 2;
+	taps.First.resize(destinationSize);
+	taps.Count.resize(destinationSize);
+	taps.Weights.assign(static_cast<size_t>(destinationSize) * taps.MaxCount, 0.0f);
+
+	std::vector<double> weights(taps.MaxCount);
+	for (uint32_t i = 0; i < destinationSize; ++i)
+	{
+		const double center = (i + 0.5) * scale;
+		const int lowest = static_cast<int>(floor(center - support));
+		const int highest = static_cast<int>(ceil(center + support));
+		const int first = std::max(lowest, 0);
+		const int last = std::min(highest, static_cast<int>(sourceSize) - 1);
+
+		std::fill(weights.begin(), weights.end(), 0.0);
+		double total = 0.0;
+		for (int k = lowest; k <= highest; ++k)
+		{
+			double w;
+			if (m_filter == MipFilter::Box)
+			{
+				// Coverage of source texel [k, k + 1) by the destination footprint.
+				w = std::max(0.0, std::min(k + 1.0, center + support) - std::max(static_cast<double>(k), center - support));
+			}
+			else
+			{
+				w = EvaluateKernel(m_filter, (k + 0.5 - center) / scale);
+			}
+
+			// Clamp addressing: taps past the edge fold onto the edge texel.
+			int clamped = std::min(std::max(k, first), last);
+			weights[clamped - first] += w;
+			total += w;
+		}
+
+		// Drop zero-weight taps at either end; for a 2:1 box this leaves exactly two.
+		int begin = 0;
+		int end = last - first + 1;
+		while (end - begin > 1 && weights[begin] == 0.0)
+		{
+			++begin;
+		}
+		while (end - begin > 1 && weights[end - 1] == 0.0)
+		{
+			--end;
+		}
+
+		taps.First[i] = static_cast<uint32_t>(first + begin);
+		taps.Count[i] = static_cast<uint32_t>(end - begin);
+		for (int k = begin; k < end; ++k)
+		{
+			taps.Weights[i * taps.MaxCount + (k - begin)] = static_cast<float>(weights[k] / total);
+		}
+	}
+}
+
+void MipGenerator::GenerateNextLevel(void* destination, size_t destinationRowPitch)
+{
+	const uint32_t width = GetNextWidth();
+	const uint32_t height = GetNextHeight();
+
+	BuildTaps(m_width, width, m_horizontalTaps);
+	BuildTaps(m_height, height, m_verticalTaps);
+
+	m_next.resize(static_cast<size_t>(width) * height * 4);
+	m_rowScratch.resize(static_cast<size_t>(m_width) * 4);
+
+	std::vector<const float*> rows(m_verticalTaps.MaxCount);
+	uint8_t* output = static_cast<uint8_t*>(destination);
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		// Vertical pass over full source rows, then the horizontal pass on the result.
+		const uint32_t taps = m_verticalTaps.Count[y];
+		for (uint32_t k = 0; k < taps; ++k)
+		{
+			rows[k] = m_current.data() + static_cast<size_t>(m_verticalTaps.First[y] + k) * m_width * 4;
+		}
+		WeightedRowSum(m_rowScratch.data(), rows.data(), m_verticalTaps.Weights.data() + y * m_verticalTaps.MaxCount, taps, m_rowScratch.size());
+
+		float* nextRow = m_next.data() + static_cast<size_t>(y) * width * 4;
+		FilterRowHorizontal(nextRow, m_rowScratch.data(), width,
+			m_horizontalTaps.First.data(), m_horizontalTaps.Count.data(), m_horizontalTaps.Weights.data(), m_horizontalTaps.MaxCount);
+
+		WriteRow(nextRow, reinterpret_cast<uint32_t*>(output + y * destinationRowPitch), width);
+	}
+
+	std::swap(m_current, m_next);
+	m_width = width;
+	m_height = height;
+}
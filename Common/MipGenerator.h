@@ -0,0 +1,85 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace DX
+{
+	enum class MipFilter
+	{
+		Box,		// Area average. Cheapest; exact 2x2 average for even sizes.
+		Kaiser,		// Kaiser-windowed sinc, 3 source texels of support per side.
+		Lanczos,	// Lanczos-3.
+	};
+
+	// How the 8-bit source values are interpreted when filtering, and how results are stored.
+	// The source is always premultiplied in gamma space, as the PNG decoder produces it.
+	enum class MipColorSpace
+	{
+		Gamma,		// Filter the stored values as they are.
+		Linear,		// Filter in linear light; store gamma-space premultiplied values, for UNORM formats.
+		Srgb,		// Filter in linear light; store sRGB-encoded linear-premultiplied values, for _SRGB formats.
+	};
+
+	// Builds a mip chain down to 1x1 from a premultiplied BGRA base level, one level at a
+	// time. Sizes follow the D3D convention (each level is max(1, previous / 2)), so
+	// non-power-of-two images are handled with fractional filter footprints.
+	//
+	// Each level is filtered separably from the one above it, kept in float so the chain
+	// doesn't accumulate rounding error. Both passes work on whole rows at a time.
+	//
+	// In the linear colour spaces the source is unpremultiplied, converted to linear light
+	// and premultiplied again there, so colour is weighted by coverage the way the GPU
+	// blends it. The conversions use lookup tables and happen once per chain: every level
+	// after the source stays linear in float.
+	class MipGenerator
+	{
+	public:
+		explicit MipGenerator(MipFilter filter = MipFilter::Box, MipColorSpace colorSpace = MipColorSpace::Gamma);
+
+		// Number of levels in a full chain for an image of this size, including the base.
+		static uint32_t GetLevelCount(uint32_t width, uint32_t height);
+
+		// Sets the level the next one is generated from. rowPitch is in bytes.
+		void SetSource(const void* pixels, uint32_t width, uint32_t height, size_t rowPitch);
+
+		// True once the current level is 1x1.
+		bool IsComplete() const { return m_width == 1 && m_height == 1; }
+
+		// Size of the level GenerateNextLevel will write.
+		uint32_t GetNextWidth() const { return m_width > 1 ? m_width / 2 : 1; }
+		uint32_t GetNextHeight() const { return m_height > 1 ? m_height / 2 : 1; }
+
+		// Downsamples the current level, writes the result as premultiplied BGRA, and makes
+		// it the current level.
+		void GenerateNextLevel(void* destination, size_t destinationRowPitch);
+
+		// Writes the current level in the output encoding. With MipColorSpace::Srgb the
+		// source level itself needs this before it can be uploaded.
+		void WriteCurrentLevel(void* destination, size_t destinationRowPitch) const;
+
+	private:
+		// Per-destination-texel filter taps along one axis: Count weights starting at First.
+		struct FilterTaps
+		{
+			std::vector<uint32_t>	First;
+			std::vector<uint32_t>	Count;
+			std::vector<float>		Weights;	// MaxCount per destination texel.
+			uint32_t				MaxCount;
+		};
+
+		void BuildTaps(uint32_t sourceSize, uint32_t destinationSize, FilterTaps& taps) const;
+		void WriteRow(const float* row, uint32_t* destination, uint32_t width) const;
+
+		MipFilter			m_filter;
+		MipColorSpace		m_colorSpace;
+		uint32_t			m_width;
+		uint32_t			m_height;
+		std::vector<float>	m_current;		// BGRA, 4 floats per texel.
+		std::vector<float>	m_next;
+		std::vector<float>	m_rowScratch;
+		FilterTaps			m_horizontalTaps;
+		FilterTaps			m_verticalTaps;
+	};
+}
@@ -0,0 +1,1150 @@
+﻿#include "PngDecoder.h"
+#include "RowCopy.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+using namespace DX;
+
+namespace
+{
+	const uint8_t c_signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	// Extra bytes kept after each row buffer so the vector paths may over-read.
+	const size_t c_rowSlack = 32;
+
+	enum ColorType : uint8_t
+	{
+		Grayscale = 0,
+		Truecolor = 2,
+		Indexed = 3,
+		GrayscaleAlpha = 4,
+		TruecolorAlpha = 6,
+	};
+
+	uint32_t ReadBigEndian32(const uint8_t* p)
+	{
+		return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+	}
+
+	uint32_t ReadBigEndian16(const uint8_t* p)
+	{
+		return (uint32_t(p[0]) << 8) | uint32_t(p[1]);
+	}
+
+	// Rounded c * a / 255; exact for all 8-bit inputs, and what the vector paths compute.
+	inline uint32_t MulDiv255(uint32_t c, uint32_t a)
+	{
+		uint32_t t = c * a + 128;
+		return (t + (t >> 8)) >> 8;
+	}
+
+	inline uint32_t PackPremultiplied(uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+	{
+		if (a != 255)
+		{
+			r = MulDiv255(r, a);
+			g = MulDiv255(g, a);
+			b = MulDiv255(b, a);
+		}
+		return b | (g << 8) | (r << 16) | (a << 24);
+	}
+
+	inline uint32_t ReverseBits16(uint32_t v)
+	{
+		v = ((v & 0xAAAA) >> 1) | ((v & 0x5555) << 1);
+		v = ((v & 0xCCCC) >> 2) | ((v & 0x3333) << 2);
+		v = ((v & 0xF0F0) >> 4) | ((v & 0x0F0F) << 4);
+		v = ((v & 0xFF00) >> 8) | ((v & 0x00FF) << 8);
+		return v;
+	}
+
+	// Canonical Huffman decoding table. Codes up to c_fastBits long resolve with a single
+	// lookup; longer ones fall back to a search over the per-length code ranges.
+	const uint32_t c_fastBits = 10;
+	const uint32_t c_fastMask = (1u << c_fastBits) - 1;
+
+	struct HuffmanTable
+	{
+		uint16_t	Fast[1 << c_fastBits];	// (length << 9) | symbol, or 0.
+		uint32_t	MaxCode[17];
+		uint16_t	FirstCode[16];
+		uint16_t	FirstSymbol[16];
+		uint8_t		Size[288];
+		uint16_t	Value[288];
+
+		void Build(const uint8_t* codeLengths, uint32_t count)
+		{
+			// Tables are rebuilt for every block, and Decode's slow path checks Size for slots
+			// this code doesn't fill, so nothing may be left from the last one.
+			memset(this, 0, sizeof(*this));
+
+			uint32_t sizes[17] = {};
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				sizes[codeLengths[i]]++;
+			}
+			sizes[0] = 0;
+
+			uint32_t nextCode[16];
+			uint32_t code = 0;
+			uint32_t symbol = 0;
+			for (uint32_t i = 1; i < 16; ++i)
+			{
+				nextCode[i] = code;
+				FirstCode[i] = static_cast<uint16_t>(code);
+				FirstSymbol[i] = static_cast<uint16_t>(symbol);
+				code += sizes[i];
+				if (sizes[i] && code - 1 >= (1u << i))
+				{
+					throw PngDecodeError("Invalid Huffman code lengths.");
+				}
+				MaxCode[i] = code << (16 - i);
+				code <<= 1;
+				symbol += sizes[i];
+			}
+			MaxCode[16] = 0x10000;
+
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				uint32_t length = codeLengths[i];
+				if (length == 0)
+				{
+					continue;
+				}
+
+				uint32_t index = nextCode[length] - FirstCode[length] + FirstSymbol[length];
+				Size[index] = static_cast<uint8_t>(length);
+				Value[index] = static_cast<uint16_t>(i);
+
+				if (length <= c_fastBits)
+				{
+					uint32_t entry = ReverseBits16(nextCode[length]) >> (16 - length);
+					while (entry <= c_fastMask)
+					{
+						Fast[entry] = static_cast<uint16_t>((length << 9) | i);
+						entry += (1u << length);
+					}
+				}
+				++nextCode[length];
+			}
+		}
+	};
+
+	const uint16_t c_lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const uint8_t c_lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const uint16_t c_distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const uint8_t c_distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	const uint8_t c_codeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	// Row unfiltering. The vector variants work one pixel at a time for Sub/Avg/Paeth,
+	// since each pixel depends on its left neighbour, and a whole register at a time for Up.
+	void UnfilterSubScalar(uint8_t* row, size_t rowBytes, uint32_t bpp)
+	{
+		for (size_t i = bpp; i < rowBytes; ++i)
+		{
+			row[i] = static_cast<uint8_t>(row[i] + row[i - bpp]);
+		}
+	}
+
+	void UnfilterUp(uint8_t* row, const uint8_t* prior, size_t rowBytes)
+	{
+		size_t i = 0;
+#if DX_SIMD_AVX2
+		for (; i + 32 <= rowBytes; i += 32)
+		{
+			__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+			__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(prior + i));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(row + i), _mm256_add_epi8(x, b));
+		}
+#endif
+#if DX_SIMD_SSE2
+		for (; i + 16 <= rowBytes; i += 16)
+		{
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prior + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), _mm_add_epi8(x, b));
+		}
+#elif DX_SIMD_NEON
+		for (; i + 16 <= rowBytes; i += 16)
+		{
+			vst1q_u8(row + i, vaddq_u8(vld1q_u8(row + i), vld1q_u8(prior + i)));
+		}
+#endif
+		for (; i < rowBytes; ++i)
+		{
+			row[i] = static_cast<uint8_t>(row[i] + prior[i]);
+		}
+	}
+
+	void UnfilterAverageScalar(uint8_t* row, const uint8_t* prior, size_t rowBytes, uint32_t bpp)
+	{
+		for (size_t i = 0; i < bpp; ++i)
+		{
+			row[i] = static_cast<uint8_t>(row[i] + (prior[i] >> 1));
+		}
+		for (size_t i = bpp; i < rowBytes; ++i)
+		{
+			row[i] = static_cast<uint8_t>(row[i] + ((row[i - bpp] + prior[i]) >> 1));
+		}
+	}
+
+	inline uint8_t PaethPredictor(int a, int b, int c)
+	{
+		int pa = abs(b - c);
+		int pb = abs(a - c);
+		int pc = abs(a + b - 2 * c);
+		if (pa <= pb && pa <= pc)
+		{
+			return static_cast<uint8_t>(a);
+		}
+		return static_cast<uint8_t>(pb <= pc ? b : c);
+	}
+
+	void UnfilterPaethScalar(uint8_t* row, const uint8_t* prior, size_t rowBytes, uint32_t bpp)
+	{
+		for (size_t i = 0; i < bpp; ++i)
+		{
+			row[i] = static_cast<uint8_t>(row[i] + prior[i]);
+		}
+		for (size_t i = bpp; i < rowBytes; ++i)
+		{
+			row[i] = static_cast<uint8_t>(row[i] + PaethPredictor(row[i - bpp], prior[i], prior[i - bpp]));
+		}
+	}
+
+#if DX_SIMD_SSE2
+	template<uint32_t Bpp>
+	inline __m128i LoadPixel(const uint8_t* p)
+	{
+		uint32_t v = 0;
+		memcpy(&v, p, Bpp);
+		return _mm_cvtsi32_si128(static_cast<int>(v));
+	}
+
+	template<uint32_t Bpp>
+	inline void StorePixel(uint8_t* p, __m128i v)
+	{
+		uint32_t x = static_cast<uint32_t>(_mm_cvtsi128_si32(v));
+		memcpy(p, &x, Bpp);
+	}
+
+	template<uint32_t Bpp>
+	void UnfilterSub(uint8_t* row, size_t rowBytes)
+	{
+		__m128i a = _mm_setzero_si128();
+		for (size_t i = 0; i < rowBytes; i += Bpp)
+		{
+			a = _mm_add_epi8(a, LoadPixel<Bpp>(row + i));
+			StorePixel<Bpp>(row + i, a);
+		}
+	}
+
+	template<uint32_t Bpp>
+	void UnfilterAverage(uint8_t* row, const uint8_t* prior, size_t rowBytes)
+	{
+		const __m128i one = _mm_set1_epi8(1);
+		__m128i a = _mm_setzero_si128();
+		for (size_t i = 0; i < rowBytes; i += Bpp)
+		{
+			__m128i b = LoadPixel<Bpp>(prior + i);
+
+			// pavgb rounds up; take the carry back off to get floor((a + b) / 2).
+			__m128i average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+			a = _mm_add_epi8(LoadPixel<Bpp>(row + i), average);
+			StorePixel<Bpp>(row + i, a);
+		}
+	}
+
+	inline __m128i Abs16(__m128i x)
+	{
+		return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+	}
+
+	inline __m128i Select(__m128i mask, __m128i a, __m128i b)
+	{
+		return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+	}
+
+	template<uint32_t Bpp>
+	void UnfilterPaeth(uint8_t* row, const uint8_t* prior, size_t rowBytes)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		__m128i a = zero;
+		__m128i c = zero;
+		for (size_t i = 0; i < rowBytes; i += Bpp)
+		{
+			__m128i b = _mm_unpacklo_epi8(LoadPixel<Bpp>(prior + i), zero);
+
+			__m128i pa = _mm_sub_epi16(b, c);
+			__m128i pb = _mm_sub_epi16(a, c);
+			__m128i pc = Abs16(_mm_add_epi16(pa, pb));
+			pa = Abs16(pa);
+			pb = Abs16(pb);
+
+			__m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+			__m128i predictor = Select(_mm_cmpeq_epi16(smallest, pa), a, Select(_mm_cmpeq_epi16(smallest, pb), b, c));
+
+			__m128i x = _mm_add_epi8(LoadPixel<Bpp>(row + i), _mm_packus_epi16(predictor, predictor));
+			StorePixel<Bpp>(row + i, x);
+
+			a = _mm_unpacklo_epi8(x, zero);
+			c = b;
+		}
+	}
+#elif DX_SIMD_NEON
+	template<uint32_t Bpp>
+	inline uint8x8_t LoadPixel(const uint8_t* p)
+	{
+		uint32_t v = 0;
+		memcpy(&v, p, Bpp);
+		return vreinterpret_u8_u32(vdup_n_u32(v));
+	}
+
+	template<uint32_t Bpp>
+	inline void StorePixel(uint8_t* p, uint8x8_t v)
+	{
+		uint32_t x = vget_lane_u32(vreinterpret_u32_u8(v), 0);
+		memcpy(p, &x, Bpp);
+	}
+
+	template<uint32_t Bpp>
+	void UnfilterSub(uint8_t* row, size_t rowBytes)
+	{
+		uint8x8_t a = vdup_n_u8(0);
+		for (size_t i = 0; i < rowBytes; i += Bpp)
+		{
+			a = vadd_u8(a, LoadPixel<Bpp>(row + i));
+			StorePixel<Bpp>(row + i, a);
+		}
+	}
+
+	template<uint32_t Bpp>
+	void UnfilterAverage(uint8_t* row, const uint8_t* prior, size_t rowBytes)
+	{
+		uint8x8_t a = vdup_n_u8(0);
+		for (size_t i = 0; i < rowBytes; i += Bpp)
+		{
+			a = vadd_u8(LoadPixel<Bpp>(row + i), vhadd_u8(a, LoadPixel<Bpp>(prior + i)));
+			StorePixel<Bpp>(row + i, a);
+		}
+	}
+
+	template<uint32_t Bpp>
+	void UnfilterPaeth(uint8_t* row, const uint8_t* prior, size_t rowBytes)
+	{
+		uint8x8_t a = vdup_n_u8(0);
+		uint8x8_t c = vdup_n_u8(0);
+		for (size_t i = 0; i < rowBytes; i += Bpp)
+		{
+			uint8x8_t b = LoadPixel<Bpp>(prior + i);
+
+			uint16x8_t pa = vabdl_u8(b, c);
+			uint16x8_t pb = vabdl_u8(a, c);
+			uint16x8_t pc = vabdq_u16(vaddl_u8(a, b), vaddl_u8(c, c));
+
+			uint8x8_t useA = vmovn_u16(vandq_u16(vcleq_u16(pa, pb), vcleq_u16(pa, pc)));
+			uint8x8_t useB = vmovn_u16(vcleq_u16(pb, pc));
+			uint8x8_t predictor = vbsl_u8(useA, a, vbsl_u8(useB, b, c));
+
+			a = vadd_u8(LoadPixel<Bpp>(row + i), predictor);
+			StorePixel<Bpp>(row + i, a);
+			c = b;
+		}
+	}
+#endif
+
+	void UnfilterRow(uint8_t filter, uint8_t* row, const uint8_t* prior, size_t rowBytes, uint32_t bpp)
+	{
+		switch (filter)
+		{
+		case 0:
+			break;
+
+		case 1:
+#if DX_SIMD_SSE2 || DX_SIMD_NEON
+			if (bpp == 4) { UnfilterSub<4>(row, rowBytes); break; }
+			if (bpp == 3) { UnfilterSub<3>(row, rowBytes); break; }
+#endif
+			UnfilterSubScalar(row, rowBytes, bpp);
+			break;
+
+		case 2:
+			UnfilterUp(row, prior, rowBytes);
+			break;
+
+		case 3:
+#if DX_SIMD_SSE2 || DX_SIMD_NEON
+			if (bpp == 4) { UnfilterAverage<4>(row, prior, rowBytes); break; }
+			if (bpp == 3) { UnfilterAverage<3>(row, prior, rowBytes); break; }
+#endif
+			UnfilterAverageScalar(row, prior, rowBytes, bpp);
+			break;
+
+		case 4:
+#if DX_SIMD_SSE2 || DX_SIMD_NEON
+			if (bpp == 4) { UnfilterPaeth<4>(row, prior, rowBytes); break; }
+			if (bpp == 3) { UnfilterPaeth<3>(row, prior, rowBytes); break; }
+#endif
+			UnfilterPaethScalar(row, prior, rowBytes, bpp);
+			break;
+
+		default:
+			throw PngDecodeError("Invalid scanline filter.");
+		}
+	}
+
+	// RGBA8 -> premultiplied BGRA8.
+	void ExpandRgba8(const uint8_t* source, uint32_t width, uint32_t* destination)
+	{
+		uint32_t x = 0;
+#if DX_SIMD_AVX2
+		{
+			const __m256i zero = _mm256_setzero_si256();
+			const __m256i bias = _mm256_set1_epi16(128);
+			const __m256i alphaMask = _mm256_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0);
+			auto premultiply = [&](__m256i v)
+			{
+				__m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(v, 0xFF), 0xFF);
+				__m256i t = _mm256_add_epi16(_mm256_mullo_epi16(v, a), bias);
+				t = _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+				t = _mm256_or_si256(_mm256_and_si256(alphaMask, v), _mm256_andnot_si256(alphaMask, t));
+				return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(t, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+			};
+			for (; x + 8 <= width; x += 8)
+			{
+				__m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + x * 4));
+				__m256i lo = premultiply(_mm256_unpacklo_epi8(pixels, zero));
+				__m256i hi = premultiply(_mm256_unpackhi_epi8(pixels, zero));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + x), _mm256_packus_epi16(lo, hi));
+			}
+		}
+#endif
+#if DX_SIMD_SSE2
+		{
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i bias = _mm_set1_epi16(128);
+			const __m128i alphaMask = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+			auto premultiply = [&](__m128i v)
+			{
+				__m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xFF), 0xFF);
+				__m128i t = _mm_add_epi16(_mm_mullo_epi16(v, a), bias);
+				t = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+				t = _mm_or_si128(_mm_and_si128(alphaMask, v), _mm_andnot_si128(alphaMask, t));
+				return _mm_shufflehi_epi16(_mm_shufflelo_epi16(t, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+			};
+			for (; x + 4 <= width; x += 4)
+			{
+				__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + x * 4));
+				__m128i lo = premultiply(_mm_unpacklo_epi8(pixels, zero));
+				__m128i hi = premultiply(_mm_unpackhi_epi8(pixels, zero));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + x), _mm_packus_epi16(lo, hi));
+			}
+		}
+#elif DX_SIMD_NEON
+		for (; x + 8 <= width; x += 8)
+		{
+			uint8x8x4_t rgba = vld4_u8(source + x * 4);
+			uint8x8x4_t bgra;
+			for (int channel = 0; channel < 3; ++channel)
+			{
+				uint16x8_t t = vmull_u8(rgba.val[2 - channel], rgba.val[3]);
+				bgra.val[channel] = vraddhn_u16(t, vrshrq_n_u16(t, 8));
+			}
+			bgra.val[3] = rgba.val[3];
+			vst4_u8(reinterpret_cast<uint8_t*>(destination + x), bgra);
+		}
+#endif
+		for (; x < width; ++x)
+		{
+			const uint8_t* p = source + x * 4;
+			destination[x] = PackPremultiplied(p[0], p[1], p[2], p[3]);
+		}
+	}
+
+}
+
+// Inflates the zlib stream spread across the IDAT chunks. Output is pulled a scanline at
+// a time; only the 32 KB back-reference window is kept between calls.
+class PngDecoder::Inflater
+{
+public:
+	Inflater(std::vector<Chunk> const& chunks) :
+		m_chunk(chunks.data()),
+		m_chunkEnd(chunks.data() + chunks.size()),
+		m_in(nullptr),
+		m_inEnd(nullptr),
+		m_bits(0),
+		m_bitCount(0),
+		m_overrun(0),
+		m_state(State::BlockHeader),
+		m_finalBlock(false),
+		m_storedRemaining(0),
+		m_copyLength(0),
+		m_copyDistance(0),
+		m_windowPosition(0)
+	{
+		uint32_t cmf = GetBits(8);
+		uint32_t flags = GetBits(8);
+		if ((cmf & 0x0F) != 8 || (cmf >> 4) > 7 || ((cmf << 8) | flags) % 31 != 0 || (flags & 0x20) != 0)
+		{
+			throw PngDecodeError("Invalid zlib header.");
+		}
+	}
+
+	void Read(uint8_t* out, size_t count)
+	{
+		while (count > 0)
+		{
+			if (m_copyLength > 0)
+			{
+				size_t n = std::min<size_t>(count, m_copyLength);
+				for (size_t i = 0; i < n; ++i)
+				{
+					uint8_t value = m_window[(m_windowPosition - m_copyDistance) & c_windowMask];
+					m_window[m_windowPosition++ & c_windowMask] = value;
+					out[i] = value;
+				}
+				out += n;
+				count -= n;
+				m_copyLength -= static_cast<uint32_t>(n);
+				continue;
+			}
+
+			switch (m_state)
+			{
+			case State::BlockHeader:
+				ReadBlockHeader();
+				break;
+
+			case State::Stored:
+			{
+				size_t n = std::min<size_t>(count, m_storedRemaining);
+				for (size_t i = 0; i < n; ++i)
+				{
+					Put(static_cast<uint8_t>(GetBits(8)), out);
+				}
+				count -= n;
+				m_storedRemaining -= static_cast<uint32_t>(n);
+				if (m_storedRemaining == 0)
+				{
+					EndBlock();
+				}
+				break;
+			}
+
+			case State::Huffman:
+				while (count > 0)
+				{
+					uint32_t symbol = Decode(m_literals);
+					if (symbol < 256)
+					{
+						Put(static_cast<uint8_t>(symbol), out);
+						--count;
+						continue;
+					}
+					if (symbol == 256)
+					{
+						EndBlock();
+						break;
+					}
+
+					symbol -= 257;
+					if (symbol >= 29)
+					{
+						throw PngDecodeError("Invalid length code.");
+					}
+					uint32_t length = c_lengthBase[symbol] + GetBits(c_lengthExtra[symbol]);
+
+					uint32_t distanceSymbol = Decode(m_distances);
+					if (distanceSymbol >= 30)
+					{
+						throw PngDecodeError("Invalid distance code.");
+					}
+					uint32_t distance = c_distanceBase[distanceSymbol] + GetBits(c_distanceExtra[distanceSymbol]);
+					if (distance > m_windowPosition)
+					{
+						throw PngDecodeError("Distance reaches before the start of the stream.");
+					}
+
+					m_copyLength = length;
+					m_copyDistance = distance;
+					break;
+				}
+				break;
+
+			case State::Done:
+				throw PngDecodeError("Image data ended early.");
+			}
+
+			if (m_overrun > 8)
+			{
+				throw PngDecodeError("Image data is truncated.");
+			}
+		}
+	}
+
+private:
+	enum class State
+	{
+		BlockHeader,
+		Stored,
+		Huffman,
+		Done,
+	};
+
+	static const uint32_t c_windowSize = 32768;
+	static const uint32_t c_windowMask = c_windowSize - 1;
+
+	bool NextChunk()
+	{
+		while (m_chunk != m_chunkEnd)
+		{
+			m_in = m_chunk->Data;
+			m_inEnd = m_chunk->Data + m_chunk->Length;
+			++m_chunk;
+			if (m_in != m_inEnd)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void Refill()
+	{
+		if (m_inEnd - m_in >= 8)
+		{
+			// Branchless refill; assumes a little-endian host.
+			uint64_t v;
+			memcpy(&v, m_in, sizeof(v));
+			m_bits |= v << m_bitCount;
+			m_in += (63 - m_bitCount) >> 3;
+			m_bitCount |= 56;
+			return;
+		}
+
+		while (m_bitCount <= 56)
+		{
+			if (m_in == m_inEnd && !NextChunk())
+			{
+				// Past the end of the data: feed zeros so the final code can be peeked,
+				// and count them so genuinely truncated streams are caught.
+				++m_overrun;
+				m_bitCount += 8;
+				continue;
+			}
+			m_bits |= uint64_t(*m_in++) << m_bitCount;
+			m_bitCount += 8;
+		}
+	}
+
+	uint32_t GetBits(uint32_t count)
+	{
+		if (m_bitCount < count)
+		{
+			Refill();
+		}
+		uint32_t value = static_cast<uint32_t>(m_bits & ((uint64_t(1) << count) - 1));
+		m_bits >>= count;
+		m_bitCount -= count;
+		return value;
+	}
+
+	uint32_t Decode(HuffmanTable const& table)
+	{
+		if (m_bitCount < 16)
+		{
+			Refill();
+		}
+
+		uint32_t entry = table.Fast[m_bits & c_fastMask];
+		if (entry)
+		{
+			uint32_t length = entry >> 9;
+			m_bits >>= length;
+			m_bitCount -= length;
+			return entry & 511;
+		}
+
+		uint32_t code = ReverseBits16(static_cast<uint32_t>(m_bits & 0xFFFF));
+		uint32_t length = c_fastBits + 1;
+		for (; length < 16; ++length)
+		{
+			if (code < table.MaxCode[length])
+			{
+				break;
+			}
+		}
+		if (length == 16)
+		{
+			throw PngDecodeError("Invalid Huffman code.");
+		}
+
+		uint32_t index = (code >> (16 - length)) - table.FirstCode[length] + table.FirstSymbol[length];
+		if (index >= 288 || table.Size[index] != length)
+		{
+			throw PngDecodeError("Invalid Huffman code.");
+		}
+		m_bits >>= length;
+		m_bitCount -= length;
+		return table.Value[index];
+	}
+
+	void Put(uint8_t value, uint8_t*& out)
+	{
+		m_window[m_windowPosition++ & c_windowMask] = value;
+		*out++ = value;
+	}
+
+	void EndBlock()
+	{
+		m_state = m_finalBlock ? State::Done : State::BlockHeader;
+	}
+
+	void ReadBlockHeader()
+	{
+		m_finalBlock = GetBits(1) != 0;
+		switch (GetBits(2))
+		{
+		case 0:
+		{
+			GetBits(m_bitCount & 7);
+			uint32_t length = GetBits(16);
+			uint32_t inverse = GetBits(16);
+			if ((length ^ 0xFFFF) != inverse)
+			{
+				throw PngDecodeError("Corrupt stored block.");
+			}
+			m_storedRemaining = length;
+			if (length == 0)
+			{
+				EndBlock();
+			}
+			else
+			{
+				m_state = State::Stored;
+			}
+			break;
+		}
+
+		case 1:
+		{
+			uint8_t lengths[288 + 32];
+			memset(lengths, 8, 144);
+			memset(lengths + 144, 9, 112);
+			memset(lengths + 256, 7, 24);
+			memset(lengths + 280, 8, 8);
+			memset(lengths + 288, 5, 32);
+			m_literals.Build(lengths, 288);
+			m_distances.Build(lengths + 288, 32);
+			m_state = State::Huffman;
+			break;
+		}
+
+		case 2:
+			ReadDynamicTables();
+			m_state = State::Huffman;
+			break;
+
+		default:
+			throw PngDecodeError("Invalid block type.");
+		}
+	}
+
+	void ReadDynamicTables()
+	{
+		uint32_t literalCount = GetBits(5) + 257;
+		uint32_t distanceCount = GetBits(5) + 1;
+		uint32_t codeLengthCount = GetBits(4) + 4;
+
+		uint8_t codeLengthLengths[19] = {};
+		for (uint32_t i = 0; i < codeLengthCount; ++i)
+		{
+			codeLengthLengths[c_codeLengthOrder[i]] = static_cast<uint8_t>(GetBits(3));
+		}
+		m_codeLengths.Build(codeLengthLengths, 19);
+
+		uint8_t lengths[288 + 32];
+		uint32_t total = literalCount + distanceCount;
+		uint32_t n = 0;
+		while (n < total)
+		{
+			uint32_t symbol = Decode(m_codeLengths);
+			if (symbol < 16)
+			{
+				lengths[n++] = static_cast<uint8_t>(symbol);
+				continue;
+			}
+
+			uint8_t fill = 0;
+			uint32_t repeat;
+			if (symbol == 16)
+			{
+				if (n == 0)
+				{
+					throw PngDecodeError("Invalid code length repeat.");
+				}
+				fill = lengths[n - 1];
+				repeat = GetBits(2) + 3;
+			}
+			else if (symbol == 17)
+			{
+				repeat = GetBits(3) + 3;
+			}
+			else
+			{
+				repeat = GetBits(7) + 11;
+			}
+
+			if (n + repeat > total)
+			{
+				throw PngDecodeError("Invalid code length repeat.");
+			}
+			memset(lengths + n, fill, repeat);
+			n += repeat;
+		}
+
+		m_literals.Build(lengths, literalCount);
+		m_distances.Build(lengths + literalCount, distanceCount);
+	}
+
+	// Input.
+	const Chunk*	m_chunk;
+	const Chunk*	m_chunkEnd;
+	const uint8_t*	m_in;
+	const uint8_t*	m_inEnd;
+	uint64_t		m_bits;
+	uint32_t		m_bitCount;
+	uint32_t		m_overrun;
+
+	// Block state.
+	State			m_state;
+	bool			m_finalBlock;
+	uint32_t		m_storedRemaining;
+	uint32_t		m_copyLength;
+	uint32_t		m_copyDistance;
+	HuffmanTable	m_literals;
+	HuffmanTable	m_distances;
+	HuffmanTable	m_codeLengths;
+
+	// Output history.
+	uint64_t		m_windowPosition;
+	uint8_t			m_window[c_windowSize];
+};
+
+PngDecoder::PngDecoder(const uint8_t* data, size_t size) :
+	m_info{},
+	m_channels(0),
+	m_bytesPerPixel(0),
+	m_palette{},
+	m_hasColorKey(false),
+	m_colorKey{}
+{
+	ParseChunks(data, size);
+}
+
+void PngDecoder::ParseChunks(const uint8_t* data, size_t size)
+{
+	if (size < sizeof(c_signature) || memcmp(data, c_signature, sizeof(c_signature)) != 0)
+	{
+		throw PngDecodeError("Not a PNG file.");
+	}
+
+	uint8_t paletteRgb[256 * 3] = {};
+	uint8_t paletteAlpha[256];
+	memset(paletteAlpha, 255, sizeof(paletteAlpha));
+	uint32_t paletteSize = 0;
+	bool sawHeader = false;
+	bool sawEnd = false;
+
+	const uint8_t* p = data + sizeof(c_signature);
+	const uint8_t* end = data + size;
+	while (!sawEnd)
+	{
+		if (end - p < 12)
+		{
+			throw PngDecodeError("Truncated chunk.");
+		}
+
+		uint32_t length = ReadBigEndian32(p);
+		const uint8_t* type = p + 4;
+		const uint8_t* body = p + 8;
+		if (length > static_cast<size_t>(end - p) - 12)
+		{
+			throw PngDecodeError("Truncated chunk.");
+		}
+		p = body + length + 4; // Skip the CRC.
+
+		if (!sawHeader && memcmp(type, "IHDR", 4) != 0)
+		{
+			throw PngDecodeError("Missing IHDR chunk.");
+		}
+
+		if (memcmp(type, "IHDR", 4) == 0)
+		{
+			if (sawHeader || length != 13)
+			{
+				throw PngDecodeError("Invalid IHDR chunk.");
+			}
+			sawHeader = true;
+
+			m_info.Width = ReadBigEndian32(body);
+			m_info.Height = ReadBigEndian32(body + 4);
+			m_info.BitDepth = body[8];
+			m_info.ColorType = body[9];
+			m_info.Interlaced = body[12] == 1;
+
+			if (m_info.Width == 0 || m_info.Height == 0 || m_info.Width > (1u << 24) || m_info.Height > (1u << 24))
+			{
+				throw PngDecodeError("Invalid image size.");
+			}
+			if (body[10] != 0 || body[11] != 0 || body[12] > 1)
+			{
+				throw PngDecodeError("Unsupported compression, filter or interlace method.");
+			}
+
+			uint8_t bitDepth = m_info.BitDepth;
+			bool validDepth = false;
+			switch (m_info.ColorType)
+			{
+			case Grayscale:
+				m_channels = 1;
+				validDepth = bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8 || bitDepth == 16;
+				break;
+			case Indexed:
+				m_channels = 1;
+				validDepth = bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8;
+				break;
+			case GrayscaleAlpha:
+				m_channels = 2;
+				validDepth = bitDepth == 8 || bitDepth == 16;
+				break;
+			case Truecolor:
+				m_channels = 3;
+				validDepth = bitDepth == 8 || bitDepth == 16;
+				break;
+			case TruecolorAlpha:
+				m_channels = 4;
+				validDepth = bitDepth == 8 || bitDepth == 16;
+				break;
+			}
+			if (!validDepth)
+			{
+				throw PngDecodeError("Unsupported color type or bit depth.");
+			}
+
+			m_bytesPerPixel = std::max(1u, m_channels * bitDepth / 8);
+			m_info.HasAlpha = m_info.ColorType == GrayscaleAlpha || m_info.ColorType == TruecolorAlpha;
+		}
+		else if (memcmp(type, "PLTE", 4) == 0)
+		{
+			if (length % 3 != 0 || length > sizeof(paletteRgb))
+			{
+				throw PngDecodeError("Invalid PLTE chunk.");
+			}
+			paletteSize = length / 3;
+			memcpy(paletteRgb, body, length);
+		}
+		else if (memcmp(type, "tRNS", 4) == 0)
+		{
+			if (m_info.ColorType == Indexed)
+			{
+				memcpy(paletteAlpha, body, std::min<size_t>(length, sizeof(paletteAlpha)));
+			}
+			else if (m_info.ColorType == Grayscale && length >= 2)
+			{
+				m_colorKey[0] = static_cast<uint16_t>(ReadBigEndian16(body));
+				m_hasColorKey = true;
+			}
+			else if (m_info.ColorType == Truecolor && length >= 6)
+			{
+				for (int i = 0; i < 3; ++i)
+				{
+					m_colorKey[i] = static_cast<uint16_t>(ReadBigEndian16(body + 2 * i));
+				}
+				m_hasColorKey = true;
+			}
+			m_info.HasAlpha = true;
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+		{
+			m_idat.push_back({ body, length });
+		}
+		else if (memcmp(type, "IEND", 4) == 0)
+		{
+			sawEnd = true;
+		}
+		else if ((type[0] & 0x20) == 0)
+		{
+			throw PngDecodeError("Unsupported critical chunk.");
+		}
+	}
+
+	if (m_idat.empty())
+	{
+		throw PngDecodeError("Missing IDAT chunk.");
+	}
+	if (m_info.ColorType == Indexed && paletteSize == 0)
+	{
+		throw PngDecodeError("Missing PLTE chunk.");
+	}
+
+	for (uint32_t i = 0; i < 256; ++i)
+	{
+		// Out-of-range indices decode as opaque black rather than failing.
+		m_palette[i] = i < paletteSize ?
+			PackPremultiplied(paletteRgb[i * 3], paletteRgb[i * 3 + 1], paletteRgb[i * 3 + 2], paletteAlpha[i]) :
+			0xFF000000;
+	}
+}
+
+void PngDecoder::ExpandRow(const uint8_t* row, uint32_t width, uint32_t* destination) const
+{
+	const uint32_t bitDepth = m_info.BitDepth;
+
+	if (bitDepth == 8 && !m_hasColorKey)
+	{
+		switch (m_info.ColorType)
+		{
+		case TruecolorAlpha:
+			ExpandRgba8(row, width, destination);
+			return;
+		case Truecolor:
+			ConvertRows(destination, 0, row, 0, width, 1, RowConversion::Rgb8ToBgra8, false);
+			return;
+		case Indexed:
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				destination[x] = m_palette[row[x]];
+			}
+			return;
+		}
+	}
+
+	// General path: sub-byte and 16-bit samples, grayscale, and color keys.
+	const uint32_t maxSample = (1u << bitDepth) - 1;
+	auto sample = [&](uint32_t index) -> uint32_t
+	{
+		if (bitDepth == 8)
+		{
+			return row[index];
+		}
+		if (bitDepth == 16)
+		{
+			return ReadBigEndian16(row + index * 2);
+		}
+		uint32_t bit = index * bitDepth;
+		return (row[bit >> 3] >> (8 - bitDepth - (bit & 7))) & maxSample;
+	};
+	auto to8 = [&](uint32_t value) -> uint32_t
+	{
+		return bitDepth == 8 ? value : (value * 255 + maxSample / 2) / maxSample;
+	};
+
+	for (uint32_t x = 0; x < width; ++x)
+	{
+		switch (m_info.ColorType)
+		{
+		case Grayscale:
+		{
+			uint32_t gray = sample(x);
+			uint32_t alpha = (m_hasColorKey && gray == m_colorKey[0]) ? 0 : 255;
+			gray = to8(gray);
+			destination[x] = PackPremultiplied(gray, gray, gray, alpha);
+			break;
+		}
+		case Indexed:
+			destination[x] = m_palette[sample(x)];
+			break;
+		case GrayscaleAlpha:
+		{
+			uint32_t gray = to8(sample(x * 2));
+			destination[x] = PackPremultiplied(gray, gray, gray, to8(sample(x * 2 + 1)));
+			break;
+		}
+		case Truecolor:
+		{
+			uint32_t r = sample(x * 3);
+			uint32_t g = sample(x * 3 + 1);
+			uint32_t b = sample(x * 3 + 2);
+			uint32_t alpha = (m_hasColorKey && r == m_colorKey[0] && g == m_colorKey[1] && b == m_colorKey[2]) ? 0 : 255;
+			destination[x] = PackPremultiplied(to8(r), to8(g), to8(b), alpha);
+			break;
+		}
+		case TruecolorAlpha:
+			destination[x] = PackPremultiplied(to8(sample(x * 4)), to8(sample(x * 4 + 1)), to8(sample(x * 4 + 2)), to8(sample(x * 4 + 3)));
+			break;
+		}
+	}
+}
+
+void PngDecoder::Decode(void* destination, size_t destinationRowPitch)
+{
+	const uint32_t width = m_info.Width;
+	const uint32_t height = m_info.Height;
+	const uint32_t bitsPerPixel = m_channels * m_info.BitDepth;
+	auto rowBytesFor = [&](uint32_t pixels) { return (static_cast<size_t>(pixels) * bitsPerPixel + 7) / 8; };
+
+	// Two rows: the one being decoded and the one above it, which starts out as zeros.
+	const size_t rowStride = rowBytesFor(width) + c_rowSlack;
+	std::vector<uint8_t> rows(rowStride * 2);
+	uint8_t* current = rows.data();
+	uint8_t* prior = rows.data() + rowStride;
+
+	std::unique_ptr<Inflater> inflater(new Inflater(m_idat));
+	uint8_t* output = static_cast<uint8_t*>(destination);
+
+	if (!m_info.Interlaced)
+	{
+		const size_t rowBytes = rowBytesFor(width);
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			uint8_t filter;
+			inflater->Read(&filter, 1);
+			inflater->Read(current, rowBytes);
+			UnfilterRow(filter, current, prior, rowBytes, m_bytesPerPixel);
+			ExpandRow(current, width, reinterpret_cast<uint32_t*>(output + y * destinationRowPitch));
+			std::swap(current, prior);
+		}
+		return;
+	}
+
+	// Adam7: each pass is a reduced image, filtered independently, scattered into place.
+	static const uint32_t c_xStart[7] = { 0, 4, 0, 2, 0, 1, 0 };
+	static const uint32_t c_yStart[7] = { 0, 0, 4, 0, 2, 0, 1 };
+	static const uint32_t c_xStep[7] = { 8, 8, 4, 4, 2, 2, 1 };
+	static const uint32_t c_yStep[7] = { 8, 8, 8, 4, 4, 2, 2 };
+
+	std::vector<uint32_t> passRow(width);
+	for (int pass = 0; pass < 7; ++pass)
+	{
+		if (c_xStart[pass] >= width || c_yStart[pass] >= height)
+		{
+			continue;
+		}
+		const uint32_t passWidth = (width - c_xStart[pass] + c_xStep[pass] - 1) / c_xStep[pass];
+		const uint32_t passHeight = (height - c_yStart[pass] + c_yStep[pass] - 1) / c_yStep[pass];
+		const size_t rowBytes = rowBytesFor(passWidth);
+
+		memset(prior, 0, rowBytes);
+		for (uint32_t y = 0; y < passHeight; ++y)
+		{
+			uint8_t filter;
+			inflater->Read(&filter, 1);
+			inflater->Read(current, rowBytes);
+			UnfilterRow(filter, current, prior, rowBytes, m_bytesPerPixel);
+			ExpandRow(current, passWidth, passRow.data());
+
+			uint32_t* target = reinterpret_cast<uint32_t*>(output + (c_yStart[pass] + y * c_yStep[pass]) * destinationRowPitch);
+			for (uint32_t x = 0; x < passWidth; ++x)
+			{
+				target[c_xStart[pass] + x * c_xStep[pass]] = passRow[x];
+			}
+			std::swap(current, prior);
+		}
+	}
+}
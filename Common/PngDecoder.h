@@ -0,0 +1,65 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace DX
+{
+	// Thrown when a PNG stream is malformed or uses something the decoder doesn't handle.
+	class PngDecodeError : public std::runtime_error
+	{
+	public:
+		explicit PngDecodeError(const char* message) : std::runtime_error(message) {}
+	};
+
+	// Image properties read from the IHDR chunk.
+	struct PngInfo
+	{
+		uint32_t	Width;
+		uint32_t	Height;
+		uint8_t		BitDepth;
+		uint8_t		ColorType;
+		bool		Interlaced;
+		bool		HasAlpha;	// Alpha channel, or a tRNS chunk.
+	};
+
+	// Self-contained PNG decoder. Produces 32-bit premultiplied BGRA, the same layout as
+	// WIC's GUID_WICPixelFormat32bppPBGRA, without going through COM.
+	//
+	// The zlib stream is inflated incrementally across the IDAT chunks, one scanline at a
+	// time, so only two rows of filtered data are ever held. Row unfiltering and the
+	// RGB(A) to BGRA expansion use SSE2/AVX2/NEON where available.
+	class PngDecoder
+	{
+	public:
+		// The data must stay valid for the lifetime of the decoder; it isn't copied.
+		PngDecoder(const uint8_t* data, size_t size);
+
+		PngInfo const& GetInfo() const { return m_info; }
+
+		// Writes Height rows of Width pixels. destinationRowPitch is in bytes and must be
+		// at least Width * 4.
+		void Decode(void* destination, size_t destinationRowPitch);
+
+	private:
+		struct Chunk
+		{
+			const uint8_t*	Data;
+			uint32_t		Length;
+		};
+		class Inflater;
+
+		void ParseChunks(const uint8_t* data, size_t size);
+		void ExpandRow(const uint8_t* row, uint32_t width, uint32_t* destination) const;
+
+		PngInfo				m_info;
+		uint32_t			m_channels;
+		uint32_t			m_bytesPerPixel;	// For filtering: at least 1.
+		std::vector<Chunk>	m_idat;
+		uint32_t			m_palette[256];		// Premultiplied BGRA.
+		bool				m_hasColorKey;
+		uint16_t			m_colorKey[3];
+	};
+}
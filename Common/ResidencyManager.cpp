@@ -0,0 +1,252 @@
+﻿#include "ResidencyManager.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace DX;
+
+ResidencyManager::ResidencyManager(uint32_t width, uint32_t height, uint32_t mipCount, uint32_t tileWidth, uint32_t tileHeight,
+	uint64_t tileBytes, uint64_t budgetBytes, uint32_t maxLoadsPerUpdate) :
+	m_width(width),
+	m_height(height),
+	m_mipCount(mipCount),
+	m_tileWidth(tileWidth),
+	m_tileHeight(tileHeight),
+	m_tileBytes(tileBytes),
+	m_budgetBytes(budgetBytes),
+	m_maxLoadsPerUpdate(maxLoadsPerUpdate),
+	m_packedMip(0),
+	m_frame(0),
+	m_residentBytes(0),
+	m_finestRequestedMip(mipCount)
+{
+	if (width == 0 || height == 0 || mipCount == 0 || tileWidth == 0 || tileHeight == 0)
+	{
+		throw std::invalid_argument("Texture and tile sizes must be non-zero.");
+	}
+
+	// Every mip gets a grid of tiles, down to the first one that fits in a single tile. That
+	// one holds the rest of the chain as well.
+	size_t tileCount = 0;
+	for (uint32_t mip = 0; mip < mipCount; ++mip)
+	{
+		const uint32_t mipWidth = std::max(1u, width >> mip);
+		const uint32_t mipHeight = std::max(1u, height >> mip);
+
+		MipTiles tiles;
+		tiles.TileCountX = (mipWidth + tileWidth - 1) / tileWidth;
+		tiles.TileCountY = (mipHeight + tileHeight - 1) / tileHeight;
+		tiles.Shift = mip;
+		tiles.FirstTile = tileCount;
+		m_mips.push_back(tiles);
+		tileCount += static_cast<size_t>(tiles.TileCountX) * tiles.TileCountY;
+
+		m_packedMip = mip;
+		if (tiles.TileCountX == 1 && tiles.TileCountY == 1)
+		{
+			break;
+		}
+	}
+
+	m_tiles.assign(tileCount, Tile{ 0, TileState::Evicted });
+
+	if (budgetBytes < tileBytes)
+	{
+		throw std::invalid_argument("The budget must hold at least the mip tail.");
+	}
+}
+
+// Marks every tile of a mip in the given range as wanted this frame, and queues the ones
+// that aren't loaded. Returns false when all of them had already been marked, in which
+// case so had every coarser tile under them.
+bool ResidencyManager::Request(uint32_t mip, uint32_t firstX, uint32_t firstY, uint32_t lastX, uint32_t lastY)
+{
+	bool marked = false;
+	for (uint32_t y = firstY; y <= lastY; ++y)
+	{
+		for (uint32_t x = firstX; x <= lastX; ++x)
+		{
+			Tile& tile = GetTile(mip, x, y);
+			if (tile.LastRequested == m_frame)
+			{
+				continue;
+			}
+
+			tile.LastRequested = m_frame;
+			marked = true;
+			if (tile.State == TileState::Evicted)
+			{
+				m_requested.push_back(ResidencyTile{ mip, x, y });
+			}
+		}
+	}
+	return marked;
+}
+
+ResidencyUpdate const& ResidencyManager::Update(MinMipMap const& feedback)
+{
+	++m_frame;
+	m_update.Loads.clear();
+	m_update.Evictions.clear();
+	m_requested.clear();
+	m_evictable.clear();
+	m_finestRequestedMip = m_mipCount;
+
+	// The tail is always wanted, so there's something to sample everywhere.
+	Request(m_packedMip, 0, 0, 0, 0);
+
+	for (uint32_t regionY = 0; regionY < feedback.Height; ++regionY)
+	{
+		const uint32_t top = regionY * feedback.RegionHeight;
+		const uint32_t bottom = std::min(m_height, top + feedback.RegionHeight) - 1;
+		if (top >= m_height)
+		{
+			break;
+		}
+
+		const uint8_t* row = feedback.Mips.data() + static_cast<size_t>(regionY) * feedback.Width;
+		for (uint32_t regionX = 0; regionX < feedback.Width; ++regionX)
+		{
+			if (row[regionX] == c_feedbackNotSampled)
+			{
+				continue;
+			}
+
+			const uint32_t left = regionX * feedback.RegionWidth;
+			const uint32_t right = std::min(m_width, left + feedback.RegionWidth) - 1;
+			if (left >= m_width)
+			{
+				break;
+			}
+
+			const uint32_t requestedMip = std::min<uint32_t>(row[regionX], m_packedMip);
+			m_finestRequestedMip = std::min(m_finestRequestedMip, static_cast<uint32_t>(row[regionX]));
+
+			// Walk up the chain until reaching tiles that another region already marked.
+			for (uint32_t mip = requestedMip; mip < m_packedMip; ++mip)
+			{
+				MipTiles const& tiles = m_mips[mip];
+				if (!Request(mip,
+					(left >> tiles.Shift) / m_tileWidth, (top >> tiles.Shift) / m_tileHeight,
+					std::min(tiles.TileCountX - 1, (right >> tiles.Shift) / m_tileWidth), std::min(tiles.TileCountY - 1, (bottom >> tiles.Shift) / m_tileHeight)))
+				{
+					break;
+				}
+			}
+		}
+	}
+
+	// Coarse mips first, so that each load has its fallback loaded before it.
+	std::stable_sort(m_requested.begin(), m_requested.end(),
+		[](ResidencyTile const& a, ResidencyTile const& b) { return a.Mip > b.Mip; });
+
+	bool evictableCollected = false;
+	for (ResidencyTile const& requested : m_requested)
+	{
+		if (m_update.Loads.size() == m_maxLoadsPerUpdate)
+		{
+			break;
+		}
+		if (m_residentBytes + m_tileBytes > m_budgetBytes && !MakeRoom(evictableCollected))
+		{
+			break;
+		}
+
+		GetTile(requested.Mip, requested.X, requested.Y).State = TileState::Loading;
+		m_residentBytes += m_tileBytes;
+		m_update.Loads.push_back(requested);
+	}
+
+	return m_update;
+}
+
+// Evicts the resident tile that has gone unsampled the longest, unless every resident tile
+// was sampled this frame.
+bool ResidencyManager::MakeRoom(bool& evictableCollected)
+{
+	if (!evictableCollected)
+	{
+		evictableCollected = true;
+		for (uint32_t mip = 0; mip < m_packedMip; ++mip)
+		{
+			for (uint32_t y = 0; y < m_mips[mip].TileCountY; ++y)
+			{
+				for (uint32_t x = 0; x < m_mips[mip].TileCountX; ++x)
+				{
+					Tile const& tile = GetTile(mip, x, y);
+					if (tile.State == TileState::Resident && tile.LastRequested < m_frame)
+					{
+						m_evictable.push_back(ResidencyTile{ mip, x, y });
+					}
+				}
+			}
+		}
+
+		// Back to front, so the next eviction is popped off the end. Within a frame, finer
+		// tiles go first, so nothing is left resident without the tiles it falls back to.
+		std::sort(m_evictable.begin(), m_evictable.end(), [this](ResidencyTile const& a, ResidencyTile const& b)
+		{
+			const uint64_t lastA = GetTile(a.Mip, a.X, a.Y).LastRequested;
+			const uint64_t lastB = GetTile(b.Mip, b.X, b.Y).LastRequested;
+			return lastA != lastB ? lastA > lastB : a.Mip > b.Mip;
+		});
+	}
+
+	if (m_evictable.empty())
+	{
+		return false;
+	}
+
+	ResidencyTile evicted = m_evictable.back();
+	m_evictable.pop_back();
+
+	GetTile(evicted.Mip, evicted.X, evicted.Y).State = TileState::Evicted;
+	m_residentBytes -= m_tileBytes;
+	m_update.Evictions.push_back(evicted);
+	return true;
+}
+
+void ResidencyManager::CompleteLoad(ResidencyTile const& tile)
+{
+	Tile& loaded = GetTile(tile.Mip, tile.X, tile.Y);
+	if (loaded.State == TileState::Loading)
+	{
+		loaded.State = TileState::Resident;
+	}
+}
+
+uint32_t ResidencyManager::GetResidentMip(uint32_t tileX, uint32_t tileY) const
+{
+	const uint32_t left = tileX * m_tileWidth;
+	const uint32_t top = tileY * m_tileHeight;
+
+	uint32_t residentMip = m_mipCount;
+	for (uint32_t mip = m_packedMip + 1; mip-- > 0;)
+	{
+		MipTiles const& tiles = m_mips[mip];
+		if (GetTile(mip, (left >> tiles.Shift) / m_tileWidth, (top >> tiles.Shift) / m_tileHeight).State != TileState::Resident)
+		{
+			break;
+		}
+		residentMip = mip;
+	}
+	return residentMip;
+}
+
+uint32_t ResidencyManager::GetSampleableMip() const
+{
+	uint32_t sampleableMip = m_mipCount;
+	for (uint32_t mip = m_packedMip + 1; mip-- > std::min(m_finestRequestedMip, m_packedMip);)
+	{
+		MipTiles const& tiles = m_mips[mip];
+		for (size_t i = tiles.FirstTile; i < tiles.FirstTile + static_cast<size_t>(tiles.TileCountX) * tiles.TileCountY; ++i)
+		{
+			if (m_tiles[i].LastRequested == m_frame && m_tiles[i].State != TileState::Resident)
+			{
+				return sampleableMip;
+			}
+		}
+		sampleableMip = mip;
+	}
+	return sampleableMip;
+}
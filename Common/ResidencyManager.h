@@ -0,0 +1,122 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace DX
+{
+	// Marks a region the shader didn't sample, as in a resolved min-mip feedback map.
+	const uint8_t c_feedbackNotSampled = 0xFF;
+
+	// A min-mip feedback map, laid out as ResolveSubresourceRegion decodes
+	// DXGI_FORMAT_SAMPLER_FEEDBACK_MIN_MIP_OPAQUE to R8_UINT: one byte per region of
+	// RegionWidth x RegionHeight texels of the top mip, holding the most detailed mip
+	// sampled anywhere in it.
+	struct MinMipMap
+	{
+		uint32_t				Width;			// In regions.
+		uint32_t				Height;
+		uint32_t				RegionWidth;	// In texels of the top mip.
+		uint32_t				RegionHeight;
+		std::vector<uint8_t>	Mips;
+	};
+
+	// One tile of one mip.
+	struct ResidencyTile
+	{
+		uint32_t	Mip;
+		uint32_t	X;
+		uint32_t	Y;
+	};
+
+	// What to do this frame. Loads are ordered coarse mips first, so a finer tile is never
+	// asked for before the tiles it falls back to.
+	struct ResidencyUpdate
+	{
+		std::vector<ResidencyTile>	Loads;
+		std::vector<ResidencyTile>	Evictions;
+	};
+
+	// Decides which tiles of a texture to keep resident from what the feedback says was
+	// sampled, within a memory budget. A tile that is sampled keeps every coarser tile
+	// under it wanted as well. When the budget is full, tiles that weren't sampled this frame
+	// are evicted least recently sampled first, finer mips before coarser. The mip tail, the
+	// mips that fit in a single tile, is loaded first and never evicted.
+	class ResidencyManager
+	{
+	public:
+		ResidencyManager(uint32_t width, uint32_t height, uint32_t mipCount, uint32_t tileWidth, uint32_t tileHeight,
+			uint64_t tileBytes, uint64_t budgetBytes, uint32_t maxLoadsPerUpdate = 16);
+
+		// Consumes one frame's feedback. The returned loads count as resident from now on,
+		// so they aren't asked for again; call CompleteLoad when one has landed.
+		ResidencyUpdate const& Update(MinMipMap const& feedback);
+		void CompleteLoad(ResidencyTile const& tile);
+
+		// The most detailed mip that is loaded for a tile of the top mip, along with every
+		// coarser mip under it, or the mip count if not even the tail is. This is what a
+		// shader should clamp its sampling to there.
+		uint32_t GetResidentMip(uint32_t tileX, uint32_t tileY) const;
+
+		// The most detailed mip a shader can be clamped to everywhere: every tile the last
+		// feedback asked for at it and coarser mips is resident. Never finer than was asked
+		// for, and the mip count if not even the tail is resident.
+		uint32_t GetSampleableMip() const;
+
+		// The most detailed mip the last feedback asked for, or the mip count if none.
+		uint32_t GetFinestRequestedMip() const { return m_finestRequestedMip; }
+
+		// Tiles exist for the mips up to and including the packed one.
+		uint32_t GetTileCountX(uint32_t mip) const { return m_mips[mip].TileCountX; }
+		uint32_t GetTileCountY(uint32_t mip) const { return m_mips[mip].TileCountY; }
+		uint32_t GetPackedMip() const { return m_packedMip; }
+		uint64_t GetResidentBytes() const { return m_residentBytes; }
+		uint64_t GetBudgetBytes() const { return m_budgetBytes; }
+
+	private:
+		enum class TileState : uint8_t
+		{
+			Evicted,
+			Loading,
+			Resident,
+		};
+
+		struct Tile
+		{
+			uint64_t	LastRequested;	// Frame number, zero if never.
+			TileState	State;
+		};
+
+		struct MipTiles
+		{
+			uint32_t	TileCountX;
+			uint32_t	TileCountY;
+			uint32_t	Shift;		// log2 of the top mip's texels per texel of this mip.
+			size_t		FirstTile;
+		};
+
+		Tile& GetTile(uint32_t mip, uint32_t x, uint32_t y) { return m_tiles[m_mips[mip].FirstTile + y * m_mips[mip].TileCountX + x]; }
+		Tile const& GetTile(uint32_t mip, uint32_t x, uint32_t y) const { return m_tiles[m_mips[mip].FirstTile + y * m_mips[mip].TileCountX + x]; }
+		bool Request(uint32_t mip, uint32_t firstX, uint32_t firstY, uint32_t lastX, uint32_t lastY);
+		bool MakeRoom(bool& evictableCollected);
+
+		uint32_t					m_width;
+		uint32_t					m_height;
+		uint32_t					m_mipCount;
+		uint32_t					m_tileWidth;
+		uint32_t					m_tileHeight;
+		uint64_t					m_tileBytes;
+		uint64_t					m_budgetBytes;
+		uint32_t					m_maxLoadsPerUpdate;
+		uint32_t					m_packedMip;	// First mip of the tail, which is one tile.
+		std::vector<MipTiles>		m_mips;
+		std::vector<Tile>			m_tiles;
+		uint64_t					m_frame;
+		uint64_t					m_residentBytes;
+		uint32_t					m_finestRequestedMip;
+		std::vector<ResidencyTile>	m_requested;	// Scratch, reused between updates.
+		std::vector<ResidencyTile>	m_evictable;
+		ResidencyUpdate				m_update;
+	};
+}
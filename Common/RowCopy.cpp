@@ -0,0 +1,165 @@
+﻿#include "RowCopy.h"
+#include "Simd.h"
+
+#include <cstring>
+
+using namespace DX;
+
+namespace
+{
+	// Rows this short gain nothing from streaming: a partial cache line is flushed piecemeal
+	// anyway, and the setup costs more than the copy.
+	const size_t c_minimumStreamingRow = 64;
+
+	void CopyRow(uint8_t* destination, const uint8_t* source, size_t size, bool streaming)
+	{
+#if DX_SIMD_SSE2
+		if (streaming && size >= c_minimumStreamingRow)
+		{
+			// Plain stores up to 16-byte alignment, which non-temporal stores need.
+			const size_t head = (16 - (reinterpret_cast<uintptr_t>(destination) & 15)) & 15;
+			memcpy(destination, source, head);
+
+			size_t i = head;
+#if DX_SIMD_AVX2
+			if ((reinterpret_cast<uintptr_t>(destination + i) & 31) != 0 && i + 16 <= size)
+			{
+				_mm_stream_si128(reinterpret_cast<__m128i*>(destination + i), _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i)));
+				i += 16;
+			}
+			for (; i + 128 <= size; i += 128)
+			{
+				// Whole cache lines at a time, so write-combining buffers are flushed full.
+				__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i));
+				__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i + 32));
+				__m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i + 64));
+				__m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i + 96));
+				_mm256_stream_si256(reinterpret_cast<__m256i*>(destination + i), a);
+				_mm256_stream_si256(reinterpret_cast<__m256i*>(destination + i + 32), b);
+				_mm256_stream_si256(reinterpret_cast<__m256i*>(destination + i + 64), c);
+				_mm256_stream_si256(reinterpret_cast<__m256i*>(destination + i + 96), d);
+			}
+#endif
+			for (; i + 64 <= size; i += 64)
+			{
+				__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+				__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i + 16));
+				__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i + 32));
+				__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i + 48));
+				_mm_stream_si128(reinterpret_cast<__m128i*>(destination + i), a);
+				_mm_stream_si128(reinterpret_cast<__m128i*>(destination + i + 16), b);
+				_mm_stream_si128(reinterpret_cast<__m128i*>(destination + i + 32), c);
+				_mm_stream_si128(reinterpret_cast<__m128i*>(destination + i + 48), d);
+			}
+			for (; i + 16 <= size; i += 16)
+			{
+				_mm_stream_si128(reinterpret_cast<__m128i*>(destination + i), _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i)));
+			}
+			memcpy(destination + i, source + i, size - i);
+			return;
+		}
+#else
+		(void)streaming;
+#endif
+		memcpy(destination, source, size);
+	}
+
+	// RGB8 -> opaque BGRA8.
+	void ConvertRgb8Row(uint32_t* destination, const uint8_t* source, uint32_t width, bool streaming)
+	{
+		uint32_t x = 0;
+#if DX_SIMD_SSSE3
+		{
+			const __m128i shuffle = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+			const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+			const bool aligned = (reinterpret_cast<uintptr_t>(destination) & 15) == 0;
+
+			// Each load takes 16 bytes for 12 bytes of pixels, so the last 2 pixels are left to
+			// the scalar loop rather than reading past the row.
+			for (; x + 6 <= width; x += 4)
+			{
+				__m128i pixels = _mm_or_si128(_mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + x * 3)), shuffle), alpha);
+				if (streaming && aligned)
+				{
+					_mm_stream_si128(reinterpret_cast<__m128i*>(destination + x), pixels);
+				}
+				else
+				{
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + x), pixels);
+				}
+			}
+		}
+#elif DX_SIMD_NEON
+		(void)streaming;
+		for (; x + 8 <= width; x += 8)
+		{
+			uint8x8x3_t rgb = vld3_u8(source + x * 3);
+			uint8x8x4_t bgra;
+			bgra.val[0] = rgb.val[2];
+			bgra.val[1] = rgb.val[1];
+			bgra.val[2] = rgb.val[0];
+			bgra.val[3] = vdup_n_u8(255);
+			vst4_u8(reinterpret_cast<uint8_t*>(destination + x), bgra);
+		}
+#else
+		(void)streaming;
+#endif
+		for (; x < width; ++x)
+		{
+			const uint8_t* p = source + x * 3;
+			destination[x] = p[2] | (p[1] << 8) | (p[0] << 16) | 0xFF000000;
+		}
+	}
+
+	void FinishStreaming(bool streaming)
+	{
+#if DX_SIMD_SSE2
+		if (streaming)
+		{
+			_mm_sfence();
+		}
+#else
+		(void)streaming;
+#endif
+	}
+}
+
+void DX::CopyRows(void* destination, size_t destinationPitch, const void* source, size_t sourcePitch, size_t rowSize, uint32_t rowCount, bool streaming)
+{
+	uint8_t* destinationRow = static_cast<uint8_t*>(destination);
+	const uint8_t* sourceRow = static_cast<const uint8_t*>(source);
+	if (rowSize == destinationPitch && rowSize == sourcePitch)
+	{
+		CopyRow(destinationRow, sourceRow, rowSize * rowCount, streaming);
+	}
+	else
+	{
+		for (uint32_t row = 0; row < rowCount; ++row)
+		{
+			CopyRow(destinationRow, sourceRow, rowSize, streaming);
+			destinationRow += destinationPitch;
+			sourceRow += sourcePitch;
+		}
+	}
+	FinishStreaming(streaming);
+}
+
+void DX::ConvertRows(void* destination, size_t destinationPitch, const void* source, size_t sourcePitch, uint32_t width, uint32_t rowCount,
+	RowConversion conversion, bool streaming)
+{
+	if (conversion == RowConversion::None)
+	{
+		CopyRows(destination, destinationPitch, source, sourcePitch, static_cast<size_t>(width) * 4, rowCount, streaming);
+		return;
+	}
+
+	uint8_t* destinationRow = static_cast<uint8_t*>(destination);
+	const uint8_t* sourceRow = static_cast<const uint8_t*>(source);
+	for (uint32_t row = 0; row < rowCount; ++row)
+	{
+		ConvertRgb8Row(reinterpret_cast<uint32_t*>(destinationRow), sourceRow, width, streaming);
+		destinationRow += destinationPitch;
+		sourceRow += sourcePitch;
+	}
+	FinishStreaming(streaming);
+}
@@ -0,0 +1,28 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace DX
+{
+	// How pixels are converted on their way to the destination.
+	enum class RowConversion
+	{
+		None,			// Bytes are copied as they are.
+		Rgb8ToBgra8,	// Opaque BGRA8 from RGB8; rows hold width * 3 bytes in and width * 4 out.
+	};
+
+	// Copies rowCount rows of rowSize bytes between pitched images, for writing into upload
+	// heaps. Rows that are contiguous on both sides are copied as one. With streaming set, the
+	// destination is written with non-temporal stores, which go straight to memory without
+	// reading it into the cache: the right thing for write-combined upload memory, which is
+	// slow to read, and for anything else that won't be read back soon. Streaming is fenced
+	// before returning, so the data is visible once the call returns.
+	void CopyRows(void* destination, size_t destinationPitch, const void* source, size_t sourcePitch, size_t rowSize, uint32_t rowCount, bool streaming);
+
+	// As CopyRows, converting pixels on the way, so that decoded pixels are read once and
+	// written once. The PNG decoder expands truecolour rows with it. width is in pixels, and
+	// the destination must be 4-byte aligned.
+	void ConvertRows(void* destination, size_t destinationPitch, const void* source, size_t sourcePitch, uint32_t width, uint32_t rowCount,
+		RowConversion conversion, bool streaming);
+}
@@ -0,0 +1,36 @@
+﻿#pragma once
+
+// Compile-time selection of the vector instruction sets used by the CPU-side asset
+// code. Everything that uses these also has a scalar path, so a build with none of
+// them defined is still complete.
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DX_SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__SSSE3__) || defined(__AVX__)
+#define DX_SIMD_SSSE3 1
+#include <tmmintrin.h>
+#endif
+
+#if defined(__SSE4_1__) || defined(__AVX__)
+#define DX_SIMD_SSE41 1
+#include <smmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define DX_SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+
+// MSVC has no macro of its own for F16C, which every AVX2 processor has.
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define DX_SIMD_F16C 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+#define DX_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
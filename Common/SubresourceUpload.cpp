@@ -0,0 +1,143 @@
+﻿#include "pch.h"
+#include "SubresourceUpload.h"
+#include "RowCopy.h"
+#include "TextureLayout.h"
+
+#include <stdexcept>
+
+using namespace DX;
+
+UINT64 SubresourceLayout::GetSize(UINT first, UINT count) const
+{
+	const UINT last = first + count - 1;
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT const& footprint = Footprints[last];
+	return footprint.Offset - Footprints[first].Offset +
+		static_cast<UINT64>(footprint.Footprint.RowPitch) * (static_cast<UINT64>(RowCounts[last]) * footprint.Footprint.Depth - 1) + RowSizes[last];
+}
+
+FootprintCache::FootprintCache(ID3D12Device* device) :
+	m_device(device),
+	m_hitCount(0),
+	m_missCount(0)
+{
+}
+
+// Descriptions have padding in them, so they are hashed and compared field by field.
+size_t FootprintCache::DescHash::operator()(D3D12_RESOURCE_DESC const& desc) const
+{
+	const UINT64 fields[] =
+	{
+		static_cast<UINT64>(desc.Dimension) | static_cast<UINT64>(desc.Format) << 8 | static_cast<UINT64>(desc.Layout) << 24 | static_cast<UINT64>(desc.Flags) << 32,
+		desc.Alignment,
+		desc.Width,
+		static_cast<UINT64>(desc.Height) | static_cast<UINT64>(desc.DepthOrArraySize) << 32 | static_cast<UINT64>(desc.MipLevels) << 48,
+		static_cast<UINT64>(desc.SampleDesc.Count) | static_cast<UINT64>(desc.SampleDesc.Quality) << 32,
+	};
+
+	// FNV-1a over the fields.
+	UINT64 hash = 14695981039346656037ull;
+	for (UINT64 field : fields)
+	{
+		hash = (hash ^ field) * 1099511628211ull;
+	}
+	return static_cast<size_t>(hash);
+}
+
+bool FootprintCache::DescEqual::operator()(D3D12_RESOURCE_DESC const& a, D3D12_RESOURCE_DESC const& b) const
+{
+	return a.Dimension == b.Dimension && a.Alignment == b.Alignment && a.Width == b.Width && a.Height == b.Height &&
+		a.DepthOrArraySize == b.DepthOrArraySize && a.MipLevels == b.MipLevels && a.Format == b.Format &&
+		a.SampleDesc.Count == b.SampleDesc.Count && a.SampleDesc.Quality == b.SampleDesc.Quality && a.Layout == b.Layout && a.Flags == b.Flags;
+}
+
+SubresourceLayout const& FootprintCache::GetLayout(D3D12_RESOURCE_DESC const& desc)
+{
+	auto found = m_layouts.find(desc);
+	if (found != m_layouts.end())
+	{
+		++m_hitCount;
+		return found->second;
+	}
+	++m_missCount;
+
+	const UINT subresourceCount = desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? desc.MipLevels : desc.MipLevels * desc.DepthOrArraySize;
+
+	SubresourceLayout layout;
+	layout.Footprints.resize(subresourceCount);
+	layout.RowCounts.resize(subresourceCount);
+	layout.RowSizes.resize(subresourceCount);
+	m_device->GetCopyableFootprints(&desc, 0, subresourceCount, 0, layout.Footprints.data(), layout.RowCounts.data(), layout.RowSizes.data(), nullptr);
+
+#if defined(_DEBUG)
+	// Layouts planned ahead of time, without a device, go by GetTextureFootprints, so check
+	// that it agrees with the device wherever it can.
+	TextureFormatLayout formatLayout;
+	if (desc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER && GetTextureFormatLayout(desc.Format, formatLayout))
+	{
+		const TextureLayoutDesc layoutDesc = { static_cast<uint32_t>(desc.Format), static_cast<uint32_t>(desc.Width), desc.Height, desc.DepthOrArraySize,
+			desc.MipLevels, desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D };
+		std::vector<SubresourceFootprint> footprints(subresourceCount);
+		GetTextureFootprints(layoutDesc, formatLayout, 0, subresourceCount, 0, footprints.data());
+
+		for (UINT i = 0; i < subresourceCount; ++i)
+		{
+			SubresourceFootprint const& expected = footprints[i];
+			D3D12_PLACED_SUBRESOURCE_FOOTPRINT const& actual = layout.Footprints[i];
+			if (expected.Offset != actual.Offset || expected.Width != actual.Footprint.Width || expected.Height != actual.Footprint.Height ||
+				expected.Depth != actual.Footprint.Depth || expected.RowPitch != actual.Footprint.RowPitch ||
+				expected.RowCount != layout.RowCounts[i] || expected.RowSize != layout.RowSizes[i])
+			{
+				throw std::logic_error("GetTextureFootprints disagrees with the device.");
+			}
+		}
+	}
+#endif
+
+	return m_layouts.emplace(desc, std::move(layout)).first->second;
+}
+
+void DX::WriteSubresources(SubresourceLayout const& layout, UINT first, UINT count, const D3D12_SUBRESOURCE_DATA* sources, UINT8* destination)
+{
+	const UINT64 baseOffset = layout.Footprints[first].Offset;
+	for (UINT i = 0; i < count; ++i)
+	{
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT const& footprint = layout.Footprints[first + i];
+		const UINT rowCount = layout.RowCounts[first + i];
+		const size_t slicePitch = static_cast<size_t>(footprint.Footprint.RowPitch) * rowCount;
+
+		// Upload memory is write-combined, so it is written with streaming stores.
+		for (UINT slice = 0; slice < footprint.Footprint.Depth; ++slice)
+		{
+			CopyRows(destination + (footprint.Offset - baseOffset) + slice * slicePitch, footprint.Footprint.RowPitch,
+				static_cast<const UINT8*>(sources[i].pData) + slice * sources[i].SlicePitch, sources[i].RowPitch,
+				static_cast<size_t>(layout.RowSizes[first + i]), rowCount, true);
+		}
+	}
+}
+
+void DX::CopySubresources(ID3D12GraphicsCommandList* commandList, ID3D12Resource* destination, SubresourceLayout const& layout, UINT first, UINT count,
+	ID3D12Resource* upload, UINT64 uploadOffset)
+{
+	const UINT64 baseOffset = layout.Footprints[first].Offset;
+	for (UINT i = 0; i < count; ++i)
+	{
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = layout.Footprints[first + i];
+		footprint.Offset = footprint.Offset - baseOffset + uploadOffset;
+
+		CD3DX12_TEXTURE_COPY_LOCATION destinationLocation(destination, first + i);
+		CD3DX12_TEXTURE_COPY_LOCATION sourceLocation(upload, footprint);
+		commandList->CopyTextureRegion(&destinationLocation, 0, 0, 0, &sourceLocation, nullptr);
+	}
+}
+
+void DX::EnqueueSubresourceCopies(UploadBatcher& batcher, ID3D12Resource* destination, SubresourceLayout const& layout, UINT first, UINT count,
+	ID3D12Resource* upload, UINT64 uploadOffset)
+{
+	const UINT64 baseOffset = layout.Footprints[first].Offset;
+	for (UINT i = 0; i < count; ++i)
+	{
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT const& footprint = layout.Footprints[first + i];
+		batcher.Enqueue(MakeTextureCopy(destination, first + i, 0, 0, upload, footprint.Offset - baseOffset + uploadOffset,
+			footprint.Footprint.Format, footprint.Footprint.Width, footprint.Footprint.Height, footprint.Footprint.RowPitch, layout.RowCounts[first + i]));
+	}
+}
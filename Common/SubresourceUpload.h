@@ -0,0 +1,64 @@
+﻿#pragma once
+
+#include "UploadBatcher.h"
+
+#include <unordered_map>
+
+namespace DX
+{
+	// What GetCopyableFootprints reports for every subresource of a resource, placed from
+	// offset zero.
+	struct SubresourceLayout
+	{
+		std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT>	Footprints;
+		std::vector<UINT>								RowCounts;
+		std::vector<UINT64>								RowSizes;
+
+		// Bytes of upload space that subresources first to first + count - 1 take, placed
+		// together as they are here.
+		UINT64 GetSize(UINT first, UINT count) const;
+	};
+
+	// Remembers the footprints of each resource description it has been asked about, so that
+	// uploading to another resource like it doesn't query the device or allocate again. Not
+	// thread-safe: each thread recording uploads keeps its own.
+	class FootprintCache
+	{
+	public:
+		explicit FootprintCache(ID3D12Device* device);
+
+		FootprintCache(FootprintCache const&) = delete;
+		FootprintCache& operator=(FootprintCache const&) = delete;
+
+		SubresourceLayout const& GetLayout(D3D12_RESOURCE_DESC const& desc);
+
+		uint64_t GetHitCount() const { return m_hitCount; }
+		uint64_t GetMissCount() const { return m_missCount; }
+
+	private:
+		struct DescHash
+		{
+			size_t operator()(D3D12_RESOURCE_DESC const& desc) const;
+		};
+		struct DescEqual
+		{
+			bool operator()(D3D12_RESOURCE_DESC const& a, D3D12_RESOURCE_DESC const& b) const;
+		};
+
+		Microsoft::WRL::ComPtr<ID3D12Device>	m_device;
+		std::unordered_map<D3D12_RESOURCE_DESC, SubresourceLayout, DescHash, DescEqual>	m_layouts;
+		uint64_t								m_hitCount;
+		uint64_t								m_missCount;
+	};
+
+	// The allocation-free counterpart of UpdateSubresources, in two halves. Upload space for
+	// subresources first to first + count - 1 starts at destination, or uploadOffset in the
+	// upload resource, and holds layout.GetSize(first, count) bytes placed as in the layout.
+	// Every subresource is written, or has its copy recorded, in one call. Copies through an
+	// UploadBatcher are limited to 2D textures and arrays, since a CopyRequest has no depth.
+	void WriteSubresources(SubresourceLayout const& layout, UINT first, UINT count, const D3D12_SUBRESOURCE_DATA* sources, UINT8* destination);
+	void CopySubresources(ID3D12GraphicsCommandList* commandList, ID3D12Resource* destination, SubresourceLayout const& layout, UINT first, UINT count,
+		ID3D12Resource* upload, UINT64 uploadOffset);
+	void EnqueueSubresourceCopies(UploadBatcher& batcher, ID3D12Resource* destination, SubresourceLayout const& layout, UINT first, UINT count,
+		ID3D12Resource* upload, UINT64 uploadOffset);
+}
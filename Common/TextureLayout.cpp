@@ -0,0 +1,111 @@
+﻿#include "TextureLayout.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace DX;
+
+namespace
+{
+	uint64_t Align(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+bool DX::GetTextureFormatLayout(uint32_t format, TextureFormatLayout& layout)
+{
+	// DXGI_FORMAT values, in ranges of the same layout.
+	uint32_t blockSize = 1;
+	uint32_t bytes;
+	if (format >= 1 && format <= 5)				// R32G32B32A32
+	{
+		bytes = 16;
+	}
+	else if (format >= 6 && format <= 9)		// R32G32B32
+	{
+		bytes = 12;
+	}
+	else if (format >= 10 && format <= 18)		// R16G16B16A16, R32G32
+	{
+		bytes = 8;
+	}
+	else if ((format >= 23 && format <= 43) || format == 67 || (format >= 87 && format <= 93))
+	{
+		// R10G10B10A2, R11G11B10, R8G8B8A8, R16G16, R32 and D32, R9G9B9E5, B8G8R8A8 and
+		// B8G8R8X8, R10G10B10_XR_BIAS_A2.
+		bytes = 4;
+	}
+	else if ((format >= 48 && format <= 59) || format == 85 || format == 86 || format == 115)
+	{
+		// R8G8, R16 and D16, B5G6R5, B5G5R5A1, B4G4R4A4.
+		bytes = 2;
+	}
+	else if (format >= 60 && format <= 65)		// R8, A8
+	{
+		bytes = 1;
+	}
+	else if (format == 68 || format == 69)		// R8G8_B8G8, G8R8_G8B8
+	{
+		layout = TextureFormatLayout{ 2, 1, 4 };
+		return true;
+	}
+	else if ((format >= 70 && format <= 72) || (format >= 79 && format <= 81))
+	{
+		// BC1, BC4.
+		blockSize = 4;
+		bytes = 8;
+	}
+	else if ((format >= 73 && format <= 78) || (format >= 82 && format <= 84) || (format >= 94 && format <= 99))
+	{
+		// BC2, BC3, BC5, BC6H, BC7.
+		blockSize = 4;
+		bytes = 16;
+	}
+	else
+	{
+		return false;
+	}
+
+	layout = TextureFormatLayout{ blockSize, blockSize, bytes };
+	return true;
+}
+
+uint64_t DX::GetTextureFootprints(TextureLayoutDesc const& desc, uint32_t first, uint32_t count, uint64_t baseOffset, SubresourceFootprint* footprints)
+{
+	TextureFormatLayout formatLayout;
+	if (!GetTextureFormatLayout(desc.Format, formatLayout))
+	{
+		throw std::invalid_argument("Footprints aren't computed for this format.");
+	}
+	return GetTextureFootprints(desc, formatLayout, first, count, baseOffset, footprints);
+}
+
+uint64_t DX::GetTextureFootprints(TextureLayoutDesc const& desc, TextureFormatLayout const& formatLayout, uint32_t first, uint32_t count, uint64_t baseOffset,
+	SubresourceFootprint* footprints)
+{
+	// Ending each subresource after its last row's padding, rather than its data, makes no
+	// difference once the next offset is aligned, since the pitch divides the placement
+	// alignment.
+	uint64_t offset = baseOffset;
+	uint64_t totalBytes = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const uint32_t mip = (first + i) % desc.MipLevels;
+
+		SubresourceFootprint& footprint = footprints[i];
+		footprint.Format = desc.Format;
+		footprint.Width = static_cast<uint32_t>(Align(std::max(1u, desc.Width >> mip), formatLayout.BlockWidth));
+		footprint.Height = static_cast<uint32_t>(Align(std::max(1u, desc.Height >> mip), formatLayout.BlockHeight));
+		footprint.Depth = desc.Volume ? std::max(1u, desc.DepthOrArraySize >> mip) : 1;
+		footprint.RowCount = footprint.Height / formatLayout.BlockHeight;
+		footprint.RowSize = static_cast<uint64_t>(footprint.Width / formatLayout.BlockWidth) * formatLayout.BlockBytes;
+		footprint.RowPitch = static_cast<uint32_t>(Align(footprint.RowSize, c_texturePitchAlignment));
+		footprint.Offset = Align(offset, c_texturePlacementAlignment);
+
+		const uint64_t rows = static_cast<uint64_t>(footprint.RowCount) * footprint.Depth;
+		offset = footprint.Offset + footprint.RowPitch * rows;
+		totalBytes = footprint.Offset + footprint.RowPitch * (rows - 1) + footprint.RowSize - baseOffset;
+	}
+	return totalBytes;
+}
@@ -0,0 +1,59 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace DX
+{
+	// Mirror D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT and D3D12_TEXTURE_DATA_PITCH_ALIGNMENT.
+	const uint32_t c_texturePlacementAlignment = 512;
+	const uint32_t c_texturePitchAlignment = 256;
+
+	// How a format's texels are stored: uncompressed formats are 1x1 blocks, the BC formats
+	// 4x4, and the packed 4:2:2 formats 2x1.
+	struct TextureFormatLayout
+	{
+		uint32_t	BlockWidth;
+		uint32_t	BlockHeight;
+		uint32_t	BlockBytes;
+	};
+
+	// Looks up a DXGI_FORMAT, by value. Returns false for formats whose footprints aren't
+	// computed here: planar depth-stencil and video formats, and R1_UNORM.
+	bool GetTextureFormatLayout(uint32_t format, TextureFormatLayout& layout);
+
+	// A texture, as much of D3D12_RESOURCE_DESC as decides its footprints.
+	struct TextureLayoutDesc
+	{
+		uint32_t	Format;				// DXGI_FORMAT.
+		uint32_t	Width;
+		uint32_t	Height;
+		uint32_t	DepthOrArraySize;
+		uint32_t	MipLevels;
+		bool		Volume;				// A 3D texture, rather than a 1D or 2D one or an array.
+	};
+
+	// A D3D12_PLACED_SUBRESOURCE_FOOTPRINT with the row count and size that come with it.
+	struct SubresourceFootprint
+	{
+		uint64_t	Offset;
+		uint32_t	Format;
+		uint32_t	Width;				// Whole blocks.
+		uint32_t	Height;
+		uint32_t	Depth;
+		uint32_t	RowPitch;
+		uint32_t	RowCount;			// Rows of blocks in a slice.
+		uint64_t	RowSize;			// Bytes of data at the start of each row.
+	};
+
+	// Works out what ID3D12Device::GetCopyableFootprints reports for subresources first to
+	// first + count - 1, placed from baseOffset, without a device: each subresource starts on
+	// c_texturePlacementAlignment and each row on c_texturePitchAlignment. Subresources are
+	// numbered mip first, then array slice. Returns the total bytes, as the device does: up to
+	// the end of the last row's data. Throws std::invalid_argument for an unsupported format.
+	uint64_t GetTextureFootprints(TextureLayoutDesc const& desc, uint32_t first, uint32_t count, uint64_t baseOffset, SubresourceFootprint* footprints);
+
+	// As above with the format's layout given, for formats that aren't DXGI ones.
+	uint64_t GetTextureFootprints(TextureLayoutDesc const& desc, TextureFormatLayout const& formatLayout, uint32_t first, uint32_t count, uint64_t baseOffset,
+		SubresourceFootprint* footprints);
+}
@@ -0,0 +1,62 @@
+﻿#include "TextureUploadPlan.h"
+
+#include <stdexcept>
+
+using namespace DX;
+
+TextureUploadPlan::TextureUploadPlan() :
+	m_size(0),
+	m_end(0)
+{
+}
+
+uint32_t TextureUploadPlan::AddTexture(TextureLayoutDesc const& desc, uint32_t first, uint32_t count)
+{
+	if (desc.Volume)
+	{
+		throw std::invalid_argument("Volume textures can't be copied from a plan.");
+	}
+
+	Texture texture;
+	texture.FirstFootprint = static_cast<uint32_t>(m_footprints.size());
+	texture.First = first;
+	texture.Count = count;
+	if (count == 0)
+	{
+		m_textures.push_back(texture);
+		return static_cast<uint32_t>(m_textures.size()) - 1;
+	}
+
+	m_footprints.resize(m_footprints.size() + count);
+	SubresourceFootprint* footprints = &m_footprints[texture.FirstFootprint];
+	const uint64_t totalBytes = GetTextureFootprints(desc, first, count, m_end, footprints);
+
+	SubresourceFootprint const& last = footprints[count - 1];
+	m_size = m_end + totalBytes;
+	m_end = last.Offset + static_cast<uint64_t>(last.RowPitch) * last.RowCount;
+
+	m_textures.push_back(texture);
+	return static_cast<uint32_t>(m_textures.size()) - 1;
+}
+
+void TextureUploadPlan::Clear()
+{
+	m_textures.clear();
+	m_footprints.clear();
+	m_size = 0;
+	m_end = 0;
+}
+
+void TextureUploadPlan::GetCopies(void* const* destinations, void* upload, uint64_t uploadOffset, std::vector<CopyRequest>& copies) const
+{
+	for (size_t i = 0; i < m_textures.size(); ++i)
+	{
+		Texture const& texture = m_textures[i];
+		for (uint32_t j = 0; j < texture.Count; ++j)
+		{
+			SubresourceFootprint const& footprint = m_footprints[texture.FirstFootprint + j];
+			copies.push_back(MakeTextureCopy(destinations[i], texture.First + j, 0, 0, upload, uploadOffset + footprint.Offset,
+				footprint.Format, footprint.Width, footprint.Height, footprint.RowPitch, footprint.RowCount));
+		}
+	}
+}
@@ -0,0 +1,50 @@
+﻿#pragma once
+
+#include "TextureLayout.h"
+#include "UploadBatcher.h"
+
+#include <vector>
+
+namespace DX
+{
+	// Lays out the subresources of one or more textures in a single block of upload space,
+	// each texture after the last and every subresource placed as GetCopyableFootprints would
+	// place it, so that a whole batch of textures takes one allocation and one batch of copies.
+	// Each subresource's place is known up front, so different threads can fill them. Clear
+	// keeps the capacity, so a plan that is reused stops allocating.
+	class TextureUploadPlan
+	{
+	public:
+		TextureUploadPlan();
+
+		// Adds subresources first to first + count - 1. Returns the texture's index in the
+		// plan. Volume textures are rejected, since a CopyRequest has no depth.
+		uint32_t AddTexture(TextureLayoutDesc const& desc, uint32_t first, uint32_t count);
+		void Clear();
+
+		// Bytes of upload space, which has to start on c_texturePlacementAlignment.
+		uint64_t GetSize() const { return m_size; }
+		uint32_t GetTextureCount() const { return static_cast<uint32_t>(m_textures.size()); }
+
+		// A texture's footprints, offset from the start of the upload space.
+		SubresourceFootprint const* GetFootprints(uint32_t texture) const { return &m_footprints[m_textures[texture].FirstFootprint]; }
+		uint32_t GetFootprintCount(uint32_t texture) const { return m_textures[texture].Count; }
+
+		// Appends a copy for every subresource in the plan, from upload space at uploadOffset
+		// in upload. destinations holds each texture's resource, in the order added.
+		void GetCopies(void* const* destinations, void* upload, uint64_t uploadOffset, std::vector<CopyRequest>& copies) const;
+
+	private:
+		struct Texture
+		{
+			uint32_t	FirstFootprint;
+			uint32_t	First;		// Subresource.
+			uint32_t	Count;
+		};
+
+		std::vector<Texture>				m_textures;
+		std::vector<SubresourceFootprint>	m_footprints;
+		uint64_t							m_size;
+		uint64_t							m_end;		// After the last row's padding.
+	};
+}
@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace DX
+{
+	// Fixed set of worker threads for CPU-side asset work such as image decoding.
+	class ThreadPool
+	{
+	public:
+		// A thread count of zero uses one thread per hardware thread.
+		explicit ThreadPool(unsigned int threadCount = 0);
+		~ThreadPool();
+
+		ThreadPool(ThreadPool const&) = delete;
+		ThreadPool& operator=(ThreadPool const&) = delete;
+
+		unsigned int GetThreadCount() const { return static_cast<unsigned int>(m_threads.size()); }
+
+		// Queues a task. Exceptions thrown by the task are rethrown from the future's get().
+		template<typename Task>
+		auto Submit(Task&& task) -> std::future<decltype(task())>
+		{
+			typedef decltype(task()) Result;
+
+			auto packagedTask = std::make_shared<std::packaged_task<Result()>>(std::forward<Task>(task));
+			std::future<Result> result = packagedTask->get_future();
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_tasks.push_back([packagedTask]() { (*packagedTask)(); });
+			}
+			m_taskAvailable.notify_one();
+			return result;
+		}
+
+	private:
+		void WorkerLoop();
+
+		std::vector<std::thread>			m_threads;
+		std::deque<std::function<void()>>	m_tasks;
+		std::mutex							m_mutex;
+		std::condition_variable				m_taskAvailable;
+		bool								m_stopping;
+	};
+}
@@ -0,0 +1,354 @@
+﻿#include "TlsfAllocator.h"
+
+#include <stdexcept>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace DX;
+
+namespace
+{
+	uint32_t GetLowestBit(uint64_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return index;
+#else
+		return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+	}
+
+	uint32_t GetHighestBit(uint64_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return index;
+#else
+		return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+	}
+}
+
+TlsfAllocator::TlsfAllocator(uint64_t size) :
+	m_size(size),
+	m_usedBytes(0),
+	m_allocationCount(0),
+	m_freeBlockCount(0),
+	m_firstLevelMap(0)
+{
+	if (size == 0)
+	{
+		throw std::invalid_argument("Allocator size must be non-zero.");
+	}
+
+	for (uint32_t firstLevel = 0; firstLevel < c_firstLevelCount; ++firstLevel)
+	{
+		m_secondLevelMaps[firstLevel] = 0;
+		for (uint32_t secondLevel = 0; secondLevel < c_secondLevelCount; ++secondLevel)
+		{
+			m_freeLists[firstLevel][secondLevel] = c_noBlock;
+		}
+	}
+
+	InsertFree(NewBlock(0, size));
+}
+
+// Sizes below c_secondLevelCount get a list each; above that, each power of two is split
+// into c_secondLevelCount equal steps.
+void TlsfAllocator::GetList(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel)
+{
+	if (size < c_secondLevelCount)
+	{
+		firstLevel = 0;
+		secondLevel = static_cast<uint32_t>(size);
+	}
+	else
+	{
+		const uint32_t log2 = GetHighestBit(size);
+		firstLevel = log2 - c_secondLevelLog2 + 1;
+		secondLevel = static_cast<uint32_t>(size >> (log2 - c_secondLevelLog2)) ^ c_secondLevelCount;
+	}
+}
+
+// Returns the first block in the first non-empty list whose blocks are all at least size.
+uint32_t TlsfAllocator::FindFreeBlock(uint64_t size) const
+{
+	// Rounding up to the next step means any block in the list found is large enough.
+	if (size >= c_secondLevelCount)
+	{
+		const uint64_t step = (1ull << (GetHighestBit(size) - c_secondLevelLog2)) - 1;
+		if (size > ~0ull - step)
+		{
+			return c_noBlock;
+		}
+		size += step;
+	}
+
+	uint32_t firstLevel;
+	uint32_t secondLevel;
+	GetList(size, firstLevel, secondLevel);
+
+	uint32_t secondLevelMap = m_secondLevelMaps[firstLevel] & (~0u << secondLevel);
+	if (secondLevelMap == 0)
+	{
+		const uint64_t firstLevelMap = firstLevel + 1 < c_firstLevelCount ? m_firstLevelMap & (~0ull << (firstLevel + 1)) : 0;
+		if (firstLevelMap == 0)
+		{
+			return c_noBlock;
+		}
+		firstLevel = GetLowestBit(firstLevelMap);
+		secondLevelMap = m_secondLevelMaps[firstLevel];
+	}
+	return m_freeLists[firstLevel][GetLowestBit(secondLevelMap)];
+}
+
+// FindFreeBlock rounds up past the lists whose blocks may or may not be large enough, so a
+// block that fits only just, such as the single block of an allocator sized for one range,
+// is never found. This checks those lists block by block, for when the search fails.
+uint32_t TlsfAllocator::FindFittingBlock(uint64_t size, uint64_t alignment) const
+{
+	uint32_t firstLevel;
+	uint32_t secondLevel;
+	uint32_t lastFirstLevel;
+	uint32_t lastSecondLevel;
+	GetList(size, firstLevel, secondLevel);
+	GetList(size + alignment - 1, lastFirstLevel, lastSecondLevel);
+
+	for (;;)
+	{
+		if ((m_secondLevelMaps[firstLevel] & (1u << secondLevel)) != 0)
+		{
+			for (uint32_t block = m_freeLists[firstLevel][secondLevel]; block != c_noBlock; block = m_blocks[block].NextFree)
+			{
+				Block const& entry = m_blocks[block];
+				const uint64_t padding = ((entry.Offset + alignment - 1) & ~(alignment - 1)) - entry.Offset;
+				if (entry.Size >= padding && entry.Size - padding >= size)
+				{
+					return block;
+				}
+			}
+		}
+		if (firstLevel == lastFirstLevel && secondLevel == lastSecondLevel)
+		{
+			return c_noBlock;
+		}
+		if (++secondLevel == c_secondLevelCount)
+		{
+			secondLevel = 0;
+			++firstLevel;
+		}
+	}
+}
+
+uint32_t TlsfAllocator::NewBlock(uint64_t offset, uint64_t size)
+{
+	uint32_t block;
+	if (!m_unusedBlocks.empty())
+	{
+		block = m_unusedBlocks.back();
+		m_unusedBlocks.pop_back();
+	}
+	else
+	{
+		block = static_cast<uint32_t>(m_blocks.size());
+		m_blocks.emplace_back();
+	}
+
+	m_blocks[block] = Block{ offset, size, c_noBlock, c_noBlock, c_noBlock, c_noBlock, false };
+	return block;
+}
+
+void TlsfAllocator::InsertFree(uint32_t block)
+{
+	uint32_t firstLevel;
+	uint32_t secondLevel;
+	GetList(m_blocks[block].Size, firstLevel, secondLevel);
+
+	uint32_t& head = m_freeLists[firstLevel][secondLevel];
+	m_blocks[block].Free = true;
+	m_blocks[block].PreviousFree = c_noBlock;
+	m_blocks[block].NextFree = head;
+	if (head != c_noBlock)
+	{
+		m_blocks[head].PreviousFree = block;
+	}
+	head = block;
+
+	m_firstLevelMap |= 1ull << firstLevel;
+	m_secondLevelMaps[firstLevel] |= 1u << secondLevel;
+	++m_freeBlockCount;
+}
+
+void TlsfAllocator::RemoveFree(uint32_t block)
+{
+	Block& entry = m_blocks[block];
+	if (entry.PreviousFree != c_noBlock)
+	{
+		m_blocks[entry.PreviousFree].NextFree = entry.NextFree;
+	}
+	else
+	{
+		uint32_t firstLevel;
+		uint32_t secondLevel;
+		GetList(entry.Size, firstLevel, secondLevel);
+
+		m_freeLists[firstLevel][secondLevel] = entry.NextFree;
+		if (entry.NextFree == c_noBlock)
+		{
+			m_secondLevelMaps[firstLevel] &= ~(1u << secondLevel);
+			if (m_secondLevelMaps[firstLevel] == 0)
+			{
+				m_firstLevelMap &= ~(1ull << firstLevel);
+			}
+		}
+	}
+	if (entry.NextFree != c_noBlock)
+	{
+		m_blocks[entry.NextFree].PreviousFree = entry.PreviousFree;
+	}
+
+	entry.Free = false;
+	--m_freeBlockCount;
+}
+
+// Cuts the block down to size, making the rest a new block after it, which isn't free yet.
+void TlsfAllocator::SplitAfter(uint32_t block, uint64_t size)
+{
+	const uint32_t rest = NewBlock(m_blocks[block].Offset + size, m_blocks[block].Size - size);
+	Block& entry = m_blocks[block];
+	Block& restEntry = m_blocks[rest];
+
+	restEntry.PreviousPhysical = block;
+	restEntry.NextPhysical = entry.NextPhysical;
+	if (entry.NextPhysical != c_noBlock)
+	{
+		m_blocks[entry.NextPhysical].PreviousPhysical = rest;
+	}
+	entry.NextPhysical = rest;
+	entry.Size = size;
+}
+
+// Absorbs the next block, which must be out of the free lists.
+void TlsfAllocator::MergeWithNext(uint32_t block)
+{
+	const uint32_t next = m_blocks[block].NextPhysical;
+	Block& entry = m_blocks[block];
+	Block const& nextEntry = m_blocks[next];
+
+	entry.Size += nextEntry.Size;
+	entry.NextPhysical = nextEntry.NextPhysical;
+	if (nextEntry.NextPhysical != c_noBlock)
+	{
+		m_blocks[nextEntry.NextPhysical].PreviousPhysical = block;
+	}
+	m_unusedBlocks.push_back(next);
+}
+
+bool TlsfAllocator::Allocate(uint64_t size, uint64_t alignment, TlsfAllocation& allocation)
+{
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+	{
+		throw std::invalid_argument("Allocation alignment must be a power of two.");
+	}
+	if (size == 0)
+	{
+		size = 1;
+	}
+
+	// Asking for enough to align anywhere in the block keeps the search constant time.
+	if (size > ~0ull - (alignment - 1))
+	{
+		return false;
+	}
+	uint32_t block = FindFreeBlock(size + alignment - 1);
+	if (block == c_noBlock)
+	{
+		block = FindFittingBlock(size, alignment);
+		if (block == c_noBlock)
+		{
+			return false;
+		}
+	}
+	RemoveFree(block);
+
+	// The padding in front becomes a free block of its own. The block before it is in
+	// use, since free neighbours are always merged.
+	const uint64_t offset = m_blocks[block].Offset;
+	const uint64_t padding = ((offset + alignment - 1) & ~(alignment - 1)) - offset;
+	if (padding > 0)
+	{
+		SplitAfter(block, padding);
+		const uint32_t aligned = m_blocks[block].NextPhysical;
+		InsertFree(block);
+		block = aligned;
+	}
+	if (m_blocks[block].Size > size)
+	{
+		SplitAfter(block, size);
+		InsertFree(m_blocks[block].NextPhysical);
+	}
+
+	m_usedBytes += size;
+	++m_allocationCount;
+
+	allocation.Offset = m_blocks[block].Offset;
+	allocation.Size = size;
+	allocation.Block = block;
+	return true;
+}
+
+void TlsfAllocator::Free(TlsfAllocation const& allocation)
+{
+	uint32_t block = allocation.Block;
+	if (block >= m_blocks.size() || m_blocks[block].Free || m_blocks[block].Offset != allocation.Offset)
+	{
+		throw std::invalid_argument("Range wasn't allocated from this allocator.");
+	}
+
+	m_usedBytes -= m_blocks[block].Size;
+	--m_allocationCount;
+
+	const uint32_t next = m_blocks[block].NextPhysical;
+	if (next != c_noBlock && m_blocks[next].Free)
+	{
+		RemoveFree(next);
+		MergeWithNext(block);
+	}
+	const uint32_t previous = m_blocks[block].PreviousPhysical;
+	if (previous != c_noBlock && m_blocks[previous].Free)
+	{
+		RemoveFree(previous);
+		MergeWithNext(previous);
+		block = previous;
+	}
+	InsertFree(block);
+}
+
+TlsfStatistics TlsfAllocator::GetStatistics() const
+{
+	TlsfStatistics statistics;
+	statistics.Size = m_size;
+	statistics.UsedBytes = m_usedBytes;
+	statistics.AllocationCount = m_allocationCount;
+	statistics.FreeBlockCount = m_freeBlockCount;
+	statistics.LargestFreeBlock = 0;
+
+	// The largest block is in the last non-empty list.
+	if (m_firstLevelMap != 0)
+	{
+		const uint32_t firstLevel = GetHighestBit(m_firstLevelMap);
+		const uint32_t secondLevel = GetHighestBit(m_secondLevelMaps[firstLevel]);
+		for (uint32_t block = m_freeLists[firstLevel][secondLevel]; block != c_noBlock; block = m_blocks[block].NextFree)
+		{
+			if (m_blocks[block].Size > statistics.LargestFreeBlock)
+			{
+				statistics.LargestFreeBlock = m_blocks[block].Size;
+			}
+		}
+	}
+	return statistics;
+}
@@ -0,0 +1,88 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace DX
+{
+	// A range handed out by a TlsfAllocator. Block identifies it for Free.
+	struct TlsfAllocation
+	{
+		uint64_t	Offset;
+		uint64_t	Size;
+		uint32_t	Block;
+	};
+
+	struct TlsfStatistics
+	{
+		uint64_t	Size;
+		uint64_t	UsedBytes;
+		uint64_t	LargestFreeBlock;
+		uint32_t	AllocationCount;
+		uint32_t	FreeBlockCount;
+
+		// Zero when all the free space is in one block, approaching one as it is split up.
+		double GetFragmentation() const
+		{
+			const uint64_t freeBytes = Size - UsedBytes;
+			return freeBytes > 0 ? 1.0 - static_cast<double>(LargestFreeBlock) / freeBytes : 0.0;
+		}
+	};
+
+	// Two-level segregated fit allocator over a range of offsets, such as a heap. Free blocks
+	// are kept in lists by size class, a power of two split into c_secondLevelCount steps, and
+	// bitmaps of the non-empty lists find a block that fits in constant time. Freed blocks
+	// are merged with free neighbours straight away.
+	class TlsfAllocator
+	{
+	public:
+		explicit TlsfAllocator(uint64_t size);
+
+		TlsfAllocator(TlsfAllocator const&) = delete;
+		TlsfAllocator& operator=(TlsfAllocator const&) = delete;
+
+		// Alignment must be a power of two. Returns false if no free block can hold the range.
+		bool Allocate(uint64_t size, uint64_t alignment, TlsfAllocation& allocation);
+		void Free(TlsfAllocation const& allocation);
+
+		uint64_t GetSize() const { return m_size; }
+		bool IsEmpty() const { return m_allocationCount == 0; }
+		TlsfStatistics GetStatistics() const;
+
+	private:
+		static const uint32_t c_secondLevelLog2 = 5;
+		static const uint32_t c_secondLevelCount = 1 << c_secondLevelLog2;
+		static const uint32_t c_firstLevelCount = 64;
+		static const uint32_t c_noBlock = 0xFFFFFFFF;
+
+		struct Block
+		{
+			uint64_t	Offset;
+			uint64_t	Size;
+			uint32_t	PreviousPhysical;	// Neighbours by offset.
+			uint32_t	NextPhysical;
+			uint32_t	PreviousFree;		// Neighbours in the block's free list.
+			uint32_t	NextFree;
+			bool		Free;
+		};
+
+		static void GetList(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+		uint32_t FindFreeBlock(uint64_t size) const;
+		uint32_t FindFittingBlock(uint64_t size, uint64_t alignment) const;
+		uint32_t NewBlock(uint64_t offset, uint64_t size);
+		void InsertFree(uint32_t block);
+		void RemoveFree(uint32_t block);
+		void SplitAfter(uint32_t block, uint64_t size);
+		void MergeWithNext(uint32_t block);
+
+		uint64_t				m_size;
+		uint64_t				m_usedBytes;
+		uint32_t				m_allocationCount;
+		uint32_t				m_freeBlockCount;
+		std::vector<Block>		m_blocks;
+		std::vector<uint32_t>	m_unusedBlocks;
+		uint64_t				m_firstLevelMap;
+		uint32_t				m_secondLevelMaps[c_firstLevelCount];
+		uint32_t				m_freeLists[c_firstLevelCount][c_secondLevelCount];
+	};
+}
@@ -0,0 +1,109 @@
+﻿#include "UploadBatcher.h"
+
+#include <algorithm>
+
+using namespace DX;
+
+CopyRequest DX::MakeBufferCopy(void* destination, uint64_t destinationOffset, void* source, uint64_t sourceOffset, uint64_t size)
+{
+	CopyRequest copy{};
+	copy.Type = CopyType::Buffer;
+	copy.Destination = destination;
+	copy.Source = source;
+	copy.SourceOffset = sourceOffset;
+	copy.Size = size;
+	copy.DestinationOffset = destinationOffset;
+	return copy;
+}
+
+CopyRequest DX::MakeTextureCopy(void* destination, uint32_t subresource, uint32_t x, uint32_t y, void* source, uint64_t sourceOffset,
+	uint32_t format, uint32_t width, uint32_t height, uint32_t rowPitch, uint32_t rowCount)
+{
+	CopyRequest copy{};
+	copy.Type = CopyType::Texture;
+	copy.Destination = destination;
+	copy.Source = source;
+	copy.SourceOffset = sourceOffset;
+	copy.Size = static_cast<uint64_t>(rowPitch) * rowCount;
+	copy.Subresource = subresource;
+	copy.X = x;
+	copy.Y = y;
+	copy.Format = format;
+	copy.Width = width;
+	copy.Height = height;
+	copy.RowPitch = rowPitch;
+	copy.RowCount = rowCount;
+	return copy;
+}
+
+UploadBatcher::UploadBatcher(CopyQueueBackend& backend) :
+	m_backend(backend),
+	m_submittedFenceValue(0),
+	m_completedFenceValue(0),
+	m_statistics{}
+{
+}
+
+void UploadBatcher::Enqueue(CopyRequest const& copy)
+{
+	++m_statistics.Requests;
+	m_statistics.Bytes += copy.Size;
+
+	if (!m_pending.empty())
+	{
+		CopyRequest& last = m_pending.back();
+		const bool continuesLast = last.Type == copy.Type && last.Destination == copy.Destination && last.Source == copy.Source &&
+			last.SourceOffset + last.Size == copy.SourceOffset;
+
+		if (continuesLast && copy.Type == CopyType::Buffer && last.DestinationOffset + last.Size == copy.DestinationOffset)
+		{
+			last.Size += copy.Size;
+			return;
+		}
+		if (continuesLast && copy.Type == CopyType::Texture && last.Subresource == copy.Subresource && last.X == copy.X &&
+			last.Y + last.Height == copy.Y && last.Format == copy.Format && last.Width == copy.Width && last.RowPitch == copy.RowPitch)
+		{
+			last.Size += copy.Size;
+			last.Height += copy.Height;
+			last.RowCount += copy.RowCount;
+			return;
+		}
+	}
+
+	m_pending.push_back(copy);
+}
+
+uint64_t UploadBatcher::Submit()
+{
+	if (m_pending.empty())
+	{
+		return 0;
+	}
+
+	if (m_completedFenceValue == m_submittedFenceValue)
+	{
+		m_busyStart = Clock::now();
+	}
+
+	m_backend.Submit(m_pending.data(), m_pending.size(), ++m_submittedFenceValue);
+	++m_statistics.Submissions;
+	m_statistics.Copies += m_pending.size();
+	m_pending.clear();
+	return m_submittedFenceValue;
+}
+
+void UploadBatcher::Update()
+{
+	if (m_completedFenceValue == m_submittedFenceValue)
+	{
+		return;
+	}
+
+	// A removed device's fence reports UINT64_MAX, but nothing past the last batch submitted
+	// has finished.
+	m_completedFenceValue = std::min(m_backend.GetCompletedFenceValue(), m_submittedFenceValue);
+	if (m_completedFenceValue == m_submittedFenceValue)
+	{
+		m_statistics.BusySeconds += std::chrono::duration<double>(Clock::now() - m_busyStart).count();
+	}
+}
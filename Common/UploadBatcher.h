@@ -0,0 +1,97 @@
+﻿#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace DX
+{
+	enum class CopyType : uint8_t
+	{
+		Buffer,
+		Texture,
+	};
+
+	// One copy out of an upload buffer. Resources are opaque here; the D3D12 backend treats
+	// them as ID3D12Resource pointers.
+	struct CopyRequest
+	{
+		CopyType	Type;
+		void*		Destination;
+		void*		Source;
+		uint64_t	SourceOffset;
+		uint64_t	Size;				// In bytes. For a texture, RowPitch * RowCount.
+
+		// Buffer copies.
+		uint64_t	DestinationOffset;
+
+		// Texture copies, from a placed footprint to (X, Y) in a subresource.
+		uint32_t	Subresource;
+		uint32_t	X;
+		uint32_t	Y;
+		uint32_t	Format;
+		uint32_t	Width;
+		uint32_t	Height;
+		uint32_t	RowPitch;
+		uint32_t	RowCount;			// Rows of blocks.
+	};
+
+	CopyRequest MakeBufferCopy(void* destination, uint64_t destinationOffset, void* source, uint64_t sourceOffset, uint64_t size);
+	CopyRequest MakeTextureCopy(void* destination, uint32_t subresource, uint32_t x, uint32_t y, void* source, uint64_t sourceOffset,
+		uint32_t format, uint32_t width, uint32_t height, uint32_t rowPitch, uint32_t rowCount);
+
+	// Where batches of copies are executed. The D3D12 implementation records them into one
+	// command list on a copy queue; a mock can record them instead.
+	class CopyQueueBackend
+	{
+	public:
+		virtual ~CopyQueueBackend() {}
+
+		// Executes the copies and then signals fenceValue, which increases with every batch.
+		virtual void Submit(const CopyRequest* copies, size_t count, uint64_t fenceValue) = 0;
+		virtual uint64_t GetCompletedFenceValue() = 0;
+	};
+
+	struct UploadStatistics
+	{
+		uint64_t	Bytes;
+		uint64_t	Requests;
+		uint64_t	Copies;			// Requests left after coalescing.
+		uint64_t	Submissions;
+		double		BusySeconds;	// Time with a batch in flight, as seen when polled.
+
+		double GetMegabytesPerSecond() const { return BusySeconds > 0.0 ? Bytes / (1024.0 * 1024.0) / BusySeconds : 0.0; }
+	};
+
+	// Collects copies and submits them to a backend in batches. A copy that continues the one
+	// queued before it, the next range of the same buffers or the next rows of the same
+	// subresource, is merged into it.
+	class UploadBatcher
+	{
+	public:
+		explicit UploadBatcher(CopyQueueBackend& backend);
+
+		void Enqueue(CopyRequest const& copy);
+
+		// Submits the queued copies as one batch. Returns the fence value signalled once they
+		// have finished, or zero if there was nothing to submit.
+		uint64_t Submit();
+
+		// Polls the backend, updating the statistics.
+		void Update();
+		bool IsComplete(uint64_t fenceValue) const { return fenceValue <= m_completedFenceValue; }
+
+		UploadStatistics const& GetStatistics() const { return m_statistics; }
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		CopyQueueBackend&			m_backend;
+		std::vector<CopyRequest>	m_pending;
+		uint64_t					m_submittedFenceValue;
+		uint64_t					m_completedFenceValue;
+		Clock::time_point			m_busyStart;
+		UploadStatistics			m_statistics;
+	};
+}
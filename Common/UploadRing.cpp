@@ -0,0 +1,75 @@
+﻿#include "UploadRing.h"
+
+#include <stdexcept>
+
+using namespace DX;
+
+UploadRing::UploadRing(uint64_t capacity) :
+	m_capacity(capacity),
+	m_head(0),
+	m_tail(0)
+{
+	if (capacity == 0)
+	{
+		throw std::invalid_argument("Upload ring capacity must be non-zero.");
+	}
+}
+
+uint64_t UploadRing::Allocate(uint64_t size, uint64_t alignment, uint64_t fenceValue)
+{
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+	{
+		throw std::invalid_argument("Upload alignment must be a power of two.");
+	}
+	if (!m_inFlight.empty() && fenceValue < m_inFlight.back().FenceValue)
+	{
+		throw std::invalid_argument("Upload fence values must not decrease.");
+	}
+
+	// With nothing in flight the whole buffer is free, so start again from its beginning
+	// rather than splitting the free space at the head.
+	if (m_inFlight.empty())
+	{
+		m_head = 0;
+		m_tail = 0;
+	}
+
+	const uint64_t headOffset = m_head % m_capacity;
+	uint64_t offset = (headOffset + alignment - 1) & ~(alignment - 1);
+	if (offset + size > m_capacity)
+	{
+		// Doesn't fit before the end, so skip to the start of the buffer.
+		offset = 0;
+		if (size > m_capacity)
+		{
+			return c_uploadRingFull;
+		}
+	}
+
+	// The offset is reached from the head going forward, maybe past the end.
+	const uint64_t start = m_head + (offset >= headOffset ? offset - headOffset : m_capacity - headOffset + offset);
+	if (start + size - m_tail > m_capacity)
+	{
+		return c_uploadRingFull;
+	}
+
+	m_head = start + size;
+	if (!m_inFlight.empty() && m_inFlight.back().FenceValue == fenceValue)
+	{
+		m_inFlight.back().End = m_head;
+	}
+	else
+	{
+		m_inFlight.push_back(FencedRange{ fenceValue, m_head });
+	}
+	return offset;
+}
+
+void UploadRing::Reclaim(uint64_t completedFenceValue)
+{
+	while (!m_inFlight.empty() && m_inFlight.front().FenceValue <= completedFenceValue)
+	{
+		m_tail = m_inFlight.front().End;
+		m_inFlight.pop_front();
+	}
+}
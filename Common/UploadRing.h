@@ -0,0 +1,43 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <deque>
+
+namespace DX
+{
+	const uint64_t c_uploadRingFull = ~0ull;
+
+	// Hands out aligned ranges of a persistently mapped upload buffer, in order, wrapping at
+	// the end. Each allocation is tagged with the fence value that the queue signals once the
+	// work reading it has finished, and its space is reused after the fence has passed that
+	// value. Fence values must not decrease from one allocation to the next.
+	class UploadRing
+	{
+	public:
+		explicit UploadRing(uint64_t capacity);
+
+		// Returns the offset of size bytes aligned to alignment, a power of two, or
+		// c_uploadRingFull if there isn't room until earlier work has finished.
+		uint64_t Allocate(uint64_t size, uint64_t alignment, uint64_t fenceValue);
+
+		// Frees the allocations tagged with completedFenceValue and earlier.
+		void Reclaim(uint64_t completedFenceValue);
+
+		uint64_t GetCapacity() const { return m_capacity; }
+		uint64_t GetUsedBytes() const { return m_head - m_tail; }
+
+	private:
+		struct FencedRange
+		{
+			uint64_t	FenceValue;
+			uint64_t	End;	// Where m_tail moves to once the fence passes FenceValue.
+		};
+
+		// Running byte counts, taken modulo the capacity for offsets. Padding skipped at
+		// the end of the buffer counts as allocated.
+		uint64_t				m_capacity;
+		uint64_t				m_head;
+		uint64_t				m_tail;
+		std::deque<FencedRange>	m_inFlight;
+	};
+}
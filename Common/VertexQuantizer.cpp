@@ -0,0 +1,269 @@
+﻿#include "VertexQuantizer.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+using namespace DX;
+
+static_assert(sizeof(MeshVertex) == 20 && sizeof(QuantizedVertex) == 12, "Vertices are read and written two at a time.");
+
+namespace
+{
+	const float c_snorm16Max = 32767.0f;
+	const float c_unorm16Max = 65535.0f;
+
+	// The normal's two bytes, as the fourth component of the position.
+	int16_t EncodeNormal(const float* normals, size_t vertex)
+	{
+		int8_t encoded[2] = {};
+		if (normals)
+		{
+			EncodeOctahedralNormal(normals + vertex * 3, encoded);
+		}
+		int16_t packed;
+		memcpy(&packed, encoded, sizeof(packed));
+		return packed;
+	}
+
+	void EncodeVertex(MeshVertex const& source, QuantizedVertex& destination, int16_t normal, const float bias[3], const float inverseScale[3],
+		VertexUvFormat uvFormat)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const float position = std::min(std::max((source.Position[axis] - bias[axis]) * inverseScale[axis], -1.0f), 1.0f);
+			destination.Position[axis] = static_cast<int16_t>(std::lrint(position * c_snorm16Max));
+		}
+		memcpy(destination.Normal, &normal, sizeof(normal));
+		for (int i = 0; i < 2; ++i)
+		{
+			destination.UV[i] = uvFormat == VertexUvFormat::Unorm16 ?
+				static_cast<uint16_t>(std::lrint(std::min(std::max(source.UV[i], 0.0f), 1.0f) * c_unorm16Max)) : FloatToHalf(source.UV[i]);
+		}
+	}
+
+	// The same arithmetic as EncodeVertex, so the results are identical, two vertices at a
+	// time: their ten floats are three loads, and their 24 bytes four stores.
+	void EncodeVertices(const MeshVertex* source, QuantizedVertex* destination, size_t count, const float* normals, const float bias[3],
+		const float inverseScale[3], VertexUvFormat uvFormat)
+	{
+		size_t i = 0;
+#if DX_SIMD_SSE2
+		{
+			const __m128 biasVector = _mm_setr_ps(bias[0], bias[1], bias[2], 0.0f);
+			const __m128 scaleVector = _mm_setr_ps(inverseScale[0], inverseScale[1], inverseScale[2], 0.0f);
+			const __m128 minusOne = _mm_set1_ps(-1.0f);
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 snormMax = _mm_set1_ps(c_snorm16Max);
+			const __m128 unormMax = _mm_set1_ps(c_unorm16Max);
+			const __m128i unsignedBias = _mm_set1_epi32(0x8000);
+			const __m128i unsignedFlip = _mm_set1_epi16(static_cast<short>(0x8000));
+
+			for (; i + 2 <= count; i += 2)
+			{
+				const float* floats = source[i].Position;
+				const __m128 a = _mm_loadu_ps(floats);														// x0 y0 z0 u0
+				const __m128 b = _mm_loadu_ps(floats + 4);													// v0 x1 y1 z1
+				const __m128 c = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(floats + 8)));	// u1 v1
+
+				const __m128 position0 = a;
+				const __m128 position1 = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 2, 1));
+				const __m128 uv = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 3, 3)), c, _MM_SHUFFLE(1, 0, 2, 0));
+
+				auto quantizePosition = [&](__m128 position)
+				{
+					const __m128 normalized = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(position, biasVector), scaleVector), minusOne), one);
+					return _mm_cvtps_epi32(_mm_mul_ps(normalized, snormMax));
+				};
+				__m128i positions = _mm_packs_epi32(quantizePosition(position0), quantizePosition(position1));
+				positions = _mm_insert_epi16(positions, EncodeNormal(normals, i), 3);
+				positions = _mm_insert_epi16(positions, EncodeNormal(normals, i + 1), 7);
+
+				__m128i uvs;
+				if (uvFormat == VertexUvFormat::Unorm16)
+				{
+					// SSE2 only packs to signed 16 bits, so the values are moved into that range
+					// and back.
+					const __m128i unorm = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(uv, zero), one), unormMax));
+					const __m128i shifted = _mm_sub_epi32(unorm, unsignedBias);
+					uvs = _mm_xor_si128(_mm_packs_epi32(shifted, shifted), unsignedFlip);
+				}
+				else
+				{
+#if DX_SIMD_F16C
+					uvs = _mm_cvtps_ph(uv, 0);
+#else
+					float values[4];
+					_mm_storeu_ps(values, uv);
+					uvs = _mm_setr_epi16(static_cast<short>(FloatToHalf(values[0])), static_cast<short>(FloatToHalf(values[1])),
+						static_cast<short>(FloatToHalf(values[2])), static_cast<short>(FloatToHalf(values[3])), 0, 0, 0, 0);
+#endif
+				}
+
+				uint8_t* bytes = reinterpret_cast<uint8_t*>(destination + i);
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(bytes), positions);
+				const int uv0 = _mm_cvtsi128_si32(uvs);
+				memcpy(bytes + 8, &uv0, sizeof(uv0));
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(bytes + 12), _mm_srli_si128(positions, 8));
+				const int uv1 = _mm_cvtsi128_si32(_mm_srli_si128(uvs, 4));
+				memcpy(bytes + 20, &uv1, sizeof(uv1));
+			}
+		}
+#endif
+		for (; i < count; ++i)
+		{
+			EncodeVertex(source[i], destination[i], EncodeNormal(normals, i), bias, inverseScale, uvFormat);
+		}
+	}
+}
+
+QuantizedMesh DX::QuantizeMesh(Mesh const& mesh, VertexUvFormat uvFormat, const float* normals)
+{
+	float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (MeshVertex const& vertex : mesh.Vertices)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			minimum[axis] = std::min(minimum[axis], vertex.Position[axis]);
+			maximum[axis] = std::max(maximum[axis], vertex.Position[axis]);
+		}
+		if (uvFormat == VertexUvFormat::Unorm16 && !(vertex.UV[0] >= 0.0f && vertex.UV[0] <= 1.0f && vertex.UV[1] >= 0.0f && vertex.UV[1] <= 1.0f))
+		{
+			throw std::out_of_range("UVs outside [0, 1] need VertexUvFormat::Half.");
+		}
+	}
+
+	QuantizedMesh quantized;
+	quantized.UvFormat = uvFormat;
+	float inverseScale[3];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		// A mesh that is flat along an axis, or empty, keeps a scale of one there.
+		const float extent = mesh.Vertices.empty() ? 0.0f : 0.5f * (maximum[axis] - minimum[axis]);
+		quantized.PositionBias[axis] = mesh.Vertices.empty() ? 0.0f : 0.5f * (maximum[axis] + minimum[axis]);
+		quantized.PositionScale[axis] = extent > 0.0f ? extent : 1.0f;
+		inverseScale[axis] = 1.0f / quantized.PositionScale[axis];
+	}
+
+	quantized.Vertices.resize(mesh.Vertices.size());
+	EncodeVertices(mesh.Vertices.data(), quantized.Vertices.data(), mesh.Vertices.size(), normals, quantized.PositionBias, inverseScale, uvFormat);
+	return quantized;
+}
+
+void DX::DecodeVertex(QuantizedMesh const& mesh, QuantizedVertex const& vertex, float position[3], float uv[2])
+{
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		position[axis] = std::max(vertex.Position[axis] / c_snorm16Max, -1.0f);
+	}
+	for (int i = 0; i < 2; ++i)
+	{
+		uv[i] = mesh.UvFormat == VertexUvFormat::Unorm16 ? vertex.UV[i] / c_unorm16Max : HalfToFloat(vertex.UV[i]);
+	}
+}
+
+void DX::EncodeOctahedralNormal(const float normal[3], int8_t encoded[2])
+{
+	const float length = std::fabs(normal[0]) + std::fabs(normal[1]) + std::fabs(normal[2]);
+	if (!(length > 0.0f))
+	{
+		encoded[0] = 0;
+		encoded[1] = 0;
+		return;
+	}
+
+	float x = normal[0] / length;
+	float y = normal[1] / length;
+	if (normal[2] < 0.0f)
+	{
+		// The lower half folds out over the corners.
+		const float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		y = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldedX;
+	}
+	encoded[0] = static_cast<int8_t>(std::lrint(std::min(std::max(x, -1.0f), 1.0f) * 127.0f));
+	encoded[1] = static_cast<int8_t>(std::lrint(std::min(std::max(y, -1.0f), 1.0f) * 127.0f));
+}
+
+void DX::DecodeOctahedralNormal(const int8_t encoded[2], float normal[3])
+{
+	float x = std::max(encoded[0] / 127.0f, -1.0f);
+	float y = std::max(encoded[1] / 127.0f, -1.0f);
+	const float z = 1.0f - std::fabs(x) - std::fabs(y);
+	if (z < 0.0f)
+	{
+		const float unfoldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		y = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = unfoldedX;
+	}
+	const float inverseLength = 1.0f / std::sqrt(x * x + y * y + z * z);
+	normal[0] = x * inverseLength;
+	normal[1] = y * inverseLength;
+	normal[2] = z * inverseLength;
+}
+
+uint16_t DX::FloatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	const uint32_t sign = (bits >> 16) & 0x8000;
+	bits &= 0x7FFFFFFF;
+
+	uint32_t half;
+	if (bits >= 0x47800000)
+	{
+		// 2^16 and up, infinity and NaN. Smaller values that round up to infinity do so below.
+		half = bits > 0x7F800000 ? 0x7E00 : 0x7C00;
+	}
+	else if (bits < 0x38800000)
+	{
+		// Subnormal or zero: adding 0.5 moves the bits into place and rounds them.
+		const float magic = 0.5f;
+		float shifted;
+		memcpy(&shifted, &bits, sizeof(shifted));
+		shifted += magic;
+		uint32_t shiftedBits;
+		memcpy(&shiftedBits, &shifted, sizeof(shiftedBits));
+		half = shiftedBits - 0x3F000000;
+	}
+	else
+	{
+		// Rebias the exponent and round the dropped 13 bits to nearest even.
+		const uint32_t odd = (bits >> 13) & 1;
+		half = (bits + 0xC8000FFF + odd) >> 13;
+	}
+	return static_cast<uint16_t>(half | sign);
+}
+
+float DX::HalfToFloat(uint16_t value)
+{
+	const uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+	const uint32_t exponent = (value >> 10) & 0x1F;
+	const uint32_t mantissa = value & 0x3FF;
+
+	uint32_t bits;
+	if (exponent == 0x1F)
+	{
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	}
+	else if (exponent == 0)
+	{
+		// Subnormal or zero: mantissa * 2^-24 is exact.
+		const float magnitude = mantissa * (1.0f / 16777216.0f);
+		memcpy(&bits, &magnitude, sizeof(bits));
+		bits |= sign;
+	}
+	else
+	{
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	}
+
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
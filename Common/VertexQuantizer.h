@@ -0,0 +1,56 @@
+﻿#pragma once
+
+#include "MeshGenerator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace DX
+{
+	// How a quantized vertex stores its texture coordinates.
+	enum class VertexUvFormat
+	{
+		Unorm16,	// R16G16_UNORM: steps of 1/65535, but only within [0, 1].
+		Half,		// R16G16_FLOAT: any range, to 11 significant bits.
+	};
+
+	// A vertex in 12 bytes, against MeshVertex's 20. The input assembler reads the position
+	// as R16G16B16A16_SNORM at offset 0, in [-1, 1] on each axis; the mesh's PositionScale
+	// and PositionBias, folded into the model matrix, take it back to object space. Its
+	// fourth component is the normal, as two octahedral coordinates read as R8G8_SNORM at
+	// offset 6. The UV is at offset 8, in the mesh's UvFormat.
+	struct QuantizedVertex
+	{
+		int16_t		Position[3];
+		int8_t		Normal[2];
+		uint16_t	UV[2];
+	};
+
+	struct QuantizedMesh
+	{
+		std::vector<QuantizedVertex>	Vertices;
+		VertexUvFormat					UvFormat;
+		float							PositionScale[3];	// Object space is position * scale + bias.
+		float							PositionBias[3];
+	};
+
+	// Quantizes the mesh's vertices, positions relative to their bounding box so that each
+	// axis uses the full range. normals, if given, holds three floats a vertex; without them
+	// the normal is zero. Throws std::out_of_range for Unorm16 if a UV is outside [0, 1].
+	QuantizedMesh QuantizeMesh(Mesh const& mesh, VertexUvFormat uvFormat, const float* normals = nullptr);
+
+	// A vertex as the input assembler reads it: the position in [-1, 1], before the scale
+	// and bias.
+	void DecodeVertex(QuantizedMesh const& mesh, QuantizedVertex const& vertex, float position[3], float uv[2]);
+
+	// Unit normals folded onto the octahedron and stored as 8-bit SNORM. The shader decodes
+	// them as n = float3(e, 1 - abs(e.x) - abs(e.y)), then where n.z < 0,
+	// n.xy = (1 - abs(n.yx)) * sign(n.xy), and normalizes.
+	void EncodeOctahedralNormal(const float normal[3], int8_t encoded[2]);
+	void DecodeOctahedralNormal(const int8_t encoded[2], float normal[3]);
+
+	// IEEE half precision, rounding to nearest even as F16C does.
+	uint16_t FloatToHalf(float value);
+	float HalfToFloat(uint16_t value);
+}
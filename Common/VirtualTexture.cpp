@@ -0,0 +1,246 @@
+﻿#include "VirtualTexture.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace DX;
+
+PhysicalTilePool::PhysicalTilePool(uint32_t tileCount) :
+	m_entries(tileCount, Entry{ c_unmappedHeapTile, c_unmappedHeapTile, nullptr, 0, false }),
+	m_oldest(c_unmappedHeapTile),
+	m_newest(c_unmappedHeapTile),
+	m_evictionCount(0)
+{
+	// Handed out from the back, so lower tiles go first.
+	m_free.reserve(tileCount);
+	for (uint32_t tile = tileCount; tile-- > 0;)
+	{
+		m_free.push_back(tile);
+	}
+}
+
+void PhysicalTilePool::Unlink(uint32_t tile)
+{
+	Entry& entry = m_entries[tile];
+	(entry.Previous != c_unmappedHeapTile ? m_entries[entry.Previous].Next : m_oldest) = entry.Next;
+	(entry.Next != c_unmappedHeapTile ? m_entries[entry.Next].Previous : m_newest) = entry.Previous;
+	entry.Previous = c_unmappedHeapTile;
+	entry.Next = c_unmappedHeapTile;
+}
+
+void PhysicalTilePool::LinkAsNewest(uint32_t tile)
+{
+	Entry& entry = m_entries[tile];
+	entry.Previous = m_newest;
+	entry.Next = c_unmappedHeapTile;
+	(m_newest != c_unmappedHeapTile ? m_entries[m_newest].Next : m_oldest) = tile;
+	m_newest = tile;
+}
+
+// Takes a free tile, or the least recently used one if there are none. Returns
+// c_unmappedHeapTile if every tile is pinned.
+uint32_t PhysicalTilePool::Allocate(VirtualTexture* owner, uint32_t ownerTile, bool pinned)
+{
+	uint32_t tile;
+	if (!m_free.empty())
+	{
+		tile = m_free.back();
+		m_free.pop_back();
+	}
+	else if (m_oldest != c_unmappedHeapTile)
+	{
+		tile = m_oldest;
+		Unlink(tile);
+
+		Entry const& evicted = m_entries[tile];
+		evicted.Owner->OnEvicted(evicted.OwnerTile);
+		++m_evictionCount;
+	}
+	else
+	{
+		return c_unmappedHeapTile;
+	}
+
+	Entry& entry = m_entries[tile];
+	entry.Owner = owner;
+	entry.OwnerTile = ownerTile;
+	entry.Pinned = pinned;
+	if (!pinned)
+	{
+		LinkAsNewest(tile);
+	}
+	return tile;
+}
+
+void PhysicalTilePool::Free(uint32_t tile)
+{
+	Entry& entry = m_entries[tile];
+	if (!entry.Pinned)
+	{
+		Unlink(tile);
+	}
+	entry.Owner = nullptr;
+	entry.Pinned = false;
+	m_free.push_back(tile);
+}
+
+void PhysicalTilePool::Touch(uint32_t tile)
+{
+	if (!m_entries[tile].Pinned && m_newest != tile)
+	{
+		Unlink(tile);
+		LinkAsNewest(tile);
+	}
+}
+
+VirtualTexture::VirtualTexture(VirtualTextureLayout const& layout, PhysicalTilePool& pool, TileMappingBackend& backend) :
+	m_layout(layout),
+	m_pool(pool),
+	m_backend(backend),
+	m_mappedTileCount(0)
+{
+	if (layout.TileWidth == 0 || layout.TileHeight == 0 || layout.StandardMipCount > layout.MipCount ||
+		(layout.StandardMipCount < layout.MipCount) != (layout.PackedTileCount > 0))
+	{
+		throw std::invalid_argument("Virtual texture layout is inconsistent.");
+	}
+
+	uint32_t tileCount = 0;
+	for (uint32_t mip = 0; mip < layout.StandardMipCount; ++mip)
+	{
+		MipTiles tiles;
+		tiles.TileCountX = (std::max(1u, layout.Width >> mip) + layout.TileWidth - 1) / layout.TileWidth;
+		tiles.TileCountY = (std::max(1u, layout.Height >> mip) + layout.TileHeight - 1) / layout.TileHeight;
+		tiles.FirstTile = tileCount;
+		m_mips.push_back(tiles);
+		tileCount += tiles.TileCountX * tiles.TileCountY;
+	}
+	if (layout.PackedTileCount > 0)
+	{
+		m_mips.push_back(MipTiles{ layout.PackedTileCount, 1, tileCount });
+		tileCount += layout.PackedTileCount;
+	}
+
+	m_pageTable.assign(tileCount, c_unmappedHeapTile);
+	m_pendingSlots.assign(tileCount, c_unmappedHeapTile);
+
+	// The packed mips are sampled whenever anything is, so they stay mapped.
+	for (uint32_t i = 0; i < layout.PackedTileCount; ++i)
+	{
+		const uint32_t tileIndex = GetTileIndex(layout.StandardMipCount, i, 0);
+		const uint32_t heapTile = m_pool.Allocate(this, tileIndex, true);
+		if (heapTile == c_unmappedHeapTile)
+		{
+			// The destructor won't run, so give back the tiles already taken.
+			for (uint32_t mappedTile : m_pageTable)
+			{
+				if (mappedTile != c_unmappedHeapTile)
+				{
+					m_pool.Free(mappedTile);
+				}
+			}
+			throw std::runtime_error("Tile pool can't hold the packed mips.");
+		}
+		SetMapping(tileIndex, heapTile);
+	}
+}
+
+VirtualTexture::~VirtualTexture()
+{
+	for (uint32_t heapTile : m_pageTable)
+	{
+		if (heapTile != c_unmappedHeapTile)
+		{
+			m_pool.Free(heapTile);
+		}
+	}
+}
+
+bool VirtualTexture::Map(uint32_t mip, uint32_t x, uint32_t y)
+{
+	const uint32_t tileIndex = GetTileIndex(mip, x, y);
+	if (m_pageTable[tileIndex] != c_unmappedHeapTile)
+	{
+		m_pool.Touch(m_pageTable[tileIndex]);
+		return false;
+	}
+
+	const uint32_t heapTile = m_pool.Allocate(this, tileIndex, false);
+	if (heapTile == c_unmappedHeapTile)
+	{
+		throw std::runtime_error("Every tile in the pool is pinned.");
+	}
+	SetMapping(tileIndex, heapTile);
+	return true;
+}
+
+void VirtualTexture::Unmap(uint32_t mip, uint32_t x, uint32_t y)
+{
+	// The packed mips stay mapped.
+	if (mip >= m_layout.StandardMipCount)
+	{
+		return;
+	}
+
+	const uint32_t tileIndex = GetTileIndex(mip, x, y);
+	if (m_pageTable[tileIndex] != c_unmappedHeapTile)
+	{
+		m_pool.Free(m_pageTable[tileIndex]);
+		SetMapping(tileIndex, c_unmappedHeapTile);
+	}
+}
+
+// The pool has given this tile's heap tile to another mapping.
+void VirtualTexture::OnEvicted(uint32_t tileIndex)
+{
+	SetMapping(tileIndex, c_unmappedHeapTile);
+}
+
+// Updates the page table and queues the change, replacing any change to the same tile that
+// hasn't been sent yet.
+void VirtualTexture::SetMapping(uint32_t tileIndex, uint32_t heapTile)
+{
+	if (m_pageTable[tileIndex] == c_unmappedHeapTile && heapTile != c_unmappedHeapTile)
+	{
+		++m_mappedTileCount;
+	}
+	else if (m_pageTable[tileIndex] != c_unmappedHeapTile && heapTile == c_unmappedHeapTile)
+	{
+		--m_mappedTileCount;
+	}
+	m_pageTable[tileIndex] = heapTile;
+
+	uint32_t& slot = m_pendingSlots[tileIndex];
+	if (slot != c_unmappedHeapTile)
+	{
+		m_pending[slot].HeapTile = heapTile;
+		return;
+	}
+
+	// Page table entries are in mip order, so the mip is the last one starting at or before it.
+	uint32_t mip = static_cast<uint32_t>(m_mips.size()) - 1;
+	while (m_mips[mip].FirstTile > tileIndex)
+	{
+		--mip;
+	}
+	const uint32_t tileInMip = tileIndex - m_mips[mip].FirstTile;
+
+	slot = static_cast<uint32_t>(m_pending.size());
+	m_pending.push_back(TileMapping{ mip, tileInMip % m_mips[mip].TileCountX, tileInMip / m_mips[mip].TileCountX, heapTile });
+}
+
+void VirtualTexture::Flush()
+{
+	if (m_pending.empty())
+	{
+		return;
+	}
+
+	m_backend.UpdateTileMappings(m_pending.data(), m_pending.size());
+
+	for (TileMapping const& mapping : m_pending)
+	{
+		m_pendingSlots[GetTileIndex(mapping.Mip, mapping.X, mapping.Y)] = c_unmappedHeapTile;
+	}
+	m_pending.clear();
+}
@@ -0,0 +1,136 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace DX
+{
+	const uint32_t c_unmappedHeapTile = 0xFFFFFFFF;
+
+	// A change to where one tile of a reserved texture lives. Packed mips are addressed as
+	// Mip = the first packed mip, X = the tile's index within them, Y = 0.
+	struct TileMapping
+	{
+		uint32_t	Mip;
+		uint32_t	X;
+		uint32_t	Y;
+		uint32_t	HeapTile;	// c_unmappedHeapTile to unmap the tile.
+	};
+
+	// Where a virtual texture sends its mapping changes. The D3D12 implementation forwards
+	// them to UpdateTileMappings; a mock can record them instead.
+	class TileMappingBackend
+	{
+	public:
+		virtual ~TileMappingBackend() {}
+
+		// Each call is one batch, holding at most one change per tile.
+		virtual void UpdateTileMappings(const TileMapping* mappings, size_t count) = 0;
+	};
+
+	class VirtualTexture;
+
+	// A fixed set of heap tiles shared by virtual textures. Tiles in use are kept in least
+	// recently used order, so that when the pool runs out the stalest one is taken back from
+	// whichever texture has it. Pinned tiles are never taken back.
+	class PhysicalTilePool
+	{
+	public:
+		explicit PhysicalTilePool(uint32_t tileCount);
+
+		PhysicalTilePool(PhysicalTilePool const&) = delete;
+		PhysicalTilePool& operator=(PhysicalTilePool const&) = delete;
+
+		uint32_t GetTileCount() const { return static_cast<uint32_t>(m_entries.size()); }
+		uint32_t GetFreeTileCount() const { return static_cast<uint32_t>(m_free.size()); }
+		uint64_t GetEvictionCount() const { return m_evictionCount; }
+
+	private:
+		friend class VirtualTexture;
+
+		struct Entry
+		{
+			uint32_t		Previous;	// Neighbours in the LRU list, c_unmappedHeapTile at the ends.
+			uint32_t		Next;
+			VirtualTexture*	Owner;		// Null while free.
+			uint32_t		OwnerTile;	// Index into the owner's page table.
+			bool			Pinned;
+		};
+
+		uint32_t Allocate(VirtualTexture* owner, uint32_t ownerTile, bool pinned);
+		void Free(uint32_t tile);
+		void Touch(uint32_t tile);
+		void Unlink(uint32_t tile);
+		void LinkAsNewest(uint32_t tile);
+
+		std::vector<Entry>		m_entries;
+		std::vector<uint32_t>	m_free;
+		uint32_t				m_oldest;
+		uint32_t				m_newest;
+		uint64_t				m_evictionCount;
+	};
+
+	// Describes a reserved texture's tiling, as GetResourceTiling reports it.
+	struct VirtualTextureLayout
+	{
+		uint32_t	Width;
+		uint32_t	Height;
+		uint32_t	MipCount;
+		uint32_t	TileWidth;			// In texels.
+		uint32_t	TileHeight;
+		uint32_t	StandardMipCount;	// Mips from here on are packed together.
+		uint32_t	PackedTileCount;
+	};
+
+	// CPU-side page table for a reserved texture: which heap tile, if any, backs each tile of
+	// each mip. The packed mips can only be mapped as a whole, so they are mapped to pinned
+	// tiles on construction. Mapping changes are queued and go to the backend in one batch
+	// per Flush. Memory use follows the number of tiles mapped, not the texture's size.
+	class VirtualTexture
+	{
+	public:
+		VirtualTexture(VirtualTextureLayout const& layout, PhysicalTilePool& pool, TileMappingBackend& backend);
+		~VirtualTexture();
+
+		VirtualTexture(VirtualTexture const&) = delete;
+		VirtualTexture& operator=(VirtualTexture const&) = delete;
+
+		// Maps a tile of a standard mip. Returns true if it wasn't mapped, in which case the
+		// caller has to fill it; if the pool was full, that took a tile from another mapping.
+		bool Map(uint32_t mip, uint32_t x, uint32_t y);
+		void Unmap(uint32_t mip, uint32_t x, uint32_t y);	// Ignored for the packed mips.
+		bool IsMapped(uint32_t mip, uint32_t x, uint32_t y) const { return m_pageTable[GetTileIndex(mip, x, y)] != c_unmappedHeapTile; }
+
+		// Sends the changes queued since the last call.
+		void Flush();
+
+		VirtualTextureLayout const& GetLayout() const { return m_layout; }
+		uint32_t GetTileCountX(uint32_t mip) const { return m_mips[mip].TileCountX; }
+		uint32_t GetTileCountY(uint32_t mip) const { return m_mips[mip].TileCountY; }
+		uint32_t GetMappedTileCount() const { return m_mappedTileCount; }
+
+	private:
+		friend class PhysicalTilePool;
+
+		struct MipTiles
+		{
+			uint32_t	TileCountX;
+			uint32_t	TileCountY;
+			uint32_t	FirstTile;
+		};
+
+		uint32_t GetTileIndex(uint32_t mip, uint32_t x, uint32_t y) const { return m_mips[mip].FirstTile + y * m_mips[mip].TileCountX + x; }
+		void SetMapping(uint32_t tileIndex, uint32_t heapTile);
+		void OnEvicted(uint32_t tileIndex);
+
+		VirtualTextureLayout		m_layout;
+		PhysicalTilePool&			m_pool;
+		TileMappingBackend&			m_backend;
+		std::vector<MipTiles>		m_mips;			// Standard mips, then the packed mips as one row.
+		std::vector<uint32_t>		m_pageTable;	// Heap tile for each tile.
+		std::vector<TileMapping>	m_pending;
+		std::vector<uint32_t>		m_pendingSlots;	// Each tile's index into m_pending, if queued.
+		uint32_t					m_mappedTileCount;
+	};
+}
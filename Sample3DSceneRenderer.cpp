@@ -2,6 +2,23 @@
 #include "Sample3DSceneRenderer.h"
 
 #include "Common\DirectXHelper.h"
+#include "Common\BlockCompressor.h"
+#include "Common\CookedTexture.h"
+#include "Common\FileView.h"
+#include "Common\IndexBuffer.h"
+#include "Common\MeshGenerator.h"
+#include "Common\MeshImporter.h"
+#include "Common\MeshOptimizer.h"
+#include "Common\MipGenerator.h"
+#include "Common\PngDecoder.h"
+#include "Common\RowCopy.h"
+#include "Common\TextureLayout.h"
+#include "Common\VertexQuantizer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <stdexcept>
 
 #include "SampleVertexShader.h"
 #include "SamplePixelShader.h"
@@ -11,27 +28,147 @@ using namespace SpinningCube;
 using namespace DirectX;
 using namespace Microsoft::WRL;
 
+static_assert(sizeof(VertexPositionTex) == sizeof(DX::MeshVertex) && offsetof(VertexPositionTex, pos) == offsetof(DX::MeshVertex, Position) &&
+	offsetof(VertexPositionTex, uv) == offsetof(DX::MeshVertex, UV), "Generated meshes are copied into vertex buffers as they are.");
+
+namespace
+{
+	// Sends a virtual texture's mapping changes to the command queue, one UpdateTileMappings
+	// call per batch, each change a single tile mapped to a single heap tile.
+	class QueueTileMappingBackend : public DX::TileMappingBackend
+	{
+	public:
+		QueueTileMappingBackend(ID3D12CommandQueue* commandQueue, ID3D12Resource* resource, ID3D12Heap* heap) :
+			m_commandQueue(commandQueue),
+			m_resource(resource),
+			m_heap(heap)
+		{
+		}
+
+		void UpdateTileMappings(const DX::TileMapping* mappings, size_t count) override
+		{
+			m_coordinates.resize(count);
+			m_regionSizes.assign(count, CD3DX12_TILE_REGION_SIZE(1, FALSE, 0, 0, 0));
+			m_rangeFlags.resize(count);
+			m_heapTiles.resize(count);
+			m_rangeTileCounts.assign(count, 1);
+
+			for (size_t i = 0; i < count; ++i)
+			{
+				DX::TileMapping const& mapping = mappings[i];
+				m_coordinates[i] = CD3DX12_TILED_RESOURCE_COORDINATE(mapping.X, mapping.Y, 0, mapping.Mip);
+				m_rangeFlags[i] = mapping.HeapTile == DX::c_unmappedHeapTile ? D3D12_TILE_RANGE_FLAG_NULL : D3D12_TILE_RANGE_FLAG_NONE;
+				m_heapTiles[i] = mapping.HeapTile == DX::c_unmappedHeapTile ? 0 : mapping.HeapTile;
+			}
+
+			m_commandQueue->UpdateTileMappings(m_resource, static_cast<UINT>(count), m_coordinates.data(), m_regionSizes.data(),
+				m_heap, static_cast<UINT>(count), m_rangeFlags.data(), m_heapTiles.data(), m_rangeTileCounts.data(), D3D12_TILE_MAPPING_FLAG_NONE);
+		}
+
+	private:
+		ID3D12CommandQueue*								m_commandQueue;
+		ID3D12Resource*									m_resource;
+		ID3D12Heap*										m_heap;
+		std::vector<D3D12_TILED_RESOURCE_COORDINATE>	m_coordinates;
+		std::vector<D3D12_TILE_REGION_SIZE>				m_regionSizes;
+		std::vector<D3D12_TILE_RANGE_FLAGS>				m_rangeFlags;
+		std::vector<UINT>								m_heapTiles;
+		std::vector<UINT>								m_rangeTileCounts;
+	};
+
+	// A PNG file, mapped, with a decoder reading its headers.
+	struct PngImage
+	{
+		explicit PngImage(std::wstring const& fileName) :
+			File(fileName),
+			Decoder(File.GetData(), File.GetSize())
+		{
+		}
+
+		DX::FileView	File;
+		DX::PngDecoder	Decoder;
+	};
+
+	// Whether the payload's levels from firstMip on are placed relative to each other as the
+	// footprints place them, so that they can be uploaded as they are.
+	bool IsPayloadPlacedAs(const DX::SubresourceFootprint* footprints, DX::CookedTextureMip const* mips, UINT firstMip, UINT mipCount)
+	{
+		for (UINT mip = firstMip; mip < mipCount; ++mip)
+		{
+			DX::SubresourceFootprint const& footprint = footprints[mip - firstMip];
+			if (footprint.Offset - footprints[0].Offset != mips[mip].Offset - mips[firstMip].Offset ||
+				footprint.RowPitch != mips[mip].RowPitch || footprint.RowCount != mips[mip].RowCount || footprint.RowSize != mips[mip].RowSize)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// The mesh in the file, centred on the origin and scaled to fit the cube it replaces.
+	DX::Mesh ImportMeshInCube(std::wstring const& fileName)
+	{
+		auto importStart = std::chrono::steady_clock::now();
+		DX::Mesh mesh = DX::ImportMesh(fileName);
+		const double importMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - importStart).count();
+
+		float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (DX::MeshVertex const& vertex : mesh.Vertices)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				minimum[axis] = (std::min)(minimum[axis], vertex.Position[axis]);
+				maximum[axis] = (std::max)(maximum[axis], vertex.Position[axis]);
+			}
+		}
+
+		float extent = 0.0f;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			extent = (std::max)(extent, maximum[axis] - minimum[axis]);
+		}
+		const float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+		for (DX::MeshVertex& vertex : mesh.Vertices)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				vertex.Position[axis] = (vertex.Position[axis] - (minimum[axis] + maximum[axis]) * 0.5f) * scale;
+			}
+		}
+
+		WCHAR message[MAX_PATH + 64];
+		if (swprintf_s(message, L"Imported %s: %zu triangles in %.2f ms\n", fileName.c_str(), mesh.Indices.size() / 3, importMilliseconds) > 0)
+		{
+			OutputDebugStringW(message);
+		}
+		return mesh;
+	}
+}
+
 // Loads vertex and pixel shaders from files and instantiates the cube geometry.
-Sample3DSceneRenderer::Sample3DSceneRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources) :
+Sample3DSceneRenderer::Sample3DSceneRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources, const std::shared_ptr<DX::AssetCache>& assetCache) :
 	m_loadingComplete(false),
 	m_radiansPerSecond(XM_PIDIV4),	// rotate 45 degrees per second
 	m_angle(0),
 	m_tracking(false),
 	m_mappedConstantBuffer(nullptr),
 	m_deviceResources(deviceResources),
+	m_assetCache(assetCache),
 	m_shouldRotate(true),
-	m_supportsSamplerFeedback(false)
+	m_supportsSamplerFeedback(false),
+	m_supportsTiledResources(false),
+	m_residentMip(0),
+	m_tailMip(0),
+	m_streamingRow(0),
+	m_streamingPayload(nullptr),
+	m_streamingUploadSize(0),
+	m_reducedDetailFrameCount(0),
+	m_streamingTargetMip(0),
+	m_mappedUploadBuffer(nullptr)
 {
 	ZeroMemory(&m_constantBufferData, sizeof(m_constantBufferData));
-
-	DX::ThrowIfFailed(CoInitialize(nullptr));
-
-	DX::ThrowIfFailed(CoCreateInstance(
-		CLSID_WICImagingFactory,
-		NULL,
-		CLSCTX_INPROC_SERVER,
-		IID_IWICImagingFactory,
-		(LPVOID*)&m_wicImagingFactory));
+	ZeroMemory(m_textureViewMips, sizeof(m_textureViewMips));
 
 	CreateDeviceDependentResources();
 	CreateWindowSizeDependentResources();
@@ -39,8 +176,13 @@ Sample3DSceneRenderer::Sample3DSceneRenderer(const std::shared_ptr<DX::DeviceRes
 
 Sample3DSceneRenderer::~Sample3DSceneRenderer()
 {
-	m_constantBuffer->Unmap(0, nullptr);
 	m_mappedConstantBuffer = nullptr;
+
+	if (m_uploadBuffer)
+	{
+		m_uploadBuffer->Unmap(0, nullptr);
+		m_mappedUploadBuffer = nullptr;
+	}
 }
 
 void Sample3DSceneRenderer::CreateDeviceDependentResources()
@@ -52,6 +194,13 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources()
 	{
 		m_supportsSamplerFeedback = options7.SamplerFeedbackTier > D3D12_SAMPLER_FEEDBACK_TIER_NOT_SUPPORTED;
 	}
+
+	// Tier 2 reads unmapped tiles as zero, so sampling one before it is streamed in is safe.
+	D3D12_FEATURE_DATA_D3D12_OPTIONS options{};
+	if (SUCCEEDED(d3dDevice->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options))))
+	{
+		m_supportsTiledResources = options.TiledResourcesTier >= D3D12_TILED_RESOURCES_TIER_2;
+	}
 	
 	// Create a root signature with a single constant buffer slot.
 	{
@@ -87,10 +236,15 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources()
 		CD3DX12_ROOT_SIGNATURE_DESC descRootSignature;
 		descRootSignature.Init(1, &parameter, 1, &sampler, rootSignatureFlags);
 
-		ComPtr<ID3DBlob> pSignature;
-		ComPtr<ID3DBlob> pError;
-		DX::ThrowIfFailed(D3D12SerializeRootSignature(&descRootSignature, D3D_ROOT_SIGNATURE_VERSION_1, pSignature.GetAddressOf(), pError.GetAddressOf()));
-		DX::ThrowIfFailed(d3dDevice->CreateRootSignature(0, pSignature->GetBufferPointer(), pSignature->GetBufferSize(), IID_PPV_ARGS(&m_rootSignature)));
+		// The serialized root signature doesn't depend on the device, so it is kept for the next one.
+		auto pSignature = m_assetCache->GetOrCreate<ComPtr<ID3DBlob>>(L"RootSignature", [&]()
+		{
+			auto signature = std::make_shared<ComPtr<ID3DBlob>>();
+			ComPtr<ID3DBlob> pError;
+			DX::ThrowIfFailed(D3D12SerializeRootSignature(&descRootSignature, D3D_ROOT_SIGNATURE_VERSION_1, signature->GetAddressOf(), pError.GetAddressOf()));
+			return signature;
+		});
+		DX::ThrowIfFailed(d3dDevice->CreateRootSignature(0, (*pSignature)->GetBufferPointer(), (*pSignature)->GetBufferSize(), IID_PPV_ARGS(&m_rootSignature)));
         NAME_D3D12_OBJECT(m_rootSignature);
 	}
 
@@ -103,8 +257,19 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources()
 			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
 		};
 
+		// The input assembler expands quantized vertices to the floats the vertex shader takes,
+		// so the shader is the same for both; the model matrix undoes the position's scaling.
+		// The normal, at offset 6, isn't read.
+		// The UV format is the mesh's, which falls back to halves when its UVs don't fit UNORM16.
+		m_cubeMesh = m_assetCache->GetOrCreate<MeshAsset>(L"Cube", &CreateCubeMesh);
+		const D3D12_INPUT_ELEMENT_DESC quantizedInputLayout[] =
+		{
+			{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "TEXCOORD", 0, m_cubeMesh->Quantized.UvFormat == DX::VertexUvFormat::Unorm16 ? DXGI_FORMAT_R16G16_UNORM : DXGI_FORMAT_R16G16_FLOAT, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+		};
+
 		D3D12_GRAPHICS_PIPELINE_STATE_DESC state = {};
-		state.InputLayout = { inputLayout, _countof(inputLayout) };
+		state.InputLayout = c_quantizeVertices ? D3D12_INPUT_LAYOUT_DESC{ quantizedInputLayout, _countof(quantizedInputLayout) } : D3D12_INPUT_LAYOUT_DESC{ inputLayout, _countof(inputLayout) };
 		state.pRootSignature = m_rootSignature.Get();
         state.VS = CD3DX12_SHADER_BYTECODE((void*)(g_SampleVertexShader), _countof(g_SampleVertexShader));
         state.PS = CD3DX12_SHADER_BYTECODE((void*)(g_SamplePixelShader), _countof(g_SamplePixelShader));
@@ -129,152 +294,48 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources()
 		DX::ThrowIfFailed(d3dDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_deviceResources->GetCommandAllocator(), m_pipelineState.Get(), IID_PPV_ARGS(&m_commandList)));
         NAME_D3D12_OBJECT(m_commandList);
 
-		// Cube vertices. Each vertex has a position and a color.
-		VertexPositionTex cubeVertices[] =
-		{
-			// Front face
-			{ XMFLOAT3(-0.5f,  0.5f,  0.5f), XMFLOAT2(0.0f, 0.0f) }, // fg top left
-			{ XMFLOAT3(0.5f,  0.5f,  0.5f), XMFLOAT2(1.0f, 0.0f) },  // fg top right
-			{ XMFLOAT3(-0.5f, -0.5f,  0.5f), XMFLOAT2(0.0f, 1.0f) }, // fg bottom left
-			{ XMFLOAT3(0.5f, -0.5f,  0.5f), XMFLOAT2(1.0f, 1.0f) },	 // fg bottom right
-
-			// Right face
-			{ XMFLOAT3(0.5f,  0.5f,  0.5f), XMFLOAT2(0.0f, 0.0f) }, // fg top right
-			{ XMFLOAT3(0.5f,  0.5f, -0.5f), XMFLOAT2(1.0f, 0.0f) }, // bg top right
-			{ XMFLOAT3(0.5f, -0.5f,  0.5f), XMFLOAT2(0.0f, 1.0f) },	// fg bottom right
-			{ XMFLOAT3(0.5f, -0.5f, -0.5f), XMFLOAT2(1.0f, 1.0f) }, // bg bottom right
-
-			// Back face
-			{ XMFLOAT3(0.5f,  0.5f, -0.5f),  XMFLOAT2(0.0f, 0.0f) }, // bg top right
-			{ XMFLOAT3(-0.5f,  0.5f, -0.5f), XMFLOAT2(1.0f, 0.0f) }, // bg top left
-			{ XMFLOAT3(0.5f, -0.5f, -0.5f),  XMFLOAT2(0.0f, 1.0f) }, // bg bottom right
-			{ XMFLOAT3(-0.5f, -0.5f, -0.5f), XMFLOAT2(1.0f, 1.0f) }, // bg bottom left
-
-			// Left face
-			{ XMFLOAT3(-0.5f,  0.5f, -0.5f), XMFLOAT2(0.0f, 0.0f) }, // bg top left
-			{ XMFLOAT3(-0.5f,  0.5f,  0.5f), XMFLOAT2(1.0f, 0.0f) }, // fg top left
-			{ XMFLOAT3(-0.5f, -0.5f, -0.5f), XMFLOAT2(0.0f, 1.0f) }, // bg bottom left
-			{ XMFLOAT3(-0.5f, -0.5f,  0.5f), XMFLOAT2(1.0f, 1.0f) }, // fg bottom left
-
-			// Top face
-			{ XMFLOAT3(-0.5f,  0.5f, -0.5f), XMFLOAT2(0.0f, 0.0f) }, // bg top left
-			{ XMFLOAT3(0.5f,  0.5f, -0.5f),  XMFLOAT2(1.0f, 0.0f) }, // bg top right
-			{ XMFLOAT3(-0.5f,  0.5f,  0.5f), XMFLOAT2(0.0f, 1.0f) }, // fg top left
-			{ XMFLOAT3(0.5f,  0.5f,  0.5f),  XMFLOAT2(1.0f, 1.0f) },  // fg top right
-
-			// Bottom face
-			{ XMFLOAT3(-0.5f, -0.5f,  0.5f), XMFLOAT2(0.0f, 0.0f) }, // fg bottom left
-			{ XMFLOAT3(0.5f, -0.5f,  0.5f),  XMFLOAT2(1.0f, 0.0f) }, // fg bottom right
-			{ XMFLOAT3(-0.5f, -0.5f, -0.5f), XMFLOAT2(0.0f, 1.0f) }, // bg bottom left
-			{ XMFLOAT3(0.5f, -0.5f, -0.5f),  XMFLOAT2(1.0f, 1.0f) }, // bg bottom right
-		};
-
-		const UINT vertexBufferSize = sizeof(cubeVertices);
-
-		// Create the vertex buffer resource in the GPU's default heap and copy vertex data into it using the upload heap.
-		// The upload resource must not be released until after the GPU has finished using it.
-		Microsoft::WRL::ComPtr<ID3D12Resource> vertexBufferUpload;
+		const void* vertexData = c_quantizeVertices ? static_cast<const void*>(m_cubeMesh->Quantized.Vertices.data()) : m_cubeMesh->Vertices.data();
+		const UINT vertexStride = c_quantizeVertices ? sizeof(DX::QuantizedVertex) : sizeof(VertexPositionTex);
+		const UINT vertexBufferSize = static_cast<UINT>(m_cubeMesh->Vertices.size() * vertexStride);
 
-		CD3DX12_HEAP_PROPERTIES defaultHeapProperties(D3D12_HEAP_TYPE_DEFAULT);
-		CD3DX12_RESOURCE_DESC vertexBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(vertexBufferSize);
-		DX::ThrowIfFailed(d3dDevice->CreateCommittedResource(
-			&defaultHeapProperties,
-			D3D12_HEAP_FLAG_NONE,
-			&vertexBufferDesc,
-			D3D12_RESOURCE_STATE_COPY_DEST,
-			nullptr,
-			IID_PPV_ARGS(&m_vertexBuffer)));
+		// Every upload is staged in the upload ring, which keeps its space until the GPU has finished reading it,
+		// and copied from there on the copy queue.
+		CreateUploadRing(c_uploadRingSize);
+		m_copyQueue = std::make_unique<DX::CopyQueue>(d3dDevice);
+		m_uploadBatcher = std::make_unique<DX::UploadBatcher>(*m_copyQueue);
 
-		CD3DX12_HEAP_PROPERTIES uploadHeapProperties(D3D12_HEAP_TYPE_UPLOAD);
-		DX::ThrowIfFailed(d3dDevice->CreateCommittedResource(
-			&uploadHeapProperties,
-			D3D12_HEAP_FLAG_NONE,
-			&vertexBufferDesc,
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&vertexBufferUpload)));
+		// Buffers are ranges of larger buffers placed in shared heaps, rather than committed resources of their own.
+		m_gpuAllocator = std::make_unique<DX::GpuAllocator>(d3dDevice);
+		m_footprintCache = std::make_unique<DX::FootprintCache>(d3dDevice);
 
-        NAME_D3D12_OBJECT(m_vertexBuffer);
+		// Allocate the vertex buffer in the GPU's default heap and copy vertex data into it through the upload ring.
+		m_vertexBuffer = m_gpuAllocator->AllocateBuffer(vertexBufferSize, sizeof(float), D3D12_HEAP_TYPE_DEFAULT);
 
-		// Upload the vertex buffer to the GPU.
+		// Upload the vertex buffer to the GPU. Buffers are promoted from the common state on first use, so the
+		// copy queue and then the input assembler can use it without barriers.
 		{
-			D3D12_SUBRESOURCE_DATA vertexData = {};
-			vertexData.pData = reinterpret_cast<BYTE*>(cubeVertices);
-			vertexData.RowPitch = vertexBufferSize;
-			vertexData.SlicePitch = vertexData.RowPitch;
-
-			UpdateSubresources(m_commandList.Get(), m_vertexBuffer.Get(), vertexBufferUpload.Get(), 0, 0, 1, &vertexData);
-
-			CD3DX12_RESOURCE_BARRIER vertexBufferResourceBarrier =
-				CD3DX12_RESOURCE_BARRIER::Transition(m_vertexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
-			m_commandList->ResourceBarrier(1, &vertexBufferResourceBarrier);
-		}
-
-		// Load mesh indices. Each trio of indices represents a triangle to be rendered on the screen.
-		// For example: 0,2,1 means that the vertices with indexes 0, 2 and 1 from the vertex buffer compose the
-		// first triangle of this mesh.
-
-		std::vector<unsigned short> cubeIndices;
-
-		unsigned short baseIndex = 0;
-		for (int i = 0; i < 6; ++i)
-		{
-			cubeIndices.push_back(baseIndex + 0);
-			cubeIndices.push_back(baseIndex + 1);
-			cubeIndices.push_back(baseIndex + 2);
-
-			cubeIndices.push_back(baseIndex + 2);
-			cubeIndices.push_back(baseIndex + 1);
-			cubeIndices.push_back(baseIndex + 3);
-
-			baseIndex += 4;
+			UploadAllocation vertexBufferUpload = AllocateUpload(vertexBufferSize, sizeof(float));
+			memcpy(vertexBufferUpload.Data, vertexData, vertexBufferSize);
+			m_uploadBatcher->Enqueue(DX::MakeBufferCopy(m_vertexBuffer.Resource, m_vertexBuffer.Offset, vertexBufferUpload.Resource, vertexBufferUpload.Offset, vertexBufferSize));
 		}
 
-		m_indexCount = static_cast<UINT>(cubeIndices.size());
-
-		const UINT indexBufferSize = m_indexCount * sizeof(unsigned short);
-
-		// Create the index buffer resource in the GPU's default heap and copy index data into it using the upload heap.
-		// The upload resource must not be released until after the GPU has finished using it.
-		Microsoft::WRL::ComPtr<ID3D12Resource> indexBufferUpload;
-
-		CD3DX12_RESOURCE_DESC indexBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(indexBufferSize);
-		DX::ThrowIfFailed(d3dDevice->CreateCommittedResource(
-			&defaultHeapProperties,
-			D3D12_HEAP_FLAG_NONE,
-			&indexBufferDesc,
-			D3D12_RESOURCE_STATE_COPY_DEST,
-			nullptr,
-			IID_PPV_ARGS(&m_indexBuffer)));
+		DX::IndexBuffer const& indices = m_cubeMesh->IndexBuffer;
+		const UINT indexBufferSize = static_cast<UINT>(indices.Data.size());
 
-		DX::ThrowIfFailed(d3dDevice->CreateCommittedResource(
-			&uploadHeapProperties,
-			D3D12_HEAP_FLAG_NONE,
-			&indexBufferDesc,
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&indexBufferUpload)));
-
-		NAME_D3D12_OBJECT(m_indexBuffer);
+		// Allocate the index buffer in the GPU's default heap and copy index data into it through the upload ring.
+		m_indexBuffer = m_gpuAllocator->AllocateBuffer(indexBufferSize, indices.IndexSize, D3D12_HEAP_TYPE_DEFAULT);
 
 		// Upload the index buffer to the GPU.
 		{
-			D3D12_SUBRESOURCE_DATA indexData = {};
-			indexData.pData = reinterpret_cast<BYTE*>(cubeIndices.data());
-			indexData.RowPitch = indexBufferSize;
-			indexData.SlicePitch = indexData.RowPitch;
-
-			UpdateSubresources(m_commandList.Get(), m_indexBuffer.Get(), indexBufferUpload.Get(), 0, 0, 1, &indexData);
-
-			CD3DX12_RESOURCE_BARRIER indexBufferResourceBarrier =
-				CD3DX12_RESOURCE_BARRIER::Transition(m_indexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_INDEX_BUFFER);
-			m_commandList->ResourceBarrier(1, &indexBufferResourceBarrier);
+			UploadAllocation indexBufferUpload = AllocateUpload(indexBufferSize, indices.IndexSize);
+			memcpy(indexBufferUpload.Data, indices.Data.data(), indexBufferSize);
+			m_uploadBatcher->Enqueue(DX::MakeBufferCopy(m_indexBuffer.Resource, m_indexBuffer.Offset, indexBufferUpload.Resource, indexBufferUpload.Offset, indexBufferSize));
 		}
 
-		// Create a descriptor heap for the constant buffers.
+		// Create a descriptor heap for the constant buffers, followed by one texture view per frame.
 		{
 			D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
-			heapDesc.NumDescriptors = DX::c_frameCount + 1;
+			heapDesc.NumDescriptors = DX::c_frameCount * 2;
 			heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
 			// This flag indicates that this descriptor heap can be bound to the pipeline and that descriptors contained in it can be referenced by a root table.
 			heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
@@ -283,19 +344,10 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources()
             NAME_D3D12_OBJECT(m_cbv_srv_Heap);
 		}
 		
-		CD3DX12_RESOURCE_DESC constantBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(DX::c_frameCount * c_alignedConstantBufferSize);
-		DX::ThrowIfFailed(d3dDevice->CreateCommittedResource(
-			&uploadHeapProperties,
-			D3D12_HEAP_FLAG_NONE,
-			&constantBufferDesc,
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&m_constantBuffer)));
-
-        NAME_D3D12_OBJECT(m_constantBuffer);
+		m_constantBuffer = m_gpuAllocator->AllocateBuffer(DX::c_frameCount * c_alignedConstantBufferSize, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, D3D12_HEAP_TYPE_UPLOAD);
 
 		// Create constant buffer views to access the upload buffer.
-		D3D12_GPU_VIRTUAL_ADDRESS cbvGpuAddress = m_constantBuffer->GetGPUVirtualAddress();
+		D3D12_GPU_VIRTUAL_ADDRESS cbvGpuAddress = m_constantBuffer.GpuAddress;
 		CD3DX12_CPU_DESCRIPTOR_HANDLE cbvCpuHandle(m_cbv_srv_Heap->GetCPUDescriptorHandleForHeapStart());
 		m_cbvDescriptorSize = d3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
@@ -310,38 +362,39 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources()
 			cbvCpuHandle.Offset(m_cbvDescriptorSize);
 		}
 
-		// Map the constant buffers.
-		CD3DX12_RANGE readRange(0, 0);		// We do not intend to read from this resource on the CPU.
-		DX::ThrowIfFailed(m_constantBuffer->Map(0, &readRange, reinterpret_cast<void**>(&m_mappedConstantBuffer)));
+		// The allocator keeps upload buffers mapped for their lifetime.
+		m_mappedConstantBuffer = m_constantBuffer.Data;
 		ZeroMemory(m_mappedConstantBuffer, DX::c_frameCount * c_alignedConstantBufferSize);
-		// We don't unmap this until the app closes. Keeping things mapped for the lifetime of the resource is okay.
 
-		// Load image resource
+		// Load image resource. The rest of the mip chain is generated from the base level.
 		std::vector<std::wstring> imageFileNames;
 		imageFileNames.push_back(L"1.png");
-		imageFileNames.push_back(L"2.png");
-		imageFileNames.push_back(L"3.png");
-		imageFileNames.push_back(L"4.png");
-		imageFileNames.push_back(L"5.png");
-		imageFileNames.push_back(L"6.png");
-		LoadTextureFromPngFile(imageFileNames);
-
-		// Close the command list and execute it to begin the vertex/index buffer copy into the GPU's default heap.
+		LoadTexture(imageFileNames);
+
+		// Submit the vertex/index buffer and texture copies to the copy queue, then close the command list and
+		// execute it once they have finished.
+		const UINT64 copyFenceValue = m_uploadBatcher->Submit();
+		if (copyFenceValue != 0)
+		{
+			m_copyQueue->WaitOnQueue(m_deviceResources->GetCommandQueue(), copyFenceValue);
+		}
 		DX::ThrowIfFailed(m_commandList->Close());
 		ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
 		m_deviceResources->GetCommandQueue()->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
 
 		// Create vertex/index buffer views.
-		m_vertexBufferView.BufferLocation = m_vertexBuffer->GetGPUVirtualAddress();
-		m_vertexBufferView.StrideInBytes = sizeof(VertexPositionTex);
-		m_vertexBufferView.SizeInBytes = sizeof(cubeVertices);
+		m_vertexBufferView.BufferLocation = m_vertexBuffer.GpuAddress;
+		m_vertexBufferView.StrideInBytes = vertexStride;
+		m_vertexBufferView.SizeInBytes = vertexBufferSize;
 
-		m_indexBufferView.BufferLocation = m_indexBuffer->GetGPUVirtualAddress();
+		m_indexBufferView.BufferLocation = m_indexBuffer.GpuAddress;
 		m_indexBufferView.SizeInBytes = indexBufferSize;
-		m_indexBufferView.Format = DXGI_FORMAT_R16_UINT;
+		m_indexBufferView.Format = indices.IndexSize == sizeof(UINT16) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
 
-		// Wait for the command list to finish executing; the vertex/index buffers need to be uploaded to the GPU before the upload resources go out of scope.
+		// Wait for the command list to finish executing, which also gives its upload ring space back before the first frame.
 		m_deviceResources->WaitForGpu();
+		ReclaimUploads();
+		ReportUploadStatistics();
 
 		// Create feedback map
 		if (m_supportsSamplerFeedback)
@@ -361,6 +414,7 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources()
 				65536,
 				4, 4, 1);
 
+			CD3DX12_HEAP_PROPERTIES defaultHeapProperties(D3D12_HEAP_TYPE_DEFAULT);
 			DX::ThrowIfFailed(d3dDevice->CreateCommittedResource2(
 				&defaultHeapProperties,
 				D3D12_HEAP_FLAG_NONE,
@@ -377,6 +431,58 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources()
 	m_loadingComplete = true;
 }
 
+// Four vertices a face at the least, so that each face has texture coordinates of its own, or
+// the mesh in c_meshFileName in the cube's place. Neither depends on the device, so they are
+// only built once.
+std::shared_ptr<Sample3DSceneRenderer::MeshAsset> Sample3DSceneRenderer::CreateCubeMesh()
+{
+	DX::Mesh cube = c_meshFileName != nullptr ? ImportMeshInCube(c_meshFileName) : DX::CreateCube(1.0f, c_cubeSegments);
+
+	// Order the triangles for the post-transform cache, optionally the clusters of them for
+	// overdraw, and then the vertices in the order the triangles use them.
+	const DX::VertexCacheStatistics before = DX::AnalyzeVertexCache(cube);
+	DX::OptimizeVertexCache(cube);
+	if (c_optimizeOverdraw)
+	{
+		DX::OptimizeOverdraw(cube);
+	}
+	DX::OptimizeVertexFetch(cube);
+	const DX::VertexCacheStatistics after = DX::AnalyzeVertexCache(cube);
+
+	WCHAR message[128];
+	if (swprintf_s(message, L"Cube mesh: %zu triangles, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+		cube.Indices.size() / 3, before.Acmr, after.Acmr, before.Atvr, after.Atvr) > 0)
+	{
+		OutputDebugStringW(message);
+	}
+
+	auto mesh = std::make_shared<MeshAsset>();
+	mesh->Vertices.resize(cube.Vertices.size());
+	memcpy(mesh->Vertices.data(), cube.Vertices.data(), cube.Vertices.size() * sizeof(VertexPositionTex));
+	if (c_quantizeVertices)
+	{
+		try
+		{
+			mesh->Quantized = DX::QuantizeMesh(cube, c_vertexUvFormat);
+		}
+		catch (std::out_of_range const&)
+		{
+			// Imported UVs may tile past [0, 1].
+			mesh->Quantized = DX::QuantizeMesh(cube, DX::VertexUvFormat::Half);
+		}
+	}
+
+	// 16-bit indices where they fit, split into submeshes with a base vertex each if that
+	// is what it takes, 32-bit otherwise.
+	mesh->IndexBuffer = DX::BuildIndexBuffer(cube, c_maxIndexSubmeshes);
+	if (swprintf_s(message, L"Cube indices: %u-bit, %zu submeshes\n", mesh->IndexBuffer.IndexSize * 8, mesh->IndexBuffer.Submeshes.size()) > 0)
+	{
+		OutputDebugStringW(message);
+	}
+	mesh->Indices = std::move(cube.Indices);
+	return mesh;
+}
+
 // Initializes view parameters when the window size changes.
 void Sample3DSceneRenderer::CreateWindowSizeDependentResources()
 {
@@ -434,14 +540,27 @@ void Sample3DSceneRenderer::Update(DX::StepTimer const& timer)
 		// Update the constant buffer resource.
 		UINT8* destination = m_mappedConstantBuffer + (m_deviceResources->GetCurrentFrameIndex() * c_alignedConstantBufferSize);
 		memcpy(destination, &m_constantBufferData, sizeof(m_constantBufferData));
+
+		if (m_residencyManager && m_streamingSource)
+		{
+			UpdateTextureResidency();
+		}
 	}
 }
 
 // Rotate the 3D cube model a set amount of radians.
 void Sample3DSceneRenderer::Rotate(float radians)
 {
-	// Prepare to pass the updated model matrix to the shader.
-	XMStoreFloat4x4(&m_constantBufferData.model, XMMatrixTranspose(XMMatrixRotationY(radians)));
+	// Prepare to pass the updated model matrix to the shader. Quantized positions are scaled
+	// and offset back to object space first.
+	XMMATRIX model = XMMatrixRotationY(radians);
+	if (c_quantizeVertices)
+	{
+		DX::QuantizedMesh const& quantized = m_cubeMesh->Quantized;
+		model = XMMatrixScaling(quantized.PositionScale[0], quantized.PositionScale[1], quantized.PositionScale[2]) *
+			XMMatrixTranslation(quantized.PositionBias[0], quantized.PositionBias[1], quantized.PositionBias[2]) * model;
+	}
+	XMStoreFloat4x4(&m_constantBufferData.model, XMMatrixTranspose(model));
 }
 
 // Renders one frame using the vertex and pixel shaders.
@@ -457,6 +576,8 @@ bool Sample3DSceneRenderer::Render()
 
 	// The command list can be reset anytime after ExecuteCommandList() is called.
 	DX::ThrowIfFailed(m_commandList->Reset(m_deviceResources->GetCommandAllocator(), m_pipelineState.Get()));
+	ReclaimUploads();
+	m_uploadBatcher->Update();
 
 	{
 		// Set the graphics root signature and descriptor heaps to be used by this frame.
@@ -464,8 +585,17 @@ bool Sample3DSceneRenderer::Render()
 		ID3D12DescriptorHeap* ppHeaps[] = { m_cbv_srv_Heap.Get() };
 		m_commandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
 
-		// Bind the current frame's constant buffer to the pipeline.
-		CD3DX12_GPU_DESCRIPTOR_HANDLE gpuHandle(m_cbv_srv_Heap->GetGPUDescriptorHandleForHeapStart());
+		// Copy in more of the texture, and widen this frame's view of it to what has arrived.
+		const UINT frameIndex = m_deviceResources->GetCurrentFrameIndex();
+		StreamTexture();
+		if (m_textureViewMips[frameIndex] != m_residentMip)
+		{
+			CreateTextureView(frameIndex);
+		}
+		ReportStreamingProgress();
+
+		// Bind the current frame's constant buffer and texture view to the pipeline.
+		CD3DX12_GPU_DESCRIPTOR_HANDLE gpuHandle(m_cbv_srv_Heap->GetGPUDescriptorHandleForHeapStart(), frameIndex, m_cbvDescriptorSize);
 		m_commandList->SetGraphicsRootDescriptorTable(0, gpuHandle);
 
 		// Set the viewport and scissor rectangle.
@@ -491,7 +621,10 @@ bool Sample3DSceneRenderer::Render()
 		m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 		m_commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
 		m_commandList->IASetIndexBuffer(&m_indexBufferView);
-		m_commandList->DrawIndexedInstanced(m_indexCount, 1, 0, 0, 0);
+		for (DX::IndexedSubmesh const& submesh : m_cubeMesh->IndexBuffer.Submeshes)
+		{
+			m_commandList->DrawIndexedInstanced(submesh.IndexCount, 1, submesh.FirstIndex, static_cast<INT>(submesh.BaseVertex), 0);
+		}
 
 		// Indicate that the render target will now be used to present when the command list is done executing.
 		CD3DX12_RESOURCE_BARRIER presentResourceBarrier =
@@ -501,6 +634,13 @@ bool Sample3DSceneRenderer::Render()
 
 	DX::ThrowIfFailed(m_commandList->Close());
 
+	// Submit this frame's copies; the command list reads what they write.
+	const UINT64 copyFenceValue = m_uploadBatcher->Submit();
+	if (copyFenceValue != 0)
+	{
+		m_copyQueue->WaitOnQueue(m_deviceResources->GetCommandQueue(), copyFenceValue);
+	}
+
 	// Execute the command list.
 	ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
 	m_deviceResources->GetCommandQueue()->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
@@ -508,112 +648,831 @@ bool Sample3DSceneRenderer::Render()
 	return true;
 }
 
-Sample3DSceneRenderer::LoadedImageData Sample3DSceneRenderer::LoadImageDataFromPngFile(std::wstring fileName)
+// Returns space in the upload ring for the work recorded this frame. If the ring is full even
+// after reclaiming what the GPU has finished with, it is replaced by one at least twice the size.
+Sample3DSceneRenderer::UploadAllocation Sample3DSceneRenderer::AllocateUpload(UINT64 size, UINT64 alignment)
 {
-	LoadedImageData result{};
-
-	ComPtr<IWICBitmapDecoder> decoder;
-	DX::ThrowIfFailed(m_wicImagingFactory->CreateDecoderFromFilename(
-		fileName.c_str(),
-		NULL,
-		GENERIC_READ,
-		WICDecodeMetadataCacheOnLoad, &decoder));
-
-	ComPtr<IWICBitmapFrameDecode> spSource;
-	DX::ThrowIfFailed(decoder->GetFrame(0, &spSource));
-
-	ComPtr<IWICFormatConverter> spConverter;
-	DX::ThrowIfFailed(m_wicImagingFactory->CreateFormatConverter(&spConverter));
-
-	DX::ThrowIfFailed(spConverter->Initialize(
-		spSource.Get(),
-		GUID_WICPixelFormat32bppPBGRA,
-		WICBitmapDitherTypeNone,
-		NULL,
-		0.f,
-		WICBitmapPaletteTypeMedianCut));
-
-	DX::ThrowIfFailed(spConverter->GetSize(&result.ImageWidth, &result.ImageHeight));
-
-	result.Buffer.resize(result.ImageWidth * result.ImageHeight);
-	DX::ThrowIfFailed(spConverter->CopyPixels(
-		NULL,
-		result.ImageWidth * sizeof(UINT),
-		static_cast<UINT>(result.Buffer.size()) * sizeof(UINT),
-		reinterpret_cast<BYTE*>(result.Buffer.data())));
-
-	return result;
+	const UINT64 fenceValue = m_deviceResources->GetCurrentFenceValue();
+	UINT64 offset = m_uploadRing->Allocate(size, alignment, fenceValue);
+	if (offset == DX::c_uploadRingFull)
+	{
+		ReclaimUploads();
+		offset = m_uploadRing->Allocate(size, alignment, fenceValue);
+	}
+	if (offset == DX::c_uploadRingFull)
+	{
+		CreateUploadRing((std::max)(m_uploadRing->GetCapacity() * 2, size));
+		offset = m_uploadRing->Allocate(size, alignment, fenceValue);
+	}
+
+	UploadAllocation allocation;
+	allocation.Resource = m_uploadBuffer.Get();
+	allocation.Offset = offset;
+	allocation.Data = m_mappedUploadBuffer + offset;
+	return allocation;
 }
 
-void Sample3DSceneRenderer::LoadTextureFromPngFile(std::vector<std::wstring> const& mipImageFileNames)
+// Creates the upload ring's buffer and maps it for the ring's lifetime. The buffer it replaces
+// is released once the work recorded with it so far has finished.
+void Sample3DSceneRenderer::CreateUploadRing(UINT64 capacity)
 {
-	// Precondition: images are of the correct size, from largest to smallest.
+	if (m_uploadBuffer)
+	{
+		m_uploadBuffer->Unmap(0, nullptr);
+		m_deviceResources->DeferRelease(m_uploadBuffer);
+
+		WCHAR message[64];
+		if (swprintf_s(message, L"Upload ring grown to %llu bytes\n", capacity) > 0)
+		{
+			OutputDebugStringW(message);
+		}
+	}
+
+	auto uploadHeap = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	auto uploadDesc = CD3DX12_RESOURCE_DESC::Buffer(capacity);
+	DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateCommittedResource(
+		&uploadHeap,
+		D3D12_HEAP_FLAG_NONE,
+		&uploadDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&m_uploadBuffer)));
+
+	NAME_D3D12_OBJECT(m_uploadBuffer);
+
+	CD3DX12_RANGE readRange(0, 0);		// We do not intend to read from this resource on the CPU.
+	DX::ThrowIfFailed(m_uploadBuffer->Map(0, &readRange, reinterpret_cast<void**>(&m_mappedUploadBuffer)));
+
+	m_uploadRing = std::make_unique<DX::UploadRing>(capacity);
+}
+
+// Gives back the upload space the GPU is done with.
+void Sample3DSceneRenderer::ReclaimUploads()
+{
+	m_uploadRing->Reclaim(m_deviceResources->GetCompletedFenceValue());
+}
+
+// Logs what has gone through the copy queue, and how full the allocator's heaps are.
+void Sample3DSceneRenderer::ReportUploadStatistics()
+{
+	m_uploadBatcher->Update();
+	DX::UploadStatistics const& statistics = m_uploadBatcher->GetStatistics();
+
+	WCHAR message[160];
+	if (swprintf_s(message, L"Uploaded %.2f MB on the copy queue: %llu requests, %llu copies, %llu submissions, %.0f MB/s\n",
+		statistics.Bytes / (1024.0 * 1024.0), statistics.Requests, statistics.Copies, statistics.Submissions, statistics.GetMegabytesPerSecond()) > 0)
+	{
+		OutputDebugStringW(message);
+	}
+
+	const DX::GpuAllocatorStatistics allocatorStatistics = m_gpuAllocator->GetStatistics();
+	if (swprintf_s(message, L"GPU allocator: %u heaps, %.2f MB, %.2f MB used, %.2f fragmentation\n",
+		allocatorStatistics.HeapCount, allocatorStatistics.HeapBytes / (1024.0 * 1024.0), allocatorStatistics.Heaps.UsedBytes / (1024.0 * 1024.0),
+		allocatorStatistics.Heaps.GetFragmentation()) > 0)
+	{
+		OutputDebugStringW(message);
+	}
+}
+
+std::shared_ptr<Sample3DSceneRenderer::TextureAsset> Sample3DSceneRenderer::LoadTextureFromPngFile(std::vector<std::wstring> const& mipImageFileNames, std::wstring const& cookedFileName)
+{
+	// The first image is the base level. Any further images are authored mips, used for as
+	// long as they have the expected sizes; every level after that, down to 1x1, is generated.
+	// Sizes come from the image headers, so every level's place is known before anything is
+	// decoded, and each level is decoded or generated straight into it: the cooked payload
+	// itself, which is laid out as an upload buffer, or for a compressed texture a chain of
+	// uncompressed levels laid out the same way.
+	std::vector<std::shared_ptr<PngImage>> images;
+	images.push_back(std::make_shared<PngImage>(mipImageFileNames[0]));
+	const UINT width = images[0]->Decoder.GetInfo().Width;
+	const UINT height = images[0]->Decoder.GetInfo().Height;
+	const UINT16 mipLevels = static_cast<UINT16>(DX::MipGenerator::GetLevelCount(width, height));
+	for (UINT mip = 1; mip < mipImageFileNames.size() && mip < mipLevels; ++mip)
+	{
+		auto image = std::make_shared<PngImage>(mipImageFileNames[mip]);
+		if (image->Decoder.GetInfo().Width != (std::max)(1u, width >> mip) || image->Decoder.GetInfo().Height != (std::max)(1u, height >> mip))
+		{
+			break;
+		}
+		images.push_back(image);
+	}
+	const size_t authoredMipCount = images.size();
 
-	std::vector<LoadedImageData> loadedImageDatas;
-	for (size_t i = 0; i < mipImageFileNames.size(); ++i)
+	// Block compression needs the top level to be a whole number of blocks.
+	const bool compress = c_compressTexture && width % 4 == 0 && height % 4 == 0;
+	const UINT cookFlags = c_useSrgbTexture ? DX::c_cookedTextureSrgb : 0;
+
+	// The cooked texture is also written out, so the next run can skip this.
+	std::shared_ptr<DX::CookedTextureWriter> cooker;
+	auto uncompressedLevels = std::make_shared<std::vector<BYTE>>();
+	std::vector<DX::SubresourceFootprint> levelFootprints(mipLevels);
+	if (compress)
 	{
-		loadedImageDatas.push_back(LoadImageDataFromPngFile(mipImageFileNames[i]));
+		const UINT64 size = DX::GetTextureFootprints(DX::TextureLayoutDesc{ DXGI_FORMAT_B8G8R8A8_UNORM, width, height, 1, mipLevels, false },
+			0, mipLevels, 0, levelFootprints.data());
+		uncompressedLevels->resize(static_cast<size_t>(size));
 	}
+	else
+	{
+		cooker = std::make_shared<DX::CookedTextureWriter>(DX::CookedTextureFormat::Bgra8, width, height, mipLevels, cookFlags);
+	}
+	auto getLevel = [&](UINT mip, size_t& rowPitch) -> BYTE*
+	{
+		if (compress)
+		{
+			rowPitch = levelFootprints[mip].RowPitch;
+			return uncompressedLevels->data() + levelFootprints[mip].Offset;
+		}
+		rowPitch = cooker->GetMip(mip).RowPitch;
+		return cooker->GetMipData(mip);
+	};
 
+	// Decode all the images at once on the worker threads. Each one holds on to the memory it
+	// decodes into, in case this throws before it has finished.
+	std::shared_ptr<void> levels = compress ? std::shared_ptr<void>(uncompressedLevels) : std::shared_ptr<void>(cooker);
+	std::vector<std::future<double>> pendingImages;
+	for (UINT mip = 0; mip < authoredMipCount; ++mip)
+	{
+		size_t rowPitch;
+		BYTE* destination = getLevel(mip, rowPitch);
+		std::shared_ptr<PngImage> image = images[mip];
+		pendingImages.push_back(m_threadPool.Submit([image, levels, destination, rowPitch]()
+		{
+			auto decodeStart = std::chrono::steady_clock::now();
+			image->Decoder.Decode(destination, rowPitch);
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - decodeStart).count();
+		}));
+	}
+	std::vector<double> levelMilliseconds(mipLevels);
+	levelMilliseconds[0] = pendingImages[0].get();
+
+	// The format is picked from the base level, which has alpha wherever any other level does.
+	size_t baseRowPitch;
+	const BYTE* baseLevel = getLevel(0, baseRowPitch);
+	DX::BlockCompressor compressor(
+		compress ? DX::BlockCompressor::ChooseFormat(baseLevel, width, height, baseRowPitch) : DX::BlockFormat::BC1,
+		c_textureCompressionQuality);
+	if (compress)
+	{
+		cooker = std::make_shared<DX::CookedTextureWriter>(GetCookedFormat(compressor.GetFormat()), width, height, mipLevels, cookFlags);
+	}
+
+	// Filter in linear light so that averaging doesn't darken the texture.
+	DX::MipGenerator mipGenerator(DX::MipFilter::Box, c_useSrgbTexture ? DX::MipColorSpace::Srgb : DX::MipColorSpace::Linear);
+	size_t compressedBytes = 0;
+
+	for (UINT currentMipLevel = 0; currentMipLevel < mipLevels; ++currentMipLevel)
+	{
+		size_t rowPitch;
+		BYTE* level = getLevel(currentMipLevel, rowPitch);
+		const UINT levelWidth = (std::max)(1u, width >> currentMipLevel);
+		const UINT levelHeight = (std::max)(1u, height >> currentMipLevel);
+
+		if (currentMipLevel < authoredMipCount)
+		{
+			if (currentMipLevel > 0)
+			{
+				levelMilliseconds[currentMipLevel] = pendingImages[currentMipLevel].get();
+			}
+
+			// Generation continues from the last authored level. For an sRGB texture the authored
+			// levels also have to be re-encoded, since they are premultiplied in gamma space.
+			mipGenerator.SetSource(level, levelWidth, levelHeight, rowPitch);
+			if (c_useSrgbTexture)
+			{
+				mipGenerator.WriteCurrentLevel(level, rowPitch);
+			}
+		}
+		else
+		{
+			auto generateStart = std::chrono::steady_clock::now();
+			mipGenerator.GenerateNextLevel(level, rowPitch);
+			levelMilliseconds[currentMipLevel] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - generateStart).count();
+		}
+
+		if (compress)
+		{
+			// Each level is split into bands of blocks across the worker threads, and compressed
+			// into its place in the payload.
+			DX::CookedTextureMip const& layout = cooker->GetMip(currentMipLevel);
+			for (auto& band : compressor.CompressAsync(m_threadPool, level, levelWidth, levelHeight, rowPitch, cooker->GetMipData(currentMipLevel), layout.RowPitch))
+			{
+				band.get();
+			}
+			compressedBytes += static_cast<size_t>(layout.RowSize) * layout.RowCount;
+		}
+	}
+
+	// Report how long each level took to decode or generate.
+	for (UINT mip = 0; mip < mipLevels; ++mip)
+	{
+		WCHAR message[MAX_PATH + 64];
+		if (swprintf_s(message, L"%s mip %u (%ux%u) in %.2f ms\n", mip < authoredMipCount ? mipImageFileNames[mip].c_str() : L"Generated", mip,
+			(std::max)(1u, width >> mip), (std::max)(1u, height >> mip), levelMilliseconds[mip]) > 0)
+		{
+			OutputDebugStringW(message);
+		}
+	}
+	if (compress)
+	{
+		WCHAR message[64];
+		if (swprintf_s(message, L"Block-compressed mip chain to %zu bytes\n", compressedBytes) > 0)
+		{
+			OutputDebugStringW(message);
+		}
+	}
+
+	DX::CookedTextureHeader& header = cooker->GetHeader();
+	if (!cookedFileName.empty())
+	{
+		header.CookSettings = GetCookSettings();
+		GetFileStamp(mipImageFileNames[0], header.SourceSize, header.SourceModifiedTime);
+		try
+		{
+			cooker->Write(cookedFileName);
+		}
+		catch (DX::CookedTextureError const& error)
+		{
+			// Cooking only saves time on the next run, so carry on without it.
+			OutputDebugStringA(error.what());
+			OutputDebugStringA("\n");
+		}
+	}
+
+	return std::make_shared<TextureAsset>(TextureAsset{ header, std::vector<DX::CookedTextureMip>(&cooker->GetMip(0), &cooker->GetMip(0) + mipLevels), cooker->GetPayload(), cooker });
+}
+
+// The texture is only read or cooked once. A renderer created for a new device after the old
+// one was removed finds it in the asset cache, and only has to upload it.
+void Sample3DSceneRenderer::LoadTexture(std::vector<std::wstring> const& mipImageFileNames)
+{
+	std::wstring assetName = L"Texture";
+	for (std::wstring const& fileName : mipImageFileNames)
+	{
+		assetName += L"|" + fileName;
+	}
+
+	auto texture = m_assetCache->GetOrCreate<TextureAsset>(assetName, [&]() { return ReadTexture(mipImageFileNames); });
+	UploadTexture(texture->Header, texture->Mips.data(), texture->Payload, texture);
+}
+
+std::shared_ptr<Sample3DSceneRenderer::TextureAsset> Sample3DSceneRenderer::ReadTexture(std::vector<std::wstring> const& mipImageFileNames)
+{
+	auto loadStart = std::chrono::steady_clock::now();
+
+	// The cooked texture sits next to the base image, and is only used if it was cooked from
+	// the same file with the same settings.
+	std::wstring cookedFileName = mipImageFileNames[0].substr(0, mipImageFileNames[0].find_last_of(L'.')) + L".ctex";
+
+	std::shared_ptr<TextureAsset> texture;
+	UINT64 sourceSize;
+	UINT64 sourceModifiedTime;
+	if (GetFileStamp(mipImageFileNames[0], sourceSize, sourceModifiedTime) &&
+		GetFileAttributesW(cookedFileName.c_str()) != INVALID_FILE_ATTRIBUTES)
+	{
+		try
+		{
+			auto cookedTexture = std::make_shared<DX::CookedTexture>(cookedFileName);
+			DX::CookedTextureHeader const& header = cookedTexture->GetHeader();
+			if (header.SourceSize == sourceSize && header.SourceModifiedTime == sourceModifiedTime && header.CookSettings == GetCookSettings())
+			{
+				texture = std::make_shared<TextureAsset>(TextureAsset{ header,
+					std::vector<DX::CookedTextureMip>(&cookedTexture->GetMip(0), &cookedTexture->GetMip(0) + header.MipCount), cookedTexture->GetPayload(), cookedTexture });
+			}
+		}
+		catch (DX::CookedTextureError const& error)
+		{
+			OutputDebugStringA(error.what());
+			OutputDebugStringA("\n");
+		}
+	}
+
+	const bool cooked = texture != nullptr;
+	if (!cooked)
+	{
+		texture = LoadTextureFromPngFile(mipImageFileNames, cookedFileName);
+	}
+
+	WCHAR message[MAX_PATH + 64];
+	if (swprintf_s(message, L"Loaded %s in %.2f ms\n", cooked ? cookedFileName.c_str() : mipImageFileNames[0].c_str(),
+		std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count()) > 0)
+	{
+		OutputDebugStringW(message);
+	}
+	return texture;
+}
+
+// The payload is already laid out as placed footprints, so the levels uploaded now are
+// copied into the upload buffer with one memcpy, and every level is copied from there. In
+// progressive mode that is only the levels of c_progressiveFirstMipSize texels and smaller,
+// or for a reserved texture the levels that fit in a single tile; StreamTexture copies in the
+// rest over the following frames, and payloadOwner keeps the payload alive while it does.
+void Sample3DSceneRenderer::UploadTexture(DX::CookedTextureHeader const& header, DX::CookedTextureMip const* mips, const UINT8* payload, std::shared_ptr<const void> const& payloadOwner)
+{
+	const DX::CookedTextureFormat cookedFormat = static_cast<DX::CookedTextureFormat>(header.Format);
+	m_textureMips.assign(mips, mips + header.MipCount);
+
+	UINT firstMip = 0;
+	UINT tileWidth;
+	UINT tileHeight;
+	if (c_progressiveTexture && c_virtualTexture && m_supportsTiledResources)
+	{
+		CreateReservedTexture(cookedFormat, header.Width, header.Height, static_cast<UINT16>(header.MipCount));
+		tileWidth = m_virtualTexture->GetLayout().TileWidth;
+		tileHeight = m_virtualTexture->GetLayout().TileHeight;
+
+		// The packed mips are mapped already. Map the single-tile mips above them as well;
+		// they are the residency manager's tail, which it never evicts.
+		firstMip = m_virtualTexture->GetLayout().StandardMipCount;
+		while (firstMip > 0 && m_virtualTexture->GetTileCountX(firstMip - 1) == 1 && m_virtualTexture->GetTileCountY(firstMip - 1) == 1)
+		{
+			--firstMip;
+			m_virtualTexture->Map(firstMip, 0, 0);
+		}
+		m_virtualTexture->Flush();
+	}
+	else
+	{
+		CreateTexture(cookedFormat, header.Width, header.Height, static_cast<UINT16>(header.MipCount));
+		GetTileShape(cookedFormat, tileWidth, tileHeight);
+
+		if (c_progressiveTexture)
+		{
+			while (firstMip + 1 < header.MipCount && (std::max)(header.Width >> firstMip, header.Height >> firstMip) > c_progressiveFirstMipSize)
+			{
+				++firstMip;
+			}
+		}
+	}
+
+	// The levels uploaded now are planned into one block of upload space. Offsets are 512-byte
+	// aligned, so when the payload is placed the same way it is copied in from the first
+	// uploaded level on; a payload placed any other way is repacked level by level.
+	const D3D12_RESOURCE_DESC textureDesc = m_texture->GetDesc();
+	m_uploadPlan.Clear();
+	m_uploadPlan.AddTexture(DX::TextureLayoutDesc{ static_cast<uint32_t>(textureDesc.Format), header.Width, header.Height, 1, header.MipCount, false },
+		firstMip, header.MipCount - firstMip);
+	const DX::SubresourceFootprint* footprints = m_uploadPlan.GetFootprints(0);
+
+	UploadAllocation upload = AllocateUpload(m_uploadPlan.GetSize(), D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+	if (IsPayloadPlacedAs(footprints, mips, firstMip, header.MipCount))
+	{
+		const size_t uploadSize = static_cast<size_t>(m_uploadPlan.GetSize());
+		DX::CopyRows(upload.Data, uploadSize, payload + mips[firstMip].Offset, uploadSize, uploadSize, 1, true);
+	}
+	else
+	{
+		for (UINT mip = firstMip; mip < header.MipCount; ++mip)
+		{
+			DX::SubresourceFootprint const& footprint = footprints[mip - firstMip];
+			DX::CopyRows(upload.Data + footprint.Offset, footprint.RowPitch, payload + mips[mip].Offset, mips[mip].RowPitch,
+				static_cast<size_t>(footprint.RowSize), footprint.RowCount, true);
+		}
+	}
+
+#if defined(_DEBUG)
+	// Looking the texture up checks the plan's footprints against the device's.
+	m_footprintCache->GetLayout(textureDesc);
+#endif
+
+	m_uploadCopies.clear();
+	void* destinations[] = { m_texture.Get() };
+	m_uploadPlan.GetCopies(destinations, upload.Resource, upload.Offset, m_uploadCopies);
+	if (m_virtualTexture)
+	{
+		DX::RecordCopies(m_commandList.Get(), m_uploadCopies.data(), m_uploadCopies.size());
+
+		// Tiles are filled in place, so a mip is only taken back to the copy state while
+		// tiles of it are being written.
+		CD3DX12_RESOURCE_BARRIER resourceBarrier =
+			CD3DX12_RESOURCE_BARRIER::Transition(m_texture.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		m_commandList->ResourceBarrier(1, &resourceBarrier);
+	}
+	else
+	{
+		for (DX::CopyRequest const& copy : m_uploadCopies)
+		{
+			m_uploadBatcher->Enqueue(copy);
+		}
+	}
+
+	m_residentMip = firstMip;
+	m_tailMip = firstMip;
+	m_streamingTargetMip = firstMip;
+	m_streamingRow = 0;
+	if (firstMip > 0)
+	{
+		m_streamingPayload = payload;
+		m_streamingSource = payloadOwner;
+
+		// A frame always copies at least one row of the largest level, or one tile.
+		m_streamingUploadSize = (std::max)(static_cast<UINT64>(c_streamingBytesPerFrame), static_cast<UINT64>(D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES));
+		for (UINT mip = 0; mip < firstMip; ++mip)
+		{
+			m_streamingUploadSize = (std::max)(m_streamingUploadSize, static_cast<UINT64>(mips[mip].RowPitch));
+		}
+
+		// Feedback regions are tile-sized, which is as fine as the residency manager works.
+		m_feedbackEmulator = std::make_unique<DX::FeedbackEmulator>(header.Width, header.Height, header.MipCount, tileWidth, tileHeight);
+		m_residencyManager = std::make_unique<DX::ResidencyManager>(header.Width, header.Height, header.MipCount, tileWidth, tileHeight,
+			D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES, c_textureResidencyBudget);
+	}
+
+	for (UINT n = 0; n < DX::c_frameCount; n++)
+	{
+		CreateTextureView(n);
+	}
+}
+
+// Creates m_texture in the common state. It is written on the copy queue and read by the
+// pixel shader, both of which promote it from there, and decays back to it after each.
+void Sample3DSceneRenderer::CreateTexture(DX::CookedTextureFormat format, UINT width, UINT height, UINT16 mipLevels)
+{
 	D3D12_RESOURCE_DESC resourceDesc{};
 	resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-	resourceDesc.Width = loadedImageDatas[0].ImageWidth;
-	resourceDesc.Height = loadedImageDatas[0].ImageHeight;
-	resourceDesc.MipLevels = static_cast<UINT>(loadedImageDatas.size());
+	resourceDesc.Width = width;
+	resourceDesc.Height = height;
+	resourceDesc.MipLevels = mipLevels;
 	resourceDesc.DepthOrArraySize = 1;
-	resourceDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+	resourceDesc.Format = GetTextureFormat(format);
 	resourceDesc.SampleDesc.Count = 1;
 	resourceDesc.SampleDesc.Quality = 0;
 
-	auto defaultHeap = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-	
-	DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateCommittedResource(
-		&defaultHeap,
-		D3D12_HEAP_FLAG_NONE,
+	m_texture = m_gpuAllocator->CreateResource(resourceDesc, D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_STATE_COMMON).Resource;
+}
+
+// Creates m_texture as a reserved resource in the copy destination state, with a heap and a
+// page table for its tiles. The heap holds c_textureResidencyBudget bytes of tiles, plus the
+// tiles that stay resident, however large the texture is.
+void Sample3DSceneRenderer::CreateReservedTexture(DX::CookedTextureFormat format, UINT width, UINT height, UINT16 mipLevels)
+{
+	auto d3dDevice = m_deviceResources->GetD3DDevice();
+
+	D3D12_RESOURCE_DESC resourceDesc{};
+	resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	resourceDesc.Width = width;
+	resourceDesc.Height = height;
+	resourceDesc.MipLevels = mipLevels;
+	resourceDesc.DepthOrArraySize = 1;
+	resourceDesc.Format = GetTextureFormat(format);
+	resourceDesc.SampleDesc.Count = 1;
+	resourceDesc.SampleDesc.Quality = 0;
+	resourceDesc.Layout = D3D12_TEXTURE_LAYOUT_64KB_UNDEFINED_SWIZZLE;
+
+	DX::ThrowIfFailed(d3dDevice->CreateReservedResource(
 		&resourceDesc,
 		D3D12_RESOURCE_STATE_COPY_DEST,
 		nullptr,
 		IID_PPV_ARGS(&m_texture)));
 
+	UINT tileCount;
+	D3D12_PACKED_MIP_INFO packedMipInfo;
+	D3D12_TILE_SHAPE tileShape;
+	UINT subresourceTilingCount = 0;
+	d3dDevice->GetResourceTiling(m_texture.Get(), &tileCount, &packedMipInfo, &tileShape, &subresourceTilingCount, 0, nullptr);
+
+	DX::VirtualTextureLayout layout;
+	layout.Width = width;
+	layout.Height = height;
+	layout.MipCount = mipLevels;
+	layout.TileWidth = tileShape.WidthInTexels;
+	layout.TileHeight = tileShape.HeightInTexels;
+	layout.StandardMipCount = packedMipInfo.NumStandardMips;
+	layout.PackedTileCount = packedMipInfo.NumTilesForPackedMips;
+
+	// At most one tile per standard mip stays resident besides the packed ones.
+	const UINT heapTileCount = (std::min)(tileCount,
+		static_cast<UINT>(c_textureResidencyBudget / D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES) + layout.StandardMipCount + layout.PackedTileCount);
+
+	CD3DX12_HEAP_DESC heapDesc(static_cast<UINT64>(heapTileCount) * D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES, D3D12_HEAP_TYPE_DEFAULT, 0,
+		D3D12_HEAP_FLAG_DENY_BUFFERS | D3D12_HEAP_FLAG_DENY_RT_DS_TEXTURES);
+	DX::ThrowIfFailed(d3dDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&m_tileHeap)));
+
+	m_tilePool = std::make_unique<DX::PhysicalTilePool>(heapTileCount);
+	m_tileMappingBackend = std::make_unique<QueueTileMappingBackend>(m_deviceResources->GetCommandQueue(), m_texture.Get(), m_tileHeap.Get());
+	m_virtualTexture = std::make_unique<DX::VirtualTexture>(layout, *m_tilePool, *m_tileMappingBackend);
+}
+
+// Creates the texture view for a frame, covering the mips that are resident. Each frame has
+// its own view, so it can be widened while frames that use a narrower one are in flight.
+void Sample3DSceneRenderer::CreateTextureView(UINT frameIndex)
+{
 	CD3DX12_CPU_DESCRIPTOR_HANDLE cpuHandle(m_cbv_srv_Heap->GetCPUDescriptorHandleForHeapStart());
-	cpuHandle.Offset(DX::c_frameCount, m_cbvDescriptorSize);
-	
+	cpuHandle.Offset(DX::c_frameCount + frameIndex, m_cbvDescriptorSize);
+
+	D3D12_RESOURCE_DESC resourceDesc = m_texture->GetDesc();
+
 	// Describe and create a SRV for the texture.
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 	srvDesc.Format = resourceDesc.Format;
 	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MipLevels = resourceDesc.MipLevels;
+	srvDesc.Texture2D.MostDetailedMip = m_residentMip;
+	srvDesc.Texture2D.MipLevels = resourceDesc.MipLevels - m_residentMip;
+	srvDesc.Texture2D.ResourceMinLODClamp = static_cast<float>(m_residentMip);
 	m_deviceResources->GetD3DDevice()->CreateShaderResourceView(m_texture.Get(), &srvDesc, cpuHandle);
 
-	for (int currentMipLevel = 0; currentMipLevel < loadedImageDatas.size(); ++currentMipLevel)
+	m_textureViewMips[frameIndex] = m_residentMip;
+}
+
+// Records copies of the next rows of the texture that aren't resident yet, up to
+// c_streamingBytesPerFrame, as far as m_streamingTargetMip. A mip becomes the resident mip
+// once all of its rows have been copied; until then no view includes it, so the copy queue
+// can write it while earlier frames are still drawing.
+void Sample3DSceneRenderer::StreamTexture()
+{
+	if (m_virtualTexture)
 	{
-		const UINT64 uploadBufferSize = GetRequiredIntermediateSize(m_texture.Get(), currentMipLevel, 1);
+		if (m_streamingSource)
+		{
+			StreamTiles();
+		}
+		return;
+	}
 
-		auto uploadHeap = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-		auto uploadDesc = CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize);
+	if (m_residentMip <= m_streamingTargetMip || !m_streamingSource)
+	{
+		return;
+	}
 
-		ComPtr<ID3D12Resource> upload;
-		DX::ThrowIfFailed(m_deviceResources->GetD3DDevice()->CreateCommittedResource(
-			&uploadHeap,
-			D3D12_HEAP_FLAG_NONE,
-			&uploadDesc,
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&upload)));
+	const DXGI_FORMAT format = m_texture->GetDesc().Format;
 
-		D3D12_SUBRESOURCE_DATA initialData{};
-		initialData.pData = loadedImageDatas[currentMipLevel].Buffer.data();
-		initialData.RowPitch = loadedImageDatas[currentMipLevel].ImageWidth * 4;
-		initialData.SlicePitch = loadedImageDatas[currentMipLevel].ImageWidth * loadedImageDatas[currentMipLevel].ImageHeight * 4;
-		UpdateSubresources(m_commandList.Get(), m_texture.Get(), upload.Get(), 0, currentMipLevel, 1, &initialData);
+	UINT64 uploadedBytes = 0;
+	while (m_residentMip > m_streamingTargetMip)
+	{
+		const UINT mip = m_residentMip - 1;
+		DX::CookedTextureMip const& layout = m_textureMips[mip];
+		const UINT texelsPerRow = layout.Height / layout.RowCount;
+
+		if (uploadedBytes + layout.RowPitch > m_streamingUploadSize)
+		{
+			break;
+		}
+		const UINT rowCount = static_cast<UINT>((std::min)(static_cast<UINT64>(layout.RowCount - m_streamingRow), (m_streamingUploadSize - uploadedBytes) / layout.RowPitch));
+		const UINT64 copySize = static_cast<UINT64>(rowCount) * layout.RowPitch;
 
-		m_uploads.push_back(upload);
+		UploadAllocation upload = AllocateUpload(copySize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+		DX::CopyRows(upload.Data, layout.RowPitch, m_streamingPayload + layout.Offset + static_cast<UINT64>(m_streamingRow) * layout.RowPitch,
+			layout.RowPitch, layout.RowPitch, rowCount, true);
+
+		m_uploadBatcher->Enqueue(DX::MakeTextureCopy(m_texture.Get(), mip, 0, m_streamingRow * texelsPerRow, upload.Resource, upload.Offset,
+			format, layout.Width, rowCount * texelsPerRow, layout.RowPitch, rowCount));
+
+		uploadedBytes += copySize;
+		m_streamingRow += rowCount;
+		if (m_streamingRow == layout.RowCount)
+		{
+			m_residentMip = mip;
+			m_streamingRow = 0;
+		}
+	}
+
+	if (m_residentMip == 0)
+	{
+		// Everything has been copied out of the payload.
+		m_streamingPayload = nullptr;
+		m_streamingSource = nullptr;
+		ReportUploadStatistics();
 	}
+}
+
+// Counts the frames drawn coarser than the streaming target, and reports how many once
+// streaming catches up with it. This runs after StreamTexture on either path: for a
+// committed texture the target is the finest mip the residency manager has loaded a tile
+// of, and for a reserved texture the finest mip the last feedback asked for, with the
+// resident mip the one sampleable everywhere it asked.
+void Sample3DSceneRenderer::ReportStreamingProgress()
+{
+	if (m_residentMip > m_streamingTargetMip)
+	{
+		++m_reducedDetailFrameCount;
+		return;
+	}
+	if (m_reducedDetailFrameCount == 0)
+	{
+		return;
+	}
+
+	WCHAR message[96];
+	if (swprintf_s(message, L"Texture resident to mip %u after %llu frames at reduced detail\n", m_residentMip, m_reducedDetailFrameCount) > 0)
+	{
+		OutputDebugStringW(message);
+	}
+	m_reducedDetailFrameCount = 0;
+}
+
+// Maps the tiles the residency manager has asked for and copies them in, up to
+// c_streamingBytesPerFrame, then clamps the texture view to what is resident wherever the
+// cube samples it.
+void Sample3DSceneRenderer::StreamTiles()
+{
+	// UpdateTileMappings is ordered on the queue with the command lists, so tiles are backed
+	// before this frame's copies, and evicted tiles are unmapped only after earlier frames
+	// have finished sampling them.
+	m_virtualTexture->Flush();
+
+	const DXGI_FORMAT format = m_texture->GetDesc().Format;
+	DX::VirtualTextureLayout const& tiling = m_virtualTexture->GetLayout();
+
+	std::vector<CD3DX12_RESOURCE_BARRIER> resourceBarriers;
+	UINT copyingMips = 0;
+	UINT64 uploadedBytes = 0;
+	size_t uploadedCount = 0;
+	for (; uploadedCount < m_pendingTileLoads.size(); ++uploadedCount)
+	{
+		DX::ResidencyTile const& tile = m_pendingTileLoads[uploadedCount];
+		DX::CookedTextureMip const& layout = m_textureMips[tile.Mip];
+		const UINT texelsPerRow = layout.Height / layout.RowCount;
+		const UINT bytesPerBlock = layout.RowSize / (layout.Width / texelsPerRow);
+
+		// The tile, clipped to the mip.
+		const UINT left = tile.X * tiling.TileWidth;
+		const UINT top = tile.Y * tiling.TileHeight;
+		const UINT width = (std::min)(tiling.TileWidth, layout.Width - left);
+		const UINT height = (std::min)(tiling.TileHeight, layout.Height - top);
+		const UINT rowSize = width / texelsPerRow * bytesPerBlock;
+		const UINT rowPitch = (rowSize + D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1) & ~(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1);
+		const UINT rowCount = height / texelsPerRow;
+		const UINT64 copySize = static_cast<UINT64>(rowPitch) * rowCount;
+
+		if (uploadedBytes + copySize > m_streamingUploadSize)
+		{
+			break;
+		}
+
+		UploadAllocation upload = AllocateUpload(copySize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+		const UINT8* source = m_streamingPayload + layout.Offset + static_cast<UINT64>(top / texelsPerRow) * layout.RowPitch + left / texelsPerRow * bytesPerBlock;
+		DX::CopyRows(upload.Data, rowPitch, source, layout.RowPitch, rowSize, rowCount, true);
+
+		if ((copyingMips & (1u << tile.Mip)) == 0)
+		{
+			copyingMips |= 1u << tile.Mip;
+			resourceBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(m_texture.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST, tile.Mip));
+			m_commandList->ResourceBarrier(1, &resourceBarriers.back());
+		}
+
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint{};
+		footprint.Offset = upload.Offset;
+		footprint.Footprint = CD3DX12_SUBRESOURCE_FOOTPRINT(format, width, height, 1, rowPitch);
+
+		CD3DX12_TEXTURE_COPY_LOCATION destination(m_texture.Get(), tile.Mip);
+		CD3DX12_TEXTURE_COPY_LOCATION source(upload.Resource, footprint);
+		m_commandList->CopyTextureRegion(&destination, left, top, 0, &source, nullptr);
+
+		uploadedBytes += copySize;
+
+		// The copy is ahead of the draw in this command list, so the tile can be sampled now.
+		m_residencyManager->CompleteLoad(tile);
+	}
+	m_pendingTileLoads.erase(m_pendingTileLoads.begin(), m_pendingTileLoads.begin() + uploadedCount);
+
+	for (CD3DX12_RESOURCE_BARRIER& resourceBarrier : resourceBarriers)
+	{
+		std::swap(resourceBarrier.Transition.StateBefore, resourceBarrier.Transition.StateAfter);
+	}
+	if (!resourceBarriers.empty())
+	{
+		m_commandList->ResourceBarrier(static_cast<UINT>(resourceBarriers.size()), resourceBarriers.data());
+	}
+
+	const UINT lastMip = static_cast<UINT>(m_textureMips.size()) - 1;
+	m_residentMip = (std::min)(m_residencyManager->GetSampleableMip(), lastMip);
+	m_streamingTargetMip = (std::min)(m_residencyManager->GetFinestRequestedMip(), lastMip);
+}
+
+// Emulates this frame's sampler feedback and hands it to the residency manager. A reserved
+// texture maps the tiles the manager loads and unmaps the ones it evicts; StreamTiles fills
+// them. A committed texture streams in whole mips instead: the finest mip the manager has
+// loaded a tile of becomes the streaming target, a load completes once its mip is resident,
+// and evictions are ignored since nothing can be given back.
+void Sample3DSceneRenderer::UpdateTextureResidency()
+{
+	XMMATRIX modelViewProjection =
+		XMMatrixTranspose(XMLoadFloat4x4(&m_constantBufferData.model)) *
+		XMMatrixTranspose(XMLoadFloat4x4(&m_constantBufferData.view)) *
+		XMMatrixTranspose(XMLoadFloat4x4(&m_constantBufferData.projection));
+
+	// The vertices as the input assembler reads them, to go with the model matrix.
+	m_feedbackVertices.resize(m_cubeMesh->Vertices.size());
+	for (size_t i = 0; i < m_cubeMesh->Vertices.size(); ++i)
+	{
+		XMFLOAT3 position = m_cubeMesh->Vertices[i].pos;
+		XMFLOAT2 uv = m_cubeMesh->Vertices[i].uv;
+		if (c_quantizeVertices)
+		{
+			DX::DecodeVertex(m_cubeMesh->Quantized, m_cubeMesh->Quantized.Vertices[i], &position.x, &uv.x);
+		}
+
+		XMFLOAT4 clipPosition;
+		XMStoreFloat4(&clipPosition, XMVector3Transform(XMLoadFloat3(&position), modelViewProjection));
 
-	CD3DX12_RESOURCE_BARRIER resourceBarrier =
-		CD3DX12_RESOURCE_BARRIER::Transition(m_texture.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-	m_commandList->ResourceBarrier(1, &resourceBarrier);
+		DX::FeedbackVertex& vertex = m_feedbackVertices[i];
+		vertex.ClipPosition[0] = clipPosition.x;
+		vertex.ClipPosition[1] = clipPosition.y;
+		vertex.ClipPosition[2] = clipPosition.z;
+		vertex.ClipPosition[3] = clipPosition.w;
+		vertex.UV[0] = uv.x;
+		vertex.UV[1] = uv.y;
+	}
+
+	D3D12_VIEWPORT viewport = m_deviceResources->GetScreenViewport();
+	m_feedbackEmulator->Clear();
+	m_feedbackEmulator->AddTriangles(m_feedbackVertices.data(), m_cubeMesh->Indices.data(), m_cubeMesh->Indices.size(), viewport.Width, viewport.Height);
+
+	DX::ResidencyUpdate const& update = m_residencyManager->Update(m_feedbackEmulator->GetMap());
+	if (m_virtualTexture)
+	{
+		for (DX::ResidencyTile const& eviction : update.Evictions)
+		{
+			m_virtualTexture->Unmap(eviction.Mip, eviction.X, eviction.Y);
+		}
+
+		// The tail was mapped and uploaded with the texture.
+		for (DX::ResidencyTile const& load : update.Loads)
+		{
+			if (load.Mip < m_tailMip)
+			{
+				m_virtualTexture->Map(load.Mip, load.X, load.Y);
+				m_pendingTileLoads.push_back(load);
+			}
+			else
+			{
+				m_residencyManager->CompleteLoad(load);
+			}
+		}
+		return;
+	}
+
+	for (DX::ResidencyTile const& load : update.Loads)
+	{
+		m_streamingTargetMip = (std::min)(m_streamingTargetMip, load.Mip);
+		m_pendingTileLoads.push_back(load);
+	}
+
+	auto landed = std::remove_if(m_pendingTileLoads.begin(), m_pendingTileLoads.end(), [this](DX::ResidencyTile const& load)
+	{
+		if (load.Mip < m_residentMip)
+		{
+			return false;
+		}
+		m_residencyManager->CompleteLoad(load);
+		return true;
+	});
+	m_pendingTileLoads.erase(landed, m_pendingTileLoads.end());
+}
+
+// The standard 64KB tile shapes, which are the same for the sRGB formats.
+void Sample3DSceneRenderer::GetTileShape(DX::CookedTextureFormat format, UINT& width, UINT& height)
+{
+	switch (format)
+	{
+	case DX::CookedTextureFormat::BC1: width = 512; height = 256; break;
+	case DX::CookedTextureFormat::BC3:
+	case DX::CookedTextureFormat::BC7: width = 256; height = 256; break;
+	default: width = 128; height = 128; break;
+	}
+}
+
+DXGI_FORMAT Sample3DSceneRenderer::GetTextureFormat(DX::CookedTextureFormat format)
+{
+	switch (format)
+	{
+	case DX::CookedTextureFormat::BC1: return c_useSrgbTexture ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+	case DX::CookedTextureFormat::BC3: return c_useSrgbTexture ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+	case DX::CookedTextureFormat::BC7: return c_useSrgbTexture ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+	default: return c_useSrgbTexture ? DXGI_FORMAT_B8G8R8A8_UNORM_SRGB : DXGI_FORMAT_B8G8R8A8_UNORM;
+	}
+}
+
+DX::CookedTextureFormat Sample3DSceneRenderer::GetCookedFormat(DX::BlockFormat blockFormat)
+{
+	switch (blockFormat)
+	{
+	case DX::BlockFormat::BC1: return DX::CookedTextureFormat::BC1;
+	case DX::BlockFormat::BC3: return DX::CookedTextureFormat::BC3;
+	default: return DX::CookedTextureFormat::BC7;
+	}
+}
+
+// Identifies the options that affect cooked output, so that changing one re-cooks.
+UINT Sample3DSceneRenderer::GetCookSettings()
+{
+	return (c_useSrgbTexture ? 1 : 0) | (c_compressTexture ? 2 : 0) | (static_cast<UINT>(c_textureCompressionQuality) << 2);
+}
+
+bool Sample3DSceneRenderer::GetFileStamp(std::wstring const& fileName, UINT64& size, UINT64& modifiedTime)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExW(fileName.c_str(), GetFileExInfoStandard, &attributes))
+	{
+		size = 0;
+		modifiedTime = 0;
+		return false;
+	}
+
+	size = (static_cast<UINT64>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+	modifiedTime = (static_cast<UINT64>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+	return true;
 }
 
 void Sample3DSceneRenderer::OnKeyUp(WPARAM wParam)
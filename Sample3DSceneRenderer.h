@@ -1,8 +1,22 @@
 ﻿#pragma once
 
+#include "Common\AssetCache.h"
+#include "Common\BlockCompressor.h"
+#include "Common\CookedTexture.h"
+#include "Common\CopyQueue.h"
 #include "Common\DeviceResources.h"
+#include "Common\FeedbackEmulator.h"
+#include "Common\GpuAllocator.h"
+#include "Common\IndexBuffer.h"
+#include "Common\ResidencyManager.h"
 #include "ShaderStructures.h"
 #include "Common\StepTimer.h"
+#include "Common\SubresourceUpload.h"
+#include "Common\TextureUploadPlan.h"
+#include "Common\ThreadPool.h"
+#include "Common\UploadRing.h"
+#include "Common\VertexQuantizer.h"
+#include "Common\VirtualTexture.h"
 
 using namespace Microsoft::WRL;
 
@@ -12,7 +26,7 @@ namespace SpinningCube
 	class Sample3DSceneRenderer
 	{
 	public:
-		Sample3DSceneRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources);
+		Sample3DSceneRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources, const std::shared_ptr<DX::AssetCache>& assetCache);
 		~Sample3DSceneRenderer();
 		void CreateDeviceDependentResources();
 		void CreateWindowSizeDependentResources();
@@ -23,30 +37,121 @@ namespace SpinningCube
 	private:
 		void Rotate(float radians);
 
-		struct LoadedImageData
+		// Space in the upload ring, read by the work recorded this frame.
+		struct UploadAllocation
 		{
-			UINT ImageWidth;
-			UINT ImageHeight;
-			std::vector<UINT> Buffer;
+			ID3D12Resource*	Resource;
+			UINT64			Offset;
+			UINT8*			Data;
 		};
-		LoadedImageData LoadImageDataFromPngFile(std::wstring fileName);
-		void LoadTextureFromPngFile(std::vector<std::wstring> const& mipImageFileNames);
+		UploadAllocation AllocateUpload(UINT64 size, UINT64 alignment);
+		void CreateUploadRing(UINT64 capacity);
+		void ReclaimUploads();
+		void ReportUploadStatistics();
+
+		// Device-independent assets, kept in the asset cache across device removal.
+		struct MeshAsset
+		{
+			std::vector<VertexPositionTex>	Vertices;
+			std::vector<uint32_t>			Indices;	// For the feedback emulator.
+			DX::IndexBuffer					IndexBuffer;
+			DX::QuantizedMesh				Quantized;	// Empty unless c_quantizeVertices.
+		};
+		struct TextureAsset
+		{
+			DX::CookedTextureHeader				Header;
+			std::vector<DX::CookedTextureMip>	Mips;
+			const UINT8*						Payload;
+			std::shared_ptr<const void>			PayloadOwner;	// Keeps the payload alive.
+		};
+		static std::shared_ptr<MeshAsset> CreateCubeMesh();
+
+		void LoadTexture(std::vector<std::wstring> const& mipImageFileNames);
+		std::shared_ptr<TextureAsset> ReadTexture(std::vector<std::wstring> const& mipImageFileNames);
+		std::shared_ptr<TextureAsset> LoadTextureFromPngFile(std::vector<std::wstring> const& mipImageFileNames, std::wstring const& cookedFileName);
+		void UploadTexture(DX::CookedTextureHeader const& header, DX::CookedTextureMip const* mips, const UINT8* payload, std::shared_ptr<const void> const& payloadOwner);
+		void CreateTexture(DX::CookedTextureFormat format, UINT width, UINT height, UINT16 mipLevels);
+		void CreateReservedTexture(DX::CookedTextureFormat format, UINT width, UINT height, UINT16 mipLevels);
+		void CreateTextureView(UINT frameIndex);
+		void StreamTexture();
+		void StreamTiles();
+		void ReportStreamingProgress();
+		void UpdateTextureResidency();
+		static void GetTileShape(DX::CookedTextureFormat format, UINT& width, UINT& height);
+		static DXGI_FORMAT GetTextureFormat(DX::CookedTextureFormat format);
+		static DX::CookedTextureFormat GetCookedFormat(DX::BlockFormat blockFormat);
+		static UINT GetCookSettings();
+		static bool GetFileStamp(std::wstring const& fileName, UINT64& size, UINT64& modifiedTime);
 
 	private:
 		// Constant buffers must be 256-byte aligned.
 		static const UINT c_alignedConstantBufferSize = (sizeof(ModelViewProjectionConstantBuffer) + 255) & ~255;
 
+		// Creates the texture as B8G8R8A8_UNORM_SRGB, so that it is sampled in linear light. The
+		// back buffer is UNORM, so this only looks right when drawing to an sRGB render target view.
+		static const bool c_useSrgbTexture = false;
+
+		// Splits each face of the cube into c_cubeSegments x c_cubeSegments quads, to draw it at
+		// higher triangle counts. Up to 103 fits 16-bit indices in one draw.
+		static const UINT c_cubeSegments = 1;
+
+		// Draws this .obj, .gltf or .glb file, scaled to the cube's bounds, in place of the cube.
+		static constexpr const wchar_t* c_meshFileName = nullptr;
+
+		// Draws a cube too big for 16-bit indices as up to this many 16-bit submeshes, each
+		// with a base vertex, before falling back to 32-bit indices.
+		static const UINT c_maxIndexSubmeshes = 4;
+
+		// Sorts clusters of the cube's triangles so that those facing out are drawn first.
+		static const bool c_optimizeOverdraw = true;
+
+		// Draws the cube from 12-byte quantized vertices rather than 20-byte float ones: SNORM16
+		// positions within the cube's bounds, and UVs as c_vertexUvFormat, or as halves when a
+		// mesh's UVs don't fit UNORM16.
+		static const bool c_quantizeVertices = true;
+		static const DX::VertexUvFormat c_vertexUvFormat = DX::VertexUvFormat::Unorm16;
+
+		// Uploads the texture block-compressed: BC1 when it is opaque, BC7 when it has alpha.
+		static const bool c_compressTexture = true;
+		static const DX::BlockCompressionQuality c_textureCompressionQuality = DX::BlockCompressionQuality::Normal;
+
+		// Uploads only the mips of c_progressiveFirstMipSize texels and smaller before the first
+		// frame, then streams the larger ones in, at most c_streamingBytesPerFrame a frame.
+		static const bool c_progressiveTexture = true;
+		static const UINT c_progressiveFirstMipSize = 16;
+		static const UINT c_streamingBytesPerFrame = 256 * 1024;
+
+		// Staging memory for every upload to the GPU. The ring grows if an upload doesn't fit
+		// while the earlier ones are still in flight, which only happens while warming up.
+		static const UINT64 c_uploadRingSize = 4 * 1024 * 1024;
+
+		// Memory the residency manager may keep loaded for the texture.
+		static const UINT64 c_textureResidencyBudget = 16 * 1024 * 1024;
+
+		// Makes the progressive texture a reserved resource when the device supports tiled
+		// resources, so that only the tiles the residency manager wants are backed by memory.
+		// Otherwise whole mips are streamed into a committed texture.
+		static const bool c_virtualTexture = true;
+
 		// Cached pointer to device resources.
 		std::shared_ptr<DX::DeviceResources> m_deviceResources;
 
+		// Outlives the renderer, so that a renderer for a new device finds what this one built.
+		std::shared_ptr<DX::AssetCache>		m_assetCache;
+		std::shared_ptr<const MeshAsset>	m_cubeMesh;
+
+		// Places the buffers and the committed texture in shared heaps. Declared ahead of
+		// them so that it outlives them.
+		std::unique_ptr<DX::GpuAllocator>	m_gpuAllocator;
+
 		// Direct3D resources for cube geometry.
 		ComPtr<ID3D12GraphicsCommandList>	m_commandList;
 		ComPtr<ID3D12RootSignature>			m_rootSignature;
 		ComPtr<ID3D12PipelineState>			m_pipelineState;
 		ComPtr<ID3D12DescriptorHeap>		m_cbv_srv_Heap;
-		ComPtr<ID3D12Resource>				m_vertexBuffer;
-		ComPtr<ID3D12Resource>				m_indexBuffer;
-		ComPtr<ID3D12Resource>				m_constantBuffer;
+		DX::GpuBufferRange					m_vertexBuffer;
+		DX::GpuBufferRange					m_indexBuffer;
+		DX::GpuBufferRange					m_constantBuffer;
 		ModelViewProjectionConstantBuffer	m_constantBufferData;
 		UINT8*								m_mappedConstantBuffer;
 		UINT								m_cbvDescriptorSize;
@@ -54,11 +159,55 @@ namespace SpinningCube
 		D3D12_VERTEX_BUFFER_VIEW			m_vertexBufferView;
 		D3D12_INDEX_BUFFER_VIEW				m_indexBufferView;
 		ComPtr<ID3D12Resource>				m_texture;
-	    std::vector<ComPtr<ID3D12Resource>> m_uploads;
 		ComPtr<ID3D12Resource>				m_feedbackTexture;
-		UINT								m_indexCount;
-		ComPtr<IWICImagingFactory>          m_wicImagingFactory;
+		std::vector<DX::CookedTextureMip>	m_textureMips;
+		UINT								m_textureViewMips[DX::c_frameCount];	// Most detailed mip in each frame's view.
+
+		// Progressive texture streaming. m_residentMip is the most detailed mip that has been
+		// uploaded; rows of the next larger one are copied from m_streamingPayload, which
+		// m_streamingSource keeps alive, until it is complete too. For a reserved texture it
+		// is the most detailed mip that is resident wherever the cube samples it.
+		UINT								m_residentMip;
+		UINT								m_tailMip;		// Mips from here on are uploaded with the texture.
+		UINT								m_streamingRow;
+		const UINT8*						m_streamingPayload;
+		std::shared_ptr<const void>			m_streamingSource;
+		UINT64								m_streamingUploadSize;	// Bytes copied in a frame at most.
+		UINT64								m_reducedDetailFrameCount;	// Since streaming last caught up with its target.
+
+		// Sets how far the texture streams in. The shaders don't write sampler feedback, so
+		// the feedback is emulated on the CPU from the cube's geometry each frame.
+		std::unique_ptr<DX::FeedbackEmulator>	m_feedbackEmulator;
+		std::unique_ptr<DX::ResidencyManager>	m_residencyManager;
+		std::vector<DX::ResidencyTile>			m_pendingTileLoads;
+		std::vector<DX::FeedbackVertex>			m_feedbackVertices;
+		UINT									m_streamingTargetMip;	// Streaming stops at this mip.
+
+		// Backing for a reserved texture. The backend sends the page table's mapping
+		// changes to the command queue.
+		ComPtr<ID3D12Heap>						m_tileHeap;
+		std::unique_ptr<DX::PhysicalTilePool>	m_tilePool;
+		std::unique_ptr<DX::TileMappingBackend>	m_tileMappingBackend;
+		std::unique_ptr<DX::VirtualTexture>		m_virtualTexture;
 		bool								m_supportsSamplerFeedback;
+		bool								m_supportsTiledResources;
+
+		// The upload ring, over a persistently mapped buffer.
+		std::unique_ptr<DX::UploadRing>		m_uploadRing;
+		ComPtr<ID3D12Resource>				m_uploadBuffer;
+		UINT8*								m_mappedUploadBuffer;
+
+		// Copies out of the upload ring run on a copy queue, in one batch a frame, and the
+		// direct queue waits for them on the GPU. Only the reserved texture's tiles are
+		// copied on the direct queue, which maps them.
+		std::unique_ptr<DX::CopyQueue>		m_copyQueue;
+		std::unique_ptr<DX::UploadBatcher>	m_uploadBatcher;
+		std::unique_ptr<DX::FootprintCache>	m_footprintCache;
+		DX::TextureUploadPlan				m_uploadPlan;
+		std::vector<DX::CopyRequest>		m_uploadCopies;
+
+		// Worker threads for decoding texture data.
+		DX::ThreadPool						m_threadPool;
 
 		// Variables used with the rendering loop.
 		bool	m_loadingComplete;
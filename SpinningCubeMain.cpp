@@ -7,7 +7,9 @@ using namespace SpinningCube;
 // The DirectX 12 Application template is documented at https://go.microsoft.com/fwlink/?LinkID=613670&clcid=0x409
 
 // Loads and initializes application assets when the application is loaded.
-SpinningCubeMain::SpinningCubeMain()
+SpinningCubeMain::SpinningCubeMain() :
+	m_assetCache(std::make_shared<DX::AssetCache>()),
+	m_deviceRemoved(false)
 {
 	// TODO: Change the timer settings if you want something other than the default variable timestep mode.
 	// e.g. for 60 FPS fixed timestep update logic, call:
@@ -21,9 +23,12 @@ SpinningCubeMain::SpinningCubeMain()
 void SpinningCubeMain::CreateRenderers(const std::shared_ptr<DX::DeviceResources>& deviceResources)
 {
 	// TODO: Replace this with your app's content initialization.
-	m_sceneRenderer = std::unique_ptr<Sample3DSceneRenderer>(new Sample3DSceneRenderer(deviceResources));
+	m_sceneRenderer = std::unique_ptr<Sample3DSceneRenderer>(new Sample3DSceneRenderer(deviceResources, m_assetCache));
 
 	OnWindowSizeChanged();
+
+	ReportAssetCache(m_deviceRemoved);
+	m_deviceRemoved = false;
 }
 
 // Updates the application state once per frame.
@@ -65,6 +70,27 @@ void SpinningCubeMain::OnDeviceRemoved()
 	// TODO: Save any necessary application or renderer state and release the renderer
 	// and its resources which are no longer valid.
 	m_sceneRenderer = nullptr;
+
+	// Recovery lasts until the renderers have been created again on the new device.
+	m_deviceRemovedTime = std::chrono::steady_clock::now();
+	m_deviceRemoved = true;
+}
+
+// Logs how the asset cache has done, and after a device removal how long recovering took.
+void SpinningCubeMain::ReportAssetCache(bool recovered)
+{
+	WCHAR message[128];
+	if (recovered && swprintf_s(message, L"Recovered from device removal in %.2f ms\n",
+		std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_deviceRemovedTime).count()) > 0)
+	{
+		OutputDebugStringW(message);
+	}
+
+	const DX::AssetCacheStatistics statistics = m_assetCache->GetStatistics();
+	if (swprintf_s(message, L"Asset cache: %u assets, %llu hits, %llu misses\n", statistics.AssetCount, statistics.Hits, statistics.Misses) > 0)
+	{
+		OutputDebugStringW(message);
+	}
 }
 
 void SpinningCubeMain::OnKeyUp(WPARAM wparam)
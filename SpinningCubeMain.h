@@ -4,6 +4,8 @@
 #include "Common\DeviceResources.h"
 #include "Sample3DSceneRenderer.h"
 
+#include <chrono>
+
 // Renders Direct3D content on the screen.
 namespace SpinningCube
 {
@@ -21,9 +23,17 @@ namespace SpinningCube
 		void OnKeyUp(WPARAM wparam);
 
 	private:
+		void ReportAssetCache(bool recovered);
+
 		// TODO: Replace with your own content renderers.
 		std::unique_ptr<Sample3DSceneRenderer> m_sceneRenderer;
 
+		// What the renderers build that doesn't depend on the device. Kept when the device is
+		// removed, so that recovering from that only takes uploading it again.
+		std::shared_ptr<DX::AssetCache> m_assetCache;
+		std::chrono::steady_clock::time_point m_deviceRemovedTime;
+		bool m_deviceRemoved;
+
 		// Rendering loop timer.
 		DX::StepTimer m_timer;
 	};
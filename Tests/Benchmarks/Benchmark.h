@@ -0,0 +1,61 @@
+﻿#pragma once
+
+#include "TestHarness.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+// Timing for the Linux benchmark executables, which print the figures each component is
+// judged by. They are built with the tests but not run by ctest.
+
+namespace DX
+{
+	namespace Benchmark
+	{
+		// Runs the work over and over for at least minimumSeconds, and at least three
+		// times, and returns the fastest run in seconds: the one least disturbed by the
+		// rest of the system.
+		template<typename Work>
+		double MeasureSeconds(Work&& work, double minimumSeconds = 0.5)
+		{
+			typedef std::chrono::steady_clock Clock;
+			double fastest = 1e30;
+			double total = 0.0;
+			for (int run = 0; run < 3 || total < minimumSeconds; ++run)
+			{
+				const Clock::time_point start = Clock::now();
+				work();
+				const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+				fastest = std::min(fastest, seconds);
+				total += seconds;
+			}
+			return fastest;
+		}
+
+		// As above, but only the work is timed: prepare runs before every run, for work that
+		// changes its input in place.
+		template<typename Prepare, typename Work>
+		double MeasurePreparedSeconds(Prepare&& prepare, Work&& work, double minimumSeconds = 0.5)
+		{
+			typedef std::chrono::steady_clock Clock;
+			double fastest = 1e30;
+			double total = 0.0;
+			for (int run = 0; run < 3 || total < minimumSeconds; ++run)
+			{
+				prepare();
+				const Clock::time_point start = Clock::now();
+				work();
+				const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+				fastest = std::min(fastest, seconds);
+				total += seconds;
+			}
+			return fastest;
+		}
+
+		inline double ToMegabytes(double bytes)
+		{
+			return bytes / (1024.0 * 1024.0);
+		}
+	}
+}
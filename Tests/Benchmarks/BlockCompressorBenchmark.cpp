@@ -0,0 +1,260 @@
+﻿#include "Benchmark.h"
+
+#include "Common/BlockCompressor.h"
+#include "Common/FileView.h"
+#include "Common/PngDecoder.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+using namespace DX;
+
+namespace
+{
+	struct Image
+	{
+		uint32_t Width;
+		uint32_t Height;
+		std::vector<uint8_t> Pixels;	// BGRA
+	};
+
+	Image LoadImage(const char* fileName)
+	{
+		FileView file(Test::GetAssetPath(fileName));
+		PngDecoder decoder(file.GetData(), file.GetSize());
+		Image image;
+		image.Width = decoder.GetInfo().Width;
+		image.Height = decoder.GetInfo().Height;
+		image.Pixels.resize(static_cast<size_t>(image.Width) * image.Height * 4);
+		decoder.Decode(image.Pixels.data(), image.Width * 4);
+		return image;
+	}
+
+	// Reference decoders, writing one block as 16 BGRA texels.
+
+	void DecodeColorBlock(const uint8_t* block, bool allowTransparent, uint8_t texels[16][4])
+	{
+		const uint32_t c0 = block[0] | block[1] << 8;
+		const uint32_t c1 = block[2] | block[3] << 8;
+		int palette[4][4];
+		for (int i = 0; i < 2; ++i)
+		{
+			const uint32_t c = i == 0 ? c0 : c1;
+			const int b = c & 31;
+			const int g = (c >> 5) & 63;
+			const int r = c >> 11;
+			palette[i][0] = b << 3 | b >> 2;
+			palette[i][1] = g << 2 | g >> 4;
+			palette[i][2] = r << 3 | r >> 2;
+			palette[i][3] = 255;
+		}
+		for (int c = 0; c < 3; ++c)
+		{
+			if (c0 > c1 || !allowTransparent)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+			}
+			else
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+		}
+		palette[2][3] = 255;
+		palette[3][3] = c0 > c1 || !allowTransparent ? 255 : 0;
+
+		const uint32_t indices = block[4] | block[5] << 8 | block[6] << 16 | static_cast<uint32_t>(block[7]) << 24;
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				texels[i][c] = static_cast<uint8_t>(palette[(indices >> (2 * i)) & 3][c]);
+			}
+		}
+	}
+
+	void DecodeAlphaBlock(const uint8_t* block, uint8_t texels[16][4])
+	{
+		const int a0 = block[0];
+		const int a1 = block[1];
+		int palette[8] = { a0, a1 };
+		if (a0 > a1)
+		{
+			for (int i = 2; i < 8; ++i)
+			{
+				palette[i] = ((8 - i) * a0 + (i - 1) * a1 + 3) / 7;
+			}
+		}
+		else
+		{
+			for (int i = 2; i < 6; ++i)
+			{
+				palette[i] = ((6 - i) * a0 + (i - 1) * a1 + 2) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		uint64_t indices = 0;
+		for (int i = 0; i < 6; ++i)
+		{
+			indices |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+		}
+		for (int i = 0; i < 16; ++i)
+		{
+			texels[i][3] = static_cast<uint8_t>(palette[(indices >> (3 * i)) & 7]);
+		}
+	}
+
+	// Mode 6 only, which is all the compressor writes.
+	void DecodeBC7Block(const uint8_t* block, uint8_t texels[16][4])
+	{
+		uint32_t position = 0;
+		auto read = [&](uint32_t bitCount)
+		{
+			uint32_t value = 0;
+			for (uint32_t i = 0; i < bitCount; ++i, ++position)
+			{
+				value |= ((block[position >> 3] >> (position & 7)) & 1u) << i;
+			}
+			return value;
+		};
+
+		if (read(7) != 1u << 6)
+		{
+			throw std::runtime_error("Expected a BC7 mode 6 block.");
+		}
+		int endpoints[2][4];	// RGBA
+		for (int c = 0; c < 4; ++c)
+		{
+			endpoints[0][c] = static_cast<int>(read(7));
+			endpoints[1][c] = static_cast<int>(read(7));
+		}
+		const uint32_t pBits[2] = { read(1), read(1) };
+		for (int e = 0; e < 2; ++e)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				endpoints[e][c] = endpoints[e][c] << 1 | static_cast<int>(pBits[e]);
+			}
+		}
+
+		static const int c_weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+		static const int c_bgraFromRgba[4] = { 2, 1, 0, 3 };
+		for (int i = 0; i < 16; ++i)
+		{
+			const int weight = c_weights[read(i == 0 ? 3 : 4)];
+			for (int c = 0; c < 4; ++c)
+			{
+				const int channel = c_bgraFromRgba[c];
+				texels[i][c] = static_cast<uint8_t>(((64 - weight) * endpoints[0][channel] + weight * endpoints[1][channel] + 32) >> 6);
+			}
+		}
+	}
+
+	// Decodes the compressed image and returns the squared error summed over every channel
+	// the format stores (alpha is not stored by BC1), with the number of samples compared.
+	double MeasureSquaredError(Image const& image, BlockFormat format, const uint8_t* compressed, size_t compressedRowPitch, double& sampleCount)
+	{
+		const int channelCount = format == BlockFormat::BC1 ? 3 : 4;
+		double squaredError = 0.0;
+		sampleCount = 0.0;
+		for (uint32_t blockY = 0; blockY < BlockCompressor::GetBlockCount(image.Height); ++blockY)
+		{
+			for (uint32_t blockX = 0; blockX < BlockCompressor::GetBlockCount(image.Width); ++blockX)
+			{
+				const uint8_t* block = compressed + blockY * compressedRowPitch + blockX * BlockCompressor::GetBlockBytes(format);
+				uint8_t texels[16][4];
+				switch (format)
+				{
+				case BlockFormat::BC1:
+					DecodeColorBlock(block, true, texels);
+					break;
+				case BlockFormat::BC3:
+					DecodeColorBlock(block + 8, false, texels);
+					DecodeAlphaBlock(block, texels);
+					break;
+				case BlockFormat::BC7:
+					DecodeBC7Block(block, texels);
+					break;
+				}
+
+				for (uint32_t y = 0; y < 4 && blockY * 4 + y < image.Height; ++y)
+				{
+					for (uint32_t x = 0; x < 4 && blockX * 4 + x < image.Width; ++x)
+					{
+						const uint8_t* source = &image.Pixels[(static_cast<size_t>(blockY * 4 + y) * image.Width + blockX * 4 + x) * 4];
+						for (int c = 0; c < channelCount; ++c)
+						{
+							const double difference = static_cast<double>(source[c]) - texels[y * 4 + x][c];
+							squaredError += difference * difference;
+						}
+						sampleCount += channelCount;
+					}
+				}
+			}
+		}
+		return squaredError;
+	}
+
+	double GetPsnr(double squaredError, double sampleCount)
+	{
+		return squaredError == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 * sampleCount / squaredError);
+	}
+}
+
+// Encode throughput over the six shipped mips, and the PSNR of each mip after a round
+// trip, for every format and quality preset.
+int main()
+{
+	const char* const fileNames[] = { "1.png", "2.png", "3.png", "4.png", "5.png", "6.png" };
+	std::vector<Image> images;
+	for (const char* fileName : fileNames)
+	{
+		images.push_back(LoadImage(fileName));
+	}
+
+	const BlockFormat formats[] = { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC7 };
+	const char* const formatNames[] = { "BC1", "BC3", "BC7" };
+	const BlockCompressionQuality qualities[] = { BlockCompressionQuality::Fast, BlockCompressionQuality::Normal, BlockCompressionQuality::High };
+	const char* const qualityNames[] = { "Fast", "Normal", "High" };
+
+	std::printf("%-4s %-7s %8s %9s  PSNR dB per mip, 1-6\n", "", "", "ms", "MPix/s");
+	for (int f = 0; f < 3; ++f)
+	{
+		for (int q = 0; q < 3; ++q)
+		{
+			const BlockCompressor compressor(formats[f], qualities[q]);
+			std::printf("%-4s %-7s", formatNames[f], qualityNames[q]);
+
+			double totalSeconds = 0.0;
+			double totalPixels = 0.0;
+			double psnr[6];
+			for (size_t i = 0; i < images.size(); ++i)
+			{
+				Image const& image = images[i];
+				const size_t rowPitch = compressor.GetRowPitch(image.Width);
+				std::vector<uint8_t> compressed(rowPitch * BlockCompressor::GetBlockCount(image.Height));
+				totalSeconds += Benchmark::MeasureSeconds([&]()
+				{
+					compressor.Compress(image.Pixels.data(), image.Width, image.Height, image.Width * 4, compressed.data(), rowPitch);
+				}, 0.1);
+				totalPixels += static_cast<double>(image.Width) * image.Height;
+
+				double sampleCount;
+				const double squaredError = MeasureSquaredError(image, formats[f], compressed.data(), rowPitch, sampleCount);
+				psnr[i] = GetPsnr(squaredError, sampleCount);
+			}
+
+			std::printf(" %8.3f %9.1f ", totalSeconds * 1e3, totalPixels / totalSeconds / 1e6);
+			for (double value : psnr)
+			{
+				std::printf(" %5.1f", value);
+			}
+			std::printf("\n");
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,49 @@
+﻿#include "Benchmark.h"
+
+#include "Common/MeshGenerator.h"
+
+#include <functional>
+
+using namespace DX;
+
+// Triangles generated per second by each shape at a few sizes, and vertices welded per
+// second on the largest cube, whose faces share their edge vertices.
+int main()
+{
+	const struct
+	{
+		const char*				Name;
+		std::function<Mesh()>	Create;
+	} shapes[] =
+	{
+		{ "cube 16", []() { return CreateCube(1.0f, 16); } },
+		{ "cube 256", []() { return CreateCube(1.0f, 256); } },
+		{ "plane 1024", []() { return CreatePlane(1.0f, 1.0f, 1024, 1024); } },
+		{ "uv sphere 64", []() { return CreateUvSphere(1.0f, 64, 32); } },
+		{ "uv sphere 1024", []() { return CreateUvSphere(1.0f, 1024, 512); } },
+		{ "icosphere 16", []() { return CreateIcosphere(1.0f, 16); } },
+		{ "icosphere 160", []() { return CreateIcosphere(1.0f, 160); } },
+		{ "torus 64", []() { return CreateTorus(1.0f, 0.25f, 64, 32); } },
+		{ "torus 1024", []() { return CreateTorus(1.0f, 0.25f, 1024, 512); } },
+	};
+
+	std::printf("%-15s %9s %9s %9s %9s\n", "", "vertices", "tris", "ms", "Mtris/s");
+	for (auto const& shape : shapes)
+	{
+		const Mesh mesh = shape.Create();
+		const double seconds = Benchmark::MeasureSeconds([&]() { shape.Create(); });
+		const size_t triangleCount = mesh.Indices.size() / 3;
+		std::printf("%-15s %9zu %9zu %9.3f %9.2f\n", shape.Name, mesh.Vertices.size(), triangleCount, seconds * 1e3, triangleCount / seconds / 1e6);
+	}
+
+	const Mesh cube = CreateCube(1.0f, 256);
+	Mesh welded;
+	const double weldSeconds = Benchmark::MeasureSeconds([&]()
+	{
+		welded = cube;
+		WeldVertices(welded, 1e-5f, 1.0f);
+	});
+	std::printf("\nWeldVertices on cube 256: %zu to %zu vertices, %.3f ms, %.2f Mverts/s\n", cube.Vertices.size(), welded.Vertices.size(),
+		weldSeconds * 1e3, cube.Vertices.size() / weldSeconds / 1e6);
+	return 0;
+}
@@ -0,0 +1,146 @@
+﻿#include "Benchmark.h"
+
+#include "Common/MeshImporter.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace DX;
+
+namespace
+{
+	void WriteFile(const char* fileName, std::string const& contents)
+	{
+		FILE* file = std::fopen(fileName, "wb");
+		if (file == nullptr || std::fwrite(contents.data(), 1, contents.size(), file) != contents.size())
+		{
+			throw std::runtime_error(std::string("Can't write ") + fileName);
+		}
+		std::fclose(file);
+	}
+
+	// Positions and UVs with six decimal places, as most exporters write them, and faces
+	// that index both with the same number.
+	std::string WriteObj(Mesh const& mesh)
+	{
+		std::string text;
+		char line[128];
+		for (MeshVertex const& vertex : mesh.Vertices)
+		{
+			text.append(line, std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", vertex.Position[0], vertex.Position[1], vertex.Position[2]));
+		}
+		for (MeshVertex const& vertex : mesh.Vertices)
+		{
+			text.append(line, std::snprintf(line, sizeof(line), "vt %.6f %.6f\n", vertex.UV[0], 1.0f - vertex.UV[1]));
+		}
+		for (size_t i = 0; i < mesh.Indices.size(); i += 3)
+		{
+			const uint32_t a = mesh.Indices[i] + 1;
+			const uint32_t b = mesh.Indices[i + 1] + 1;
+			const uint32_t c = mesh.Indices[i + 2] + 1;
+			text.append(line, std::snprintf(line, sizeof(line), "f %u/%u %u/%u %u/%u\n", a, a, c, c, b, b));
+		}
+		return text;
+	}
+
+	void AppendUint32(std::string& data, uint32_t value)
+	{
+		const char bytes[4] = { static_cast<char>(value), static_cast<char>(value >> 8), static_cast<char>(value >> 16), static_cast<char>(value >> 24) };
+		data.append(bytes, 4);
+	}
+
+	// One primitive with float positions and UVs and 32-bit indices, in a .glb's binary chunk.
+	std::string WriteGlb(Mesh const& mesh)
+	{
+		std::vector<float> positions;
+		std::vector<float> uvs;
+		float minimum[3] = { 1e30f, 1e30f, 1e30f };
+		float maximum[3] = { -1e30f, -1e30f, -1e30f };
+		for (MeshVertex const& vertex : mesh.Vertices)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				positions.push_back(vertex.Position[c]);
+				minimum[c] = std::min(minimum[c], vertex.Position[c]);
+				maximum[c] = std::max(maximum[c], vertex.Position[c]);
+			}
+			uvs.push_back(vertex.UV[0]);
+			uvs.push_back(vertex.UV[1]);
+		}
+		std::vector<uint32_t> indices(mesh.Indices.size());
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			indices[i] = mesh.Indices[i];
+			indices[i + 1] = mesh.Indices[i + 2];
+			indices[i + 2] = mesh.Indices[i + 1];
+		}
+
+		const size_t positionBytes = positions.size() * sizeof(float);
+		const size_t uvBytes = uvs.size() * sizeof(float);
+		const size_t indexBytes = indices.size() * sizeof(uint32_t);
+		std::string binary(positionBytes + uvBytes + indexBytes, '\0');
+		std::memcpy(&binary[0], positions.data(), positionBytes);
+		std::memcpy(&binary[positionBytes], uvs.data(), uvBytes);
+		std::memcpy(&binary[positionBytes + uvBytes], indices.data(), indexBytes);
+
+		char json[2048];
+		std::string chunk(json, std::snprintf(json, sizeof(json),
+			"{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"byteLength\":%zu}],"
+			"\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":%zu},{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu},"
+			"{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu}],"
+			"\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC3\",\"min\":[%g,%g,%g],\"max\":[%g,%g,%g]},"
+			"{\"bufferView\":1,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC2\"},"
+			"{\"bufferView\":2,\"componentType\":5125,\"count\":%zu,\"type\":\"SCALAR\"}],"
+			"\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"TEXCOORD_0\":1},\"indices\":2}]}]}",
+			binary.size(), positionBytes, positionBytes, uvBytes, positionBytes + uvBytes, indexBytes,
+			mesh.Vertices.size(), minimum[0], minimum[1], minimum[2], maximum[0], maximum[1], maximum[2], mesh.Vertices.size(), indices.size()));
+		chunk.resize((chunk.size() + 3) & ~static_cast<size_t>(3), ' ');
+
+		std::string glb;
+		AppendUint32(glb, 0x46546c67);	// glTF
+		AppendUint32(glb, 2);
+		AppendUint32(glb, static_cast<uint32_t>(12 + 8 + chunk.size() + 8 + binary.size()));
+		AppendUint32(glb, static_cast<uint32_t>(chunk.size()));
+		AppendUint32(glb, 0x4e4f534a);	// JSON
+		glb += chunk;
+		AppendUint32(glb, static_cast<uint32_t>(binary.size()));
+		AppendUint32(glb, 0x004e4942);	// BIN
+		glb += binary;
+		return glb;
+	}
+
+	void Report(const char* name, double bytes, Mesh const& mesh, double seconds)
+	{
+		const double triangleCount = static_cast<double>(mesh.Indices.size() / 3);
+		std::printf("%-14s %8.1f %9zu %9.0f %9.3f %9.1f %9.2f\n", name, Benchmark::ToMegabytes(bytes), mesh.Vertices.size(), triangleCount, seconds * 1e3,
+			Benchmark::ToMegabytes(bytes) / seconds, triangleCount / seconds / 1e6);
+	}
+}
+
+// Import throughput in MB of file and triangles per second, for an OBJ and a .glb of the
+// same sphere. The files are written to the working directory and removed afterwards. The
+// OBJ is also parsed from memory, which leaves out mapping the file.
+int main()
+{
+	const Mesh source = CreateUvSphere(1.0f, 512, 256);
+	const std::string obj = WriteObj(source);
+	const std::string glb = WriteGlb(source);
+	const char* const objName = "MeshImporterBenchmark.obj";
+	const char* const glbName = "MeshImporterBenchmark.glb";
+	WriteFile(objName, obj);
+	WriteFile(glbName, glb);
+
+	std::printf("%-14s %8s %9s %9s %9s %9s %9s\n", "", "MB", "vertices", "tris", "ms", "MB/s", "Mtris/s");
+	Mesh mesh;
+	double seconds = Benchmark::MeasureSeconds([&]() { mesh = ImportObj(obj.data(), obj.size()); });
+	Report("OBJ in memory", static_cast<double>(obj.size()), mesh, seconds);
+	seconds = Benchmark::MeasureSeconds([&]() { mesh = ImportMesh(L"MeshImporterBenchmark.obj"); });
+	Report("OBJ file", static_cast<double>(obj.size()), mesh, seconds);
+	seconds = Benchmark::MeasureSeconds([&]() { mesh = ImportMesh(L"MeshImporterBenchmark.glb"); });
+	Report("GLB file", static_cast<double>(glb.size()), mesh, seconds);
+
+	std::remove(objName);
+	std::remove(glbName);
+	return 0;
+}
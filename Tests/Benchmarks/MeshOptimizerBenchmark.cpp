@@ -0,0 +1,90 @@
+﻿#include "Benchmark.h"
+
+#include "Common/MeshOptimizer.h"
+
+#include <numeric>
+#include <random>
+
+using namespace DX;
+
+namespace
+{
+	// Shuffles the triangles and the vertices, as a mesh exported without any care for
+	// ordering might be.
+	Mesh Shuffle(Mesh mesh, uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		std::vector<uint32_t> triangles(mesh.Indices.size() / 3);
+		std::iota(triangles.begin(), triangles.end(), 0u);
+		std::shuffle(triangles.begin(), triangles.end(), random);
+		std::vector<uint32_t> vertices(mesh.Vertices.size());
+		std::iota(vertices.begin(), vertices.end(), 0u);
+		std::shuffle(vertices.begin(), vertices.end(), random);
+
+		Mesh shuffled;
+		shuffled.Vertices.resize(mesh.Vertices.size());
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			shuffled.Vertices[vertices[i]] = mesh.Vertices[i];
+		}
+		shuffled.Indices.reserve(mesh.Indices.size());
+		for (uint32_t triangle : triangles)
+		{
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				shuffled.Indices.push_back(vertices[mesh.Indices[triangle * 3 + corner]]);
+			}
+		}
+		return shuffled;
+	}
+
+	void PrintStatistics(const char* stage, VertexCacheStatistics const& statistics, double triangleCount, double seconds)
+	{
+		std::printf("  %-10s ACMR %6.3f  ATVR %6.3f", stage, statistics.Acmr, statistics.Atvr);
+		if (seconds > 0.0)
+		{
+			std::printf("  %9.3f ms %8.2f Mtris/s", seconds * 1e3, triangleCount / seconds / 1e6);
+		}
+		std::printf("\n");
+	}
+}
+
+// ACMR and ATVR for a cache of c_vertexCacheSize before and after each pass, and each
+// pass's speed, on generated meshes both in their own order and shuffled.
+int main()
+{
+	const struct
+	{
+		const char*	Name;
+		Mesh		Source;
+	} meshes[] =
+	{
+		{ "plane 256", CreatePlane(1.0f, 1.0f, 256, 256) },
+		{ "plane 256 shuffled", Shuffle(CreatePlane(1.0f, 1.0f, 256, 256), 1) },
+		{ "icosphere 64 shuffled", Shuffle(CreateIcosphere(1.0f, 64), 2) },
+		{ "torus 512 shuffled", Shuffle(CreateTorus(1.0f, 0.25f, 512, 256), 3) },
+		{ "uv sphere 1024 shuffled", Shuffle(CreateUvSphere(1.0f, 1024, 512), 4) },
+	};
+
+	for (auto const& entry : meshes)
+	{
+		const double triangleCount = static_cast<double>(entry.Source.Indices.size() / 3);
+		std::printf("%s: %zu vertices, %.0f triangles\n", entry.Name, entry.Source.Vertices.size(), triangleCount);
+		PrintStatistics("before", AnalyzeVertexCache(entry.Source), triangleCount, 0.0);
+
+		// Each pass starts from the previous one's result.
+		Mesh input = entry.Source;
+		Mesh mesh;
+		const double cacheSeconds = Benchmark::MeasurePreparedSeconds([&]() { mesh = input; }, [&]() { OptimizeVertexCache(mesh); }, 0.2);
+		PrintStatistics("cache", AnalyzeVertexCache(mesh), triangleCount, cacheSeconds);
+
+		input = mesh;
+		const double overdrawSeconds = Benchmark::MeasurePreparedSeconds([&]() { mesh = input; }, [&]() { OptimizeOverdraw(mesh); }, 0.2);
+		PrintStatistics("overdraw", AnalyzeVertexCache(mesh), triangleCount, overdrawSeconds);
+
+		input = mesh;
+		const double fetchSeconds = Benchmark::MeasurePreparedSeconds([&]() { mesh = input; }, [&]() { OptimizeVertexFetch(mesh); }, 0.2);
+		PrintStatistics("fetch", AnalyzeVertexCache(mesh), triangleCount, fetchSeconds);
+	}
+	return 0;
+}
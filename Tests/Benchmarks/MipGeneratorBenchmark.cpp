@@ -0,0 +1,129 @@
+﻿#include "Benchmark.h"
+
+#include "Common/FileView.h"
+#include "Common/MipGenerator.h"
+#include "Common/PngDecoder.h"
+
+#include <vector>
+
+using namespace DX;
+
+namespace
+{
+	struct Image
+	{
+		uint32_t Width;
+		uint32_t Height;
+		std::vector<uint8_t> Pixels;
+	};
+
+	// 1.png repeated to fill the requested size, so sizes other than the shipped ones
+	// (non-powers of two in particular) filter real content.
+	Image MakeSource(uint32_t width, uint32_t height)
+	{
+		FileView file(Test::GetAssetPath("1.png"));
+		PngDecoder decoder(file.GetData(), file.GetSize());
+		const PngInfo info = decoder.GetInfo();
+		std::vector<uint8_t> tile(static_cast<size_t>(info.Width) * info.Height * 4);
+		decoder.Decode(tile.data(), info.Width * 4);
+
+		Image image;
+		image.Width = width;
+		image.Height = height;
+		image.Pixels.resize(static_cast<size_t>(width) * height * 4);
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				const uint8_t* source = &tile[(static_cast<size_t>(y % info.Height) * info.Width + x % info.Width) * 4];
+				uint8_t* destination = &image.Pixels[(static_cast<size_t>(y) * width + x) * 4];
+				for (int c = 0; c < 4; ++c)
+				{
+					destination[c] = source[c];
+				}
+			}
+		}
+		return image;
+	}
+
+	// Generates the whole chain below the base level and returns seconds per chain.
+	double MeasureChain(Image const& source, MipFilter filter, MipColorSpace colorSpace)
+	{
+		std::vector<uint8_t> level(static_cast<size_t>(source.Width / 2 + 1) * (source.Height / 2 + 1) * 4);
+		return Benchmark::MeasureSeconds([&]()
+		{
+			MipGenerator generator(filter, colorSpace);
+			generator.SetSource(source.Pixels.data(), source.Width, source.Height, source.Width * 4);
+			while (!generator.IsComplete())
+			{
+				generator.GenerateNextLevel(level.data(), generator.GetNextWidth() * 4);
+			}
+		});
+	}
+
+	const char* GetName(MipFilter filter)
+	{
+		switch (filter)
+		{
+		case MipFilter::Box:		return "Box";
+		case MipFilter::Kaiser:		return "Kaiser";
+		case MipFilter::Lanczos:	return "Lanczos";
+		}
+		return "?";
+	}
+
+	const char* GetName(MipColorSpace colorSpace)
+	{
+		switch (colorSpace)
+		{
+		case MipColorSpace::Gamma:	return "Gamma";
+		case MipColorSpace::Linear:	return "Linear";
+		case MipColorSpace::Srgb:	return "Srgb";
+		}
+		return "?";
+	}
+}
+
+// Full-chain throughput per filter, in megapixels of base level per second, then the box
+// filter in each colour space. Filtering in linear light is meant to cost less than twice
+// filtering the stored values, and the exit code is non-zero when it doesn't.
+int main()
+{
+	const uint32_t sizes[][2] = { { 512, 512 }, { 2048, 2048 }, { 1920, 1080 } };
+	const MipFilter filters[] = { MipFilter::Box, MipFilter::Kaiser, MipFilter::Lanczos };
+
+	std::printf("%-10s %-8s %9s %9s\n", "size", "filter", "ms", "MPix/s");
+	for (auto const& size : sizes)
+	{
+		const Image source = MakeSource(size[0], size[1]);
+		const double pixelCount = static_cast<double>(source.Width) * source.Height;
+		for (MipFilter filter : filters)
+		{
+			const double seconds = MeasureChain(source, filter, MipColorSpace::Gamma);
+			std::printf("%4ux%-5u %-8s %9.3f %9.1f\n", source.Width, source.Height, GetName(filter), seconds * 1e3, pixelCount / seconds / 1e6);
+		}
+	}
+
+	const double c_maximumLinearCost = 2.0;
+	bool withinBudget = true;
+	std::printf("\n%-10s %-8s %9s %9s %9s\n", "size", "space", "ms", "MPix/s", "x Gamma");
+	for (auto const& size : sizes)
+	{
+		const Image source = MakeSource(size[0], size[1]);
+		const double pixelCount = static_cast<double>(source.Width) * source.Height;
+		const double gammaSeconds = MeasureChain(source, MipFilter::Box, MipColorSpace::Gamma);
+		for (MipColorSpace colorSpace : { MipColorSpace::Gamma, MipColorSpace::Linear, MipColorSpace::Srgb })
+		{
+			const double seconds = colorSpace == MipColorSpace::Gamma ? gammaSeconds : MeasureChain(source, MipFilter::Box, colorSpace);
+			const double ratio = seconds / gammaSeconds;
+			withinBudget = withinBudget && ratio <= c_maximumLinearCost;
+			std::printf("%4ux%-5u %-8s %9.3f %9.1f %9.2f\n", source.Width, source.Height, GetName(colorSpace), seconds * 1e3, pixelCount / seconds / 1e6, ratio);
+		}
+	}
+	if (!withinBudget)
+	{
+		std::printf("linear-light box filtering costs more than %.0fx gamma\n", c_maximumLinearCost);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,43 @@
+﻿#include "Benchmark.h"
+
+#include "Common/FileView.h"
+#include "Common/PngDecoder.h"
+
+#include <vector>
+
+using namespace DX;
+
+// Decode throughput over the six shipped mip PNGs: megabytes of PNG read and megapixels
+// of premultiplied BGRA written per second.
+int main()
+{
+	const char* const fileNames[] = { "1.png", "2.png", "3.png", "4.png", "5.png", "6.png" };
+
+	std::printf("%-6s %9s %10s %8s %9s %9s\n", "file", "size", "pixels", "ms", "MB/s", "MPix/s");
+	double totalSeconds = 0.0;
+	double totalBytes = 0.0;
+	double totalPixels = 0.0;
+	for (const char* fileName : fileNames)
+	{
+		FileView file(Test::GetAssetPath(fileName));
+		PngInfo info = PngDecoder(file.GetData(), file.GetSize()).GetInfo();
+		std::vector<uint8_t> pixels(static_cast<size_t>(info.Width) * info.Height * 4);
+
+		// Parsing the chunks is part of decoding.
+		const double seconds = Benchmark::MeasureSeconds([&]()
+		{
+			PngDecoder decoder(file.GetData(), file.GetSize());
+			decoder.Decode(pixels.data(), info.Width * 4);
+		});
+
+		const double pixelCount = static_cast<double>(info.Width) * info.Height;
+		std::printf("%-6s %9zu %4ux%-5u %8.3f %9.1f %9.1f\n", fileName, file.GetSize(), info.Width, info.Height, seconds * 1e3,
+			Benchmark::ToMegabytes(static_cast<double>(file.GetSize())) / seconds, pixelCount / seconds / 1e6);
+		totalSeconds += seconds;
+		totalBytes += static_cast<double>(file.GetSize());
+		totalPixels += pixelCount;
+	}
+	std::printf("%-6s %9.0f %10.0f %8.3f %9.1f %9.1f\n", "all", totalBytes, totalPixels, totalSeconds * 1e3,
+		Benchmark::ToMegabytes(totalBytes) / totalSeconds, totalPixels / totalSeconds / 1e6);
+	return 0;
+}
@@ -0,0 +1,147 @@
+﻿#include "Benchmark.h"
+
+#include "Common/FeedbackEmulator.h"
+#include "Common/MeshGenerator.h"
+#include "Common/ResidencyManager.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+using namespace DX;
+
+namespace
+{
+	const uint32_t c_tileSize = 128;
+	const uint64_t c_tileBytes = 64 * 1024;
+	const uint64_t c_budgetBytes = 16 * 1024 * 1024;	// As the sample's.
+	const float c_viewportWidth = 1920.0f;
+	const float c_viewportHeight = 1080.0f;
+	const uint32_t c_frameCount = 1000;
+
+	struct Workload
+	{
+		const char*	Name;
+		uint32_t	TextureSize;
+		uint32_t	MipCount;
+		uint32_t	CubeSegments;
+	};
+
+	// The cube's vertices through the view and projection of one frame of a camera orbiting
+	// it while dollying in and out, so the mips it asks for change as well as the tiles: a
+	// right-handed look-at and 70-degree perspective, as the sample's.
+	std::vector<FeedbackVertex> Project(Mesh const& mesh, uint32_t frame)
+	{
+		const float angle = frame * 0.02f;
+		const float distance = 2.0f + 1.4f * std::sin(frame * 0.013f);
+		const float eye[3] = { distance * std::sin(angle), 0.5f, distance * std::cos(angle) };
+
+		float zAxis[3] = { eye[0], eye[1], eye[2] };
+		float length = std::sqrt(zAxis[0] * zAxis[0] + zAxis[1] * zAxis[1] + zAxis[2] * zAxis[2]);
+		for (float& c : zAxis)
+		{
+			c /= length;
+		}
+		float xAxis[3] = { zAxis[2], 0.0f, -zAxis[0] };
+		length = std::sqrt(xAxis[0] * xAxis[0] + xAxis[2] * xAxis[2]);
+		xAxis[0] /= length;
+		xAxis[2] /= length;
+		const float yAxis[3] =
+		{
+			zAxis[1] * xAxis[2] - zAxis[2] * xAxis[1],
+			zAxis[2] * xAxis[0] - zAxis[0] * xAxis[2],
+			zAxis[0] * xAxis[1] - zAxis[1] * xAxis[0],
+		};
+
+		const float nearZ = 0.01f;
+		const float farZ = 100.0f;
+		const float yScale = 1.0f / std::tan(0.5f * 70.0f * 3.14159265f / 180.0f);
+		const float xScale = yScale * c_viewportHeight / c_viewportWidth;
+		const float zScale = farZ / (nearZ - farZ);
+
+		std::vector<FeedbackVertex> vertices(mesh.Vertices.size());
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			const float* p = mesh.Vertices[i].Position;
+			const float d[3] = { p[0] - eye[0], p[1] - eye[1], p[2] - eye[2] };
+			const float x = d[0] * xAxis[0] + d[1] * xAxis[1] + d[2] * xAxis[2];
+			const float y = d[0] * yAxis[0] + d[1] * yAxis[1] + d[2] * yAxis[2];
+			const float z = d[0] * zAxis[0] + d[1] * zAxis[1] + d[2] * zAxis[2];
+			vertices[i] = FeedbackVertex{ { x * xScale, y * yScale, (z + nearZ) * zScale, -z }, { mesh.Vertices[i].UV[0], mesh.Vertices[i].UV[1] } };
+		}
+		return vertices;
+	}
+
+	void Run(Workload const& workload)
+	{
+		const Mesh mesh = CreateCube(1.0f, workload.CubeSegments);
+		std::vector<std::vector<FeedbackVertex>> frames(c_frameCount);
+		for (uint32_t frame = 0; frame < c_frameCount; ++frame)
+		{
+			frames[frame] = Project(mesh, frame);
+		}
+
+		// The emulator alone, keeping each frame's map for the residency manager.
+		FeedbackEmulator emulator(workload.TextureSize, workload.TextureSize, workload.MipCount, c_tileSize, c_tileSize);
+		std::vector<MinMipMap> maps(c_frameCount);
+		const double feedbackSeconds = Benchmark::MeasureSeconds([&]()
+		{
+			for (uint32_t frame = 0; frame < c_frameCount; ++frame)
+			{
+				emulator.Clear();
+				emulator.AddTriangles(frames[frame].data(), mesh.Indices.data(), mesh.Indices.size(), c_viewportWidth, c_viewportHeight);
+				maps[frame] = emulator.GetMap();
+			}
+		});
+
+		// Then the residency manager over those maps, from nothing resident, with every load
+		// landing before the next frame.
+		std::unique_ptr<ResidencyManager> manager;
+		size_t loadCount = 0;
+		size_t evictionCount = 0;
+		const double residencySeconds = Benchmark::MeasurePreparedSeconds([&]()
+		{
+			manager.reset(new ResidencyManager(workload.TextureSize, workload.TextureSize, workload.MipCount, c_tileSize, c_tileSize,
+				c_tileBytes, c_budgetBytes));
+			loadCount = 0;
+			evictionCount = 0;
+		}, [&]()
+		{
+			for (MinMipMap const& map : maps)
+			{
+				ResidencyUpdate const& update = manager->Update(map);
+				for (ResidencyTile const& tile : update.Loads)
+				{
+					manager->CompleteLoad(tile);
+				}
+				loadCount += update.Loads.size();
+				evictionCount += update.Evictions.size();
+			}
+		});
+
+		std::printf("%-16s %9zu %10.2f %10.2f %8.2f %8.2f\n", workload.Name, mesh.Indices.size() / 3,
+			feedbackSeconds * 1e6 / c_frameCount, residencySeconds * 1e6 / c_frameCount,
+			static_cast<double>(loadCount) / c_frameCount, static_cast<double>(evictionCount) / c_frameCount);
+	}
+}
+
+// Microseconds a frame to emulate sampler feedback for a cube seen from a camera orbiting
+// and dollying around it, and for ResidencyManager::Update to act on it, over 1000 frames
+// at 1080p. Feedback regions are a tile each, as in the sample, and the budget is the
+// sample's 16 MB. Loads and evictions are averages a frame.
+int main()
+{
+	const Workload workloads[] =
+	{
+		{ "512, cube", 512, 10, 1 },
+		{ "8K, cube", 8192, 14, 1 },
+		{ "8K, 16x16 cube", 8192, 14, 16 },
+	};
+
+	std::printf("%-16s %9s %10s %10s %8s %8s\n", "", "triangles", "feedback", "update", "loads", "evicts");
+	for (Workload const& workload : workloads)
+	{
+		Run(workload);
+	}
+	return 0;
+}
@@ -0,0 +1,118 @@
+﻿#include "Benchmark.h"
+
+#include "Common/TextureUploadPlan.h"
+
+#include <random>
+#include <vector>
+
+using namespace DX;
+
+namespace
+{
+	// DXGI_FORMAT values: R8G8B8A8_UNORM, R16G16B16A16_FLOAT, R8_UNORM, BC1_UNORM,
+	// BC3_UNORM, BC5_UNORM, B8G8R8A8_UNORM and BC7_UNORM.
+	const uint32_t c_formats[] = { 28, 10, 61, 71, 77, 83, 87, 98 };
+
+	uint32_t GetFullMipCount(uint32_t width, uint32_t height)
+	{
+		uint32_t count = 1;
+		for (uint32_t size = std::max(width, height); size > 1; size /= 2)
+		{
+			++count;
+		}
+		return count;
+	}
+
+	// A streaming workload: mostly full mip chains of power-of-two textures, some with odd
+	// sizes and some arrays.
+	std::vector<TextureLayoutDesc> MakeTextures(size_t count)
+	{
+		std::mt19937 random(1);
+		std::vector<TextureLayoutDesc> textures(count);
+		for (TextureLayoutDesc& desc : textures)
+		{
+			desc.Format = c_formats[random() % (sizeof(c_formats) / sizeof(c_formats[0]))];
+			desc.Width = 1u << (2 + random() % 11);
+			desc.Height = 1u << (2 + random() % 11);
+			if (random() % 4 == 0)
+			{
+				desc.Width = 1 + random() % 2048;
+				desc.Height = 1 + random() % 2048;
+			}
+			desc.DepthOrArraySize = random() % 8 == 0 ? 1 + random() % 6 : 1;
+			desc.MipLevels = GetFullMipCount(desc.Width, desc.Height);
+			desc.Volume = false;
+		}
+		return textures;
+	}
+}
+
+// Layouts planned per second, as textures and as subresources: first each texture alone
+// with GetTextureFootprints, then all of them into one reused TextureUploadPlan, with and
+// without building the copies.
+int main()
+{
+	const std::vector<TextureLayoutDesc> textures = MakeTextures(4096);
+	size_t subresourceCount = 0;
+	for (TextureLayoutDesc const& desc : textures)
+	{
+		subresourceCount += static_cast<size_t>(desc.MipLevels) * desc.DepthOrArraySize;
+	}
+
+	std::vector<SubresourceFootprint> footprints(subresourceCount);
+	const double footprintSeconds = Benchmark::MeasureSeconds([&]()
+	{
+		uint64_t offset = 0;
+		size_t next = 0;
+		for (TextureLayoutDesc const& desc : textures)
+		{
+			const uint32_t count = desc.MipLevels * desc.DepthOrArraySize;
+			offset = GetTextureFootprints(desc, 0, count, offset, &footprints[next]);
+			offset = (offset + c_texturePlacementAlignment - 1) & ~static_cast<uint64_t>(c_texturePlacementAlignment - 1);
+			next += count;
+		}
+	});
+
+	TextureUploadPlan plan;
+	const double planSeconds = Benchmark::MeasureSeconds([&]()
+	{
+		plan.Clear();
+		for (TextureLayoutDesc const& desc : textures)
+		{
+			plan.AddTexture(desc, 0, desc.MipLevels * desc.DepthOrArraySize);
+		}
+	});
+
+	std::vector<void*> destinations(textures.size());
+	std::vector<CopyRequest> copies;
+	copies.reserve(subresourceCount);
+	const double copySeconds = Benchmark::MeasureSeconds([&]()
+	{
+		plan.Clear();
+		for (TextureLayoutDesc const& desc : textures)
+		{
+			plan.AddTexture(desc, 0, desc.MipLevels * desc.DepthOrArraySize);
+		}
+		copies.clear();
+		plan.GetCopies(destinations.data(), nullptr, 0, copies);
+	});
+
+	std::printf("%zu textures, %zu subresources, %.1f MB of upload space\n\n", textures.size(), subresourceCount,
+		Benchmark::ToMegabytes(static_cast<double>(plan.GetSize())));
+	std::printf("%-22s %9s %12s %15s\n", "", "ms", "textures/s", "subresources/s");
+	const struct
+	{
+		const char*	Name;
+		double		Seconds;
+	} results[] =
+	{
+		{ "GetTextureFootprints", footprintSeconds },
+		{ "TextureUploadPlan", planSeconds },
+		{ "plan and copies", copySeconds },
+	};
+	for (auto const& result : results)
+	{
+		std::printf("%-22s %9.3f %12.0f %15.0f\n", result.Name, result.Seconds * 1e3, textures.size() / result.Seconds, subresourceCount / result.Seconds);
+	}
+	return 0;
+}
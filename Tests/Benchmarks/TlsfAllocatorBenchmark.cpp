@@ -0,0 +1,99 @@
+﻿#include "Benchmark.h"
+
+#include "Common/TlsfAllocator.h"
+
+#include <random>
+#include <vector>
+
+using namespace DX;
+
+namespace
+{
+	struct Workload
+	{
+		const char*	Name;
+		uint64_t	Capacity;
+		uint64_t	MinimumSize;
+		uint64_t	MaximumSize;
+		uint64_t	Alignment;
+		size_t		LiveCount;		// Allocations kept alive once warmed up.
+	};
+
+	struct Operation
+	{
+		uint64_t	Size;
+		uint32_t	Victim;			// Index of the live allocation freed before allocating.
+	};
+
+	// Frees a random live allocation and makes a new one, over and over, with about
+	// LiveCount alive, which is where fragmentation builds up. The random numbers are drawn
+	// up front so that only the allocator is timed.
+	void Run(Workload const& workload)
+	{
+		std::mt19937 random(1);
+		std::uniform_int_distribution<uint64_t> sizes(workload.MinimumSize, workload.MaximumSize);
+		std::vector<Operation> operations(200000);
+		for (Operation& operation : operations)
+		{
+			operation.Size = sizes(random);
+			operation.Victim = static_cast<uint32_t>(random() % workload.LiveCount);
+		}
+
+		TlsfAllocator allocator(workload.Capacity);
+		std::vector<TlsfAllocation> live(workload.LiveCount);
+		std::vector<bool> allocated(workload.LiveCount, false);
+		size_t failures = 0;
+		size_t count = 0;
+		auto step = [&](Operation const& operation)
+		{
+			if (allocated[operation.Victim])
+			{
+				allocator.Free(live[operation.Victim]);
+			}
+			allocated[operation.Victim] = allocator.Allocate(operation.Size, workload.Alignment, live[operation.Victim]);
+			failures += !allocated[operation.Victim];
+			++count;
+		};
+
+		// Warm up until the live set is full and fragmented.
+		for (Operation const& operation : operations)
+		{
+			step(operation);
+		}
+		failures = 0;
+		count = 0;
+
+		const double seconds = Benchmark::MeasureSeconds([&]()
+		{
+			for (Operation const& operation : operations)
+			{
+				step(operation);
+			}
+		});
+
+		const TlsfStatistics statistics = allocator.GetStatistics();
+		std::printf("%-8s %9.1f %10u %8.1f%% %8u %9.3f %8.2f%%\n", workload.Name, seconds * 1e9 / operations.size(), statistics.AllocationCount,
+			100.0 * statistics.UsedBytes / statistics.Size, statistics.FreeBlockCount, statistics.GetFragmentation(),
+			100.0 * failures / count);
+	}
+}
+
+// Nanoseconds per free and allocate pair at steady state, and the fragmentation left: how
+// much of the free space is outside the largest free block. Failures are the allocations
+// that found no room, as a share of all of them.
+int main()
+{
+	const Workload workloads[] =
+	{
+		{ "buffers", 2 * 1024 * 1024, 16, 4096, 256, 700 },
+		{ "mixed", 32 * 1024 * 1024, 256, 256 * 1024, 256, 150 },
+		{ "textures", 256 * 1024 * 1024, 64 * 1024, 8 * 1024 * 1024, 64 * 1024, 40 },
+	};
+
+	std::printf("%-8s %9s %10s %9s %8s %9s %9s\n", "", "ns/op", "allocated", "used", "free", "frag", "failed");
+	for (Workload const& workload : workloads)
+	{
+		Run(workload);
+	}
+	return 0;
+}
@@ -0,0 +1,148 @@
+﻿#include "Benchmark.h"
+
+#include "Common/VertexQuantizer.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace DX;
+
+namespace
+{
+	struct ErrorSummary
+	{
+		double	Maximum;
+		double	Sum;
+		size_t	Count;
+
+		ErrorSummary() : Maximum(0.0), Sum(0.0), Count(0) {}
+
+		void Add(double error)
+		{
+			Maximum = std::max(Maximum, error);
+			Sum += error;
+			++Count;
+		}
+
+		double GetMean() const { return Count == 0 ? 0.0 : Sum / Count; }
+	};
+
+	// Object-space normals of a sphere centred on the origin.
+	std::vector<float> GetSphereNormals(Mesh const& mesh)
+	{
+		std::vector<float> normals(mesh.Vertices.size() * 3);
+		for (size_t i = 0; i < mesh.Vertices.size(); ++i)
+		{
+			const float* p = mesh.Vertices[i].Position;
+			const float length = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+			for (int c = 0; c < 3; ++c)
+			{
+				normals[i * 3 + c] = length > 0.0f ? p[c] / length : (c == 1 ? 1.0f : 0.0f);
+			}
+		}
+		return normals;
+	}
+
+	bool HasUnitUvs(Mesh const& mesh)
+	{
+		for (MeshVertex const& vertex : mesh.Vertices)
+		{
+			if (vertex.UV[0] < 0.0f || vertex.UV[0] > 1.0f || vertex.UV[1] < 0.0f || vertex.UV[1] > 1.0f)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void Report(const char* name, Mesh const& mesh, const float* normals, VertexUvFormat uvFormat)
+	{
+		QuantizedMesh quantized;
+		const double seconds = Benchmark::MeasureSeconds([&]() { quantized = QuantizeMesh(mesh, uvFormat, normals); });
+
+		// Position error is relative to the largest extent of the bounding box, since the
+		// quantization steps scale with it.
+		const float extent = 2.0f * std::max({ quantized.PositionScale[0], quantized.PositionScale[1], quantized.PositionScale[2] });
+		ErrorSummary position;
+		ErrorSummary uv;
+		ErrorSummary normalDegrees;
+		for (size_t i = 0; i < mesh.Vertices.size(); ++i)
+		{
+			float decodedPosition[3];
+			float decodedUv[2];
+			DecodeVertex(quantized, quantized.Vertices[i], decodedPosition, decodedUv);
+			for (int c = 0; c < 3; ++c)
+			{
+				const float objectPosition = decodedPosition[c] * quantized.PositionScale[c] + quantized.PositionBias[c];
+				position.Add(std::fabs(objectPosition - mesh.Vertices[i].Position[c]) / extent);
+			}
+			for (int c = 0; c < 2; ++c)
+			{
+				uv.Add(std::fabs(decodedUv[c] - mesh.Vertices[i].UV[c]));
+			}
+
+			float decodedNormal[3];
+			DecodeOctahedralNormal(quantized.Vertices[i].Normal, decodedNormal);
+			const float* normal = normals + i * 3;
+			const double cosine = decodedNormal[0] * normal[0] + decodedNormal[1] * normal[1] + decodedNormal[2] * normal[2];
+			normalDegrees.Add(std::acos(std::min(1.0, std::max(-1.0, cosine))) * 180.0 / 3.14159265358979);
+		}
+
+		std::printf("%-16s %-7s %8.3f %9.2f  %9.2e %9.2e  %9.2e %9.2e  %6.3f %6.3f\n", name, uvFormat == VertexUvFormat::Unorm16 ? "Unorm16" : "Half",
+			seconds * 1e3, mesh.Vertices.size() / seconds / 1e6, position.Maximum, position.GetMean(), uv.Maximum, uv.GetMean(),
+			normalDegrees.Maximum, normalDegrees.GetMean());
+	}
+}
+
+// Encode throughput in vertices per second, and the error of the decoded vertices: the
+// position relative to the mesh's extent, the UV, and the normal's angle in degrees.
+int main()
+{
+	const struct
+	{
+		const char*	Name;
+		Mesh		Source;
+	} meshes[] =
+	{
+		{ "uv sphere 64", CreateUvSphere(1.0f, 64, 32) },
+		{ "uv sphere 1024", CreateUvSphere(1.0f, 1024, 512) },
+		{ "icosphere 160", CreateIcosphere(25.0f, 160) },
+	};
+
+	std::printf("%-16s %-7s %8s %9s  %-19s  %-19s  %-13s\n", "", "", "ms", "Mverts/s", "position max/mean", "uv max/mean", "normal deg");
+	for (auto const& entry : meshes)
+	{
+		const std::vector<float> normals = GetSphereNormals(entry.Source);
+		// The icosphere's seam triangles reach past the edge of the texture.
+		if (HasUnitUvs(entry.Source))
+		{
+			Report(entry.Name, entry.Source, normals.data(), VertexUvFormat::Unorm16);
+		}
+		Report(entry.Name, entry.Source, normals.data(), VertexUvFormat::Half);
+	}
+
+	// The half conversions on their own, over every finite half value and back.
+	std::vector<float> values;
+	for (uint32_t bits = 0; bits < 0x10000; ++bits)
+	{
+		if ((bits & 0x7c00) != 0x7c00)
+		{
+			values.push_back(HalfToFloat(static_cast<uint16_t>(bits)));
+		}
+	}
+	std::vector<uint16_t> halves(values.size());
+	const double halfSeconds = Benchmark::MeasureSeconds([&]()
+	{
+		for (size_t i = 0; i < values.size(); ++i)
+		{
+			halves[i] = FloatToHalf(values[i]);
+		}
+	});
+	size_t mismatches = 0;
+	for (size_t i = 0; i < values.size(); ++i)
+	{
+		mismatches += HalfToFloat(halves[i]) != values[i] && values[i] == values[i];
+	}
+	std::printf("\nFloatToHalf: %.1f M/s, %zu of %zu values changed by a round trip\n", values.size() / halfSeconds / 1e6, mismatches, values.size());
+	return 0;
+}
@@ -0,0 +1,193 @@
+﻿#include "Benchmark.h"
+
+#include "Common/VirtualTexture.h"
+
+#include <memory>
+#include <vector>
+
+using namespace DX;
+
+namespace
+{
+	// A 16384x16384 texture in 128x128 tiles: mips 0 to 7 are standard, and the 15-mip chain
+	// packs the rest into one tile.
+	const VirtualTextureLayout c_layout = { 16384, 16384, 15, 128, 128, 8, 1 };
+	const uint32_t c_tilesAcross = 128;
+	const uint32_t c_textureCount = 4;
+
+	// The mip 0 window the camera needs each frame, in tiles; each mip below needs a window
+	// half the size, down to one tile.
+	const uint32_t c_windowTiles = 32;
+
+	// Keeps the heap tile each texture tile is mapped to, and which heap tiles are in use, as
+	// the GPU would after each batch. Counts the heap ranges each batch maps: runs of
+	// consecutive heap tiles, which is what UpdateTileMappings is handed.
+	class HeapTrackingBackend : public TileMappingBackend
+	{
+	public:
+		explicit HeapTrackingBackend(std::vector<uint32_t>& heapUsers) :
+			RangeCount(0),
+			MappedCount(0),
+			m_heapUsers(heapUsers),
+			m_tiles((c_layout.StandardMipCount + 1) * c_tilesAcross * c_tilesAcross, c_unmappedHeapTile)
+		{
+		}
+
+		void UpdateTileMappings(const TileMapping* mappings, size_t count) override
+		{
+			uint32_t previous = c_unmappedHeapTile;
+			for (size_t i = 0; i < count; ++i)
+			{
+				TileMapping const& mapping = mappings[i];
+				uint32_t& tile = m_tiles[(mapping.Mip * c_tilesAcross + mapping.Y) * c_tilesAcross + mapping.X];
+				if (tile != c_unmappedHeapTile)
+				{
+					--m_heapUsers[tile];
+				}
+				tile = mapping.HeapTile;
+				if (tile != c_unmappedHeapTile)
+				{
+					++m_heapUsers[tile];
+					RangeCount += previous == c_unmappedHeapTile || tile != previous + 1;
+					++MappedCount;
+				}
+				previous = tile;
+			}
+		}
+
+		uint64_t	RangeCount;
+		uint64_t	MappedCount;
+
+	private:
+		std::vector<uint32_t>&	m_heapUsers;
+		std::vector<uint32_t>	m_tiles;
+	};
+
+	struct Scene
+	{
+		explicit Scene(uint32_t poolTiles) :
+			Pool(poolTiles),
+			HeapUsers(poolTiles, 0)
+		{
+			for (uint32_t i = 0; i < c_textureCount; ++i)
+			{
+				Backends.emplace_back(new HeapTrackingBackend(HeapUsers));
+				Textures.emplace_back(new VirtualTexture(c_layout, Pool, *Backends.back()));
+			}
+		}
+
+		PhysicalTilePool								Pool;
+		std::vector<uint32_t>							HeapUsers;
+		std::vector<std::unique_ptr<HeapTrackingBackend>>	Backends;
+		std::vector<std::unique_ptr<VirtualTexture>>		Textures;
+	};
+
+	// Maps the tiles a camera sweeping diagonally across every texture needs on one frame,
+	// then flushes. Returns the tiles that weren't mapped already.
+	uint32_t MapFrame(Scene& scene, uint32_t frame, uint32_t& mapCount)
+	{
+		uint32_t newCount = 0;
+		for (uint32_t i = 0; i < c_textureCount; ++i)
+		{
+			VirtualTexture& texture = *scene.Textures[i];
+			for (uint32_t mip = 0; mip < c_layout.StandardMipCount; ++mip)
+			{
+				const uint32_t window = std::max(1u, c_windowTiles >> mip);
+				const uint32_t origin = ((frame + i * 29) >> mip) % (texture.GetTileCountX(mip) - window + 1);
+				for (uint32_t y = origin; y < origin + window; ++y)
+				{
+					for (uint32_t x = origin; x < origin + window; ++x)
+					{
+						newCount += texture.Map(mip, x, y);
+						++mapCount;
+					}
+				}
+			}
+			texture.Flush();
+		}
+		return newCount;
+	}
+
+	// Share of the free heap tiles outside the longest run of them, once half the textures
+	// have been unmapped.
+	double MeasureFreeFragmentation(Scene& scene)
+	{
+		for (uint32_t i = 0; i < c_textureCount; i += 2)
+		{
+			VirtualTexture& texture = *scene.Textures[i];
+			for (uint32_t mip = 0; mip < c_layout.StandardMipCount; ++mip)
+			{
+				for (uint32_t y = 0; y < texture.GetTileCountY(mip); ++y)
+				{
+					for (uint32_t x = 0; x < texture.GetTileCountX(mip); ++x)
+					{
+						texture.Unmap(mip, x, y);
+					}
+				}
+			}
+			texture.Flush();
+		}
+
+		uint32_t freeCount = 0;
+		uint32_t run = 0;
+		uint32_t longestRun = 0;
+		for (uint32_t users : scene.HeapUsers)
+		{
+			run = users == 0 ? run + 1 : 0;
+			freeCount += users == 0;
+			longestRun = std::max(longestRun, run);
+		}
+		return freeCount > 0 ? 1.0 - static_cast<double>(longestRun) / freeCount : 0.0;
+	}
+
+	void Run(const char* name, uint32_t poolTiles, uint32_t frameCount)
+	{
+		std::unique_ptr<Scene> scene;
+		uint32_t mapCount = 0;
+		uint64_t newCount = 0;
+		const double seconds = Benchmark::MeasurePreparedSeconds([&]()
+		{
+			scene.reset();
+			scene.reset(new Scene(poolTiles));
+			mapCount = 0;
+			newCount = 0;
+		}, [&]()
+		{
+			for (uint32_t frame = 0; frame < frameCount; ++frame)
+			{
+				newCount += MapFrame(*scene, frame, mapCount);
+			}
+		});
+
+		uint64_t rangeCount = 0;
+		uint64_t mappedCount = 0;
+		for (auto const& backend : scene->Backends)
+		{
+			rangeCount += backend->RangeCount;
+			mappedCount += backend->MappedCount;
+		}
+		const uint64_t evictionCount = scene->Pool.GetEvictionCount();
+		std::printf("%-9s %6u %9.1f %9.1f %10.1f %10.1f %8.2f %8.3f\n", name, poolTiles, seconds * 1e9 / mapCount, seconds * 1e9 / newCount,
+			static_cast<double>(newCount) / frameCount, static_cast<double>(evictionCount) / frameCount,
+			static_cast<double>(rangeCount) / mappedCount, MeasureFreeFragmentation(*scene));
+	}
+}
+
+// Four 16K textures with a camera sweeping across them, each frame mapping a window of
+// every standard mip and flushing: about 5500 Map calls a frame, most of them for tiles
+// already mapped. With a roomy pool only stale tiles are evicted; at just over the working
+// set each frame's new tiles evict old ones; below it, least recently used replacement
+// evicts every tile before it comes round again.
+//
+// Nanoseconds per Map call, and per new mapping including any eviction and its share of
+// the flush; new mappings and evictions a frame; heap ranges per mapped tile in the
+// batches sent, where 1 means every tile started a range of its own; and the share of free
+// heap tiles outside the longest free run once half the textures are unmapped.
+int main()
+{
+	std::printf("%-9s %6s %9s %9s %10s %10s %8s %8s\n", "", "tiles", "ns/map", "ns/new", "new/frame", "evict/frm", "ranges", "frag");
+	Run("roomy", 16384, 2000);
+	Run("churn", 6144, 2000);
+	Run("thrash", 4096, 500);
+	return 0;
+}
@@ -0,0 +1,170 @@
+﻿#include "TestHarness.h"
+
+#include "Common/CookedTexture.h"
+
+#include <cstdio>
+#include <vector>
+
+using namespace DX;
+
+namespace
+{
+	// Written to the working directory, which is the build directory under ctest.
+	const wchar_t* const c_fileName = L"CookedTextureTests.ctex";
+	const char* const c_narrowFileName = "CookedTextureTests.ctex";
+
+	std::vector<uint8_t> ReadFile()
+	{
+		std::vector<uint8_t> bytes;
+		FILE* file = std::fopen(c_narrowFileName, "rb");
+		if (file != nullptr)
+		{
+			uint8_t buffer[4096];
+			size_t count;
+			while ((count = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+			{
+				bytes.insert(bytes.end(), buffer, buffer + count);
+			}
+			std::fclose(file);
+		}
+		return bytes;
+	}
+
+	void WriteFile(std::vector<uint8_t> const& bytes)
+	{
+		FILE* file = std::fopen(c_narrowFileName, "wb");
+		CHECK(file != nullptr && std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size());
+		if (file != nullptr)
+		{
+			std::fclose(file);
+		}
+	}
+
+	// A cooked texture with every payload byte numbered, so a level read from the wrong
+	// place shows.
+	void WriteCooked(CookedTextureFormat format, uint32_t width, uint32_t height, uint32_t mipCount)
+	{
+		CookedTextureWriter writer(format, width, height, mipCount);
+		for (uint32_t mip = 0; mip < mipCount; ++mip)
+		{
+			CookedTextureMip const& layout = writer.GetMip(mip);
+			uint8_t* data = writer.GetMipData(mip);
+			for (size_t i = 0; i < static_cast<size_t>(layout.RowPitch) * layout.RowCount; ++i)
+			{
+				data[i] = static_cast<uint8_t>(mip * 31 + i);
+			}
+		}
+		writer.Write(c_fileName);
+	}
+
+	CookedTextureHeader& GetHeader(std::vector<uint8_t>& bytes)
+	{
+		return *reinterpret_cast<CookedTextureHeader*>(bytes.data());
+	}
+
+	CookedTextureMip& GetMip(std::vector<uint8_t>& bytes, uint32_t mip)
+	{
+		return reinterpret_cast<CookedTextureMip*>(bytes.data() + sizeof(CookedTextureHeader))[mip];
+	}
+
+	// Cooks a file, changes it with corrupt, and checks that it no longer loads.
+	template<typename Corrupt>
+	void CheckRejected(CookedTextureFormat format, uint32_t width, uint32_t height, uint32_t mipCount, Corrupt corrupt)
+	{
+		WriteCooked(format, width, height, mipCount);
+		std::vector<uint8_t> bytes = ReadFile();
+		corrupt(bytes);
+		WriteFile(bytes);
+		CHECK_THROWS(CookedTexture texture(c_fileName), CookedTextureError);
+	}
+
+	// Full chains in each format, including sizes that aren't whole blocks, load as written.
+	void FullChainsLoad()
+	{
+		const struct
+		{
+			CookedTextureFormat	Format;
+			uint32_t			Width;
+			uint32_t			Height;
+			uint32_t			MipCount;
+		} cases[] =
+		{
+			{ CookedTextureFormat::Bgra8, 512, 512, 10 },
+			{ CookedTextureFormat::Bgra8, 300, 7, 9 },
+			{ CookedTextureFormat::BC1, 64, 64, 7 },
+			{ CookedTextureFormat::BC3, 8, 8, 4 },
+			{ CookedTextureFormat::BC7, 252, 132, 8 },
+			{ CookedTextureFormat::BC7, 1, 1, 1 },
+		};
+		for (auto const& test : cases)
+		{
+			WriteCooked(test.Format, test.Width, test.Height, test.MipCount);
+			CookedTexture texture(c_fileName);
+			CHECK(texture.GetHeader().MipCount == test.MipCount);
+			CookedTextureMip const& last = texture.GetMip(test.MipCount - 1);
+			CHECK(texture.GetPayload()[last.Offset] == static_cast<uint8_t>((test.MipCount - 1) * 31));
+		}
+	}
+
+	// A chain can't go past 1x1: floor(log2(max(width, height))) + 1 levels at most.
+	void TooManyMips()
+	{
+		CheckRejected(CookedTextureFormat::Bgra8, 512, 512, 11, [](std::vector<uint8_t>&) {});
+		CheckRejected(CookedTextureFormat::BC1, 300, 7, 10, [](std::vector<uint8_t>&) {});
+		CheckRejected(CookedTextureFormat::BC7, 1, 1, 2, [](std::vector<uint8_t>&) {});
+	}
+
+	// Each level has to be exactly the size its format and the texture's size give it.
+	void LevelSizeMismatch()
+	{
+		CheckRejected(CookedTextureFormat::BC1, 64, 64, 7, [](std::vector<uint8_t>& bytes) { GetMip(bytes, 2).Width += 4; });
+		CheckRejected(CookedTextureFormat::BC1, 64, 64, 7, [](std::vector<uint8_t>& bytes) { GetMip(bytes, 2).Height -= 4; });
+		CheckRejected(CookedTextureFormat::BC3, 64, 64, 7, [](std::vector<uint8_t>& bytes) { GetMip(bytes, 6).RowSize = 8; });
+
+		// Larger but self-consistent: a level that claims more blocks than its size needs.
+		CheckRejected(CookedTextureFormat::BC1, 64, 64, 7, [](std::vector<uint8_t>& bytes)
+		{
+			CookedTextureMip& mip = GetMip(bytes, 0);
+			mip.Width += 4;
+			mip.RowSize += 8;
+		});
+		CheckRejected(CookedTextureFormat::Bgra8, 64, 64, 7, [](std::vector<uint8_t>& bytes) { GetMip(bytes, 1).RowCount = 16; });
+	}
+
+	// A header that doesn't match the levels: a different format or size.
+	void HeaderMismatch()
+	{
+		CheckRejected(CookedTextureFormat::Bgra8, 64, 64, 7, [](std::vector<uint8_t>& bytes)
+		{
+			GetHeader(bytes).Format = static_cast<uint32_t>(CookedTextureFormat::BC1);
+		});
+		CheckRejected(CookedTextureFormat::BC1, 64, 64, 7, [](std::vector<uint8_t>& bytes)
+		{
+			GetHeader(bytes).Format = static_cast<uint32_t>(CookedTextureFormat::BC7);
+		});
+		CheckRejected(CookedTextureFormat::Bgra8, 64, 64, 7, [](std::vector<uint8_t>& bytes) { GetHeader(bytes).Width = 128; });
+		CheckRejected(CookedTextureFormat::Bgra8, 64, 64, 7, [](std::vector<uint8_t>& bytes) { GetHeader(bytes).Height = 32; });
+		CheckRejected(CookedTextureFormat::Bgra8, 64, 64, 7, [](std::vector<uint8_t>& bytes) { GetHeader(bytes).Format = 9; });
+	}
+
+	void TruncatedPayload()
+	{
+		CheckRejected(CookedTextureFormat::BC7, 252, 132, 8, [](std::vector<uint8_t>& bytes) { bytes.resize(bytes.size() - 1); });
+		CheckRejected(CookedTextureFormat::BC7, 252, 132, 8, [](std::vector<uint8_t>& bytes) { bytes.resize(sizeof(CookedTextureHeader) - 1); });
+	}
+}
+
+int main()
+{
+	const Test::TestCase tests[] =
+	{
+		{ "FullChainsLoad", FullChainsLoad },
+		{ "TooManyMips", TooManyMips },
+		{ "LevelSizeMismatch", LevelSizeMismatch },
+		{ "HeaderMismatch", HeaderMismatch },
+		{ "TruncatedPayload", TruncatedPayload },
+	};
+	const int result = Test::RunTests(tests);
+	std::remove(c_narrowFileName);
+	return result;
+}
@@ -0,0 +1,225 @@
+﻿#include "TestHarness.h"
+
+#include "Common/CookedTexture.h"
+#include "Common/FileView.h"
+#include "Common/PngDecoder.h"
+#include "Common/TextureLayout.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace DX;
+
+// LoadTextureFromPngFile decodes each level straight into its placed footprint in upload
+// memory. These run the same decodes into plain memory standing in for the mapped upload
+// buffer, filled beforehand so that any byte written outside the rows' data shows.
+
+namespace
+{
+	const uint32_t c_formatB8G8R8A8Unorm = 87;
+	const uint8_t c_unwritten = 0xcd;
+
+	// Checks that each footprint's rows hold the tightly packed image, and that nothing
+	// else in the buffer was written.
+	void CheckFootprints(std::vector<uint8_t> const& buffer, std::vector<SubresourceFootprint> const& footprints,
+		std::vector<std::vector<uint8_t>> const& images)
+	{
+		std::vector<bool> written(buffer.size(), false);
+		for (size_t i = 0; i < footprints.size(); ++i)
+		{
+			SubresourceFootprint const& footprint = footprints[i];
+			const size_t rowSize = static_cast<size_t>(footprint.RowSize);
+			for (uint32_t row = 0; row < footprint.RowCount; ++row)
+			{
+				const size_t rowOffset = static_cast<size_t>(footprint.Offset) + static_cast<size_t>(row) * footprint.RowPitch;
+				CHECK(memcmp(buffer.data() + rowOffset, images[i].data() + row * rowSize, rowSize) == 0);
+				std::fill(written.begin() + rowOffset, written.begin() + rowOffset + rowSize, true);
+			}
+		}
+
+		size_t overwritten = 0;
+		for (size_t i = 0; i < buffer.size(); ++i)
+		{
+			overwritten += !written[i] && buffer[i] != c_unwritten;
+		}
+		CHECK(overwritten == 0);
+	}
+
+	std::vector<uint8_t> DecodePacked(PngDecoder& decoder)
+	{
+		std::vector<uint8_t> pixels(static_cast<size_t>(decoder.GetInfo().Width) * decoder.GetInfo().Height * 4);
+		decoder.Decode(pixels.data(), decoder.GetInfo().Width * 4);
+		return pixels;
+	}
+
+	// The shipped mips, decoded into the footprints of one upload allocation that starts
+	// part way into the buffer, as a suballocation of the upload ring does.
+	void ShippedMipsIntoFootprints()
+	{
+		const char* const fileNames[] = { "1.png", "2.png", "3.png", "4.png", "5.png", "6.png" };
+		const uint32_t mipCount = 6;
+		const uint64_t allocationOffset = 3 * c_texturePlacementAlignment;
+
+		std::vector<SubresourceFootprint> footprints(mipCount);
+		const uint64_t allocationSize = GetTextureFootprints(TextureLayoutDesc{ c_formatB8G8R8A8Unorm, 512, 512, 1, mipCount, false },
+			0, mipCount, allocationOffset, footprints.data());
+		std::vector<uint8_t> uploadBuffer(static_cast<size_t>(allocationOffset + allocationSize + 1024), c_unwritten);
+
+		std::vector<std::vector<uint8_t>> images;
+		for (uint32_t mip = 0; mip < mipCount; ++mip)
+		{
+			FileView file(Test::GetAssetPath(fileNames[mip]));
+			PngDecoder decoder(file.GetData(), file.GetSize());
+			images.push_back(DecodePacked(decoder));
+			decoder.Decode(uploadBuffer.data() + footprints[mip].Offset, footprints[mip].RowPitch);
+		}
+		CheckFootprints(uploadBuffer, footprints, images);
+	}
+
+	// A PNG of the given pixels, RGB or RGBA, with its image data in stored deflate blocks.
+	std::vector<uint8_t> EncodePng(uint32_t width, uint32_t height, bool alpha, std::vector<uint8_t> const& pixels)
+	{
+		std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+		auto writeUint32 = [](std::vector<uint8_t>& out, uint32_t value)
+		{
+			for (int shift = 24; shift >= 0; shift -= 8)
+			{
+				out.push_back(static_cast<uint8_t>(value >> shift));
+			}
+		};
+		auto writeChunk = [&](const char* type, std::vector<uint8_t> const& data)
+		{
+			writeUint32(png, static_cast<uint32_t>(data.size()));
+			const size_t typeStart = png.size();
+			png.insert(png.end(), type, type + 4);
+			png.insert(png.end(), data.begin(), data.end());
+
+			uint32_t crc = 0xffffffff;
+			for (size_t i = typeStart; i < png.size(); ++i)
+			{
+				crc ^= png[i];
+				for (int bit = 0; bit < 8; ++bit)
+				{
+					crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+				}
+			}
+			writeUint32(png, ~crc);
+		};
+
+		std::vector<uint8_t> header;
+		writeUint32(header, width);
+		writeUint32(header, height);
+		header.insert(header.end(), { 8, static_cast<uint8_t>(alpha ? 6 : 2), 0, 0, 0 });
+		writeChunk("IHDR", header);
+
+		// Every row is filtered with None.
+		const size_t rowBytes = static_cast<size_t>(width) * (alpha ? 4 : 3);
+		std::vector<uint8_t> filtered;
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			filtered.push_back(0);
+			filtered.insert(filtered.end(), pixels.begin() + y * rowBytes, pixels.begin() + (y + 1) * rowBytes);
+		}
+
+		std::vector<uint8_t> zlib = { 0x78, 0x01 };
+		for (size_t start = 0; start < filtered.size() || start == 0; start += 65535)
+		{
+			const size_t length = std::min<size_t>(65535, filtered.size() - start);
+			zlib.push_back(start + length == filtered.size() ? 1 : 0);
+			zlib.insert(zlib.end(), { static_cast<uint8_t>(length), static_cast<uint8_t>(length >> 8),
+				static_cast<uint8_t>(~length), static_cast<uint8_t>(~length >> 8) });
+			zlib.insert(zlib.end(), filtered.begin() + start, filtered.begin() + start + length);
+		}
+		uint32_t a = 1, b = 0;
+		for (uint8_t value : filtered)
+		{
+			a = (a + value) % 65521;
+			b = (b + a) % 65521;
+		}
+		writeUint32(zlib, (b << 16) | a);
+		writeChunk("IDAT", zlib);
+		writeChunk("IEND", {});
+		return png;
+	}
+
+	// Widths that leave a partial vector at the end of every row, decoded into a pitch with
+	// little padding and into one with a lot: the expansion's vector stores stop at the row.
+	void OddWidthsIntoFootprints()
+	{
+		for (bool alpha : { false, true })
+		{
+			for (uint32_t width : { 1u, 3u, 5u, 7u, 13u, 33u, 63u, 65u, 67u, 129u })
+			{
+				const uint32_t height = 5;
+				const uint32_t channels = alpha ? 4 : 3;
+				std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * channels);
+				for (size_t i = 0; i < pixels.size(); ++i)
+				{
+					pixels[i] = static_cast<uint8_t>(i * 151 + 17);
+				}
+				const std::vector<uint8_t> png = EncodePng(width, height, alpha, pixels);
+				PngDecoder decoder(png.data(), png.size());
+
+				std::vector<SubresourceFootprint> footprints(1);
+				const uint64_t size = GetTextureFootprints(TextureLayoutDesc{ c_formatB8G8R8A8Unorm, width, height, 1, 1, false }, 0, 1, 0, footprints.data());
+				std::vector<uint8_t> uploadBuffer(static_cast<size_t>(footprints[0].RowPitch) * height + 64, c_unwritten);
+				CHECK(size <= uploadBuffer.size());
+
+				std::vector<std::vector<uint8_t>> images = { DecodePacked(decoder) };
+				decoder.Decode(uploadBuffer.data(), footprints[0].RowPitch);
+				CheckFootprints(uploadBuffer, footprints, images);
+
+				// Opaque pixels are just reordered to BGRA.
+				if (!alpha)
+				{
+					bool expanded = true;
+					for (size_t pixel = 0; pixel < static_cast<size_t>(width) * height; ++pixel)
+					{
+						const uint8_t* source = &pixels[pixel * 3];
+						const uint8_t* decoded = &images[0][pixel * 4];
+						expanded = expanded && decoded[0] == source[2] && decoded[1] == source[1] && decoded[2] == source[0] && decoded[3] == 255;
+					}
+					CHECK(expanded);
+				}
+
+				// A pitch of exactly the row's size leaves no room to overrun into.
+				std::vector<uint8_t> packed(static_cast<size_t>(width) * 4 * height + 64, c_unwritten);
+				decoder.Decode(packed.data(), width * 4);
+				CHECK(memcmp(packed.data(), images[0].data(), images[0].size()) == 0);
+				bool untouched = true;
+				for (size_t i = images[0].size(); i < packed.size(); ++i)
+				{
+					untouched = untouched && packed[i] == c_unwritten;
+				}
+				CHECK(untouched);
+			}
+		}
+	}
+
+	// The cooked payload the loader decodes into when the texture isn't compressed is laid
+	// out as the upload footprints are.
+	void CookedLayoutMatchesFootprints()
+	{
+		const uint32_t mipCount = 10;
+		CookedTextureWriter writer(CookedTextureFormat::Bgra8, 512, 512, mipCount);
+		std::vector<SubresourceFootprint> footprints(mipCount);
+		GetTextureFootprints(TextureLayoutDesc{ c_formatB8G8R8A8Unorm, 512, 512, 1, mipCount, false }, 0, mipCount, 0, footprints.data());
+		for (uint32_t mip = 0; mip < mipCount; ++mip)
+		{
+			CookedTextureMip const& cooked = writer.GetMip(mip);
+			CHECK(cooked.Offset == footprints[mip].Offset && cooked.RowPitch == footprints[mip].RowPitch &&
+				cooked.RowCount == footprints[mip].RowCount && cooked.RowSize == footprints[mip].RowSize);
+		}
+	}
+}
+
+int main()
+{
+	const Test::TestCase tests[] =
+	{
+		{ "ShippedMipsIntoFootprints", ShippedMipsIntoFootprints },
+		{ "OddWidthsIntoFootprints", OddWidthsIntoFootprints },
+		{ "CookedLayoutMatchesFootprints", CookedLayoutMatchesFootprints },
+	};
+	return Test::RunTests(tests);
+}
@@ -0,0 +1,154 @@
+﻿#include "TestHarness.h"
+
+#include "Common/DeferredReleaseQueue.h"
+
+#include <memory>
+#include <vector>
+
+using namespace DX;
+
+namespace
+{
+	// Stands in for an ID3D12Fence and the queue that signals it: Signal hands out the next
+	// value, and the GPU finishing work is Complete.
+	class MockFence
+	{
+	public:
+		MockFence() : m_nextValue(1), m_completedValue(0) {}
+
+		uint64_t Signal() { return m_nextValue++; }
+		void Complete(uint64_t value) { m_completedValue = value; }
+		uint64_t GetCompletedValue() const { return m_completedValue; }
+
+	private:
+		uint64_t	m_nextValue;
+		uint64_t	m_completedValue;
+	};
+
+	// An object that records its release, in order.
+	typedef std::shared_ptr<int> Resource;
+
+	Resource MakeResource(int id, std::vector<int>& released)
+	{
+		return Resource(new int(id), [&released](int* value) { released.push_back(*value); delete value; });
+	}
+
+	// Nothing is released before its fence value completes, and everything queued with a
+	// value is released once it has, in the order it was queued.
+	void ReleaseAfterFence()
+	{
+		std::vector<int> released;
+		MockFence fence;
+		DeferredReleaseQueue<Resource> queue;
+
+		const uint64_t first = fence.Signal();
+		queue.Enqueue(MakeResource(1, released), first);
+		queue.Enqueue(MakeResource(2, released), first);
+		const uint64_t second = fence.Signal();
+		queue.Enqueue(MakeResource(3, released), second);
+
+		CHECK(queue.Drain(fence.GetCompletedValue()) == 0);
+		CHECK(released.empty());
+
+		fence.Complete(first);
+		CHECK(queue.Drain(fence.GetCompletedValue()) == 2);
+		CHECK((released == std::vector<int>{ 1, 2 }));
+		CHECK(queue.GetSize() == 1);
+
+		// Draining again at the same value releases nothing more.
+		CHECK(queue.Drain(fence.GetCompletedValue()) == 0);
+
+		fence.Complete(second);
+		CHECK(queue.Drain(fence.GetCompletedValue()) == 1);
+		CHECK((released == std::vector<int>{ 1, 2, 3 }));
+		CHECK(queue.GetSize() == 0);
+	}
+
+	// The fence passing several values between drains releases them all at once, and an
+	// object queued with a lower value than the one before it waits for that one.
+	void OutOfOrderCompletion()
+	{
+		std::vector<int> released;
+		MockFence fence;
+		DeferredReleaseQueue<Resource> queue;
+
+		const uint64_t first = fence.Signal();
+		const uint64_t second = fence.Signal();
+		const uint64_t third = fence.Signal();
+		queue.Enqueue(MakeResource(1, released), first);
+		queue.Enqueue(MakeResource(3, released), third);
+		queue.Enqueue(MakeResource(2, released), second);
+
+		fence.Complete(second);
+		CHECK(queue.Drain(fence.GetCompletedValue()) == 1);
+		CHECK((released == std::vector<int>{ 1 }));
+
+		// A stale, lower completed value doesn't release anything.
+		CHECK(queue.Drain(first) == 0);
+
+		fence.Complete(third);
+		CHECK(queue.Drain(fence.GetCompletedValue()) == 2);
+		CHECK((released == std::vector<int>{ 1, 3, 2 }));
+
+		for (int id = 10; id < 20; ++id)
+		{
+			queue.Enqueue(MakeResource(id, released), fence.Signal());
+		}
+		fence.Complete(fence.Signal());
+		CHECK(queue.Drain(fence.GetCompletedValue()) == 10);
+		CHECK(released.size() == 13 && released.back() == 19);
+	}
+
+	// At shutdown, after the last wait for the GPU, everything left is released by a drain
+	// at the last value, by Clear, or by the queue going away.
+	void FlushAtShutdown()
+	{
+		std::vector<int> released;
+		MockFence fence;
+		{
+			DeferredReleaseQueue<Resource> queue;
+			queue.Enqueue(MakeResource(1, released), fence.Signal());
+			queue.Enqueue(MakeResource(2, released), fence.Signal());
+			const uint64_t last = fence.Signal();
+			queue.Enqueue(MakeResource(3, released), last);
+
+			fence.Complete(last);
+			CHECK(queue.Drain(fence.GetCompletedValue()) == 3);
+			CHECK((released == std::vector<int>{ 1, 2, 3 }));
+
+			queue.Enqueue(MakeResource(4, released), fence.Signal());
+			queue.Enqueue(MakeResource(5, released), fence.Signal());
+			queue.Clear();
+			CHECK(queue.GetSize() == 0);
+			CHECK(released.size() == 5);
+
+			queue.Enqueue(MakeResource(6, released), fence.Signal());
+		}
+		CHECK(released.size() == 6 && released.back() == 6);
+	}
+
+	// The queue doesn't keep a released object alive for anyone still holding it.
+	void ReleasesOnlyItsReference()
+	{
+		std::vector<int> released;
+		DeferredReleaseQueue<Resource> queue;
+		Resource resource = MakeResource(1, released);
+		queue.Enqueue(resource, 1);
+		CHECK(queue.Drain(1) == 1);
+		CHECK(released.empty() && resource.use_count() == 1);
+		resource.reset();
+		CHECK(released.size() == 1);
+	}
+}
+
+int main()
+{
+	const Test::TestCase tests[] =
+	{
+		{ "ReleaseAfterFence", ReleaseAfterFence },
+		{ "OutOfOrderCompletion", OutOfOrderCompletion },
+		{ "FlushAtShutdown", FlushAtShutdown },
+		{ "ReleasesOnlyItsReference", ReleasesOnlyItsReference },
+	};
+	return Test::RunTests(tests);
+}
@@ -0,0 +1,219 @@
+﻿#include "TestHarness.h"
+
+#include "Common/IndexBuffer.h"
+#include "Common/MeshGenerator.h"
+#include "Common/MeshOptimizer.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+using namespace DX;
+
+namespace
+{
+	// A mesh of the given triangles, with just enough vertices for them.
+	Mesh MakeTriangles(std::vector<uint32_t> const& indices)
+	{
+		Mesh mesh;
+		mesh.Vertices.resize(indices.empty() ? 0 : *std::max_element(indices.begin(), indices.end()) + 1);
+		mesh.Indices = indices;
+		return mesh;
+	}
+
+	// The submeshes cover the indices in order, and each index plus its submesh's base
+	// vertex is the mesh's index.
+	void CheckIndexBuffer(Mesh const& mesh, IndexBuffer const& buffer)
+	{
+		CHECK(buffer.Data.size() == mesh.Indices.size() * buffer.IndexSize);
+		size_t covered = 0;
+		for (IndexedSubmesh const& submesh : buffer.Submeshes)
+		{
+			CHECK(submesh.FirstIndex == covered && submesh.IndexCount % 3 == 0);
+			for (uint32_t i = submesh.FirstIndex; i < submesh.FirstIndex + submesh.IndexCount; ++i)
+			{
+				const uint32_t index = buffer.IndexSize == 2 ? reinterpret_cast<const uint16_t*>(buffer.Data.data())[i] :
+					reinterpret_cast<const uint32_t*>(buffer.Data.data())[i];
+				if (index + submesh.BaseVertex != mesh.Indices[i])
+				{
+					CHECK(index + submesh.BaseVertex == mesh.Indices[i]);
+					return;
+				}
+			}
+			covered += submesh.IndexCount;
+		}
+		CHECK(covered == mesh.Indices.size());
+	}
+
+	// Meshes using 65535, 65536 and 65537 vertices: the last two need a base vertex, or a
+	// second submesh, to be drawn with 16-bit indices.
+	void SixteenBitBoundary()
+	{
+		{
+			Mesh mesh = MakeTriangles({ 0, 1, 65534 });
+			IndexBuffer buffer = BuildIndexBuffer(mesh);
+			CHECK(buffer.IndexSize == 2 && buffer.Submeshes.size() == 1 && buffer.Submeshes[0].BaseVertex == 0);
+			CheckIndexBuffer(mesh, buffer);
+		}
+		{
+			Mesh mesh = MakeTriangles({ 0, 1, 65535 });
+			IndexBuffer buffer = BuildIndexBuffer(mesh);
+			CHECK(buffer.IndexSize == 2 && buffer.Submeshes.size() == 1 && buffer.Submeshes[0].BaseVertex == 0);
+			CheckIndexBuffer(mesh, buffer);
+		}
+		{
+			// One triangle spanning 65537 vertices can't be drawn with 16-bit indices.
+			Mesh mesh = MakeTriangles({ 0, 1, 65536 });
+			IndexBuffer buffer = BuildIndexBuffer(mesh);
+			CHECK(buffer.IndexSize == 4 && buffer.Submeshes.size() == 1 && buffer.Submeshes[0].BaseVertex == 0);
+			CheckIndexBuffer(mesh, buffer);
+		}
+		{
+			// 65537 vertices, but no triangle spans more than 65536 of them.
+			Mesh mesh = MakeTriangles({ 1, 2, 65536 });
+			IndexBuffer buffer = BuildIndexBuffer(mesh);
+			CHECK(buffer.IndexSize == 2 && buffer.Submeshes.size() == 1 && buffer.Submeshes[0].BaseVertex == 1);
+			CheckIndexBuffer(mesh, buffer);
+		}
+		{
+			Mesh mesh = MakeTriangles({ 0, 1, 2, 65534, 65535, 65536 });
+			IndexBuffer buffer = BuildIndexBuffer(mesh);
+			CHECK(buffer.IndexSize == 2 && buffer.Submeshes.size() == 2 && buffer.Submeshes[1].BaseVertex == 65534);
+			CheckIndexBuffer(mesh, buffer);
+
+			buffer = BuildIndexBuffer(mesh, 1);
+			CHECK(buffer.IndexSize == 4 && buffer.Submeshes.size() == 1);
+			CheckIndexBuffer(mesh, buffer);
+		}
+	}
+
+	// A later triangle going back below the run's highest vertex stays in the run while the
+	// run's span fits, and starts a new one when it doesn't.
+	void SubmeshSplitting()
+	{
+		{
+			Mesh mesh = MakeTriangles({ 0, 1, 2, 60000, 60001, 65535, 0, 65535, 3 });
+			IndexBuffer buffer = BuildIndexBuffer(mesh);
+			CHECK(buffer.IndexSize == 2 && buffer.Submeshes.size() == 1);
+			CheckIndexBuffer(mesh, buffer);
+		}
+		{
+			Mesh mesh = MakeTriangles({ 0, 1, 2, 60000, 60001, 65536, 0, 1, 3 });
+			IndexBuffer buffer = BuildIndexBuffer(mesh);
+			CHECK(buffer.IndexSize == 2 && buffer.Submeshes.size() == 3);
+			CheckIndexBuffer(mesh, buffer);
+		}
+		{
+			Mesh mesh = MakeTriangles({ 0, 1, 2 });
+			IndexBuffer buffer = BuildIndexBuffer(mesh, 0);
+			CHECK(buffer.IndexSize == 4);
+			CheckIndexBuffer(mesh, buffer);
+		}
+		{
+			Mesh mesh;
+			IndexBuffer buffer = BuildIndexBuffer(mesh);
+			CHECK(buffer.IndexSize == 2 && buffer.Submeshes.empty() && buffer.Data.empty());
+		}
+		CHECK_THROWS(BuildIndexBuffer(MakeTriangles({ 0, 1, 2, 3 })), std::invalid_argument);
+	}
+
+	// Every length up to a few vectors, so that each SIMD tail length is converted, with the
+	// largest index that fits and with ones that don't at every position.
+	void ConversionTails()
+	{
+		const uint32_t baseVertex = 100000;
+		for (size_t count = 0; count < 40; ++count)
+		{
+			std::vector<uint32_t> indices(count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				indices[i] = baseVertex + static_cast<uint32_t>(i * 1723 % 65536);
+			}
+
+			std::vector<uint16_t> destination(count + 1, 0xabcd);
+			ConvertIndices(indices.data(), count, baseVertex, destination.data(), 2);
+			bool converted = true;
+			for (size_t i = 0; i < count; ++i)
+			{
+				converted = converted && destination[i] + baseVertex == indices[i];
+			}
+			CHECK(converted);
+			CHECK(destination[count] == 0xabcd);
+
+			for (size_t position = 0; position < count; ++position)
+			{
+				std::vector<uint32_t> largest = indices;
+				largest[position] = baseVertex + 65535;
+				ConvertIndices(largest.data(), count, baseVertex, destination.data(), 2);
+				CHECK(destination[position] == 65535);
+
+				for (uint32_t offset : { 65536u, 65537u, 0x7fffffffu })
+				{
+					std::vector<uint32_t> tooLarge = indices;
+					tooLarge[position] = baseVertex + offset;
+					CHECK_THROWS(ConvertIndices(tooLarge.data(), count, baseVertex, destination.data(), 2), std::out_of_range);
+				}
+				std::vector<uint32_t> largestValue = indices;
+				largestValue[position] = 0xffffffffu;
+				CHECK_THROWS(ConvertIndices(largestValue.data(), count, baseVertex, destination.data(), 2), std::out_of_range);
+			}
+		}
+	}
+
+	// An index below the base vertex would wrap around to a large one, so it's rejected in
+	// both sizes rather than converted.
+	void BelowBaseVertex()
+	{
+		const uint32_t baseVertex = 100000;
+		for (size_t count = 1; count < 40; ++count)
+		{
+			std::vector<uint32_t> indices(count, baseVertex);
+			std::vector<uint32_t> destination(count);
+			for (size_t position = 0; position < count; ++position)
+			{
+				for (uint32_t index : { baseVertex - 1, 0u })
+				{
+					std::vector<uint32_t> below = indices;
+					below[position] = index;
+					CHECK_THROWS(ConvertIndices(below.data(), count, baseVertex, destination.data(), 2), std::out_of_range);
+					CHECK_THROWS(ConvertIndices(below.data(), count, baseVertex, destination.data(), 4), std::out_of_range);
+				}
+			}
+		}
+
+		const uint32_t indices[] = { 5, 6, 7 };
+		uint32_t destination[3];
+		ConvertIndices(indices, 3, 5, destination, 4);
+		CHECK(destination[0] == 0 && destination[2] == 2);
+		CHECK_THROWS(ConvertIndices(indices, 3, 0, destination, 3), std::invalid_argument);
+	}
+
+	// Cubes just under and over 16-bit range, ordered as the renderer orders them, take as
+	// few submeshes as their vertex count allows.
+	void GeneratedMeshes()
+	{
+		for (uint32_t segments : { 103u, 104u, 150u })
+		{
+			Mesh mesh = CreateCube(1.0f, segments);
+			OptimizeVertexCache(mesh);
+			OptimizeVertexFetch(mesh);
+			IndexBuffer buffer = BuildIndexBuffer(mesh);
+			CHECK(buffer.IndexSize == 2);
+			CHECK(buffer.Submeshes.size() == (mesh.Vertices.size() + 65535) / 65536);
+			CheckIndexBuffer(mesh, buffer);
+		}
+	}
+}
+
+int main()
+{
+	const Test::TestCase tests[] =
+	{
+		{ "SixteenBitBoundary", SixteenBitBoundary },
+		{ "SubmeshSplitting", SubmeshSplitting },
+		{ "ConversionTails", ConversionTails },
+		{ "BelowBaseVertex", BelowBaseVertex },
+		{ "GeneratedMeshes", GeneratedMeshes },
+	};
+	return Test::RunTests(tests);
+}
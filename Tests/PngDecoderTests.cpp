@@ -0,0 +1,99 @@
+﻿#include "TestHarness.h"
+
+#include "Common/FileView.h"
+#include "Common/PngDecoder.h"
+#include "Common/ThreadPool.h"
+
+#include <future>
+#include <memory>
+#include <vector>
+
+using namespace DX;
+
+namespace
+{
+	const char* const c_mipFileNames[] = { "1.png", "2.png", "3.png", "4.png", "5.png", "6.png" };
+	const size_t c_mipFileCount = sizeof(c_mipFileNames) / sizeof(c_mipFileNames[0]);
+
+	struct DecodedImage
+	{
+		uint32_t				Width;
+		uint32_t				Height;
+		std::vector<uint8_t>	Pixels;
+	};
+
+	DecodedImage DecodeFile(const char* fileName)
+	{
+		FileView file(Test::GetAssetPath(fileName));
+		PngDecoder decoder(file.GetData(), file.GetSize());
+		DecodedImage image;
+		image.Width = decoder.GetInfo().Width;
+		image.Height = decoder.GetInfo().Height;
+		image.Pixels.resize(static_cast<size_t>(image.Width) * image.Height * 4);
+		decoder.Decode(image.Pixels.data(), image.Width * 4);
+		return image;
+	}
+
+	// The mips decoded on the worker threads, all at once, as LoadTextureFromPngFile does,
+	// match the same files decoded one after another on this thread byte for byte.
+	void ParallelDecodeMatchesSerial()
+	{
+		std::vector<DecodedImage> serial;
+		for (const char* fileName : c_mipFileNames)
+		{
+			serial.push_back(DecodeFile(fileName));
+		}
+
+		for (unsigned int threadCount : { 1u, 2u, 4u, 0u })
+		{
+			ThreadPool threadPool(threadCount);
+			std::vector<std::future<DecodedImage>> pending;
+			for (const char* fileName : c_mipFileNames)
+			{
+				pending.push_back(threadPool.Submit([fileName]() { return DecodeFile(fileName); }));
+			}
+
+			for (size_t mip = 0; mip < c_mipFileCount; ++mip)
+			{
+				DecodedImage parallel = pending[mip].get();
+				CHECK(parallel.Width == serial[mip].Width && parallel.Height == serial[mip].Height);
+				CHECK(parallel.Pixels.size() == serial[mip].Pixels.size() &&
+					memcmp(parallel.Pixels.data(), serial[mip].Pixels.data(), parallel.Pixels.size()) == 0);
+			}
+		}
+	}
+
+	// The shipped mips halve in size from 512x512.
+	void ShippedMipSizes()
+	{
+		for (size_t mip = 0; mip < c_mipFileCount; ++mip)
+		{
+			FileView file(Test::GetAssetPath(c_mipFileNames[mip]));
+			PngDecoder decoder(file.GetData(), file.GetSize());
+			CHECK(decoder.GetInfo().Width == 512u >> mip && decoder.GetInfo().Height == 512u >> mip);
+		}
+	}
+
+	// A task's exception reaches the caller through its future, and the pool keeps working.
+	void DecodeErrorReachesCaller()
+	{
+		ThreadPool threadPool(2);
+		const uint8_t notPng[] = { 'n', 'o', 't', ' ', 'a', ' ', 'p', 'n', 'g' };
+		auto failed = threadPool.Submit([&notPng]() { PngDecoder decoder(notPng, sizeof(notPng)); return decoder.GetInfo().Width; });
+		CHECK_THROWS(failed.get(), PngDecodeError);
+
+		auto decoded = threadPool.Submit([]() { return DecodeFile(c_mipFileNames[c_mipFileCount - 1]); });
+		CHECK(decoded.get().Width == 16);
+	}
+}
+
+int main()
+{
+	const Test::TestCase tests[] =
+	{
+		{ "ParallelDecodeMatchesSerial", ParallelDecodeMatchesSerial },
+		{ "ShippedMipSizes", ShippedMipSizes },
+		{ "DecodeErrorReachesCaller", DecodeErrorReachesCaller },
+	};
+	return Test::RunTests(tests);
+}
@@ -0,0 +1,257 @@
+﻿#include "TestHarness.h"
+
+#include "Common/FeedbackEmulator.h"
+#include "Common/ResidencyManager.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+using namespace DX;
+
+namespace
+{
+	// The sample's texture, in 128x128 tiles of 64 KB: 4x4 tiles of mip 0, 2x2 of mip 1, and
+	// the tail from mip 2.
+	const uint32_t c_textureSize = 512;
+	const uint32_t c_mipCount = 10;
+	const uint32_t c_tileSize = 128;
+	const uint64_t c_tileBytes = 64 * 1024;
+	const uint32_t c_regionSize = 32;
+
+	// Draws the texture's UVs from (u0, v0) to (u1, v1) on a screen-aligned rectangle, in
+	// pixels, with the orthographic projection of w = 1.
+	void AddScreenQuad(FeedbackEmulator& emulator, float left, float top, float right, float bottom,
+		float u0, float v0, float u1, float v1, float viewportWidth, float viewportHeight)
+	{
+		auto toClip = [&](float x, float y, float u, float v)
+		{
+			return FeedbackVertex{ { 2.0f * x / viewportWidth - 1.0f, 1.0f - 2.0f * y / viewportHeight, 0.5f, 1.0f }, { u, v } };
+		};
+		const FeedbackVertex vertices[] =
+		{
+			toClip(left, top, u0, v0),
+			toClip(right, top, u1, v0),
+			toClip(left, bottom, u0, v1),
+			toClip(right, bottom, u1, v1),
+		};
+		const uint32_t indices[] = { 0, 1, 2, 2, 1, 3 };
+		emulator.AddTriangles(vertices, indices, 6, viewportWidth, viewportHeight);
+	}
+
+	// A feedback map of 32x32-texel regions with one rectangle of them sampled at a mip.
+	MinMipMap MakeFeedback(uint32_t firstX, uint32_t firstY, uint32_t lastX, uint32_t lastY, uint8_t mip)
+	{
+		const uint32_t regionCount = c_textureSize / c_regionSize;
+		MinMipMap feedback = { regionCount, regionCount, c_regionSize, c_regionSize,
+			std::vector<uint8_t>(regionCount * regionCount, c_feedbackNotSampled) };
+		for (uint32_t y = firstY; y <= lastY; ++y)
+		{
+			for (uint32_t x = firstX; x <= lastX; ++x)
+			{
+				feedback.Mips[y * regionCount + x] = mip;
+			}
+		}
+		return feedback;
+	}
+
+	bool SameTile(ResidencyTile const& a, ResidencyTile const& b)
+	{
+		return a.Mip == b.Mip && a.X == b.X && a.Y == b.Y;
+	}
+
+	void CompleteLoads(ResidencyManager& manager, ResidencyUpdate const& update)
+	{
+		for (ResidencyTile const& tile : update.Loads)
+		{
+			manager.CompleteLoad(tile);
+		}
+	}
+
+	// The emulator records the mip a trilinear sample reads first: one texel a pixel is mip
+	// 0, 512 texels over 200 pixels mip 1, over 100 pixels mip 2, and over one pixel the
+	// last. Back faces and what lies off screen record nothing.
+	void EmulatedMips()
+	{
+		FeedbackEmulator emulator(c_textureSize, c_textureSize, c_mipCount, c_regionSize, c_regionSize);
+		MinMipMap const& map = emulator.GetMap();
+		CHECK(map.Width == 16 && map.Height == 16);
+
+		struct Case
+		{
+			float	Size;
+			uint8_t	Mip;
+		};
+		for (Case const& test : { Case{ 512.0f, 0 }, Case{ 200.0f, 1 }, Case{ 100.0f, 2 }, Case{ 1.0f, 9 } })
+		{
+			emulator.Clear();
+			AddScreenQuad(emulator, 0.0f, 0.0f, test.Size, test.Size, 0.0f, 0.0f, 1.0f, 1.0f, 512.0f, 512.0f);
+			CHECK(std::count(map.Mips.begin(), map.Mips.end(), test.Mip) == static_cast<ptrdiff_t>(map.Mips.size()));
+		}
+
+		emulator.Clear();
+		AddScreenQuad(emulator, 512.0f, 0.0f, 0.0f, 512.0f, 0.0f, 0.0f, 1.0f, 1.0f, 512.0f, 512.0f);
+		CHECK(std::count(map.Mips.begin(), map.Mips.end(), c_feedbackNotSampled) == static_cast<ptrdiff_t>(map.Mips.size()));
+
+		// The right half of the quad is off screen.
+		emulator.Clear();
+		AddScreenQuad(emulator, 256.0f, 0.0f, 768.0f, 512.0f, 0.0f, 0.0f, 1.0f, 1.0f, 512.0f, 512.0f);
+		CHECK(map.Mips[0] == 0 && map.Mips[7] == 0 && map.Mips[8] == c_feedbackNotSampled && map.Mips[15] == c_feedbackNotSampled);
+
+		// A quarter of the texture magnified samples only its regions.
+		emulator.Clear();
+		AddScreenQuad(emulator, 0.0f, 0.0f, 512.0f, 512.0f, 0.5f, 0.5f, 1.0f, 1.0f, 512.0f, 512.0f);
+		CHECK(map.Mips[8 * 16 + 8] == 0 && map.Mips[15 * 16 + 15] == 0 && map.Mips[0] == c_feedbackNotSampled && map.Mips[7 * 16 + 7] == c_feedbackNotSampled);
+	}
+
+	// A sampled tile brings in the coarser tiles under it, coarsest first, and is what the
+	// shader can be clamped to once they have all landed.
+	void LoadsCoarseFirst()
+	{
+		ResidencyManager manager(c_textureSize, c_textureSize, c_mipCount, c_tileSize, c_tileSize, c_tileBytes, 16 * c_tileBytes);
+		CHECK(manager.GetPackedMip() == 2 && manager.GetTileCountX(0) == 4 && manager.GetTileCountX(1) == 2);
+		CHECK(manager.GetResidentMip(0, 0) == c_mipCount && manager.GetSampleableMip() == c_mipCount);
+
+		ResidencyUpdate update = manager.Update(MakeFeedback(5, 0, 5, 0, 0));
+		CHECK(update.Loads.size() == 3 && update.Evictions.empty());
+		CHECK(update.Loads.size() == 3 && SameTile(update.Loads[0], { 2, 0, 0 }) && SameTile(update.Loads[1], { 1, 0, 0 }) && SameTile(update.Loads[2], { 0, 1, 0 }));
+		CHECK(manager.GetResidentBytes() == 3 * c_tileBytes);
+		CHECK(manager.GetFinestRequestedMip() == 0);
+
+		// Loading tiles count against the budget but can't be sampled yet.
+		CHECK(manager.GetSampleableMip() == c_mipCount);
+		manager.CompleteLoad(update.Loads[0]);
+		manager.CompleteLoad(update.Loads[1]);
+		CHECK(manager.GetSampleableMip() == 1 && manager.GetResidentMip(1, 0) == 1);
+		manager.CompleteLoad(update.Loads[2]);
+		CHECK(manager.GetSampleableMip() == 0 && manager.GetResidentMip(1, 0) == 0 && manager.GetResidentMip(2, 0) == 2);
+
+		// Nothing resident or loading is asked for again.
+		CHECK(manager.Update(MakeFeedback(5, 0, 5, 0, 0)).Loads.empty());
+	}
+
+	// With the budget full, the tiles sampled longest ago go first, finer mips before the
+	// coarser ones they fall back to, and tiles sampled this frame and the tail stay.
+	void EvictionOrder()
+	{
+		ResidencyManager manager(c_textureSize, c_textureSize, c_mipCount, c_tileSize, c_tileSize, c_tileBytes, 5 * c_tileBytes);
+		CompleteLoads(manager, manager.Update(MakeFeedback(0, 0, 0, 0, 0)));
+		ResidencyUpdate update = manager.Update(MakeFeedback(15, 0, 15, 0, 0));
+		CHECK(update.Loads.size() == 2 && update.Evictions.empty());
+		CompleteLoads(manager, update);
+		CHECK(manager.GetResidentBytes() == 5 * c_tileBytes);
+
+		update = manager.Update(MakeFeedback(0, 15, 0, 15, 0));
+		CHECK(update.Evictions.size() == 2 && SameTile(update.Evictions[0], { 0, 0, 0 }) && SameTile(update.Evictions[1], { 1, 0, 0 }));
+		CHECK(update.Loads.size() == 2 && SameTile(update.Loads[0], { 1, 0, 1 }) && SameTile(update.Loads[1], { 0, 0, 3 }));
+		CompleteLoads(manager, update);
+		CHECK(manager.GetResidentMip(0, 0) == 2 && manager.GetResidentMip(3, 0) == 0 && manager.GetResidentMip(0, 3) == 0);
+
+		// Asking for more than fits evicts only what wasn't sampled this frame, and loads
+		// the rest later.
+		MinMipMap both = MakeFeedback(0, 15, 0, 15, 0);
+		both.Mips[15] = 0;
+		both.Mips[15 * 16 + 15] = 0;
+		update = manager.Update(both);
+		CHECK(update.Evictions.empty() && update.Loads.empty());
+		CHECK(manager.GetResidentBytes() == 5 * c_tileBytes);
+		CHECK(manager.GetSampleableMip() == 2);
+	}
+
+	// Feedback that moves around every frame, from a quad the emulator draws at changing
+	// places and sizes, with loads landing a frame late. The budget is never exceeded, no
+	// update loads more than its limit, every load's coarser tile is loaded before it, and
+	// only resident tiles outside the tail are evicted.
+	void Churn()
+	{
+		const uint64_t budget = 9 * c_tileBytes;
+		const uint32_t maxLoads = 4;
+		ResidencyManager manager(c_textureSize, c_textureSize, c_mipCount, c_tileSize, c_tileSize, c_tileBytes, budget, maxLoads);
+		FeedbackEmulator emulator(c_textureSize, c_textureSize, c_mipCount, c_regionSize, c_regionSize);
+
+		// What the updates say is resident or loading, by mip and tile.
+		enum class State { Evicted, Loading, Resident };
+		std::vector<std::vector<State>> states(manager.GetPackedMip() + 1);
+		for (uint32_t mip = 0; mip <= manager.GetPackedMip(); ++mip)
+		{
+			states[mip].assign(manager.GetTileCountX(mip) * manager.GetTileCountY(mip), State::Evicted);
+		}
+		auto getState = [&](ResidencyTile const& tile) -> State& { return states[tile.Mip][tile.Y * manager.GetTileCountX(tile.Mip) + tile.X]; };
+
+		uint64_t loadCount = 0;
+		uint64_t evictionCount = 0;
+		std::vector<ResidencyTile> inFlight;
+		for (int frame = 0; frame < 2000; ++frame)
+		{
+			const float phase = frame * 0.037f;
+			const float u = 0.5f + 0.45f * std::sin(phase);
+			const float v = 0.5f + 0.45f * std::cos(phase * 1.3f);
+			const float extent = 0.1f + 0.08f * std::sin(phase * 0.7f);
+			const float size = 300.0f + 250.0f * std::sin(phase * 0.21f);
+			emulator.Clear();
+			AddScreenQuad(emulator, 10.0f, 10.0f, 10.0f + size, 10.0f + size, u - extent, v - extent, u + extent, v + extent, 600.0f, 600.0f);
+
+			ResidencyUpdate const& update = manager.Update(emulator.GetMap());
+			loadCount += update.Loads.size();
+			evictionCount += update.Evictions.size();
+			CHECK(manager.GetResidentBytes() <= budget);
+			CHECK(update.Loads.size() <= maxLoads);
+
+			for (ResidencyTile const& eviction : update.Evictions)
+			{
+				CHECK(eviction.Mip < manager.GetPackedMip() && getState(eviction) == State::Resident);
+				getState(eviction) = State::Evicted;
+			}
+			for (ResidencyTile const& load : update.Loads)
+			{
+				CHECK(getState(load) == State::Evicted);
+				if (load.Mip < manager.GetPackedMip())
+				{
+					const ResidencyTile coarser = { load.Mip + 1, load.Mip + 1 == manager.GetPackedMip() ? 0 : load.X / 2,
+						load.Mip + 1 == manager.GetPackedMip() ? 0 : load.Y / 2 };
+					CHECK(getState(coarser) != State::Evicted);
+				}
+				getState(load) = State::Loading;
+			}
+
+			size_t present = 0;
+			for (auto const& mipStates : states)
+			{
+				present += mipStates.size() - std::count(mipStates.begin(), mipStates.end(), State::Evicted);
+			}
+			CHECK(manager.GetResidentBytes() == present * c_tileBytes);
+
+			for (ResidencyTile const& tile : inFlight)
+			{
+				manager.CompleteLoad(tile);
+				if (getState(tile) == State::Loading)
+				{
+					getState(tile) = State::Resident;
+				}
+			}
+			inFlight = update.Loads;
+		}
+		CHECK(loadCount > 100 && evictionCount > 50);
+	}
+
+	void InvalidArguments()
+	{
+		CHECK_THROWS(ResidencyManager(0, 512, 10, 128, 128, c_tileBytes, c_tileBytes), std::invalid_argument);
+		CHECK_THROWS(ResidencyManager(512, 512, 10, 128, 128, c_tileBytes, c_tileBytes - 1), std::invalid_argument);
+		CHECK_THROWS(FeedbackEmulator(512, 512, 10, 0, 32), std::invalid_argument);
+	}
+}
+
+int main()
+{
+	const Test::TestCase tests[] =
+	{
+		{ "EmulatedMips", EmulatedMips },
+		{ "LoadsCoarseFirst", LoadsCoarseFirst },
+		{ "EvictionOrder", EvictionOrder },
+		{ "Churn", Churn },
+		{ "InvalidArguments", InvalidArguments },
+	};
+	return Test::RunTests(tests);
+}
@@ -0,0 +1,132 @@
+﻿#include "TestHarness.h"
+
+#include "Common/RowCopy.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace DX;
+
+namespace
+{
+	const uint8_t c_untouched = 0xCD;
+
+	// Distinct bytes, so a row copied from the wrong place or shifted shows up.
+	std::vector<uint8_t> MakeSource(size_t size)
+	{
+		std::vector<uint8_t> source(size);
+		for (size_t i = 0; i < size; ++i)
+		{
+			source[i] = static_cast<uint8_t>(i * 7 + i / 251);
+		}
+		return source;
+	}
+
+	// Row sizes either side of the 16-byte store, the 64-byte streaming threshold and the
+	// 128-byte AVX2 block, at every destination alignment the head handles, tight and
+	// padded: rows arrive intact and the padding between them is left alone.
+	void CopyRowsMatchMemcpy()
+	{
+		const size_t rowSizes[] = { 1, 3, 15, 16, 17, 63, 64, 65, 79, 127, 128, 129, 191, 255, 256, 1000, 4099 };
+		const size_t destinationOffsets[] = { 0, 1, 7, 16, 24 };
+		const uint32_t rowCount = 5;
+		for (size_t rowSize : rowSizes)
+		{
+			for (bool padded : { false, true })
+			{
+				const size_t sourcePitch = padded ? rowSize + 13 : rowSize;
+				const size_t destinationPitch = padded ? (rowSize + 256) & ~static_cast<size_t>(255) : rowSize;
+				const std::vector<uint8_t> source = MakeSource(sourcePitch * rowCount);
+				for (size_t offset : destinationOffsets)
+				{
+					for (bool streaming : { false, true })
+					{
+						std::vector<uint8_t> destination(offset + destinationPitch * rowCount + 32, c_untouched);
+						CopyRows(destination.data() + offset, destinationPitch, source.data(), sourcePitch, rowSize, rowCount, streaming);
+						for (size_t i = 0; i < destination.size(); ++i)
+						{
+							const bool inRow = i >= offset && (i - offset) / destinationPitch < rowCount && (i - offset) % destinationPitch < rowSize;
+							const uint8_t expected = inRow ?
+								source[(i - offset) / destinationPitch * sourcePitch + (i - offset) % destinationPitch] : c_untouched;
+							if (destination[i] != expected)
+							{
+								std::printf("row size %zu, %s, offset %zu, %s: byte %zu\n", rowSize, padded ? "padded" : "tight", offset,
+									streaming ? "streaming" : "cached", i);
+								CHECK(!"copied rows differ");
+								return;
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Widths around the SSSE3 loop's x + 6 <= width bound, whose last two pixels are left
+	// to the scalar tail, and around the NEON loop's eight, streaming or not and into
+	// aligned and unaligned destinations. Each source row ends where its pitch does, so the
+	// last row ends the allocation.
+	void ConvertRowsRgb8ToBgra8()
+	{
+		const size_t destinationOffsets[] = { 0, 4, 12 };
+		const uint32_t rowCount = 3;
+		for (uint32_t width = 1; width <= 70; width = width < 40 ? width + 1 : width + 15)
+		{
+			for (bool padded : { false, true })
+			{
+				const size_t sourcePitch = width * 3 + (padded ? 5 : 0);
+				const size_t destinationPitch = width * 4 + (padded ? 36 : 0);
+				const std::vector<uint8_t> source = MakeSource(sourcePitch * rowCount - (padded ? 5 : 0));
+				for (size_t offset : destinationOffsets)
+				{
+					for (bool streaming : { false, true })
+					{
+						std::vector<uint8_t> destination(offset + destinationPitch * rowCount + 16, c_untouched);
+						ConvertRows(destination.data() + offset, destinationPitch, source.data(), sourcePitch, width, rowCount,
+							RowConversion::Rgb8ToBgra8, streaming);
+						for (size_t i = 0; i < destination.size(); ++i)
+						{
+							const size_t row = (i - offset) / destinationPitch;
+							const size_t column = (i - offset) % destinationPitch;
+							uint8_t expected = c_untouched;
+							if (i >= offset && row < rowCount && column < width * 4)
+							{
+								const size_t channel = column % 4;
+								expected = channel == 3 ? 255 : source[row * sourcePitch + column / 4 * 3 + 2 - channel];
+							}
+							if (destination[i] != expected)
+							{
+								std::printf("width %u, %s, offset %zu, %s: byte %zu\n", width, padded ? "padded" : "tight", offset,
+									streaming ? "streaming" : "cached", i);
+								CHECK(!"converted rows differ");
+								return;
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Without a conversion, ConvertRows copies width * 4 bytes a row.
+	void ConvertRowsWithoutConversion()
+	{
+		const uint32_t width = 37;
+		const uint32_t rowCount = 4;
+		const std::vector<uint8_t> source = MakeSource(width * 4 * rowCount);
+		std::vector<uint8_t> destination(width * 4 * rowCount);
+		ConvertRows(destination.data(), width * 4, source.data(), width * 4, width, rowCount, RowConversion::None, true);
+		CHECK(destination == source);
+	}
+}
+
+int main()
+{
+	const Test::TestCase tests[] =
+	{
+		{ "CopyRowsMatchMemcpy", CopyRowsMatchMemcpy },
+		{ "ConvertRowsRgb8ToBgra8", ConvertRowsRgb8ToBgra8 },
+		{ "ConvertRowsWithoutConversion", ConvertRowsWithoutConversion },
+	};
+	return Test::RunTests(tests);
+}
@@ -0,0 +1,71 @@
+﻿#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <string>
+
+// Checks for the Linux test executables. Each one lists its cases and runs them from main()
+// with RunTests, which returns non-zero if any check failed or any case threw.
+
+#define CHECK(condition) \
+	do { if (!(condition)) DX::Test::ReportFailure(__FILE__, __LINE__, #condition); } while (false)
+
+#define CHECK_THROWS(expression, exceptionType) \
+	do \
+	{ \
+		bool thrown = false; \
+		try { expression; } catch (exceptionType const&) { thrown = true; } \
+		if (!thrown) DX::Test::ReportFailure(__FILE__, __LINE__, #expression " throws " #exceptionType); \
+	} while (false)
+
+namespace DX
+{
+	namespace Test
+	{
+		struct TestCase
+		{
+			const char*	Name;
+			void		(*Run)();
+		};
+
+		inline int& GetFailureCount()
+		{
+			static int failureCount = 0;
+			return failureCount;
+		}
+
+		inline void ReportFailure(const char* file, int line, const char* expression)
+		{
+			std::printf("%s(%d): check failed: %s\n", file, line, expression);
+			++GetFailureCount();
+		}
+
+		template<size_t count>
+		int RunTests(const TestCase (&tests)[count])
+		{
+			for (TestCase const& test : tests)
+			{
+				const int failuresBefore = GetFailureCount();
+				try
+				{
+					test.Run();
+				}
+				catch (std::exception const& exception)
+				{
+					std::printf("%s threw: %s\n", test.Name, exception.what());
+					++GetFailureCount();
+				}
+				std::printf("%s %s\n", GetFailureCount() == failuresBefore ? "passed" : "FAILED", test.Name);
+			}
+			return GetFailureCount() == 0 ? 0 : 1;
+		}
+
+		// A file shipped with the sample, such as 1.png, from the repository root.
+		inline std::wstring GetAssetPath(const char* fileName)
+		{
+			std::string path = std::string(DX_TEST_ASSET_DIRECTORY "/") + fileName;
+			return std::wstring(path.begin(), path.end());
+		}
+	}
+}
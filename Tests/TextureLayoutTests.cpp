@@ -0,0 +1,208 @@
+﻿#include "TestHarness.h"
+
+#include "Common/TextureLayout.h"
+
+#include <stdexcept>
+#include <vector>
+
+using namespace DX;
+
+namespace
+{
+	// DXGI_FORMAT values.
+	const uint32_t c_formatR32G32B32Float = 6;
+	const uint32_t c_formatR8G8B8A8Unorm = 28;
+	const uint32_t c_formatR8Unorm = 61;
+	const uint32_t c_formatG8R8G8B8Unorm = 69;
+	const uint32_t c_formatBC1Unorm = 71;
+	const uint32_t c_formatBC3Unorm = 77;
+	const uint32_t c_formatB8G8R8A8Unorm = 87;
+	const uint32_t c_formatBC7Unorm = 98;
+
+	struct ExpectedFootprint
+	{
+		uint64_t	Offset;
+		uint32_t	Width;
+		uint32_t	Height;
+		uint32_t	Depth;
+		uint32_t	RowPitch;
+		uint32_t	RowCount;
+		uint64_t	RowSize;
+	};
+
+	// What GetCopyableFootprints reports for the subresources first to first + count - 1 of
+	// a texture, placed from baseOffset, and the total bytes it returns.
+	struct ConformanceCase
+	{
+		const char*						Name;
+		TextureLayoutDesc				Desc;
+		uint32_t						First;
+		uint32_t						Count;
+		uint64_t						BaseOffset;
+		uint64_t						TotalBytes;
+		std::vector<ExpectedFootprint>	Footprints;
+	};
+
+	const std::vector<ConformanceCase>& GetConformanceCases()
+	{
+		static const std::vector<ConformanceCase> cases =
+		{
+			// The sample's texture: rows of the small mips are padded to 256 bytes, and each
+			// mip starts on 512.
+			{ "B8G8R8A8 512x512, full chain", { c_formatB8G8R8A8Unorm, 512, 512, 1, 10, false }, 0, 10, 0, 1408516,
+			{
+				{ 0, 512, 512, 1, 2048, 512, 2048 },
+				{ 1048576, 256, 256, 1, 1024, 256, 1024 },
+				{ 1310720, 128, 128, 1, 512, 128, 512 },
+				{ 1376256, 64, 64, 1, 256, 64, 256 },
+				{ 1392640, 32, 32, 1, 256, 32, 128 },
+				{ 1400832, 16, 16, 1, 256, 16, 64 },
+				{ 1404928, 8, 8, 1, 256, 8, 32 },
+				{ 1406976, 4, 4, 1, 256, 4, 16 },
+				{ 1408000, 2, 2, 1, 256, 2, 8 },
+				{ 1408512, 1, 1, 1, 256, 1, 4 },
+			} },
+
+			// Block-compressed mips below 4x4 still take a whole block, and a mip of one row
+			// of blocks still starts the next on 512.
+			{ "BC1 64x64, full chain", { c_formatBC1Unorm, 64, 64, 1, 7, false }, 0, 7, 0, 8712,
+			{
+				{ 0, 64, 64, 1, 256, 16, 128 },
+				{ 4096, 32, 32, 1, 256, 8, 64 },
+				{ 6144, 16, 16, 1, 256, 4, 32 },
+				{ 7168, 8, 8, 1, 256, 2, 16 },
+				{ 7680, 4, 4, 1, 256, 1, 8 },
+				{ 8192, 4, 4, 1, 256, 1, 8 },
+				{ 8704, 4, 4, 1, 256, 1, 8 },
+			} },
+			{ "BC3 8x8, mip tail", { c_formatBC3Unorm, 8, 8, 1, 4, false }, 0, 4, 0, 1552,
+			{
+				{ 0, 8, 8, 1, 256, 2, 32 },
+				{ 512, 4, 4, 1, 256, 1, 16 },
+				{ 1024, 4, 4, 1, 256, 1, 16 },
+				{ 1536, 4, 4, 1, 256, 1, 16 },
+			} },
+
+			// Odd sizes: a BC7 mip of 126x66 rounds up to whole blocks, and a 300-byte row
+			// pads to 512.
+			{ "BC7 252x132, two mips", { c_formatBC7Unorm, 252, 132, 1, 2, false }, 0, 2, 0, 42496,
+			{
+				{ 0, 252, 132, 1, 1024, 33, 1008 },
+				{ 33792, 128, 68, 1, 512, 17, 512 },
+			} },
+			{ "R8 300x7, three mips", { c_formatR8Unorm, 300, 7, 1, 3, false }, 0, 3, 0, 4683,
+			{
+				{ 0, 300, 7, 1, 512, 7, 300 },
+				{ 3584, 150, 3, 1, 256, 3, 150 },
+				{ 4608, 75, 1, 1, 256, 1, 75 },
+			} },
+			{ "R32G32B32 3x3", { c_formatR32G32B32Float, 3, 3, 1, 1, false }, 0, 1, 0, 548,
+			{
+				{ 0, 3, 3, 1, 256, 3, 36 },
+			} },
+			{ "G8R8_G8B8 5x1", { c_formatG8R8G8B8Unorm, 5, 1, 1, 1, false }, 0, 1, 0, 12,
+			{
+				{ 0, 6, 1, 1, 256, 1, 12 },
+			} },
+
+			// Arrays number their subresources mip first, and volumes have a slice per depth.
+			{ "R8G8B8A8 16x16, 3 slices of 2 mips", { c_formatR8G8B8A8Unorm, 16, 16, 3, 2, false }, 0, 6, 0, 18208,
+			{
+				{ 0, 16, 16, 1, 256, 16, 64 },
+				{ 4096, 8, 8, 1, 256, 8, 32 },
+				{ 6144, 16, 16, 1, 256, 16, 64 },
+				{ 10240, 8, 8, 1, 256, 8, 32 },
+				{ 12288, 16, 16, 1, 256, 16, 64 },
+				{ 16384, 8, 8, 1, 256, 8, 32 },
+			} },
+			{ "R8G8B8A8 8x8x4 volume, two mips", { c_formatR8G8B8A8Unorm, 8, 8, 4, 2, true }, 0, 2, 0, 10000,
+			{
+				{ 0, 8, 8, 4, 256, 8, 32 },
+				{ 8192, 4, 4, 2, 256, 4, 16 },
+			} },
+
+			// A range of subresources placed after other data: offsets count from the start
+			// of the buffer, and the total from the base offset.
+			{ "R8G8B8A8 16x16, slices 1 and 2, at 1024", { c_formatR8G8B8A8Unorm, 16, 16, 3, 2, false }, 3, 2, 1024, 5952,
+			{
+				{ 1024, 8, 8, 1, 256, 8, 32 },
+				{ 3072, 16, 16, 1, 256, 16, 64 },
+			} },
+		};
+		return cases;
+	}
+
+	void ConformanceTable()
+	{
+		for (ConformanceCase const& test : GetConformanceCases())
+		{
+			CHECK(test.Footprints.size() == test.Count);
+			std::vector<SubresourceFootprint> footprints(test.Count);
+			const uint64_t totalBytes = GetTextureFootprints(test.Desc, test.First, test.Count, test.BaseOffset, footprints.data());
+			bool matches = totalBytes == test.TotalBytes;
+			for (uint32_t i = 0; i < test.Count; ++i)
+			{
+				SubresourceFootprint const& actual = footprints[i];
+				ExpectedFootprint const& expected = test.Footprints[i];
+				matches = matches && actual.Format == test.Desc.Format && actual.Offset == expected.Offset && actual.Width == expected.Width &&
+					actual.Height == expected.Height && actual.Depth == expected.Depth && actual.RowPitch == expected.RowPitch &&
+					actual.RowCount == expected.RowCount && actual.RowSize == expected.RowSize;
+			}
+			if (!matches)
+			{
+				std::printf("%s doesn't match:\n", test.Name);
+				for (SubresourceFootprint const& actual : footprints)
+				{
+					std::printf("  { %llu, %u, %u, %u, %u, %u, %llu }\n", static_cast<unsigned long long>(actual.Offset), actual.Width, actual.Height,
+						actual.Depth, actual.RowPitch, actual.RowCount, static_cast<unsigned long long>(actual.RowSize));
+				}
+				std::printf("  total %llu\n", static_cast<unsigned long long>(totalBytes));
+			}
+			CHECK(matches);
+		}
+	}
+
+	// Every footprint starts on the placement alignment and every pitch is a multiple of
+	// the pitch alignment, across sizes and formats.
+	void Alignment()
+	{
+		const uint32_t formats[] = { c_formatR8Unorm, c_formatR8G8B8A8Unorm, c_formatR32G32B32Float, c_formatBC1Unorm, c_formatBC7Unorm };
+		for (uint32_t format : formats)
+		{
+			for (uint32_t size = 4; size < 700; size += 37)
+			{
+				TextureLayoutDesc desc = { format, size, size / 2 + 4, 2, 6, false };
+				std::vector<SubresourceFootprint> footprints(12);
+				GetTextureFootprints(desc, 0, 12, 0, footprints.data());
+				for (SubresourceFootprint const& footprint : footprints)
+				{
+					CHECK(footprint.Offset % c_texturePlacementAlignment == 0 && footprint.RowPitch % c_texturePitchAlignment == 0 &&
+						footprint.RowPitch >= footprint.RowSize);
+				}
+			}
+		}
+	}
+
+	void UnsupportedFormats()
+	{
+		TextureFormatLayout layout;
+		CHECK(!GetTextureFormatLayout(0, layout));
+		CHECK(!GetTextureFormatLayout(20, layout));		// D32_FLOAT_S8X24_UINT
+		CHECK(!GetTextureFormatLayout(66, layout));		// R1_UNORM
+		CHECK(!GetTextureFormatLayout(103, layout));	// NV12
+
+		SubresourceFootprint footprint;
+		CHECK_THROWS(GetTextureFootprints(TextureLayoutDesc{ 103, 16, 16, 1, 1, false }, 0, 1, 0, &footprint), std::invalid_argument);
+	}
+}
+
+int main()
+{
+	const Test::TestCase tests[] =
+	{
+		{ "ConformanceTable", ConformanceTable },
+		{ "Alignment", Alignment },
+		{ "UnsupportedFormats", UnsupportedFormats },
+	};
+	return Test::RunTests(tests);
+}
@@ -0,0 +1,176 @@
+﻿#include "TestHarness.h"
+
+#include "Common/TlsfAllocator.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace DX;
+
+namespace
+{
+	// The live ranges, by offset, to check new ones against.
+	class RangeModel
+	{
+	public:
+		bool Overlaps(uint64_t offset, uint64_t size) const
+		{
+			auto next = m_ranges.lower_bound(offset);
+			if (next != m_ranges.end() && next->first < offset + size)
+			{
+				return true;
+			}
+			return next != m_ranges.begin() && std::prev(next)->second > offset;
+		}
+
+		void Add(uint64_t offset, uint64_t size) { m_ranges[offset] = offset + size; }
+		void Remove(uint64_t offset) { m_ranges.erase(offset); }
+
+	private:
+		std::map<uint64_t, uint64_t>	m_ranges;	// Offset to end.
+	};
+
+	// Random sizes and alignments, freed in random order, never overlap, stay in range and
+	// are aligned; then freeing everything merges the space back into one block.
+	void RandomAllocateFree()
+	{
+		const uint64_t capacity = 64 * 1024 * 1024;
+		TlsfAllocator allocator(capacity);
+		RangeModel model;
+		std::vector<TlsfAllocation> live;
+		uint64_t usedBytes = 0;
+		uint32_t failures = 0;
+
+		std::mt19937 random(1);
+		for (int step = 0; step < 100000; ++step)
+		{
+			if (!live.empty() && random() % 2 == 0)
+			{
+				const size_t i = random() % live.size();
+				allocator.Free(live[i]);
+				model.Remove(live[i].Offset);
+				usedBytes -= live[i].Size;
+				live[i] = live.back();
+				live.pop_back();
+				continue;
+			}
+
+			const uint64_t size = random() % 4 == 0 ? 1 + random() % (1024 * 1024) : 1 + random() % 4096;
+			const uint64_t alignment = 1ull << (random() % 17);
+			TlsfAllocation allocation;
+			if (!allocator.Allocate(size, alignment, allocation))
+			{
+				++failures;
+				continue;
+			}
+			CHECK(allocation.Size == size);
+			CHECK(allocation.Offset % alignment == 0);
+			CHECK(allocation.Offset + size <= capacity);
+			CHECK(!model.Overlaps(allocation.Offset, size));
+			model.Add(allocation.Offset, size);
+			usedBytes += size;
+			live.push_back(allocation);
+
+			TlsfStatistics statistics = allocator.GetStatistics();
+			CHECK(statistics.UsedBytes == usedBytes && statistics.AllocationCount == live.size());
+		}
+		CHECK(failures < 1000);
+
+		std::shuffle(live.begin(), live.end(), random);
+		for (TlsfAllocation const& allocation : live)
+		{
+			allocator.Free(allocation);
+		}
+		TlsfStatistics statistics = allocator.GetStatistics();
+		CHECK(allocator.IsEmpty());
+		CHECK(statistics.UsedBytes == 0 && statistics.FreeBlockCount == 1 && statistics.LargestFreeBlock == capacity);
+		CHECK(statistics.GetFragmentation() == 0.0);
+
+		// The whole space is one block again.
+		TlsfAllocation whole;
+		CHECK(allocator.Allocate(capacity, 1, whole) && whole.Offset == 0);
+	}
+
+	// An allocator sized for exactly one range, as a dedicated heap or buffer is, hands it
+	// out, even though the size class search rounds up past it.
+	void ExactFitDedicated()
+	{
+		const uint64_t c_64KB = 64 * 1024;
+		const uint64_t sizes[] =
+		{
+			c_64KB, 2 * 1024 * 1024, 2 * 1024 * 1024 + c_64KB, 33 * 1024 * 1024 + 12345, 40 * 1024 * 1024, 85 * 1024 * 1024,
+			4096ull * 4096 * 4 * 4 / 3,
+		};
+		const uint64_t alignments[] = { 1, 256, c_64KB, 4 * 1024 * 1024 };
+		for (uint64_t size : sizes)
+		{
+			const uint64_t dedicatedSize = (size + c_64KB - 1) & ~(c_64KB - 1);
+			for (uint64_t alignment : alignments)
+			{
+				TlsfAllocator allocator(dedicatedSize);
+				TlsfAllocation allocation;
+				CHECK(allocator.Allocate(size, alignment, allocation));
+				CHECK(allocation.Offset == 0 && allocation.Size == size);
+
+				TlsfAllocation more;
+				CHECK(allocator.Allocate(dedicatedSize - size, 1, more) == (dedicatedSize > size));
+			}
+
+			// One byte more than there is still fails.
+			TlsfAllocator allocator(dedicatedSize);
+			TlsfAllocation allocation;
+			CHECK(!allocator.Allocate(dedicatedSize + 1, 1, allocation));
+		}
+	}
+
+	// A freed range is found again by a request of exactly its size, and its alignment.
+	void ExactFitBetweenRanges()
+	{
+		TlsfAllocator allocator(16 * 1024 * 1024);
+		TlsfAllocation first;
+		TlsfAllocation middle;
+		TlsfAllocation last;
+		CHECK(allocator.Allocate(3 * 1024 * 1024, 65536, first));
+		CHECK(allocator.Allocate(5 * 1024 * 1024 + 65536, 65536, middle));
+		CHECK(allocator.Allocate(16 * 1024 * 1024 - first.Size - middle.Size, 65536, last));
+		allocator.Free(middle);
+
+		TlsfAllocation again;
+		CHECK(allocator.Allocate(middle.Size, 65536, again));
+		CHECK(again.Offset == middle.Offset);
+
+		// A misaligned fit doesn't count.
+		allocator.Free(again);
+		CHECK(!allocator.Allocate(middle.Size, 4 * 1024 * 1024, again));
+	}
+
+	void InvalidArguments()
+	{
+		CHECK_THROWS(TlsfAllocator(0), std::invalid_argument);
+
+		TlsfAllocator allocator(1024);
+		TlsfAllocation allocation;
+		CHECK_THROWS(allocator.Allocate(16, 0, allocation), std::invalid_argument);
+		CHECK_THROWS(allocator.Allocate(16, 48, allocation), std::invalid_argument);
+		CHECK(!allocator.Allocate(~0ull, 1024, allocation));
+
+		CHECK(allocator.Allocate(16, 16, allocation));
+		allocator.Free(allocation);
+		CHECK_THROWS(allocator.Free(allocation), std::invalid_argument);
+	}
+}
+
+int main()
+{
+	const Test::TestCase tests[] =
+	{
+		{ "RandomAllocateFree", RandomAllocateFree },
+		{ "ExactFitDedicated", ExactFitDedicated },
+		{ "ExactFitBetweenRanges", ExactFitBetweenRanges },
+		{ "InvalidArguments", InvalidArguments },
+	};
+	return Test::RunTests(tests);
+}
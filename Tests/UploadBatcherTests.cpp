@@ -0,0 +1,208 @@
+﻿#include "TestHarness.h"
+
+#include "Common/UploadBatcher.h"
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using namespace DX;
+
+namespace
+{
+	// Records each batch and the fence value it signals; the test decides how far the
+	// simulated copy queue has got.
+	class MockCopyQueue : public CopyQueueBackend
+	{
+	public:
+		MockCopyQueue() : SignalledFenceValue(0), CompletedFenceValue(0), OutOfOrderCount(0) {}
+
+		void Submit(const CopyRequest* copies, size_t count, uint64_t fenceValue) override
+		{
+			Batches.emplace_back(copies, copies + count);
+			OutOfOrderCount += fenceValue <= SignalledFenceValue;
+			SignalledFenceValue = fenceValue;
+		}
+
+		uint64_t GetCompletedFenceValue() override { return CompletedFenceValue; }
+
+		std::vector<std::vector<CopyRequest>>	Batches;
+		uint64_t								SignalledFenceValue;
+		uint64_t								CompletedFenceValue;
+		uint64_t								OutOfOrderCount;
+	};
+
+	// Stand-ins for resources, which the batcher only compares.
+	int g_vertexBuffer;
+	int g_indexBuffer;
+	int g_texture;
+	int g_uploadBuffer;
+	int g_otherUploadBuffer;
+
+	const uint32_t c_formatBC1Unorm = 71;
+
+	// Ranges that continue the one queued before them in both buffers merge, however many
+	// there are in a row; anything else starts a new copy.
+	void MergesAdjacentBufferRanges()
+	{
+		MockCopyQueue queue;
+		UploadBatcher batcher(queue);
+		batcher.Enqueue(MakeBufferCopy(&g_vertexBuffer, 0, &g_uploadBuffer, 0, 100));
+		batcher.Enqueue(MakeBufferCopy(&g_vertexBuffer, 100, &g_uploadBuffer, 100, 50));
+		batcher.Enqueue(MakeBufferCopy(&g_vertexBuffer, 150, &g_uploadBuffer, 150, 10));
+
+		batcher.Enqueue(MakeBufferCopy(&g_vertexBuffer, 160, &g_uploadBuffer, 256, 10));		// Source gap.
+		batcher.Enqueue(MakeBufferCopy(&g_vertexBuffer, 200, &g_uploadBuffer, 266, 10));		// Destination gap.
+		batcher.Enqueue(MakeBufferCopy(&g_indexBuffer, 210, &g_uploadBuffer, 276, 10));		// Other destination.
+		batcher.Enqueue(MakeBufferCopy(&g_indexBuffer, 220, &g_otherUploadBuffer, 286, 10));	// Other source.
+
+		// Only the copy queued last is merged into.
+		batcher.Enqueue(MakeBufferCopy(&g_vertexBuffer, 210, &g_uploadBuffer, 276, 10));
+
+		CHECK(batcher.Submit() == 1);
+		CHECK(queue.Batches.size() == 1);
+		std::vector<CopyRequest> const& copies = queue.Batches[0];
+		CHECK(copies.size() == 6);
+		CHECK(copies.size() == 6 && copies[0].Size == 160 && copies[0].DestinationOffset == 0 && copies[0].SourceOffset == 0);
+		CHECK(copies.size() == 6 && copies[1].SourceOffset == 256 && copies[2].DestinationOffset == 200 && copies[5].Destination == &g_vertexBuffer);
+
+		UploadStatistics const& statistics = batcher.GetStatistics();
+		CHECK(statistics.Requests == 8 && statistics.Copies == 6 && statistics.Bytes == 160 + 5 * 10);
+	}
+
+	// The next rows of the same subresource, at the same pitch, merge into one taller copy.
+	void MergesTextureRows()
+	{
+		MockCopyQueue queue;
+		UploadBatcher batcher(queue);
+		auto rows = [](uint32_t subresource, uint32_t x, uint32_t y, uint64_t sourceOffset, uint32_t width, uint32_t rowPitch)
+		{
+			return MakeTextureCopy(&g_texture, subresource, x, y, &g_uploadBuffer, sourceOffset, c_formatBC1Unorm, width, 16, rowPitch, 4);
+		};
+
+		batcher.Enqueue(rows(3, 0, 0, 0, 256, 1024));
+		batcher.Enqueue(rows(3, 0, 16, 4096, 256, 1024));
+		batcher.Enqueue(rows(3, 0, 32, 8192, 256, 1024));
+		CHECK(batcher.Submit() == 1);
+		CHECK(queue.Batches[0].size() == 1);
+		CopyRequest const& merged = queue.Batches[0][0];
+		CHECK(merged.Y == 0 && merged.Height == 48 && merged.RowCount == 12 && merged.Size == 3 * 4096 && merged.SourceOffset == 0);
+
+		const CopyRequest first = rows(3, 0, 0, 0, 256, 1024);
+		const CopyRequest breaks[] =
+		{
+			rows(3, 0, 16, 4096, 256, 2048),		// Changed pitch.
+			rows(4, 0, 16, 4096, 256, 1024),		// Changed subresource.
+			rows(3, 0, 32, 4096, 256, 1024),		// Rows skipped in the texture.
+			rows(3, 0, 16, 8192, 256, 1024),		// Rows skipped in the source.
+			rows(3, 256, 16, 4096, 256, 1024),		// Beside rather than below.
+			rows(3, 0, 16, 4096, 128, 1024),		// Narrower.
+			MakeTextureCopy(&g_texture, 3, 0, 16, &g_uploadBuffer, 4096, c_formatBC1Unorm + 1, 256, 16, 1024, 4),
+			MakeBufferCopy(&g_texture, 4096, &g_uploadBuffer, 4096, 4096),
+		};
+		for (CopyRequest const& next : breaks)
+		{
+			batcher.Enqueue(first);
+			batcher.Enqueue(next);
+			batcher.Submit();
+			CHECK(queue.Batches.back().size() == 2);
+			CHECK(queue.Batches.back()[0].Height == 16 && queue.Batches.back()[0].Size == 4096);
+		}
+	}
+
+	// Each batch signals the next fence value, an empty one is never sent, and a fence value
+	// only counts as complete once the queue has passed it and the batcher has polled.
+	void FenceValueOrdering()
+	{
+		MockCopyQueue queue;
+		UploadBatcher batcher(queue);
+		CHECK(batcher.Submit() == 0);
+		CHECK(queue.Batches.empty());
+		CHECK(batcher.IsComplete(0));
+
+		uint64_t fenceValues[3];
+		for (uint64_t& fenceValue : fenceValues)
+		{
+			batcher.Enqueue(MakeBufferCopy(&g_vertexBuffer, 0, &g_uploadBuffer, 0, 64));
+			fenceValue = batcher.Submit();
+		}
+		CHECK(fenceValues[0] == 1 && fenceValues[1] == 2 && fenceValues[2] == 3);
+		CHECK(queue.SignalledFenceValue == 3 && queue.OutOfOrderCount == 0);
+		CHECK(batcher.Submit() == 0 && queue.Batches.size() == 3);
+
+		batcher.Update();
+		CHECK(!batcher.IsComplete(1));
+
+		queue.CompletedFenceValue = 2;
+		CHECK(!batcher.IsComplete(1));
+		batcher.Update();
+		CHECK(batcher.IsComplete(1) && batcher.IsComplete(2) && !batcher.IsComplete(3));
+
+		queue.CompletedFenceValue = 3;
+		batcher.Update();
+		CHECK(batcher.IsComplete(3) && !batcher.IsComplete(4));
+
+		UploadStatistics const& statistics = batcher.GetStatistics();
+		CHECK(statistics.Submissions == 3 && statistics.Requests == 3 && statistics.Copies == 3 && statistics.Bytes == 3 * 64);
+	}
+
+	// Time counts while a batch is in flight, from its submission to the poll that sees it
+	// finished, and not while the queue is idle.
+	void BusyTime()
+	{
+		MockCopyQueue queue;
+		UploadBatcher batcher(queue);
+		batcher.Enqueue(MakeBufferCopy(&g_vertexBuffer, 0, &g_uploadBuffer, 0, 1024 * 1024));
+		batcher.Submit();
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		queue.CompletedFenceValue = 1;
+		batcher.Update();
+		const double busySeconds = batcher.GetStatistics().BusySeconds;
+		CHECK(busySeconds >= 0.015);
+		CHECK(batcher.GetStatistics().GetMegabytesPerSecond() > 0.0);
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		batcher.Update();
+		CHECK(batcher.GetStatistics().BusySeconds == busySeconds);
+	}
+
+	// A removed device's fence reports UINT64_MAX as its completed value. That finishes what
+	// was submitted, and the busy time with it, but not fence values still to come.
+	void DeviceRemoved()
+	{
+		MockCopyQueue queue;
+		UploadBatcher batcher(queue);
+		batcher.Enqueue(MakeBufferCopy(&g_vertexBuffer, 0, &g_uploadBuffer, 0, 64));
+		CHECK(batcher.Submit() == 1);
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+		queue.CompletedFenceValue = UINT64_MAX;
+		batcher.Update();
+		CHECK(batcher.IsComplete(1) && !batcher.IsComplete(2) && !batcher.IsComplete(UINT64_MAX));
+		const double busySeconds = batcher.GetStatistics().BusySeconds;
+		CHECK(busySeconds > 0.0);
+
+		// Later batches keep being tracked the same way.
+		batcher.Enqueue(MakeBufferCopy(&g_vertexBuffer, 0, &g_uploadBuffer, 0, 64));
+		CHECK(batcher.Submit() == 2);
+		CHECK(!batcher.IsComplete(2));
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		batcher.Update();
+		CHECK(batcher.IsComplete(2) && !batcher.IsComplete(3));
+		CHECK(batcher.GetStatistics().BusySeconds > busySeconds);
+	}
+}
+
+int main()
+{
+	const Test::TestCase tests[] =
+	{
+		{ "MergesAdjacentBufferRanges", MergesAdjacentBufferRanges },
+		{ "MergesTextureRows", MergesTextureRows },
+		{ "FenceValueOrdering", FenceValueOrdering },
+		{ "BusyTime", BusyTime },
+		{ "DeviceRemoved", DeviceRemoved },
+	};
+	return Test::RunTests(tests);
+}
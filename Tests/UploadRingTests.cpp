@@ -0,0 +1,161 @@
+﻿#include "TestHarness.h"
+
+#include "Common/UploadRing.h"
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace DX;
+
+namespace
+{
+	// Every offset is a multiple of its alignment, whatever was allocated before it.
+	void Alignment()
+	{
+		UploadRing ring(1 << 20);
+		const uint64_t alignments[] = { 1, 4, 16, 256, 512, 65536 };
+		for (int i = 0; i < 200; ++i)
+		{
+			const uint64_t alignment = alignments[i % 6];
+			const uint64_t offset = ring.Allocate(1 + i * 37 % 1000, alignment, i);
+			CHECK(offset != c_uploadRingFull && offset % alignment == 0);
+			ring.Reclaim(i);
+		}
+	}
+
+	// An allocation that doesn't fit before the end starts again at the beginning, and the
+	// space it skips counts as used until the allocation before it is reclaimed.
+	void Wraparound()
+	{
+		UploadRing ring(1024);
+		CHECK(ring.Allocate(600, 1, 1) == 0);
+		CHECK(ring.Allocate(300, 1, 2) == 600);
+		ring.Reclaim(1);
+		CHECK(ring.GetUsedBytes() == 300);
+
+		CHECK(ring.Allocate(200, 1, 3) == 0);
+		CHECK(ring.GetUsedBytes() == 300 + 124 + 200);
+
+		// Alignment can push an allocation past the end too, and then it has to wait for
+		// whatever is at the beginning.
+		CHECK(ring.Allocate(300, 1, 3) == 200);
+		ring.Reclaim(2);
+		CHECK(ring.Allocate(100, 256, 4) == 512);
+		CHECK(ring.Allocate(400, 256, 5) == c_uploadRingFull);
+		ring.Reclaim(3);
+		CHECK(ring.Allocate(400, 256, 5) == 0);
+		CHECK(ring.GetUsedBytes() == 12 + 100 + 412 + 400);
+	}
+
+	// With the fence behind, the ring reports it's full rather than overwriting anything,
+	// and takes the allocation once enough of the earlier work has finished.
+	void BlocksWhenFull()
+	{
+		UploadRing ring(1024);
+		CHECK(ring.Allocate(512, 256, 1) == 0);
+		CHECK(ring.Allocate(512, 256, 2) == 512);
+		CHECK(ring.Allocate(1, 1, 3) == c_uploadRingFull);
+		CHECK(ring.GetUsedBytes() == 1024);
+
+		ring.Reclaim(0);
+		CHECK(ring.Allocate(256, 256, 3) == c_uploadRingFull);
+		ring.Reclaim(1);
+		CHECK(ring.Allocate(256, 256, 3) == 0);
+		CHECK(ring.Allocate(512, 256, 3) == c_uploadRingFull);
+		CHECK(ring.Allocate(256, 256, 3) == 256);
+		CHECK(ring.Allocate(2048, 1, 3) == c_uploadRingFull);
+
+		// Once everything has finished, any size up to the capacity fits, wherever the
+		// last allocation ended.
+		ring.Reclaim(3);
+		CHECK(ring.GetUsedBytes() == 0);
+		CHECK(ring.Allocate(1024, 256, 4) == 0);
+		ring.Reclaim(4);
+		CHECK(ring.Allocate(100, 1, 5) == 0);
+		ring.Reclaim(5);
+		CHECK(ring.Allocate(1000, 1, 6) == 0);
+	}
+
+	void InvalidArguments()
+	{
+		CHECK_THROWS(UploadRing(0), std::invalid_argument);
+		UploadRing ring(1024);
+		CHECK_THROWS(ring.Allocate(16, 0, 1), std::invalid_argument);
+		CHECK_THROWS(ring.Allocate(16, 24, 1), std::invalid_argument);
+		CHECK(ring.Allocate(16, 16, 2) == 0);
+		CHECK_THROWS(ring.Allocate(16, 16, 1), std::invalid_argument);
+	}
+
+	// Random allocations against a simulated fence that lags a few frames behind: no two
+	// allocations the GPU may still be reading overlap, and none crosses the end.
+	void SimulatedFence()
+	{
+		struct Allocation
+		{
+			uint64_t	Offset;
+			uint64_t	Size;
+			uint64_t	FenceValue;
+		};
+
+		const uint64_t capacity = 64 * 1024;
+		UploadRing ring(capacity);
+		std::mt19937 random(7);
+		std::vector<Allocation> live;
+		uint64_t fenceValue = 1;
+		uint64_t completedFenceValue = 0;
+		uint64_t fullCount = 0;
+
+		for (int i = 0; i < 100000; ++i)
+		{
+			if (random() % 8 == 0)
+			{
+				++fenceValue;
+			}
+			if (random() % 6 == 0 && completedFenceValue + 1 < fenceValue)
+			{
+				completedFenceValue += 1 + random() % (fenceValue - completedFenceValue - 1);
+				ring.Reclaim(completedFenceValue);
+				live.erase(std::remove_if(live.begin(), live.end(), [&](Allocation const& allocation) { return allocation.FenceValue <= completedFenceValue; }), live.end());
+			}
+
+			const uint64_t size = 1 + random() % (random() % 4 == 0 ? capacity / 4 : 2048);
+			const uint64_t alignment = 1ull << (random() % 10);
+			const uint64_t offset = ring.Allocate(size, alignment, fenceValue);
+			if (offset == c_uploadRingFull)
+			{
+				++fullCount;
+				continue;
+			}
+
+			CHECK(offset % alignment == 0 && offset + size <= capacity);
+			for (Allocation const& allocation : live)
+			{
+				if (offset < allocation.Offset + allocation.Size && allocation.Offset < offset + size)
+				{
+					CHECK(!"allocation overlaps one in flight");
+					return;
+				}
+			}
+			live.push_back(Allocation{ offset, size, fenceValue });
+		}
+		CHECK(fullCount > 0);
+
+		ring.Reclaim(fenceValue);
+		CHECK(ring.GetUsedBytes() == 0);
+	}
+}
+
+int main()
+{
+	const Test::TestCase tests[] =
+	{
+		{ "Alignment", Alignment },
+		{ "Wraparound", Wraparound },
+		{ "BlocksWhenFull", BlocksWhenFull },
+		{ "InvalidArguments", InvalidArguments },
+		{ "SimulatedFence", SimulatedFence },
+	};
+	return Test::RunTests(tests);
+}
@@ -0,0 +1,277 @@
+﻿#include "TestHarness.h"
+
+#include "Common/VirtualTexture.h"
+
+#include <map>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+using namespace DX;
+
+namespace
+{
+	// Records what the GPU's tile mappings would be after each batch.
+	class MockTileMappingBackend : public TileMappingBackend
+	{
+	public:
+		typedef std::tuple<uint32_t, uint32_t, uint32_t> TileKey;
+
+		MockTileMappingBackend() : BatchCount(0), ChangeCount(0), DuplicateCount(0) {}
+
+		void UpdateTileMappings(const TileMapping* mappings, size_t count) override
+		{
+			++BatchCount;
+			ChangeCount += count;
+			std::set<TileKey> batchTiles;
+			for (size_t i = 0; i < count; ++i)
+			{
+				const TileKey key(mappings[i].Mip, mappings[i].X, mappings[i].Y);
+				DuplicateCount += !batchTiles.insert(key).second;
+				if (mappings[i].HeapTile == c_unmappedHeapTile)
+				{
+					Mapped.erase(key);
+				}
+				else
+				{
+					Mapped[key] = mappings[i].HeapTile;
+				}
+			}
+		}
+
+		bool IsMapped(uint32_t mip, uint32_t x, uint32_t y) const { return Mapped.count(TileKey(mip, x, y)) != 0; }
+
+		std::map<TileKey, uint32_t>	Mapped;
+		size_t						BatchCount;
+		size_t						ChangeCount;
+		size_t						DuplicateCount;
+	};
+
+	// A 4096x4096 texture in 128x128 tiles: mips 0 to 5 are standard, and the 13-mip chain
+	// packs the rest into three tiles.
+	const VirtualTextureLayout c_layout = { 4096, 4096, 13, 128, 128, 6, 3 };
+
+	// Every tile of the texture, standard mips only, is mapped after a flush exactly when
+	// the page table says so.
+	void CheckBackendMatches(VirtualTexture const& texture, MockTileMappingBackend const& backend)
+	{
+		size_t mismatches = 0;
+		for (uint32_t mip = 0; mip < texture.GetLayout().StandardMipCount; ++mip)
+		{
+			for (uint32_t y = 0; y < texture.GetTileCountY(mip); ++y)
+			{
+				for (uint32_t x = 0; x < texture.GetTileCountX(mip); ++x)
+				{
+					mismatches += texture.IsMapped(mip, x, y) != backend.IsMapped(mip, x, y);
+				}
+			}
+		}
+		CHECK(mismatches == 0);
+		CHECK(backend.Mapped.size() == texture.GetMappedTileCount());
+	}
+
+	// The page table covers each standard mip and the packed mips as one row of tiles, which
+	// are mapped on construction and stay mapped.
+	void PackedMipsStayMapped()
+	{
+		PhysicalTilePool pool(8);
+		MockTileMappingBackend backend;
+		VirtualTexture texture(c_layout, pool, backend);
+		CHECK(texture.GetTileCountX(0) == 32 && texture.GetTileCountY(0) == 32 && texture.GetTileCountX(5) == 1);
+		CHECK(texture.GetMappedTileCount() == 3 && pool.GetFreeTileCount() == 5);
+		CHECK(backend.BatchCount == 0);
+
+		texture.Flush();
+		CHECK(backend.BatchCount == 1 && backend.Mapped.size() == 3);
+		CHECK(backend.IsMapped(6, 0, 0) && backend.IsMapped(6, 1, 0) && backend.IsMapped(6, 2, 0));
+
+		texture.Unmap(6, 1, 0);
+		for (uint32_t x = 0; x < 32; ++x)
+		{
+			texture.Map(0, x, 0);
+		}
+		texture.Flush();
+		CHECK(texture.IsMapped(6, 0, 0) && texture.IsMapped(6, 1, 0) && texture.IsMapped(6, 2, 0));
+		CHECK(backend.IsMapped(6, 0, 0) && backend.IsMapped(6, 1, 0) && backend.IsMapped(6, 2, 0));
+		CheckBackendMatches(texture, backend);
+	}
+
+	// A full pool takes back its least recently used tile; mapping a mapped tile again
+	// counts as using it.
+	void LeastRecentlyUsedEviction()
+	{
+		PhysicalTilePool pool(20);
+		MockTileMappingBackend backend;
+		VirtualTexture texture(c_layout, pool, backend);
+		for (uint32_t x = 0; x < 17; ++x)
+		{
+			CHECK(texture.Map(0, x, 0));
+		}
+		CHECK(pool.GetFreeTileCount() == 0 && pool.GetEvictionCount() == 0);
+
+		CHECK(!texture.Map(0, 0, 0));
+		CHECK(texture.Map(1, 5, 5));
+		CHECK(pool.GetEvictionCount() == 1);
+		CHECK(texture.IsMapped(0, 0, 0) && !texture.IsMapped(0, 1, 0) && texture.IsMapped(0, 2, 0));
+
+		CHECK(texture.Map(1, 6, 5));
+		CHECK(!texture.IsMapped(0, 2, 0) && texture.IsMapped(0, 3, 0));
+		CHECK(texture.GetMappedTileCount() == 20);
+
+		// Unmapping frees a tile, so the next map doesn't evict.
+		texture.Unmap(0, 16, 0);
+		CHECK(texture.Map(2, 0, 0));
+		CHECK(pool.GetEvictionCount() == 2);
+
+		texture.Flush();
+		CheckBackendMatches(texture, backend);
+	}
+
+	// Changes go to the backend in one batch a flush, with one change per tile holding the
+	// last state it was given.
+	void BatchedMappings()
+	{
+		PhysicalTilePool pool(64);
+		MockTileMappingBackend backend;
+		VirtualTexture texture(c_layout, pool, backend);
+		for (uint32_t x = 0; x < 10; ++x)
+		{
+			texture.Map(0, x, 3);
+		}
+		texture.Flush();
+		CHECK(backend.BatchCount == 1 && backend.ChangeCount == 13);
+
+		texture.Flush();
+		CHECK(backend.BatchCount == 1);
+
+		texture.Unmap(0, 4, 3);
+		texture.Map(0, 4, 3);
+		texture.Unmap(0, 4, 3);
+		texture.Map(0, 20, 20);
+		texture.Unmap(0, 20, 20);
+		texture.Map(0, 21, 20);
+		texture.Flush();
+		CHECK(backend.BatchCount == 2 && backend.ChangeCount == 13 + 3);
+		CHECK(!backend.IsMapped(0, 4, 3) && !backend.IsMapped(0, 20, 20) && backend.IsMapped(0, 21, 20));
+		CHECK(backend.DuplicateCount == 0);
+		CheckBackendMatches(texture, backend);
+	}
+
+	// Textures sharing a pool take tiles from each other, and each hears about the tiles it
+	// lost on its own next flush. A texture going away gives its tiles back.
+	void SharedPool()
+	{
+		PhysicalTilePool pool(12);
+		MockTileMappingBackend firstBackend;
+		MockTileMappingBackend secondBackend;
+		VirtualTexture first(c_layout, pool, firstBackend);
+		{
+			VirtualTexture second(c_layout, pool, secondBackend);
+			for (uint32_t x = 0; x < 6; ++x)
+			{
+				first.Map(0, x, 0);
+			}
+			first.Flush();
+			CHECK(pool.GetFreeTileCount() == 0);
+
+			second.Map(0, 0, 0);
+			second.Map(0, 1, 0);
+			second.Flush();
+			CHECK(!first.IsMapped(0, 0, 0) && !first.IsMapped(0, 1, 0) && first.IsMapped(0, 2, 0));
+			CHECK(firstBackend.IsMapped(0, 0, 0));
+			first.Flush();
+			CheckBackendMatches(first, firstBackend);
+			CheckBackendMatches(second, secondBackend);
+
+			// The heap tiles the two mappings use are all different.
+			std::set<uint32_t> heapTiles;
+			for (auto const& mapping : firstBackend.Mapped)
+			{
+				heapTiles.insert(mapping.second);
+			}
+			for (auto const& mapping : secondBackend.Mapped)
+			{
+				heapTiles.insert(mapping.second);
+			}
+			CHECK(heapTiles.size() == 12);
+		}
+		CHECK(pool.GetFreeTileCount() == 5);
+		CHECK(first.Map(1, 0, 0) && pool.GetEvictionCount() == 2);
+	}
+
+	// Random maps and unmaps over two textures, flushed at random: what the backends hold
+	// matches the page tables after every flush, no heap tile backs two tiles, and the
+	// mapped tiles never outnumber the pool.
+	void Churn()
+	{
+		PhysicalTilePool pool(96);
+		MockTileMappingBackend backends[2];
+		VirtualTexture first(c_layout, pool, backends[0]);
+		VirtualTexture second(VirtualTextureLayout{ 1000, 700, 10, 128, 128, 4, 1 }, pool, backends[1]);
+		VirtualTexture* textures[] = { &first, &second };
+
+		std::mt19937 random(11);
+		for (int i = 0; i < 200000; ++i)
+		{
+			VirtualTexture& texture = *textures[random() % 2];
+			const uint32_t mip = random() % texture.GetLayout().StandardMipCount;
+			const uint32_t x = random() % texture.GetTileCountX(mip);
+			const uint32_t y = random() % texture.GetTileCountY(mip);
+			if (random() % 4 == 0)
+			{
+				texture.Unmap(mip, x, y);
+			}
+			else
+			{
+				texture.Map(mip, x, y);
+			}
+
+			if (random() % 500 == 0)
+			{
+				first.Flush();
+				second.Flush();
+				CHECK(first.GetMappedTileCount() + second.GetMappedTileCount() + pool.GetFreeTileCount() == pool.GetTileCount());
+
+				std::set<uint32_t> heapTiles;
+				for (MockTileMappingBackend const& backend : backends)
+				{
+					for (auto const& mapping : backend.Mapped)
+					{
+						heapTiles.insert(mapping.second);
+					}
+				}
+				CHECK(heapTiles.size() == backends[0].Mapped.size() + backends[1].Mapped.size());
+				CheckBackendMatches(first, backends[0]);
+				CheckBackendMatches(second, backends[1]);
+			}
+		}
+		CHECK(pool.GetEvictionCount() > 1000);
+		CHECK(backends[0].DuplicateCount == 0 && backends[1].DuplicateCount == 0);
+	}
+
+	void InvalidLayouts()
+	{
+		PhysicalTilePool pool(2);
+		MockTileMappingBackend backend;
+		CHECK_THROWS(VirtualTexture(VirtualTextureLayout{ 4096, 4096, 13, 0, 128, 6, 3 }, pool, backend), std::invalid_argument);
+		CHECK_THROWS(VirtualTexture(VirtualTextureLayout{ 4096, 4096, 13, 128, 128, 6, 0 }, pool, backend), std::invalid_argument);
+		CHECK_THROWS(VirtualTexture(c_layout, pool, backend), std::runtime_error);
+		CHECK(pool.GetFreeTileCount() == 2);
+	}
+}
+
+int main()
+{
+	const Test::TestCase tests[] =
+	{
+		{ "PackedMipsStayMapped", PackedMipsStayMapped },
+		{ "LeastRecentlyUsedEviction", LeastRecentlyUsedEviction },
+		{ "BatchedMappings", BatchedMappings },
+		{ "SharedPool", SharedPool },
+		{ "Churn", Churn },
+		{ "InvalidLayouts", InvalidLayouts },
+	};
+	return Test::RunTests(tests);
+}
@@ -12,7 +12,6 @@
 
 #include <d3d12.h>
 #include <dxgi1_6.h>
-#include <wincodec.h>
 #include <initguid.h>
 #include <dxgidebug.h>
 #include <DirectXMath.h>